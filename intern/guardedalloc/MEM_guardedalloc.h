@@ -230,6 +230,18 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Keep freed small blocks in a cache of the thread, for reuse by its next allocations.
+ * Only used by the lock-free allocator, can be enabled at any time. */
+void MEM_use_small_block_cache(void);
+
+/* Collect allocation statistics per name (and optionally per callstack).
+ * Only used by the guarded allocator, enable before allocations of interest are made. */
+void MEM_profile_enable(bool use_callstacks);
+/* Write collected statistics, as JSON for `.json` files, otherwise as collapsed stacks
+ * (one line of `frame;frame;name bytes` each), for use with flame graph tools.
+ * Must not be called while other threads allocate memory. */
+bool MEM_profile_write(const char *filepath);
+
 #ifdef __cplusplus
 /* alloc funcs for C++ only */
 #  define MEM_CXX_CLASS_ALLOC_FUNCS(_id) \
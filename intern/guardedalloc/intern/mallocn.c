@@ -127,3 +127,8 @@ void MEM_use_guarded_allocator(void)
   MEM_name_ptr = MEM_guarded_name_ptr;
 #endif
 }
+
+void MEM_use_small_block_cache(void)
+{
+  MEM_lockfree_use_small_block_cache();
+}
@@ -108,6 +108,7 @@ typedef struct MemHead {
   short alignment; /* if non-zero aligned alloc was used
                     * and alignment is stored here.
                     */
+  MemProfileBlock profile; /* only set when profiling is enabled */
 #ifdef DEBUG_MEMCOUNTER
   int _count;
 #endif
@@ -498,6 +499,12 @@ static void make_memhead_header(MemHead *memh, size_t len, const char *str)
 
   mem_lock_thread();
   addtail(membase, &memh->next);
+  if (UNLIKELY(mem_profile_enabled)) {
+    mem_profile_alloc(&memh->profile, str, len);
+  }
+  else {
+    memh->profile.entry_name = NULL;
+  }
   if (memh->next) {
     memh->nextname = MEMNEXT(memh->next)->name;
   }
@@ -1068,6 +1075,9 @@ static void rem_memblock(MemHead *memh)
     else
       MEMNEXT(memh->prev)->nextname = NULL;
   }
+  if (UNLIKELY(mem_profile_enabled)) {
+    mem_profile_free(&memh->profile, memh->len);
+  }
   mem_unlock_thread();
 
   atomic_sub_and_fetch_u(&totblock, 1);
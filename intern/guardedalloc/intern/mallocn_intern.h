@@ -96,6 +96,12 @@ size_t malloc_usable_size(void *ptr);
 #  define MEM_INLINE static inline
 #endif
 
+#ifdef _MSC_VER
+#  define MEM_THREAD_LOCAL __declspec(thread)
+#else
+#  define MEM_THREAD_LOCAL __thread
+#endif
+
 #define IS_POW2(a) (((a) & ((a)-1)) == 0)
 
 /* Extra padding which needs to be applied on MemHead to make it aligned. */
@@ -154,10 +160,22 @@ size_t MEM_lockfree_get_mapped_memory_in_use(void);
 unsigned int MEM_lockfree_get_memory_blocks_in_use(void);
 void MEM_lockfree_reset_peak_memory(void);
 size_t MEM_lockfree_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+void MEM_lockfree_use_small_block_cache(void);
 #ifndef NDEBUG
 const char *MEM_lockfree_name_ptr(void *vmemh);
 #endif
 
+/* Allocation profiling, only used by the guarded allocator. */
+typedef struct MemProfileBlock {
+  struct MemProfileEntry *entry_name;
+  struct MemProfileEntry *entry_callstack;
+  double time;
+} MemProfileBlock;
+
+extern bool mem_profile_enabled;
+void mem_profile_alloc(MemProfileBlock *block, const char *name, size_t len);
+void mem_profile_free(const MemProfileBlock *block, size_t len);
+
 /* Prototypes for fully guarded allocator functions */
 size_t MEM_guarded_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_guarded_freeN(void *vmemh);
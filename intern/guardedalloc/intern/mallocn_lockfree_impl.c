@@ -25,6 +25,10 @@
 #include <stdarg.h>
 #include <sys/types.h>
 
+#ifndef WIN32
+#  include <pthread.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 /* to ensure strict conversions */
@@ -43,8 +47,7 @@ typedef struct MemHeadAligned {
   size_t len;
 } MemHeadAligned;
 
-static unsigned int totblock = 0;
-static size_t mem_in_use = 0, mmap_in_use = 0, peak_mem = 0;
+static size_t mmap_in_use = 0, peak_mem = 0;
 static bool malloc_debug_memset = false;
 
 static void (*error_callback)(const char *) = NULL;
@@ -56,11 +59,17 @@ enum {
   MEMHEAD_ALIGN_FLAG = 2,
 };
 
+/* Allocated with the size of its size class, can be reused from the small block cache. */
+#define MEMHEAD_CACHE_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
 #define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
 #define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t)MEMHEAD_MMAP_FLAG)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_CACHED(memhead) ((memhead)->len & MEMHEAD_CACHE_FLAG)
+#define MEMHEAD_LEN(memhead) \
+  ((memhead)->len & ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG) | MEMHEAD_CACHE_FLAG))
 
 /* Uncomment this to have proper peak counter. */
 #define USE_ATOMIC_MAX
@@ -74,6 +83,201 @@ MEM_INLINE void update_maximum(size_t *maximum_value, size_t value)
 #endif
 }
 
+/* -------------------------------------------------------------------- */
+/* Memory Statistics
+ *
+ * Counters are split in shards (threads use the shard assigned to them on first use),
+ * so parallel allocations don't all update the same cache line.
+ * The totals are summed when they're queried.
+ *
+ * Counters of a shard wrap around when its memory is freed by another thread,
+ * the sum over all shards is still correct.
+ */
+
+#define MEM_STATS_SHARDS 64
+
+/* Update the peak memory after a shard allocated this much more memory,
+ * the peak is accurate to within #MEM_STATS_SHARDS times this. */
+#define MEM_PEAK_UPDATE_SIZE ((size_t)1 << 20)
+
+typedef union MemStatsShard {
+  struct {
+    size_t mem_in_use;
+    /* The value of mem_in_use when the peak memory was last updated. */
+    size_t mem_in_use_peak;
+    unsigned int totblock;
+  } s;
+  /* Avoid false sharing. */
+  char _pad[64];
+} MemStatsShard;
+
+static MemStatsShard stats_shards[MEM_STATS_SHARDS];
+static unsigned int stats_shards_used = 0;
+
+/* The shard used by this thread plus one (zero when not assigned yet). */
+static MEM_THREAD_LOCAL unsigned int stats_shard_thread = 0;
+
+MEM_INLINE MemStatsShard *stats_shard_get(void)
+{
+  if (UNLIKELY(stats_shard_thread == 0)) {
+    stats_shard_thread = (atomic_fetch_and_add_u(&stats_shards_used, 1) % MEM_STATS_SHARDS) + 1;
+  }
+  return &stats_shards[stats_shard_thread - 1];
+}
+
+static size_t stats_mem_in_use(void)
+{
+  size_t mem_in_use = 0;
+  for (int i = 0; i < MEM_STATS_SHARDS; i++) {
+    mem_in_use += stats_shards[i].s.mem_in_use;
+  }
+  return mem_in_use;
+}
+
+static unsigned int stats_totblock(void)
+{
+  unsigned int totblock = 0;
+  for (int i = 0; i < MEM_STATS_SHARDS; i++) {
+    totblock += stats_shards[i].s.totblock;
+  }
+  return totblock;
+}
+
+MEM_INLINE void stats_alloc(size_t len)
+{
+  MemStatsShard *shard = stats_shard_get();
+  atomic_add_and_fetch_u(&shard->s.totblock, 1);
+  const size_t mem_in_use = atomic_add_and_fetch_z(&shard->s.mem_in_use, len);
+  if (UNLIKELY((ptrdiff_t)(mem_in_use - shard->s.mem_in_use_peak) >
+               (ptrdiff_t)MEM_PEAK_UPDATE_SIZE)) {
+    shard->s.mem_in_use_peak = mem_in_use;
+    update_maximum(&peak_mem, stats_mem_in_use());
+  }
+}
+
+MEM_INLINE void stats_free(size_t len)
+{
+  MemStatsShard *shard = stats_shard_get();
+  atomic_sub_and_fetch_u(&shard->s.totblock, 1);
+  const size_t mem_in_use = atomic_sub_and_fetch_z(&shard->s.mem_in_use, len);
+  if ((ptrdiff_t)(mem_in_use - shard->s.mem_in_use_peak) < 0) {
+    shard->s.mem_in_use_peak = mem_in_use;
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Small Block Cache
+ *
+ * Optionally, freed small blocks are kept in a cache of the thread that freed them,
+ * to be reused by allocations of the same size class.
+ * Only blocks allocated while the cache is used have the size of their class
+ * (and #MEMHEAD_CACHE_FLAG set), so the cache can be enabled at any time.
+ *
+ * Cached blocks are counted as freed, the cache is freed when the thread exits.
+ */
+
+#ifndef WIN32
+#  define USE_SMALL_BLOCK_CACHE
+#endif
+
+#ifdef USE_SMALL_BLOCK_CACHE
+
+#  define SMALL_BLOCK_CLASS_SIZE 16
+#  define SMALL_BLOCK_CLASSES 16
+#  define SMALL_BLOCK_SIZE_MAX (SMALL_BLOCK_CLASS_SIZE * SMALL_BLOCK_CLASSES)
+/* Maximum number of cached blocks of each size class. */
+#  define SMALL_BLOCK_CACHE_LEN 64
+
+#  define SMALL_BLOCK_CLASS(len) ((len) ? ((len)-1) / SMALL_BLOCK_CLASS_SIZE : 0)
+#  define SMALL_BLOCK_CLASS_LEN(size_class) (((size_t)(size_class) + 1) * SMALL_BLOCK_CLASS_SIZE)
+
+typedef struct MemThreadCache {
+  /* Linked lists of cached blocks, the next block is stored in the data of the block. */
+  MemHead *blocks[SMALL_BLOCK_CLASSES];
+  unsigned int blocks_len[SMALL_BLOCK_CLASSES];
+} MemThreadCache;
+
+static bool use_small_block_cache = false;
+static MEM_THREAD_LOCAL MemThreadCache *thread_cache = NULL;
+
+/* Only used to free the cache when the thread exits. */
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+
+#  define SMALL_BLOCK_NEXT(memh) (*(MemHead **)PTR_FROM_MEMHEAD(memh))
+
+static void thread_cache_free(void *cache_v)
+{
+  MemThreadCache *cache = cache_v;
+  for (int i = 0; i < SMALL_BLOCK_CLASSES; i++) {
+    MemHead *memh = cache->blocks[i];
+    while (memh) {
+      MemHead *memh_next = SMALL_BLOCK_NEXT(memh);
+      free(memh);
+      memh = memh_next;
+    }
+  }
+  free(cache);
+  thread_cache = NULL;
+}
+
+static void thread_cache_key_create(void)
+{
+  pthread_key_create(&thread_cache_key, thread_cache_free);
+}
+
+static MemThreadCache *thread_cache_ensure(void)
+{
+  if (UNLIKELY(thread_cache == NULL)) {
+    pthread_once(&thread_cache_key_once, thread_cache_key_create);
+    thread_cache = calloc(1, sizeof(*thread_cache));
+    pthread_setspecific(thread_cache_key, thread_cache);
+  }
+  return thread_cache;
+}
+
+/* Allocate a block of the size class of \a len, from the cache when possible. */
+static MemHead *small_block_alloc(size_t len)
+{
+  const size_t size_class = SMALL_BLOCK_CLASS(len);
+  MemThreadCache *cache = thread_cache;
+  MemHead *memh;
+
+  if (cache && cache->blocks[size_class]) {
+    memh = cache->blocks[size_class];
+    cache->blocks[size_class] = SMALL_BLOCK_NEXT(memh);
+    cache->blocks_len[size_class]--;
+  }
+  else {
+    memh = (MemHead *)malloc(SMALL_BLOCK_CLASS_LEN(size_class) + sizeof(MemHead));
+    if (UNLIKELY(memh == NULL)) {
+      return NULL;
+    }
+  }
+  memh->len = len | MEMHEAD_CACHE_FLAG;
+  return memh;
+}
+
+/* Add the block to the cache, returns false when it's full (and the block needs to be freed). */
+static bool small_block_free(MemHead *memh, size_t len)
+{
+  const size_t size_class = SMALL_BLOCK_CLASS(len);
+  MemThreadCache *cache = thread_cache_ensure();
+
+  if (UNLIKELY(cache == NULL) || (cache->blocks_len[size_class] == SMALL_BLOCK_CACHE_LEN)) {
+    return false;
+  }
+  SMALL_BLOCK_NEXT(memh) = cache->blocks[size_class];
+  cache->blocks[size_class] = memh;
+  cache->blocks_len[size_class]++;
+  return true;
+}
+
+#endif /* USE_SMALL_BLOCK_CACHE */
+
+/* -------------------------------------------------------------------- */
+/* Allocation */
+
 #ifdef __GNUC__
 __attribute__((format(printf, 1, 2)))
 #endif
@@ -110,7 +314,7 @@ static void mem_unlock_thread(void)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_LEN(MEMHEAD_FROM_PTR(vmemh));
   }
   else {
     return 0;
@@ -130,8 +334,7 @@ void MEM_lockfree_freeN(void *vmemh)
     return;
   }
 
-  atomic_sub_and_fetch_u(&totblock, 1);
-  atomic_sub_and_fetch_z(&mem_in_use, len);
+  stats_free(len);
 
   if (MEMHEAD_IS_MMAP(memh)) {
     atomic_sub_and_fetch_z(&mmap_in_use, len);
@@ -153,6 +356,13 @@ void MEM_lockfree_freeN(void *vmemh)
       MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
       aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
     }
+#ifdef USE_SMALL_BLOCK_CACHE
+    else if (MEMHEAD_IS_CACHED(memh)) {
+      if (!small_block_free(memh, len)) {
+        free(memh);
+      }
+    }
+#endif
     else {
       free(memh);
     }
@@ -264,20 +474,31 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+#ifdef USE_SMALL_BLOCK_CACHE
+  if (use_small_block_cache && (len <= SMALL_BLOCK_SIZE_MAX)) {
+    memh = small_block_alloc(len);
+    if (LIKELY(memh)) {
+      memset(memh + 1, 0, len);
+    }
+  }
+  else
+#endif
+  {
+    memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
-    memh->len = len;
-    atomic_add_and_fetch_u(&totblock, 1);
-    atomic_add_and_fetch_z(&mem_in_use, len);
-    update_maximum(&peak_mem, mem_in_use);
+    stats_alloc(len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
   print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
               SIZET_ARG(len),
               str,
-              (unsigned int)mem_in_use);
+              (unsigned int)stats_mem_in_use());
   return NULL;
 }
 
@@ -291,7 +512,7 @@ void *MEM_lockfree_calloc_arrayN(size_t len, size_t size, const char *str)
         SIZET_ARG(len),
         SIZET_ARG(size),
         str,
-        (unsigned int)mem_in_use);
+        (unsigned int)stats_mem_in_use());
     abort();
     return NULL;
   }
@@ -305,24 +526,32 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 
   len = SIZET_ALIGN_4(len);
 
-  memh = (MemHead *)malloc(len + sizeof(MemHead));
+#ifdef USE_SMALL_BLOCK_CACHE
+  if (use_small_block_cache && (len <= SMALL_BLOCK_SIZE_MAX)) {
+    memh = small_block_alloc(len);
+  }
+  else
+#endif
+  {
+    memh = (MemHead *)malloc(len + sizeof(MemHead));
+    if (LIKELY(memh)) {
+      memh->len = len;
+    }
+  }
 
   if (LIKELY(memh)) {
     if (UNLIKELY(malloc_debug_memset && len)) {
       memset(memh + 1, 255, len);
     }
 
-    memh->len = len;
-    atomic_add_and_fetch_u(&totblock, 1);
-    atomic_add_and_fetch_z(&mem_in_use, len);
-    update_maximum(&peak_mem, mem_in_use);
+    stats_alloc(len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
   print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
               SIZET_ARG(len),
               str,
-              (unsigned int)mem_in_use);
+              (unsigned int)stats_mem_in_use());
   return NULL;
 }
 
@@ -336,7 +565,7 @@ void *MEM_lockfree_malloc_arrayN(size_t len, size_t size, const char *str)
         SIZET_ARG(len),
         SIZET_ARG(size),
         str,
-        (unsigned int)mem_in_use);
+        (unsigned int)stats_mem_in_use());
     abort();
     return NULL;
   }
@@ -381,16 +610,14 @@ void *MEM_lockfree_mallocN_aligned(size_t len, size_t alignment, const char *str
 
     memh->len = len | (size_t)MEMHEAD_ALIGN_FLAG;
     memh->alignment = (short)alignment;
-    atomic_add_and_fetch_u(&totblock, 1);
-    atomic_add_and_fetch_z(&mem_in_use, len);
-    update_maximum(&peak_mem, mem_in_use);
+    stats_alloc(len);
 
     return PTR_FROM_MEMHEAD(memh);
   }
   print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
               SIZET_ARG(len),
               str,
-              (unsigned int)mem_in_use);
+              (unsigned int)stats_mem_in_use());
   return NULL;
 }
 
@@ -417,11 +644,9 @@ void *MEM_lockfree_mapallocN(size_t len, const char *str)
 
   if (memh != (MemHead *)-1) {
     memh->len = len | (size_t)MEMHEAD_MMAP_FLAG;
-    atomic_add_and_fetch_u(&totblock, 1);
-    atomic_add_and_fetch_z(&mem_in_use, len);
+    stats_alloc(len);
     atomic_add_and_fetch_z(&mmap_in_use, len);
 
-    update_maximum(&peak_mem, mem_in_use);
     update_maximum(&peak_mem, mmap_in_use);
 
     return PTR_FROM_MEMHEAD(memh);
@@ -451,8 +676,9 @@ void MEM_lockfree_callbackmemlist(void (*func)(void *))
 
 void MEM_lockfree_printmemlist_stats(void)
 {
-  printf("\ntotal memory len: %.3f MB\n", (double)mem_in_use / (double)(1024 * 1024));
-  printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+  printf("\ntotal memory len: %.3f MB\n", (double)stats_mem_in_use() / (double)(1024 * 1024));
+  printf("peak memory len: %.3f MB\n",
+         (double)MEM_lockfree_get_peak_memory() / (double)(1024 * 1024));
   printf(
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
@@ -486,7 +712,7 @@ void MEM_lockfree_set_memory_debug(void)
 
 size_t MEM_lockfree_get_memory_in_use(void)
 {
-  return mem_in_use;
+  return stats_mem_in_use();
 }
 
 size_t MEM_lockfree_get_mapped_memory_in_use(void)
@@ -496,20 +722,28 @@ size_t MEM_lockfree_get_mapped_memory_in_use(void)
 
 unsigned int MEM_lockfree_get_memory_blocks_in_use(void)
 {
-  return totblock;
+  return stats_totblock();
 }
 
 /* dummy */
 void MEM_lockfree_reset_peak_memory(void)
 {
-  peak_mem = mem_in_use;
+  peak_mem = stats_mem_in_use();
 }
 
 size_t MEM_lockfree_get_peak_memory(void)
 {
+  update_maximum(&peak_mem, stats_mem_in_use());
   return peak_mem;
 }
 
+void MEM_lockfree_use_small_block_cache(void)
+{
+#ifdef USE_SMALL_BLOCK_CACHE
+  use_small_block_cache = true;
+#endif
+}
+
 #ifndef NDEBUG
 const char *MEM_lockfree_name_ptr(void *vmemh)
 {
@@ -0,0 +1,479 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Allocation profiling for the guarded allocator: statistics of all allocations
+ * aggregated per name (and optionally per callstack), written as JSON or collapsed stacks
+ * (as used by flame graph tools).
+ *
+ * Uses the system allocator, so profiling data isn't profiled itself.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#if defined(WIN32)
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+#  include <execinfo.h>
+#  define USE_CALLSTACKS
+#endif
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "mallocn_intern.h"
+
+/* Frames stored for each callstack (after skipping the allocator's own frames). */
+#define PROFILE_FRAMES_MAX 24
+#define PROFILE_FRAMES_SKIP 3
+
+/* Lifetime histogram buckets, every bucket is 10 times longer than the previous. */
+#define PROFILE_LIFETIME_BUCKETS 8
+#define PROFILE_LIFETIME_MIN 1e-5
+
+static const char *profile_lifetime_names[PROFILE_LIFETIME_BUCKETS] = {
+    "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"};
+
+typedef struct MemProfileEntry {
+  /* Copy of the allocation name. */
+  char *name;
+  /* Callstack, only used for callstack entries. */
+  void **frames;
+  int frames_len;
+  unsigned int hash;
+
+  size_t count;
+  size_t bytes;
+  size_t live_count;
+  size_t live_bytes;
+  size_t peak_bytes;
+  /* Number of freed blocks by lifetime. */
+  size_t lifetime[PROFILE_LIFETIME_BUCKETS];
+} MemProfileEntry;
+
+/* Open addressing hash table. */
+typedef struct MemProfileTable {
+  MemProfileEntry **entries;
+  size_t size;
+  size_t len;
+} MemProfileTable;
+
+/* Avoid hashing names for every allocation, names are usually string literals. */
+#define PROFILE_NAME_CACHE_SIZE 1024
+typedef struct MemProfileNameCache {
+  const char *name;
+  MemProfileEntry *entry;
+} MemProfileNameCache;
+
+static struct {
+  bool use_callstacks;
+  double time_start;
+  MemProfileTable names;
+  MemProfileTable callstacks;
+  MemProfileNameCache name_cache[PROFILE_NAME_CACHE_SIZE];
+} profile = {false};
+
+bool mem_profile_enabled = false;
+
+/* -------------------------------------------------------------------- */
+/* Utilities */
+
+static double profile_time(void)
+{
+#if defined(WIN32)
+  LARGE_INTEGER frequency, count;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static unsigned int profile_hash_string(const char *str)
+{
+  unsigned int hash = 5381;
+  for (; *str; str++) {
+    hash = (hash << 5) + hash + (unsigned int)(unsigned char)*str;
+  }
+  return hash;
+}
+
+static unsigned int profile_hash_frames(unsigned int hash, void **frames, int frames_len)
+{
+  for (int i = 0; i < frames_len; i++) {
+    hash = (hash * 31u) ^ (unsigned int)((uintptr_t)frames[i] >> 4);
+  }
+  return hash;
+}
+
+static bool profile_entry_matches(const MemProfileEntry *entry,
+                                  unsigned int hash,
+                                  const char *name,
+                                  void **frames,
+                                  int frames_len)
+{
+  return (entry->hash == hash) && (entry->frames_len == frames_len) &&
+         (strcmp(entry->name, name) == 0) &&
+         (frames_len == 0 ||
+          memcmp(entry->frames, frames, sizeof(void *) * (size_t)frames_len) == 0);
+}
+
+static void profile_table_insert(MemProfileTable *table, MemProfileEntry *entry)
+{
+  size_t i = entry->hash & (table->size - 1);
+  while (table->entries[i]) {
+    i = (i + 1) & (table->size - 1);
+  }
+  table->entries[i] = entry;
+}
+
+static MemProfileEntry *profile_table_ensure(MemProfileTable *table,
+                                             unsigned int hash,
+                                             const char *name,
+                                             void **frames,
+                                             int frames_len)
+{
+  if (table->size != 0) {
+    for (size_t i = hash & (table->size - 1); table->entries[i]; i = (i + 1) & (table->size - 1)) {
+      if (profile_entry_matches(table->entries[i], hash, name, frames, frames_len)) {
+        return table->entries[i];
+      }
+    }
+  }
+
+  if ((table->len + 1) * 2 > table->size) {
+    MemProfileTable table_old = *table;
+    table->size = table->size ? table->size * 2 : 256;
+    table->entries = calloc(table->size, sizeof(*table->entries));
+    for (size_t i = 0; i < table_old.size; i++) {
+      if (table_old.entries[i]) {
+        profile_table_insert(table, table_old.entries[i]);
+      }
+    }
+    free(table_old.entries);
+  }
+
+  MemProfileEntry *entry = calloc(1, sizeof(*entry));
+  entry->name = strdup(name);
+  entry->hash = hash;
+  if (frames_len != 0) {
+    entry->frames = malloc(sizeof(void *) * (size_t)frames_len);
+    memcpy(entry->frames, frames, sizeof(void *) * (size_t)frames_len);
+    entry->frames_len = frames_len;
+  }
+  profile_table_insert(table, entry);
+  table->len++;
+  return entry;
+}
+
+static MemProfileEntry *profile_name_entry_ensure(const char *name)
+{
+  MemProfileNameCache *cache =
+      &profile.name_cache[((uintptr_t)name >> 3) & (PROFILE_NAME_CACHE_SIZE - 1)];
+  if ((cache->name == name) && (strcmp(cache->entry->name, name) == 0)) {
+    return cache->entry;
+  }
+  cache->name = name;
+  cache->entry = profile_table_ensure(&profile.names, profile_hash_string(name), name, NULL, 0);
+  return cache->entry;
+}
+
+static void profile_entry_alloc(MemProfileEntry *entry, size_t len)
+{
+  entry->count++;
+  entry->bytes += len;
+  entry->live_count++;
+  entry->live_bytes += len;
+  if (entry->live_bytes > entry->peak_bytes) {
+    entry->peak_bytes = entry->live_bytes;
+  }
+}
+
+static void profile_entry_free(MemProfileEntry *entry, size_t len, double lifetime)
+{
+  entry->live_count--;
+  entry->live_bytes -= len;
+
+  int bucket = 0;
+  double limit = PROFILE_LIFETIME_MIN;
+  while ((bucket < PROFILE_LIFETIME_BUCKETS - 1) && (lifetime >= limit)) {
+    bucket++;
+    limit *= 10.0;
+  }
+  entry->lifetime[bucket]++;
+}
+
+/* -------------------------------------------------------------------- */
+/* Allocator Callbacks (called with the allocator locked) */
+
+void mem_profile_alloc(MemProfileBlock *block, const char *name, size_t len)
+{
+  block->entry_name = profile_name_entry_ensure(name);
+  block->entry_callstack = NULL;
+  block->time = profile_time();
+  profile_entry_alloc(block->entry_name, len);
+
+#ifdef USE_CALLSTACKS
+  if (profile.use_callstacks) {
+    void *frames[PROFILE_FRAMES_MAX + PROFILE_FRAMES_SKIP];
+    const int frames_len = backtrace(frames, PROFILE_FRAMES_MAX + PROFILE_FRAMES_SKIP);
+    if (frames_len > PROFILE_FRAMES_SKIP) {
+      void **frames_used = frames + PROFILE_FRAMES_SKIP;
+      const int frames_used_len = frames_len - PROFILE_FRAMES_SKIP;
+      block->entry_callstack = profile_table_ensure(
+          &profile.callstacks,
+          profile_hash_frames(block->entry_name->hash, frames_used, frames_used_len),
+          name,
+          frames_used,
+          frames_used_len);
+      profile_entry_alloc(block->entry_callstack, len);
+    }
+  }
+#endif
+}
+
+void mem_profile_free(const MemProfileBlock *block, size_t len)
+{
+  if (block->entry_name == NULL) {
+    /* Allocated before profiling was enabled. */
+    return;
+  }
+  const double lifetime = profile_time() - block->time;
+  profile_entry_free(block->entry_name, len, lifetime);
+  if (block->entry_callstack) {
+    profile_entry_free(block->entry_callstack, len, lifetime);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Writing */
+
+static int profile_entry_cmp_bytes(const void *a, const void *b)
+{
+  const MemProfileEntry *entry_a = *(const MemProfileEntry **)a;
+  const MemProfileEntry *entry_b = *(const MemProfileEntry **)b;
+  if (entry_a->bytes != entry_b->bytes) {
+    return (entry_a->bytes < entry_b->bytes) ? 1 : -1;
+  }
+  return strcmp(entry_a->name, entry_b->name);
+}
+
+/* Entries of \a table sorted by allocated bytes (largest first), free with `free()`. */
+static MemProfileEntry **profile_table_sorted(const MemProfileTable *table)
+{
+  MemProfileEntry **entries = malloc(sizeof(*entries) * (table->len + 1));
+  size_t len = 0;
+  for (size_t i = 0; i < table->size; i++) {
+    if (table->entries[i]) {
+      entries[len++] = table->entries[i];
+    }
+  }
+  qsort(entries, len, sizeof(*entries), profile_entry_cmp_bytes);
+  return entries;
+}
+
+/* Name of the function of a callstack frame, or the binary & offset when the symbol isn't exported
+ * (which can be resolved with `addr2line`), or the address when nothing else is known. */
+static void profile_frame_name(void *frame, const char *symbol, char *r_name, size_t name_len)
+{
+  /* Symbols are formatted like: "binary(function+0x12) [0x1234]" or "binary(+0x1234) [0x1234]". */
+  const char *start = symbol ? strchr(symbol, '(') : NULL;
+  if (start && (start[1] == '+')) {
+    const char *binary = symbol;
+    for (const char *c = symbol; c < start; c++) {
+      if (*c == '/' || *c == '\\') {
+        binary = c + 1;
+      }
+    }
+    snprintf(r_name,
+             name_len,
+             "%.*s%.*s",
+             (int)(start - binary),
+             binary,
+             (int)strcspn(start + 1, ")"),
+             start + 1);
+  }
+  else if (start && (start[1] != ')')) {
+    snprintf(r_name, name_len, "%.*s", (int)strcspn(start + 1, "+)"), start + 1);
+  }
+  else {
+    snprintf(r_name, name_len, "%p", frame);
+  }
+}
+
+static void profile_write_json_string(FILE *file, const char *str)
+{
+  fputc('"', file);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\') {
+      fprintf(file, "\\%c", *str);
+    }
+    else if ((unsigned char)*str < 0x20) {
+      fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*str);
+    }
+    else {
+      fputc(*str, file);
+    }
+  }
+  fputc('"', file);
+}
+
+static void profile_write_json_entry_stats(FILE *file, const MemProfileEntry *entry)
+{
+  fprintf(file,
+          "\"count\": " SIZET_FORMAT ", \"bytes\": " SIZET_FORMAT ", \"live_count\": " SIZET_FORMAT
+          ", \"live_bytes\": " SIZET_FORMAT ", \"peak_bytes\": " SIZET_FORMAT ", \"lifetime\": [",
+          SIZET_ARG(entry->count),
+          SIZET_ARG(entry->bytes),
+          SIZET_ARG(entry->live_count),
+          SIZET_ARG(entry->live_bytes),
+          SIZET_ARG(entry->peak_bytes));
+  for (int i = 0; i < PROFILE_LIFETIME_BUCKETS; i++) {
+    fprintf(file, i ? ", " SIZET_FORMAT : SIZET_FORMAT, SIZET_ARG(entry->lifetime[i]));
+  }
+  fprintf(file, "]");
+}
+
+static void profile_write_json(FILE *file)
+{
+  fprintf(file,
+          "{\n  \"duration\": %f,\n  \"lifetime_buckets\": [",
+          profile_time() - profile.time_start);
+  for (int i = 0; i < PROFILE_LIFETIME_BUCKETS; i++) {
+    fprintf(file, i ? ", \"%s\"" : "\"%s\"", profile_lifetime_names[i]);
+  }
+  fprintf(file, "],\n  \"names\": [");
+
+  MemProfileEntry **entries = profile_table_sorted(&profile.names);
+  for (size_t i = 0; i < profile.names.len; i++) {
+    fprintf(file, i ? ",\n    {\"name\": " : "\n    {\"name\": ");
+    profile_write_json_string(file, entries[i]->name);
+    fprintf(file, ", ");
+    profile_write_json_entry_stats(file, entries[i]);
+    fprintf(file, "}");
+  }
+  free(entries);
+  fprintf(file, "\n  ],\n  \"callstacks\": [");
+
+  entries = profile_table_sorted(&profile.callstacks);
+  for (size_t i = 0; i < profile.callstacks.len; i++) {
+    MemProfileEntry *entry = entries[i];
+    fprintf(file, i ? ",\n    {\"name\": " : "\n    {\"name\": ");
+    profile_write_json_string(file, entry->name);
+    fprintf(file, ", \"frames\": [");
+#ifdef USE_CALLSTACKS
+    char **symbols = backtrace_symbols(entry->frames, entry->frames_len);
+#else
+    char **symbols = NULL;
+#endif
+    for (int j = 0; j < entry->frames_len; j++) {
+      char frame_name[256];
+      profile_frame_name(
+          entry->frames[j], symbols ? symbols[j] : NULL, frame_name, sizeof(frame_name));
+      fprintf(file, j ? ", " : "");
+      profile_write_json_string(file, frame_name);
+    }
+    free(symbols);
+    fprintf(file, "], ");
+    profile_write_json_entry_stats(file, entry);
+    fprintf(file, "}");
+  }
+  free(entries);
+  fprintf(file, "\n  ]\n}\n");
+}
+
+/* Replace characters with a special meaning in collapsed stacks. */
+static void profile_write_collapsed_name(FILE *file, const char *name)
+{
+  for (; *name; name++) {
+    fputc((*name == ';' || *name == '\n') ? ':' : *name, file);
+  }
+}
+
+/* Lines of semicolon separated frames (outermost first) followed by the allocated bytes. */
+static void profile_write_collapsed(FILE *file)
+{
+  const bool use_callstacks = (profile.callstacks.len != 0);
+  const MemProfileTable *table = use_callstacks ? &profile.callstacks : &profile.names;
+  MemProfileEntry **entries = profile_table_sorted(table);
+
+  for (size_t i = 0; i < table->len; i++) {
+    MemProfileEntry *entry = entries[i];
+#ifdef USE_CALLSTACKS
+    char **symbols = use_callstacks ? backtrace_symbols(entry->frames, entry->frames_len) : NULL;
+#else
+    char **symbols = NULL;
+#endif
+    for (int j = entry->frames_len - 1; j >= 0; j--) {
+      char frame_name[256];
+      profile_frame_name(
+          entry->frames[j], symbols ? symbols[j] : NULL, frame_name, sizeof(frame_name));
+      profile_write_collapsed_name(file, frame_name);
+      fputc(';', file);
+    }
+    free(symbols);
+    profile_write_collapsed_name(file, entry->name);
+    fprintf(file, " " SIZET_FORMAT "\n", SIZET_ARG(entry->bytes));
+  }
+  free(entries);
+}
+
+/* -------------------------------------------------------------------- */
+/* Public API */
+
+void MEM_profile_enable(bool use_callstacks)
+{
+  profile.use_callstacks = use_callstacks;
+  profile.time_start = profile_time();
+  mem_profile_enabled = true;
+}
+
+bool MEM_profile_write(const char *filepath)
+{
+  if (!mem_profile_enabled) {
+    return false;
+  }
+
+  FILE *file = fopen(filepath, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  const size_t filepath_len = strlen(filepath);
+  if ((filepath_len >= 5) && (strcmp(filepath + filepath_len - 5, ".json") == 0)) {
+    profile_write_json(file);
+  }
+  else {
+    profile_write_collapsed(file);
+  }
+
+  return (fclose(file) == 0);
+}
@@ -36,6 +36,63 @@ MimeType=application/x-blender;
 import struct
 
 
+class ChunkedBlendFile:
+    """
+    Read the uncompressed data of a chunked compressed blend file ("BLENDERZ" header),
+    see ``source/blender/blenloader/intern/chunkfile.h`` for the layout.
+    Only deflate chunks are supported, LZO would need a module outside of Python.
+    """
+    __slots__ = ("_file", "_table", "_chunk", "_buf", "_pos")
+
+    @classmethod
+    def open(cls, fileobj):
+        fileobj.seek(0)
+        header = struct.unpack('<8sBBHI', fileobj.read(16))
+        magic, codec = header[0], header[2]
+        if magic != b'BLENDERZ' or codec != 1:  # 1 == deflate
+            return None
+        fileobj.seek(-16, 2)
+        table_offset, chunks_len, magic = struct.unpack('<QI4s', fileobj.read(16))
+        if magic != b'BZCT':
+            return None
+        fileobj.seek(table_offset)
+        table = [struct.unpack('<QII', fileobj.read(16)) for _ in range(chunks_len)]
+        return cls(fileobj, table)
+
+    def __init__(self, fileobj, table):
+        self._file = fileobj
+        self._table = table  # (offset, size, raw_size) for each chunk.
+        self._chunk = 0
+        self._buf = b''
+        self._pos = 0
+
+    def _read_chunk(self):
+        import zlib
+        offset, size, raw_size = self._table[self._chunk]
+        self._chunk += 1
+        self._file.seek(offset)
+        data = self._file.read(size)
+        if size != raw_size:
+            data = zlib.decompress(data)
+        self._buf = self._buf[self._pos:] + data
+        self._pos = 0
+
+    def read(self, size):
+        while len(self._buf) - self._pos < size and self._chunk < len(self._table):
+            self._read_chunk()
+        data = self._buf[self._pos:self._pos + size]
+        self._pos += len(data)
+        return data
+
+    def seek(self, offset, whence=0):
+        # Only skipping forward is needed.
+        assert whence == 1 and offset >= 0
+        self.read(offset)
+
+    def close(self):
+        self._file.close()
+
+
 def open_wrapper_get():
     """ wrap OS specific read functionality here, fallback to 'open()'
     """
@@ -100,6 +157,13 @@ def blend_extract_thumb(path):
         blendfile.close()
         blendfile = gzip.GzipFile('', 'rb', 0, open_wrapper(path, 'rb'))
         head = blendfile.read(12)
+    elif head[0:8] == b'BLENDERZ':  # chunked compression
+        blendfile_chunked = ChunkedBlendFile.open(blendfile)
+        if blendfile_chunked is None:
+            blendfile.close()
+            return None, 0, 0
+        blendfile = blendfile_chunked
+        head = blendfile.read(12)
 
     if not head.startswith(b'BLENDER'):
         blendfile.close()
@@ -31,27 +31,92 @@
 #     int SDNAnr, nr;
 # } BHead;
 
+import struct
+
+
+class ChunkedBlendFile:
+    """
+    Read the uncompressed data of a chunked compressed blend file ("BLENDERZ" header),
+    see ``source/blender/blenloader/intern/chunkfile.h`` for the layout.
+    Only deflate chunks are supported, LZO would need a module outside of Python.
+    """
+    __slots__ = ("_file", "_table", "_chunk", "_buf", "_pos")
+
+    @classmethod
+    def open(cls, fileobj):
+        fileobj.seek(0)
+        header = struct.unpack('<8sBBHI', fileobj.read(16))
+        magic, codec = header[0], header[2]
+        if magic != b'BLENDERZ' or codec != 1:  # 1 == deflate
+            return None
+        fileobj.seek(-16, 2)
+        table_offset, chunks_len, magic = struct.unpack('<QI4s', fileobj.read(16))
+        if magic != b'BZCT':
+            return None
+        fileobj.seek(table_offset)
+        table = [struct.unpack('<QII', fileobj.read(16)) for _ in range(chunks_len)]
+        return cls(fileobj, table)
+
+    def __init__(self, fileobj, table):
+        self._file = fileobj
+        self._table = table  # (offset, size, raw_size) for each chunk.
+        self._chunk = 0
+        self._buf = b''
+        self._pos = 0
+
+    def _read_chunk(self):
+        import zlib
+        offset, size, raw_size = self._table[self._chunk]
+        self._chunk += 1
+        self._file.seek(offset)
+        data = self._file.read(size)
+        if size != raw_size:
+            data = zlib.decompress(data)
+        self._buf = self._buf[self._pos:] + data
+        self._pos = 0
+
+    def read(self, size):
+        while len(self._buf) - self._pos < size and self._chunk < len(self._table):
+            self._read_chunk()
+        data = self._buf[self._pos:self._pos + size]
+        self._pos += len(data)
+        return data
+
+    def seek(self, offset, whence=0):
+        # Only skipping forward is needed.
+        assert whence == 1 and offset >= 0
+        self.read(offset)
+
+    def close(self):
+        self._file.close()
 
-def read_blend_rend_chunk(path):
 
-    import struct
+def read_blend_rend_chunk(path):
 
     blendfile = open(path, "rb")
 
-    head = blendfile.read(7)
+    head = blendfile.read(8)
 
     if head[0:2] == b'\x1f\x8b':  # gzip magic
         import gzip
         blendfile.seek(0)
         blendfile = gzip.open(blendfile, "rb")
-        head = blendfile.read(7)
-
-    if head != b'BLENDER':
+        head = blendfile.read(8)
+    elif head == b'BLENDERZ':  # chunked compression
+        blendfile_chunked = ChunkedBlendFile.open(blendfile)
+        if blendfile_chunked is None:
+            print("unsupported compression:", path)
+            blendfile.close()
+            return []
+        blendfile = blendfile_chunked
+        head = blendfile.read(8)
+
+    if head[0:7] != b'BLENDER':
         print("not a blend file:", path)
         blendfile.close()
         return []
 
-    is_64_bit = (blendfile.read(1) == b'-')
+    is_64_bit = (head[7:8] == b'-')
 
     # true for PPC, false for X86
     is_big_endian = (blendfile.read(1) == b'V')
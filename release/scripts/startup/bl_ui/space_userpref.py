@@ -2158,6 +2158,21 @@ class USERPREF_PT_experimental_usd(ExperimentalPanel, Panel):
         col.operator("wm.url_open", text='Give Feedback', icon='URL').url = url
 
 
+class USERPREF_PT_experimental_performance(ExperimentalPanel, Panel):
+    bl_label = "Performance"
+
+    def draw(self, context):
+        prefs = context.preferences
+        experimental = prefs.experimental
+
+        layout = self.layout
+        layout.use_property_split = True
+        layout.use_property_decorate = False
+
+        col = layout.column()
+        col.prop(experimental, "use_soa_positions", text="Separate Vertex Positions")
+
+
 # -----------------------------------------------------------------------------
 # Class Registration
 
@@ -2244,6 +2259,7 @@ classes = (
 
     USERPREF_PT_experimental_ui,
     USERPREF_PT_experimental_usd,
+    USERPREF_PT_experimental_performance,
 
     # Popovers.
     USERPREF_PT_ndof_settings,
@@ -300,6 +300,10 @@ void BKE_animsys_eval_driver(struct Depsgraph *depsgraph,
 
 void BKE_animsys_update_driver_array(struct ID *id);
 
+/* Check the resolved paths cached by evaluated animation data again on their next evaluation.
+ * Called by the dependency graph when an action is copied again or relations are updated. */
+void BKE_animsys_path_cache_tag_outdated(void);
+
 /* ************************************* */
 
 #ifdef __cplusplus
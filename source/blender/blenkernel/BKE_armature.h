@@ -311,6 +311,13 @@ void BKE_pose_eval_bone(struct Depsgraph *depsgraph,
                         struct Object *object,
                         int pchan_index);
 
+void BKE_pose_eval_bone_batch(struct Depsgraph *depsgraph,
+                              struct Scene *scene,
+                              struct Object *object,
+                              const int *pchan_indices,
+                              const int *level_offsets,
+                              const int levels_len);
+
 void BKE_pose_constraints_evaluate(struct Depsgraph *depsgraph,
                                    struct Scene *scene,
                                    struct Object *object,
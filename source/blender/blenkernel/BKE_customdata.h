@@ -73,6 +73,13 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share the data of the source layers, which are only copied when duplicated for writing,
+   * see #CustomData_duplicate_referenced_layer. Same requirements as #CD_DUPLICATE.
+   * Only for copies of evaluated data: original meshes are written without duplicating
+   * their layers first, so copy-on-write doesn't share layers with them.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -147,13 +154,13 @@ bool CustomData_merge(const struct CustomData *source,
                       eCDAllocType alloctype,
                       int totelem);
 
-/* Reallocate custom data to a new element count.
+/* Reallocate custom data from \a old_size to a new element count.
  * Only affects on data layers which are owned by the CustomData itself,
  * referenced data is kept unchanged,
  *
  * NOTE: Take care of referenced layers by yourself!
  */
-void CustomData_realloc(struct CustomData *data, int totelem);
+void CustomData_realloc(struct CustomData *data, int old_size, int new_size);
 
 /* bmesh version of CustomData_merge; merges the layouts of source and dest,
  * then goes through the mesh and makes sure all the customdata blocks are
@@ -218,6 +225,7 @@ int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
 /* duplicate data of a layer with flag NOFREE, and remove that flag.
+ * Data shared with other custom data (see #CD_SHARE) is duplicated too.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -231,6 +239,7 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const char *name,
                                                   const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
+bool CustomData_is_shared_layer(const struct CustomData *data, int type);
 
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
  * zero for the layer type, so only layer types specified by the mask
@@ -272,10 +281,10 @@ void CustomData_copy_layer_type_data(const struct CustomData *source,
                                      int destination_index,
                                      int count);
 
-/* frees data in a CustomData object
+/* frees data in a CustomData object of \a totelem elements
  * return 1 on success, 0 on failure
  */
-void CustomData_free_elem(struct CustomData *data, int index, int count);
+void CustomData_free_elem(struct CustomData *data, int index, int count, int totelem);
 
 /* interpolates data from one CustomData object to another
  * objects need not be compatible, each source layer is interpolated to the
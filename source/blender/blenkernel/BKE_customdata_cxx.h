@@ -0,0 +1,59 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef __BKE_CUSTOMDATA_CXX_H__
+#define __BKE_CUSTOMDATA_CXX_H__
+
+/** \file
+ * \ingroup bke
+ *
+ * Typed access to custom data layers stored as plain arrays, such as #CD_POSITION.
+ * C code uses #CustomData_get_layer and the accessors of the data-block, e.g.
+ * #BKE_mesh_vert_positions.
+ */
+
+#include "BLI_array_ref.h"
+
+#include "BKE_customdata.h"
+
+/**
+ * Get the first layer of \a type as an array of \a totelem elements,
+ * the array is empty when there is no such layer.
+ */
+template<typename T>
+inline BLI::ArrayRef<T> CustomData_get_layer_array(const CustomData *data,
+                                                   const int type,
+                                                   const int totelem)
+{
+  BLI_assert(CustomData_sizeof(type) == (int)sizeof(T));
+  const T *layer = (const T *)CustomData_get_layer(data, type);
+  return BLI::ArrayRef<T>(layer, (layer != nullptr) ? (uint)totelem : 0);
+}
+
+/**
+ * Same as #CustomData_get_layer_array, but the layer is duplicated first
+ * when it is referenced from another data-block.
+ */
+template<typename T>
+inline BLI::MutableArrayRef<T> CustomData_get_layer_array_for_write(CustomData *data,
+                                                                    const int type,
+                                                                    const int totelem)
+{
+  BLI_assert(CustomData_sizeof(type) == (int)sizeof(T));
+  T *layer = (T *)CustomData_duplicate_referenced_layer(data, type, totelem);
+  return BLI::MutableArrayRef<T>(layer, (layer != nullptr) ? (uint)totelem : 0);
+}
+
+#endif /* __BKE_CUSTOMDATA_CXX_H__ */
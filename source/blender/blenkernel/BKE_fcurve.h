@@ -344,9 +344,17 @@ float evaluate_fcurve_driver(struct PathResolvedRNA *anim_rna,
                              struct FCurve *fcu,
                              struct ChannelDriver *driver_orig,
                              float evaltime);
+void BKE_fcurve_evaluate_samples(struct FCurve *fcu,
+                                 const float *evaltimes,
+                                 float *r_values,
+                                 const int samples_len);
 bool BKE_fcurve_is_empty(struct FCurve *fcu);
 /* evaluate fcurve and store value */
 float calculate_fcurve(struct PathResolvedRNA *anim_rna, struct FCurve *fcu, float evaltime);
+float calculate_fcurve_ex(struct PathResolvedRNA *anim_rna,
+                          struct FCurve *fcu,
+                          float evaltime,
+                          int *segment_hint);
 
 /* ************* F-Curve Samples API ******************** */
 
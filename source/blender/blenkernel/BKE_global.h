@@ -153,6 +153,8 @@ enum {
   G_DEBUG_GPU_FORCE_WORKAROUNDS = (1 << 19), /* force gpu workarounds bypassing detections. */
 
   G_DEBUG_GHOST = (1 << 20), /* Debug GHOST module. */
+
+  G_DEBUG_DEPSGRAPH_VALIDATE = (1 << 21), /* validate incremental depsgraph relations update */
 };
 
 #define G_DEBUG_ALL \
@@ -182,6 +184,11 @@ enum {
   /** On write, restore paths after editing them (G_FILE_RELATIVE_REMAP) */
   G_FILE_SAVE_COPY = (1 << 27),
   /* #define G_FILE_GLSL_NO_ENV_LIGHTING (1 << 28) */ /* deprecated */
+  /**
+   * On write, compress in parallel into chunks (with #G_FILE_COMPRESS),
+   * instead of a single gzip stream. Older versions can't read these files.
+   */
+  G_FILE_COMPRESS_FAST = (1 << 29),
 };
 
 /** Don't overwrite these flags when reading a file. */
@@ -53,6 +53,7 @@ struct MVert;
 struct Main;
 struct MemArena;
 struct Mesh;
+struct MeshElemMap;
 struct ModifierData;
 struct Object;
 struct Scene;
@@ -274,6 +275,12 @@ void BKE_mesh_vert_coords_apply_with_mat4(struct Mesh *mesh,
 void BKE_mesh_vert_coords_apply(struct Mesh *mesh, const float (*vert_coords)[3]);
 void BKE_mesh_vert_normals_apply(struct Mesh *mesh, const short (*vertNormals)[3]);
 
+const float (*BKE_mesh_vert_positions(const struct Mesh *mesh))[3];
+void BKE_mesh_vert_positions_add(struct Mesh *mesh, const float (*vert_coords)[3]);
+float (*BKE_mesh_vert_positions_for_write(struct Mesh *mesh))[3];
+void BKE_mesh_vert_positions_apply(struct Mesh *mesh);
+void BKE_mesh_vert_positions_clear(struct Mesh *mesh);
+
 /* *** mesh_evaluate.c *** */
 
 void BKE_mesh_calc_normals_mapping_simple(struct Mesh *me);
@@ -309,6 +316,17 @@ void BKE_mesh_calc_normals_poly(struct MVert *mverts,
                                 int numPolys,
                                 float (*r_polyNors)[3],
                                 const bool only_face_normals);
+void BKE_mesh_calc_normals_poly_ex(struct MVert *mverts,
+                                   float (*r_vertnors)[3],
+                                   int numVerts,
+                                   const struct MLoop *mloop,
+                                   const struct MPoly *mpolys,
+                                   int numLoops,
+                                   int numPolys,
+                                   float (*r_polyNors)[3],
+                                   const bool only_face_normals,
+                                   const struct MeshElemMap *vert_loop_map);
+const struct MeshElemMap *BKE_mesh_calc_normals_vert_loop_map(struct Mesh *mesh);
 void BKE_mesh_calc_normals(struct Mesh *me);
 void BKE_mesh_ensure_normals(struct Mesh *me);
 void BKE_mesh_ensure_normals_for_display(struct Mesh *mesh);
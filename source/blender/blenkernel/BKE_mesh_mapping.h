@@ -119,6 +119,27 @@ void BKE_mesh_vert_loop_map_create(MeshElemMap **r_map,
                                    int totvert,
                                    int totface,
                                    int totloop);
+void BKE_mesh_vert_loop_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const struct MLoop *mloop,
+                                            int totvert,
+                                            int totloop);
+void BKE_mesh_vert_poly_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const struct MPoly *mpoly,
+                                            const struct MLoop *mloop,
+                                            int totvert,
+                                            int totpoly,
+                                            int totloop);
+void BKE_mesh_vert_edge_map_create_parallel(
+    MeshElemMap **r_map, int **r_mem, const struct MEdge *medge, int totvert, int totedge);
+void BKE_mesh_edge_poly_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const int totedge,
+                                            const struct MPoly *mpoly,
+                                            const int totpoly,
+                                            const struct MLoop *mloop,
+                                            const int totloop);
 void BKE_mesh_vert_looptri_map_create(MeshElemMap **r_map,
                                       int **r_mem,
                                       const struct MVert *mvert,
@@ -35,14 +35,35 @@ struct MLoop;
 struct MLoopTri;
 struct MVertTri;
 struct Mesh;
+struct MeshElemMap;
 struct Object;
 struct Scene;
 
+/** Deform weights packed vertex after vertex, see #BKE_mesh_runtime_vertex_weights_ensure. */
+typedef struct MeshVertexWeights {
+  /** The weights of vertex `i` are `weights[offsets[i]]` to `weights[offsets[i + 1] - 1]`. */
+  int *offsets;
+  /** The weights in the order of #MDeformVert.dw, including zero weights. */
+  struct MDeformWeight *weights;
+
+  /* Deform vertices the weights are copied from. */
+  const struct MDeformVert *dvert;
+  int totvert;
+} MeshVertexWeights;
+
 void BKE_mesh_runtime_reset(struct Mesh *mesh);
 void BKE_mesh_runtime_reset_on_copy(struct Mesh *mesh, const int flag);
 int BKE_mesh_runtime_looptri_len(const struct Mesh *mesh);
 void BKE_mesh_runtime_looptri_recalc(struct Mesh *mesh);
 const struct MLoopTri *BKE_mesh_runtime_looptri_ensure(struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_vert_loop_map_ensure(struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_vert_poly_map_ensure(struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_vert_edge_map_ensure(struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_edge_poly_map_ensure(struct Mesh *mesh);
+void BKE_mesh_runtime_topology_cache_share(struct Mesh *me_dst, const struct Mesh *me_src);
+void BKE_mesh_runtime_topology_cache_clear(struct Mesh *mesh);
+const struct MeshVertexWeights *BKE_mesh_runtime_vertex_weights_ensure(struct Mesh *mesh);
+void BKE_mesh_runtime_vertex_weights_clear(struct Mesh *mesh);
 bool BKE_mesh_runtime_ensure_edit_data(struct Mesh *mesh);
 bool BKE_mesh_runtime_clear_edit_data(struct Mesh *mesh);
 void BKE_mesh_runtime_clear_geometry(struct Mesh *mesh);
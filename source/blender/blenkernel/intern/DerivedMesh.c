@@ -41,6 +41,7 @@
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
+#include "BLI_scratch_arena.h"
 #include "BLI_task.h"
 
 #include "BKE_cdderivedmesh.h"
@@ -809,15 +810,19 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
-      BKE_mesh_calc_normals_poly(mesh_final->mvert,
-                                 NULL,
-                                 mesh_final->totvert,
-                                 mesh_final->mloop,
-                                 mesh_final->mpoly,
-                                 mesh_final->totloop,
-                                 mesh_final->totpoly,
-                                 polynors,
-                                 false);
+      /* Valid vertex normals of referenced or shared vertices are not written again. */
+      const bool only_face_normals = !(mesh_final->runtime.cd_dirty_vert & CD_MASK_NORMAL) &&
+                                     CustomData_is_referenced_layer(&mesh_final->vdata, CD_MVERT);
+      BKE_mesh_calc_normals_poly_ex(mesh_final->mvert,
+                                    NULL,
+                                    mesh_final->totvert,
+                                    mesh_final->mloop,
+                                    mesh_final->mpoly,
+                                    mesh_final->totloop,
+                                    mesh_final->totpoly,
+                                    polynors,
+                                    only_face_normals,
+                                    BKE_mesh_calc_normals_vert_loop_map(mesh_final));
     }
   }
 
@@ -869,6 +874,16 @@ static void mesh_calc_finalize(const Mesh *mesh_input, Mesh *mesh_eval)
   mesh_eval->edit_mesh = mesh_input->edit_mesh;
 }
 
+/* Deformed coordinates are only needed while applying the modifiers. */
+static float (*mesh_vert_coords_alloc_scratch(const Mesh *mesh, int *r_vert_len))[3]
+{
+  float(*vert_coords)[3] = BLI_scratch_alloc_array(
+      (size_t)mesh->totvert, sizeof(*vert_coords), __func__);
+  BKE_mesh_vert_coords_get(mesh, vert_coords);
+  *r_vert_len = mesh->totvert;
+  return vert_coords;
+}
+
 static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
                                 Scene *scene,
                                 Object *ob,
@@ -970,7 +985,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
 
       if (mti->type == eModifierTypeType_OnlyDeform && !sculpt_dyntopo) {
         if (!deformed_verts) {
-          deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
+          deformed_verts = mesh_vert_coords_alloc_scratch(mesh_input, &num_deformed_verts);
         }
         else if (isPrevDeform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
           if (mesh_final == NULL) {
@@ -1087,10 +1102,10 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
           /* Deforming a mesh, read the vertex locations
            * out of the mesh and deform them. Once done with this
            * run of deformers verts will be written back. */
-          deformed_verts = BKE_mesh_vert_coords_alloc(mesh_final, &num_deformed_verts);
+          deformed_verts = mesh_vert_coords_alloc_scratch(mesh_final, &num_deformed_verts);
         }
         else {
-          deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
+          deformed_verts = mesh_vert_coords_alloc_scratch(mesh_input, &num_deformed_verts);
         }
       }
       /* if this is not the last modifier in the stack then recalculate the normals
@@ -1196,7 +1211,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
         mesh_final = mesh_next;
 
         if (deformed_verts) {
-          MEM_freeN(deformed_verts);
+          BLI_scratch_free(deformed_verts);
           deformed_verts = NULL;
         }
       }
@@ -1305,14 +1320,23 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   }
   if (deformed_verts) {
     BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
-    MEM_freeN(deformed_verts);
-    deformed_verts = NULL;
   }
 
   /* Denotes whether the object which the modifier stack came from owns the mesh or whether the
    * mesh is shared across multiple objects since there are no effective modifiers. */
   const bool is_own_mesh = (mesh_final != mesh_input);
 
+  /* Store positions as a plain array if requested, for code which only reads positions.
+   * Deformed positions are copied as is, instead of gathering them from the vertices again. */
+  if ((final_datamask.vmask & CD_MASK_POSITION) && is_own_mesh) {
+    BKE_mesh_vert_positions_add(mesh_final, deformed_verts);
+  }
+
+  if (deformed_verts) {
+    BLI_scratch_free(deformed_verts);
+    deformed_verts = NULL;
+  }
+
   /* Add orco coordinates to final and deformed mesh if requested. */
   if (final_datamask.vmask & CD_MASK_ORCO) {
     /* No need in ORCO layer if the mesh was not deformed or modified: undeformed mesh in this case
@@ -1415,15 +1439,19 @@ static void editbmesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
-      BKE_mesh_calc_normals_poly(mesh_final->mvert,
-                                 NULL,
-                                 mesh_final->totvert,
-                                 mesh_final->mloop,
-                                 mesh_final->mpoly,
-                                 mesh_final->totloop,
-                                 mesh_final->totpoly,
-                                 polynors,
-                                 false);
+      /* Valid vertex normals of referenced or shared vertices are not written again. */
+      const bool only_face_normals = !(mesh_final->runtime.cd_dirty_vert & CD_MASK_NORMAL) &&
+                                     CustomData_is_referenced_layer(&mesh_final->vdata, CD_MVERT);
+      BKE_mesh_calc_normals_poly_ex(mesh_final->mvert,
+                                    NULL,
+                                    mesh_final->totvert,
+                                    mesh_final->mloop,
+                                    mesh_final->mpoly,
+                                    mesh_final->totloop,
+                                    mesh_final->totpoly,
+                                    polynors,
+                                    only_face_normals,
+                                    BKE_mesh_calc_normals_vert_loop_map(mesh_final));
     }
   }
 
@@ -1455,6 +1483,19 @@ static void editbmesh_calc_modifier_final_normals(const Mesh *mesh_input,
   }
 }
 
+/**
+ * Copy of an evaluated mesh sharing its custom data layers, used when only the vertex coordinates
+ * of the copy are changed. Evaluated meshes are only written to after duplicating their layers,
+ * which is not the case for original meshes, so those are never shared.
+ */
+static Mesh *mesh_copy_for_eval_shared(Mesh *mesh_eval)
+{
+  Mesh *result;
+  BKE_id_copy_ex(
+      NULL, &mesh_eval->id, (ID **)&result, (LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE));
+  return result;
+}
+
 static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
                                      Scene *scene,
                                      Object *ob,
@@ -1569,7 +1610,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
       /* apply vertex coordinates or build a DerivedMesh as necessary */
       if (mesh_final) {
         if (deformed_verts) {
-          Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+          Mesh *mesh_tmp = mesh_copy_for_eval_shared(mesh_final);
           if (mesh_final != mesh_cage) {
             BKE_id_free(NULL, mesh_final);
           }
@@ -1653,7 +1694,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
 
     if (r_cage && i == cageIndex) {
       if (mesh_final && deformed_verts) {
-        mesh_cage = BKE_mesh_copy_for_eval(mesh_final, false);
+        mesh_cage = mesh_copy_for_eval_shared(mesh_final);
         BKE_mesh_vert_coords_apply(mesh_cage, deformed_verts);
       }
       else if (mesh_final) {
@@ -1683,7 +1724,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
    * then we need to build one. */
   if (mesh_final) {
     if (deformed_verts) {
-      Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
+      Mesh *mesh_tmp = mesh_copy_for_eval_shared(mesh_final);
       if (mesh_final != mesh_cage) {
         BKE_id_free(NULL, mesh_final);
       }
@@ -37,6 +37,7 @@
 #include "BLI_string_utils.h"
 #include "BLI_math_rotation.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -239,6 +240,102 @@ bool BKE_animdata_set_action(ReportList *reports, ID *id, bAction *act)
   return ok;
 }
 
+/* Resolved Paths Cache ------------------------------- */
+
+/* State of the cached RNA path of an animated property. */
+typedef enum eAnimEvalPathStatus {
+  /* Path has not been resolved yet. */
+  ANIM_EVAL_PATH_UNRESOLVED = 0,
+  /* Path resolved to a property of the owner ID, the cached result is used. */
+  ANIM_EVAL_PATH_RESOLVED,
+  /* Path could not be resolved, the property is skipped. */
+  ANIM_EVAL_PATH_INVALID,
+  /* Path resolved to data of another ID, which can be copied again independently of the owner,
+   * so it is resolved on every evaluation. */
+  ANIM_EVAL_PATH_UNCACHED,
+} eAnimEvalPathStatus;
+
+typedef struct AnimEvalPathChannel {
+  PathResolvedRNA anim_rna;
+  /* eAnimEvalPathStatus. */
+  int status;
+  /* Array index the path was resolved for. */
+  int array_index;
+  /* Keyframe segment of the last evaluation, see #calculate_fcurve_ex. */
+  int segment_hint;
+  /* Value of #animsys_path_cache_generation when the path was found to be invalid. */
+  uint invalid_generation;
+} AnimEvalPathChannel;
+
+/**
+ * Resolved RNA paths of the active action F-Curves and of the drivers of an evaluated
+ * (copy-on-write) AnimData, so paths are not parsed again on every frame.
+ *
+ * Created by #BKE_animsys_update_driver_array when the dependency graph copies the ID, so it is
+ * freed together with the copy whenever animation data changes. Editing the action only copies
+ * the action again, so action channels also keep the paths they were resolved for. These are
+ * only compared with the F-Curves after #BKE_animsys_path_cache_tag_outdated, and the channels
+ * are rebuilt when they do not match anymore.
+ */
+typedef struct AnimEvalPathCache {
+  /* Channels of the active action F-Curves, in list order. */
+  AnimEvalPathChannel *action_channels;
+  /* Paths of the action channels, stored one after another with their null terminators. */
+  char *action_paths;
+  int num_action_channels;
+  /* First F-Curve of the action and value of #animsys_path_cache_generation the action channels
+   * were last checked for. */
+  const FCurve *action_fcurve_first;
+  uint action_generation;
+
+  /* Channels of the drivers, indexed like AnimData.driver_array. Every driver is evaluated by its
+   * own depsgraph operation, which only accesses its own channel. */
+  AnimEvalPathChannel *driver_channels;
+  int num_driver_channels;
+
+  /* Channels of the NLA stack with their resolved properties and default values, kept between
+   * evaluations, and value of #animsys_path_cache_generation they were built for. */
+  struct NlaEvalData *nla_channels;
+  uint nla_generation;
+} AnimEvalPathCache;
+
+/* Incremented when any cached paths might be outdated, see #BKE_animsys_path_cache_tag_outdated.
+ * Caches compare it with the value they were last checked for, so one shared counter is enough
+ * for all evaluated IDs of all dependency graphs. */
+static uint animsys_path_cache_generation = 0;
+
+static uint animsys_path_cache_generation_get(void)
+{
+  return atomic_add_and_fetch_uint32(&animsys_path_cache_generation, 0);
+}
+
+void BKE_animsys_path_cache_tag_outdated(void)
+{
+  atomic_add_and_fetch_uint32(&animsys_path_cache_generation, 1);
+}
+
+static void animsys_nla_cache_free(AnimEvalPathCache *cache);
+
+static void animsys_path_cache_free_action_channels(AnimEvalPathCache *cache)
+{
+  MEM_SAFE_FREE(cache->action_channels);
+  MEM_SAFE_FREE(cache->action_paths);
+  cache->num_action_channels = 0;
+}
+
+static void animsys_path_cache_free(AnimData *adt)
+{
+  AnimEvalPathCache *cache = adt->path_cache;
+  if (cache == NULL) {
+    return;
+  }
+  animsys_path_cache_free_action_channels(cache);
+  MEM_SAFE_FREE(cache->driver_channels);
+  animsys_nla_cache_free(cache);
+  MEM_freeN(cache);
+  adt->path_cache = NULL;
+}
+
 /* Freeing -------------------------------------------- */
 
 /* Free AnimData used by the nominated ID-block, and clear ID-block's AnimData pointer */
@@ -273,6 +370,9 @@ void BKE_animdata_free(ID *id, const bool do_id_user)
       /* free driver array cache */
       MEM_SAFE_FREE(adt->driver_array);
 
+      /* free resolved paths cache */
+      animsys_path_cache_free(adt);
+
       /* free overrides */
       /* TODO... */
 
@@ -341,6 +441,7 @@ AnimData *BKE_animdata_copy(Main *bmain, AnimData *adt, const int flag)
   /* duplicate drivers (F-Curves) */
   copy_fcurves(&dadt->drivers, &adt->drivers);
   dadt->driver_array = NULL;
+  dadt->path_cache = NULL;
 
   /* don't copy overrides */
   BLI_listbase_clear(&dadt->overrides);
@@ -1885,18 +1986,130 @@ static void animsys_write_orig_anim_rna(PointerRNA *ptr,
   }
 }
 
+/* Resolve the path of an animated property, using and updating the cached result of the channel.
+ * The pointer is expected to be the one of the ID owning the cache. */
+static bool animsys_path_channel_resolve(PointerRNA *ptr,
+                                         AnimEvalPathChannel *channel,
+                                         const char *rna_path,
+                                         const int array_index,
+                                         PathResolvedRNA *r_result)
+{
+  switch ((eAnimEvalPathStatus)channel->status) {
+    case ANIM_EVAL_PATH_RESOLVED:
+      *r_result = channel->anim_rna;
+      return true;
+    case ANIM_EVAL_PATH_INVALID: {
+      /* The path might have become valid since, for example when a bone got renamed. */
+      if (channel->invalid_generation == animsys_path_cache_generation_get()) {
+        return false;
+      }
+      break;
+    }
+    case ANIM_EVAL_PATH_UNCACHED:
+      return animsys_store_rna_setting(ptr, rna_path, array_index, r_result);
+    case ANIM_EVAL_PATH_UNRESOLVED:
+      break;
+  }
+
+  if (!animsys_store_rna_setting(ptr, rna_path, array_index, r_result)) {
+    channel->status = ANIM_EVAL_PATH_INVALID;
+    channel->invalid_generation = animsys_path_cache_generation_get();
+    return false;
+  }
+  if (r_result->ptr.owner_id == ptr->owner_id) {
+    channel->anim_rna = *r_result;
+    channel->status = ANIM_EVAL_PATH_RESOLVED;
+  }
+  else {
+    channel->status = ANIM_EVAL_PATH_UNCACHED;
+  }
+  return true;
+}
+
+/* Check whether the action channels of the cache were resolved for the given F-Curves. */
+static bool animsys_path_cache_action_matches(const AnimEvalPathCache *cache,
+                                              const ListBase *list)
+{
+  const AnimEvalPathChannel *channel = cache->action_channels;
+  const char *path = cache->action_paths;
+  int num_channels = 0;
+
+  for (const FCurve *fcu = list->first; fcu; fcu = fcu->next, channel++, num_channels++) {
+    if (num_channels == cache->num_action_channels) {
+      return false;
+    }
+    const char *rna_path = fcu->rna_path ? fcu->rna_path : "";
+    if (channel->array_index != fcu->array_index || !STREQ(path, rna_path)) {
+      return false;
+    }
+    path += strlen(path) + 1;
+  }
+  return num_channels == cache->num_action_channels;
+}
+
+/* Get channels for the given F-Curves of the active action, (re)building them when needed.
+ * The paths are only compared when the action might have been copied again since the last
+ * check, otherwise checking the first F-Curve is enough. */
+static AnimEvalPathChannel *animsys_path_cache_action_channels_ensure(AnimEvalPathCache *cache,
+                                                                      const ListBase *list)
+{
+  const uint generation = animsys_path_cache_generation_get();
+  if (cache->action_channels != NULL && cache->action_fcurve_first == list->first) {
+    if (cache->action_generation == generation) {
+      return cache->action_channels;
+    }
+    if (animsys_path_cache_action_matches(cache, list)) {
+      cache->action_generation = generation;
+      return cache->action_channels;
+    }
+  }
+  animsys_path_cache_free_action_channels(cache);
+
+  int num_channels = 0;
+  size_t paths_len = 0;
+  for (const FCurve *fcu = list->first; fcu; fcu = fcu->next) {
+    paths_len += (fcu->rna_path ? strlen(fcu->rna_path) : 0) + 1;
+    num_channels++;
+  }
+  if (num_channels == 0) {
+    return NULL;
+  }
+
+  cache->action_channels = MEM_calloc_arrayN(
+      num_channels, sizeof(AnimEvalPathChannel), "AnimEvalPathCache action channels");
+  cache->action_paths = MEM_mallocN(paths_len, "AnimEvalPathCache action paths");
+  cache->num_action_channels = num_channels;
+  cache->action_fcurve_first = list->first;
+  cache->action_generation = generation;
+
+  AnimEvalPathChannel *channel = cache->action_channels;
+  char *path = cache->action_paths;
+  for (const FCurve *fcu = list->first; fcu; fcu = fcu->next, channel++) {
+    const char *rna_path = fcu->rna_path ? fcu->rna_path : "";
+    const size_t path_len = strlen(rna_path) + 1;
+    memcpy(path, rna_path, path_len);
+    path += path_len;
+    channel->array_index = fcu->array_index;
+  }
+  return cache->action_channels;
+}
+
 /**
  * Evaluate all the F-Curves in the given list
  * This performs a set of standard checks. If extra checks are required,
  * separate code should be used.
+ *
+ * \param channels: Optional cached paths, one for every F-Curve in the list.
  */
 static void animsys_evaluate_fcurves(PointerRNA *ptr,
                                      ListBase *list,
+                                     AnimEvalPathChannel *channels,
                                      float ctime,
                                      bool flush_to_original)
 {
   /* Calculate then execute each curve. */
-  for (FCurve *fcu = list->first; fcu; fcu = fcu->next) {
+  int index = 0;
+  for (FCurve *fcu = list->first; fcu; fcu = fcu->next, index++) {
     /* Check if this F-Curve doesn't belong to a muted group. */
     if ((fcu->grp != NULL) && (fcu->grp->flag & AGRP_MUTED)) {
       continue;
@@ -1910,8 +2123,17 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
       continue;
     }
     PathResolvedRNA anim_rna;
-    if (animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
-      const float curval = calculate_fcurve(&anim_rna, fcu, ctime);
+    bool resolved;
+    if (channels != NULL) {
+      resolved = animsys_path_channel_resolve(
+          ptr, &channels[index], fcu->rna_path, fcu->array_index, &anim_rna);
+    }
+    else {
+      resolved = animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, &anim_rna);
+    }
+    if (resolved) {
+      int *segment_hint = (channels != NULL) ? &channels[index].segment_hint : NULL;
+      const float curval = calculate_fcurve_ex(&anim_rna, fcu, ctime, segment_hint);
       BKE_animsys_write_rna_setting(&anim_rna, curval);
       if (flush_to_original) {
         animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
@@ -2031,9 +2253,13 @@ void animsys_evaluate_action_group(PointerRNA *ptr, bAction *act, bActionGroup *
   }
 }
 
-/* Evaluate Action (F-Curve Bag) */
+/* Evaluate Action (F-Curve Bag)
+ *
+ * \param path_cache: Optional cache of resolved paths, owned by the ID of the pointer.
+ */
 static void animsys_evaluate_action_ex(PointerRNA *ptr,
                                        bAction *act,
+                                       AnimEvalPathCache *path_cache,
                                        float ctime,
                                        const bool flush_to_original)
 {
@@ -2044,8 +2270,13 @@ static void animsys_evaluate_action_ex(PointerRNA *ptr,
 
   action_idcode_patch_check(ptr->owner_id, act);
 
+  AnimEvalPathChannel *channels = NULL;
+  if (path_cache != NULL) {
+    channels = animsys_path_cache_action_channels_ensure(path_cache, &act->curves);
+  }
+
   /* calculate then execute each curve */
-  animsys_evaluate_fcurves(ptr, &act->curves, ctime, flush_to_original);
+  animsys_evaluate_fcurves(ptr, &act->curves, channels, ctime, flush_to_original);
 }
 
 void animsys_evaluate_action(PointerRNA *ptr,
@@ -2053,7 +2284,7 @@ void animsys_evaluate_action(PointerRNA *ptr,
                              float ctime,
                              const bool flush_to_original)
 {
-  animsys_evaluate_action_ex(ptr, act, ctime, flush_to_original);
+  animsys_evaluate_action_ex(ptr, act, NULL, ctime, flush_to_original);
 }
 
 /* ***************************************** */
@@ -2092,7 +2323,7 @@ static void nlastrip_evaluate_controls(NlaStrip *strip, float ctime, const bool
     RNA_pointer_create(NULL, &RNA_NlaStrip, strip, &strip_ptr);
 
     /* execute these settings as per normal */
-    animsys_evaluate_fcurves(&strip_ptr, &strip->fcurves, ctime, flush_to_original);
+    animsys_evaluate_fcurves(&strip_ptr, &strip->fcurves, NULL, ctime, flush_to_original);
   }
 
   /* analytically generate values for influence and time (if applicable)
@@ -2418,6 +2649,18 @@ static void nlaeval_snapshot_free_data(NlaEvalSnapshot *snapshot)
   snapshot->channels = NULL;
 }
 
+/* Reset all channel values to the ones of the base snapshot, keeping the allocated memory. */
+static void nlaeval_snapshot_reset(NlaEvalSnapshot *snapshot)
+{
+  for (int i = 0; i < snapshot->size; i++) {
+    NlaEvalChannelSnapshot *nec_snapshot = snapshot->channels[i];
+    if (nec_snapshot != NULL) {
+      NlaEvalChannel *nec = nec_snapshot->channel;
+      nlaevalchan_snapshot_copy(nec_snapshot, nlaeval_snapshot_find_channel(snapshot->base, nec));
+    }
+  }
+}
+
 /* ---------------------- */
 
 /* Free memory owned by this evaluation channel. */
@@ -2430,6 +2673,31 @@ static void nlaevalchan_free_data(NlaEvalChannel *nec)
   }
 }
 
+/* Channel affected by an F-Curve of an action, see #NlaEvalActionChannels. */
+typedef struct NlaEvalActionCurve {
+  /* NULL when the curve is skipped or its path can't be resolved. */
+  NlaEvalChannel *nec;
+  int array_index;
+  bool skip;
+} NlaEvalActionCurve;
+
+/* Channels affected by the F-Curves of an action, so the channels don't have to be looked up by
+ * path on every evaluation. Only valid as long as the action isn't copied again by the dependency
+ * graph, see #animsys_nla_cache_ensure. */
+typedef struct NlaEvalActionChannels {
+  /* One for every F-Curve of the action, in list order. */
+  NlaEvalActionCurve *curves;
+  int num_curves;
+} NlaEvalActionChannels;
+
+static void nlaeval_action_channels_free(void *action_channels_v)
+{
+  NlaEvalActionChannels *action_channels = action_channels_v;
+
+  MEM_SAFE_FREE(action_channels->curves);
+  MEM_freeN(action_channels);
+}
+
 /* Initialize a full NLA evaluation state structure. */
 static void nlaeval_init(NlaEvalData *nlaeval)
 {
@@ -2456,6 +2724,10 @@ static void nlaeval_free(NlaEvalData *nlaeval)
   BLI_freelistN(&nlaeval->channels);
   BLI_ghash_free(nlaeval->path_hash, NULL, NULL);
   BLI_ghash_free(nlaeval->key_hash, NULL, NULL);
+
+  if (nlaeval->action_channels != NULL) {
+    BLI_ghash_free(nlaeval->action_channels, NULL, nlaeval_action_channels_free);
+  }
 }
 
 /* ---------------------- */
@@ -2663,6 +2935,10 @@ static NlaEvalChannel *nlaevalchan_verify(PointerRNA *ptr, NlaEvalData *nlaeval,
     return NULL;
   }
 
+  if (key.ptr.owner_id != ptr->owner_id) {
+    nlaeval->has_foreign_channels = true;
+  }
+
   NlaEvalChannel *nec = nlaevalchan_verify_key(nlaeval, path, &key);
 
   if (nec->rna_path == NULL) {
@@ -2674,6 +2950,56 @@ static NlaEvalChannel *nlaevalchan_verify(PointerRNA *ptr, NlaEvalData *nlaeval,
 
 /* ---------------------- */
 
+/* Check whether the F-Curve doesn't take part in NLA evaluation. */
+static bool nlaeval_fcurve_is_skipped(FCurve *fcu)
+{
+  if (fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED)) {
+    return true;
+  }
+  if ((fcu->grp) && (fcu->grp->flag & AGRP_MUTED)) {
+    return true;
+  }
+  return BKE_fcurve_is_empty(fcu);
+}
+
+/* Get the channels affected by the F-Curves of the action, creating them when needed.
+ * Only for evaluation data which is kept between evaluations. */
+static NlaEvalActionChannels *nlaeval_action_channels_ensure(PointerRNA *ptr,
+                                                             NlaEvalData *nlaeval,
+                                                             bAction *act)
+{
+  BLI_assert(nlaeval->action_channels != NULL);
+
+  NlaEvalActionChannels **p_action_channels;
+  if (BLI_ghash_ensure_p(nlaeval->action_channels, act, (void ***)&p_action_channels)) {
+    return *p_action_channels;
+  }
+
+  NlaEvalActionChannels *action_channels = MEM_callocN(sizeof(NlaEvalActionChannels),
+                                                       "NlaEvalActionChannels");
+  *p_action_channels = action_channels;
+
+  action_channels->num_curves = BLI_listbase_count(&act->curves);
+  if (action_channels->num_curves == 0) {
+    return action_channels;
+  }
+
+  action_channels->curves = MEM_calloc_arrayN(
+      action_channels->num_curves, sizeof(NlaEvalActionCurve), "NlaEvalActionChannels curves");
+
+  NlaEvalActionCurve *curve = action_channels->curves;
+  for (FCurve *fcu = act->curves.first; fcu; fcu = fcu->next, curve++) {
+    curve->array_index = fcu->array_index;
+    curve->skip = nlaeval_fcurve_is_skipped(fcu);
+    if (!curve->skip) {
+      curve->nec = nlaevalchan_verify(ptr, nlaeval, fcu->rna_path);
+    }
+  }
+  return action_channels;
+}
+
+/* ---------------------- */
+
 /* accumulate the old and new values of a channel according to mode and influence */
 static float nla_blend_value(int blendmode, float old_value, float value, float inf)
 {
@@ -3067,6 +3393,78 @@ static void nlaeval_fmodifiers_split_stacks(ListBase *list1, ListBase *list2)
 
 /* ---------------------- */
 
+/* Evaluate the F-Curves of an action-clip strip which affect a channel, including the modifiers
+ * of the strip. Values of the other curves are left untouched. */
+static void nlastrip_evaluate_actionclip_fcurves(NlaStrip *strip,
+                                                 ListBase *modifiers,
+                                                 const NlaEvalActionChannels *action_channels,
+                                                 float *r_values)
+{
+  /* evaluate strip's modifiers which modify time to evaluate the base curves at */
+  FModifiersStackStorage storage;
+  storage.modifier_count = BLI_listbase_count(modifiers);
+  storage.size_per_modifier = evaluate_fmodifiers_storage_size_per_modifier(modifiers);
+  storage.buffer = alloca(storage.modifier_count * storage.size_per_modifier);
+
+  const float evaltime = evaluate_time_fmodifiers(
+      &storage, modifiers, NULL, 0.0f, strip->strip_time);
+
+  const NlaEvalActionCurve *curve = action_channels->curves;
+  int index = 0;
+  for (FCurve *fcu = strip->act->curves.first; fcu; fcu = fcu->next, curve++, index++) {
+    if (curve->nec == NULL) {
+      continue;
+    }
+
+    /* Same as in #nlastrip_evaluate_actionclip. */
+    float value = evaluate_fcurve(fcu, evaltime);
+    evaluate_value_fmodifiers(&storage, modifiers, fcu, &value, strip->strip_time);
+    r_values[index] = value;
+  }
+}
+
+/* Evaluate an action-clip strip using the channels of its action found earlier. */
+static void nlastrip_evaluate_actionclip_cached(PointerRNA *ptr,
+                                                NlaEvalData *channels,
+                                                ListBase *modifiers,
+                                                NlaEvalStrip *nes,
+                                                NlaEvalSnapshot *snapshot)
+{
+  NlaStrip *strip = nes->strip;
+  NlaEvalActionChannels *action_channels = nlaeval_action_channels_ensure(
+      ptr, channels, strip->act);
+
+  if (action_channels->num_curves == 0) {
+    return;
+  }
+
+  /* Use values evaluated ahead when available, see #nlastrips_evaluate_fcurves. */
+  float *values = nes->fcurve_values;
+  if (values == NULL) {
+    values = MEM_malloc_arrayN(action_channels->num_curves, sizeof(float), __func__);
+    nlastrip_evaluate_actionclip_fcurves(strip, modifiers, action_channels, values);
+  }
+
+  NlaBlendData blend = {
+      .snapshot = snapshot,
+      .mode = strip->blendmode,
+      .influence = strip->influence,
+  };
+
+  for (int i = 0; i < action_channels->num_curves; i++) {
+    const NlaEvalActionCurve *curve = &action_channels->curves[i];
+    if (curve->nec != NULL) {
+      nlaeval_blend_value(&blend, curve->nec, curve->array_index, values[i]);
+    }
+  }
+
+  nlaeval_blend_flush(&blend);
+
+  if (values != nes->fcurve_values) {
+    MEM_freeN(values);
+  }
+}
+
 /* evaluate action-clip strip */
 static void nlastrip_evaluate_actionclip(PointerRNA *ptr,
                                          NlaEvalData *channels,
@@ -3094,6 +3492,12 @@ static void nlastrip_evaluate_actionclip(PointerRNA *ptr,
   /* join this strip's modifiers to the parent's modifiers (own modifiers first) */
   nlaeval_fmodifiers_join_stacks(&tmp_modifiers, &strip->modifiers, modifiers);
 
+  if (channels->action_channels != NULL) {
+    nlastrip_evaluate_actionclip_cached(ptr, channels, &tmp_modifiers, nes, snapshot);
+    nlaeval_fmodifiers_split_stacks(&strip->modifiers, modifiers);
+    return;
+  }
+
   /* evaluate strip's modifiers which modify time to evaluate the base curves at */
   FModifiersStackStorage storage;
   storage.modifier_count = BLI_listbase_count(&tmp_modifiers);
@@ -3190,6 +3594,7 @@ static void nlastrip_evaluate_transition(PointerRNA *ptr,
    *   which allows us to appear to be 'interpolating' between the two extremes
    */
   tmp_nes = *nes;
+  tmp_nes.fcurve_values = NULL;
 
   /* evaluate these strips into a temp-buffer (tmp_channels) */
   /* FIXME: modifier evaluation here needs some work... */
@@ -3330,6 +3735,25 @@ void nladata_flush_channels(PointerRNA *ptr,
 
 /* ---------------------- */
 
+static void nla_eval_domain_channel(NlaEvalChannel *nec, int array_index)
+{
+  if (nec == NULL) {
+    return;
+  }
+
+  /* For quaternion properties, enable all sub-channels. */
+  if (nec->mix_mode == NEC_MIX_QUATERNION) {
+    BLI_bitmap_set_all(nec->valid.ptr, true, 4);
+    return;
+  }
+
+  int idx = nlaevalchan_validate_index(nec, array_index);
+
+  if (idx >= 0) {
+    BLI_BITMAP_ENABLE(nec->valid.ptr, idx);
+  }
+}
+
 static void nla_eval_domain_action(PointerRNA *ptr,
                                    NlaEvalData *channels,
                                    bAction *act,
@@ -3339,33 +3763,26 @@ static void nla_eval_domain_action(PointerRNA *ptr,
     return;
   }
 
+  /* Data kept between evaluations also finds the channels of the F-Curves here. */
+  if (channels->action_channels != NULL) {
+    NlaEvalActionChannels *action_channels = nlaeval_action_channels_ensure(ptr, channels, act);
+
+    for (int i = 0; i < action_channels->num_curves; i++) {
+      const NlaEvalActionCurve *curve = &action_channels->curves[i];
+      nla_eval_domain_channel(curve->nec, curve->array_index);
+    }
+    return;
+  }
+
   for (FCurve *fcu = act->curves.first; fcu; fcu = fcu->next) {
     /* check if this curve should be skipped */
-    if (fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED)) {
-      continue;
-    }
-    if ((fcu->grp) && (fcu->grp->flag & AGRP_MUTED)) {
-      continue;
-    }
-    if (BKE_fcurve_is_empty(fcu)) {
+    if (nlaeval_fcurve_is_skipped(fcu)) {
       continue;
     }
 
     NlaEvalChannel *nec = nlaevalchan_verify(ptr, channels, fcu->rna_path);
 
-    if (nec != NULL) {
-      /* For quaternion properties, enable all sub-channels. */
-      if (nec->mix_mode == NEC_MIX_QUATERNION) {
-        BLI_bitmap_set_all(nec->valid.ptr, true, 4);
-        continue;
-      }
-
-      int idx = nlaevalchan_validate_index(nec, fcu->array_index);
-
-      if (idx >= 0) {
-        BLI_BITMAP_ENABLE(nec->valid.ptr, idx);
-      }
-    }
+    nla_eval_domain_channel(nec, fcu->array_index);
   }
 }
 
@@ -3422,6 +3839,87 @@ static void animsys_evaluate_nla_domain(PointerRNA *ptr, NlaEvalData *channels,
 
 /* ---------------------- */
 
+/* Action-clip strips with fewer F-Curves than this in total are evaluated on a single thread. */
+#define NLA_PARALLEL_FCURVES_MIN 256
+
+typedef struct NlaEvalFCurvesData {
+  NlaEvalStrip **strips;
+  NlaEvalActionChannels **action_channels;
+} NlaEvalFCurvesData;
+
+static void nlastrips_evaluate_fcurves_cb(void *__restrict userdata,
+                                          const int index,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  NlaEvalFCurvesData *data = userdata;
+  NlaEvalStrip *nes = data->strips[index];
+
+  /* Strips of the stack itself have no parent modifiers. */
+  nlastrip_evaluate_actionclip_fcurves(
+      nes->strip, &nes->strip->modifiers, data->action_channels[index], nes->fcurve_values);
+}
+
+/**
+ * Evaluate the F-Curves of the action-clip strips of the stack in parallel, ahead of blending
+ * them in order (which depends on the result of the strips below).
+ *
+ * The values are stored in the evaluation strips and freed together with them.
+ * Only for evaluation data which is kept between evaluations.
+ */
+static void nlastrips_evaluate_fcurves(PointerRNA *ptr, NlaEvalData *channels, ListBase *estrips)
+{
+  const int max_strips = BLI_listbase_count(estrips);
+  if (max_strips < 2) {
+    return;
+  }
+
+  NlaEvalFCurvesData data;
+  data.strips = MEM_malloc_arrayN(max_strips, sizeof(NlaEvalStrip *), __func__);
+  data.action_channels = MEM_malloc_arrayN(max_strips, sizeof(NlaEvalActionChannels *), __func__);
+
+  /* Find the channels first, this can't run in parallel. */
+  int num_strips = 0;
+  int num_fcurves = 0;
+  for (NlaEvalStrip *nes = estrips->first; nes; nes = nes->next) {
+    NlaStrip *strip = nes->strip;
+    if (strip->type != NLASTRIP_TYPE_CLIP || strip->act == NULL ||
+        (strip->flag & NLASTRIP_FLAG_EDIT_TOUCHED)) {
+      continue;
+    }
+
+    action_idcode_patch_check(ptr->owner_id, strip->act);
+
+    NlaEvalActionChannels *action_channels = nlaeval_action_channels_ensure(
+        ptr, channels, strip->act);
+    if (action_channels->num_curves == 0) {
+      continue;
+    }
+
+    nes->fcurve_values = MEM_malloc_arrayN(
+        action_channels->num_curves, sizeof(float), "NlaEvalStrip fcurve_values");
+    data.strips[num_strips] = nes;
+    data.action_channels[num_strips] = action_channels;
+    num_strips++;
+    num_fcurves += action_channels->num_curves;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num_strips > 1 && num_fcurves >= NLA_PARALLEL_FCURVES_MIN);
+  BLI_task_parallel_range(0, num_strips, &data, nlastrips_evaluate_fcurves_cb, &settings);
+
+  MEM_freeN(data.strips);
+  MEM_freeN(data.action_channels);
+}
+
+static void nlastrips_free(ListBase *estrips)
+{
+  for (NlaEvalStrip *nes = estrips->first; nes; nes = nes->next) {
+    MEM_SAFE_FREE(nes->fcurve_values);
+  }
+  BLI_freelistN(estrips);
+}
+
 /**
  * NLA Evaluation function - values are calculated and stored in temporary "NlaEvalChannels"
  *
@@ -3581,12 +4079,15 @@ static bool animsys_evaluate_nla(NlaEvalData *echannels,
 
   /* 2. for each strip, evaluate then accumulate on top of existing channels,
    * but don't set values yet. */
+  if (echannels->action_channels != NULL) {
+    nlastrips_evaluate_fcurves(ptr, echannels, &estrips);
+  }
   for (nes = estrips.first; nes; nes = nes->next) {
     nlastrip_evaluate(ptr, echannels, NULL, nes, &echannels->eval_snapshot, flush_to_original);
   }
 
   /* 3. free temporary evaluation data that's not used elsewhere */
-  BLI_freelistN(&estrips);
+  nlastrips_free(&estrips);
   return true;
 }
 
@@ -3594,22 +4095,85 @@ static bool animsys_evaluate_nla(NlaEvalData *echannels,
  * - All channels that will be affected are not cleared anymore. Instead, we just evaluate into
  *   some temp channels, where values can be accumulated in one go.
  */
+static void animsys_nla_cache_free(AnimEvalPathCache *cache)
+{
+  if (cache->nla_channels != NULL) {
+    nlaeval_free(cache->nla_channels);
+    MEM_freeN(cache->nla_channels);
+    cache->nla_channels = NULL;
+  }
+}
+
+/**
+ * Get the NLA channels kept in the cache, ready for evaluation.
+ *
+ * All channels (and the channels of all actions) are found when the data is built, so only the
+ * values of the result are reset on later evaluations. The data points to the F-Curves and their
+ * paths, and uses the actions as keys, so it is rebuilt as a whole after any action was copied
+ * again or freed (without accessing the actions it was built for).
+ */
+static NlaEvalData *animsys_nla_cache_ensure(PointerRNA *ptr,
+                                             AnimData *adt,
+                                             AnimEvalPathCache *cache)
+{
+  NlaEvalData *nlaeval = cache->nla_channels;
+  const uint generation = animsys_path_cache_generation_get();
+
+  if (nlaeval != NULL && cache->nla_generation != generation) {
+    animsys_nla_cache_free(cache);
+    nlaeval = NULL;
+  }
+
+  if (nlaeval != NULL) {
+    nlaeval_snapshot_reset(&nlaeval->eval_snapshot);
+    return nlaeval;
+  }
+
+  nlaeval = cache->nla_channels = MEM_mallocN(sizeof(NlaEvalData), "NlaEvalData cache");
+  cache->nla_generation = generation;
+  nlaeval_init(nlaeval);
+  nlaeval->action_channels = BLI_ghash_ptr_new("NlaEvalData::action_channels");
+
+  /* Channels touched by currently inactive actions are reset to their default value on every
+   * evaluation anyway, so find all of them now. */
+  animsys_evaluate_nla_domain(ptr, nlaeval, adt);
+
+  return nlaeval;
+}
+
+/* NLA Evaluation function (mostly for use through do_animdata)
+ * - All channels that will be affected are not cleared anymore. Instead, we just evaluate into
+ *   some temp channels, where values can be accumulated in one go.
+ *
+ * \param path_cache: Optional cache owned by the ID of the pointer, to keep channels in.
+ */
 static void animsys_calculate_nla(PointerRNA *ptr,
                                   AnimData *adt,
+                                  AnimEvalPathCache *path_cache,
                                   float ctime,
                                   const bool flush_to_original)
 {
-  NlaEvalData echannels;
+  NlaEvalData echannels_buf;
+  NlaEvalData *echannels;
 
-  nlaeval_init(&echannels);
+  if (path_cache != NULL) {
+    echannels = animsys_nla_cache_ensure(ptr, adt, path_cache);
+  }
+  else {
+    echannels = &echannels_buf;
+    nlaeval_init(echannels);
+  }
 
   /* evaluate the NLA stack, obtaining a set of values to flush */
-  if (animsys_evaluate_nla(&echannels, ptr, adt, ctime, flush_to_original, NULL)) {
-    /* reset any channels touched by currently inactive actions to default value */
-    animsys_evaluate_nla_domain(ptr, &echannels, adt);
+  if (animsys_evaluate_nla(echannels, ptr, adt, ctime, flush_to_original, NULL)) {
+    /* reset any channels touched by currently inactive actions to default value
+     * (kept channels include those already) */
+    if (path_cache == NULL) {
+      animsys_evaluate_nla_domain(ptr, echannels, adt);
+    }
 
     /* flush effects of accumulating channels in NLA to the actual data they affect */
-    nladata_flush_channels(ptr, &echannels, &echannels.eval_snapshot, flush_to_original);
+    nladata_flush_channels(ptr, echannels, &echannels->eval_snapshot, flush_to_original);
   }
   else {
     /* special case - evaluate as if there isn't any NLA data */
@@ -3618,11 +4182,18 @@ static void animsys_calculate_nla(PointerRNA *ptr,
       CLOG_WARN(&LOG, "NLA Eval: Stopgap for active action on NLA Stack - no strips case");
     }
 
-    animsys_evaluate_action(ptr, adt->action, ctime, flush_to_original);
+    animsys_evaluate_action_ex(ptr, adt->action, path_cache, ctime, flush_to_original);
   }
 
   /* free temp data */
-  nlaeval_free(&echannels);
+  if (path_cache == NULL) {
+    nlaeval_free(echannels);
+  }
+  else if (echannels->has_foreign_channels) {
+    /* Other IDs can be copied again independently of this one, so pointers to their properties
+     * can't be kept. */
+    animsys_nla_cache_free(path_cache);
+  }
 }
 
 /* ---------------------- */
@@ -3853,8 +4424,13 @@ static void animsys_evaluate_overrides(PointerRNA *ptr, AnimData *adt)
  * and that the flags for which parts of the anim-data settings need to be recalculated
  * have been set already by the depsgraph. Now, we use the recalc
  */
-void BKE_animsys_evaluate_animdata(
-    Scene *scene, ID *id, AnimData *adt, float ctime, short recalc, const bool flush_to_original)
+static void animsys_evaluate_animdata_ex(Scene *scene,
+                                         ID *id,
+                                         AnimData *adt,
+                                         float ctime,
+                                         short recalc,
+                                         const bool flush_to_original,
+                                         const bool use_path_cache)
 {
   PointerRNA id_ptr;
 
@@ -3872,16 +4448,20 @@ void BKE_animsys_evaluate_animdata(
    */
   /* TODO: need to double check that this all works correctly */
   if (recalc & ADT_RECALC_ANIM) {
+    /* Only the evaluation owning the ID may update its cache, other users (like sub-frame
+     * evaluation of physics) can run from multiple threads. */
+    AnimEvalPathCache *path_cache = use_path_cache ? adt->path_cache : NULL;
+
     /* evaluate NLA data */
     if ((adt->nla_tracks.first) && !(adt->flag & ADT_NLA_EVAL_OFF)) {
       /* evaluate NLA-stack
        * - active action is evaluated as part of the NLA stack as the last item
        */
-      animsys_calculate_nla(&id_ptr, adt, ctime, flush_to_original);
+      animsys_calculate_nla(&id_ptr, adt, path_cache, ctime, flush_to_original);
     }
     /* evaluate Active Action only */
     else if (adt->action) {
-      animsys_evaluate_action_ex(&id_ptr, adt->action, ctime, flush_to_original);
+      animsys_evaluate_action_ex(&id_ptr, adt->action, path_cache, ctime, flush_to_original);
     }
   }
 
@@ -3910,6 +4490,12 @@ void BKE_animsys_evaluate_animdata(
   }
 }
 
+void BKE_animsys_evaluate_animdata(
+    Scene *scene, ID *id, AnimData *adt, float ctime, short recalc, const bool flush_to_original)
+{
+  animsys_evaluate_animdata_ex(scene, id, adt, ctime, recalc, flush_to_original, false);
+}
+
 /* Evaluation of all ID-blocks with Animation Data blocks - Animation Data Only
  *
  * This will evaluate only the animation info available in the animation data-blocks
@@ -4066,7 +4652,7 @@ void BKE_animsys_eval_animdata(Depsgraph *depsgraph, ID *id)
   Scene *scene = NULL;
   DEG_debug_print_eval_time(depsgraph, __func__, id->name, id, ctime);
   const bool flush_to_original = DEG_is_active(depsgraph);
-  BKE_animsys_evaluate_animdata(scene, id, adt, ctime, ADT_RECALC_ANIM, flush_to_original);
+  animsys_evaluate_animdata_ex(scene, id, adt, ctime, ADT_RECALC_ANIM, flush_to_original, true);
 }
 
 void BKE_animsys_update_driver_array(ID *id)
@@ -4087,6 +4673,21 @@ void BKE_animsys_update_driver_array(ID *id)
       adt->driver_array[driver_index++] = fcu;
     }
   }
+
+  /* Resolved paths of the animated properties, filled in on their first evaluation.
+   * Allocated here so driver evaluation (which runs threaded) only has to fill its own channel. */
+  if (adt && (adt->action || adt->drivers.first || adt->nla_tracks.first)) {
+    BLI_assert(!adt->path_cache);
+
+    AnimEvalPathCache *cache = MEM_callocN(sizeof(AnimEvalPathCache), "AnimEvalPathCache");
+    if (adt->drivers.first) {
+      cache->num_driver_channels = BLI_listbase_count(&adt->drivers);
+      cache->driver_channels = MEM_calloc_arrayN(cache->num_driver_channels,
+                                                 sizeof(AnimEvalPathChannel),
+                                                 "AnimEvalPathCache driver channels");
+    }
+    adt->path_cache = cache;
+  }
 }
 
 void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCurve *fcu_orig)
@@ -4125,7 +4726,16 @@ void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCu
       // printf("\told val = %f\n", fcu->curval);
 
       PathResolvedRNA anim_rna;
-      if (animsys_store_rna_setting(&id_ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
+      bool resolved;
+      if (adt->path_cache && driver_index < adt->path_cache->num_driver_channels) {
+        AnimEvalPathChannel *channel = &adt->path_cache->driver_channels[driver_index];
+        resolved = animsys_path_channel_resolve(
+            &id_ptr, channel, fcu->rna_path, fcu->array_index, &anim_rna);
+      }
+      else {
+        resolved = animsys_store_rna_setting(&id_ptr, fcu->rna_path, fcu->array_index, &anim_rna);
+      }
+      if (resolved) {
         /* Evaluate driver, and write results to COW-domain destination */
         const float ctime = DEG_get_ctime(depsgraph);
         const float curval = calculate_fcurve(&anim_rna, fcu, ctime);
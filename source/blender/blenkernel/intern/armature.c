@@ -61,6 +61,7 @@
 #include "BKE_library.h"
 #include "BKE_lattice.h"
 #include "BKE_main.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_object.h"
 #include "BKE_scene.h"
 
@@ -1466,6 +1467,8 @@ typedef struct ArmatureUserdata {
 
   int target_totvert;
   MDeformVert *dverts;
+  /** Same weights as the deform vertices used, when available. */
+  const MeshVertexWeights *vertex_weights;
 
   int defbase_tot;
   bPoseChannel **defnrToPC;
@@ -1487,7 +1490,7 @@ static void armature_vert_task(void *__restrict userdata,
   const bool use_dverts = data->use_dverts;
   const int armature_def_nr = data->armature_def_nr;
 
-  MDeformVert *dvert;
+  MDeformVert *dvert, dvert_packed;
   DualQuat sumdq, *dq = NULL;
   bPoseChannel *pchan;
   float *co, dco[3];
@@ -1512,7 +1515,13 @@ static void armature_vert_task(void *__restrict userdata,
   }
 
   if (use_dverts || armature_def_nr != -1) {
-    if (data->mesh) {
+    if (data->vertex_weights) {
+      const int *offsets = data->vertex_weights->offsets;
+      dvert_packed.dw = &data->vertex_weights->weights[offsets[i]];
+      dvert_packed.totweight = offsets[i + 1] - offsets[i];
+      dvert = &dvert_packed;
+    }
+    else if (data->mesh) {
       BLI_assert(i < data->mesh->totvert);
       if (data->mesh->dvert != NULL) {
         dvert = data->mesh->dvert + i;
@@ -1659,6 +1668,7 @@ void armature_deform_verts(Object *armOb,
   bArmature *arm = armOb->data;
   bPoseChannel **defnrToPC = NULL;
   MDeformVert *dverts = NULL;
+  const MeshVertexWeights *vertex_weights = NULL;
   bDeformGroup *dg;
   const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
   const bool use_quaternion = (deformflag & ARM_DEF_QUATERNION) != 0;
@@ -1738,6 +1748,15 @@ void armature_deform_verts(Object *armOb,
     }
   }
 
+  if ((use_dverts || armature_def_nr != -1) && target->type == OB_MESH) {
+    /* Mesh deform vertices are only read, use their packed copy when deforming the
+     * evaluated mesh with its own weights (the common case of the first modifier). */
+    Mesh *me = target->data;
+    if ((mesh ? mesh->dvert : dverts) == me->dvert && numVerts <= me->totvert) {
+      vertex_weights = BKE_mesh_runtime_vertex_weights_ensure(me);
+    }
+  }
+
   ArmatureUserdata data = {.armOb = armOb,
                            .target = target,
                            .mesh = mesh,
@@ -1751,6 +1770,7 @@ void armature_deform_verts(Object *armOb,
                            .armature_def_nr = armature_def_nr,
                            .target_totvert = target_totvert,
                            .dverts = dverts,
+                           .vertex_weights = vertex_weights,
                            .defbase_tot = defbase_tot,
                            .defnrToPC = defnrToPC};
 
@@ -28,6 +28,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_armature_types.h"
 #include "DNA_constraint_types.h"
@@ -702,6 +703,70 @@ void BKE_pose_eval_bone(struct Depsgraph *depsgraph, Scene *scene, Object *objec
   }
 }
 
+/* Bones of a level of a batch from which they are evaluated in parallel. */
+#define POSE_BONE_BATCH_PARALLEL_MIN 128
+
+typedef struct PoseBoneBatchData {
+  struct Depsgraph *depsgraph;
+  Scene *scene;
+  Object *object;
+  const int *pchan_indices;
+} PoseBoneBatchData;
+
+static void pose_eval_bone_batch_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const PoseBoneBatchData *data = userdata;
+  const int pchan_index = data->pchan_indices[i];
+  BKE_pose_eval_bone(data->depsgraph, data->scene, data->object, pchan_index);
+  BKE_pose_bone_done(data->depsgraph, data->object, pchan_index);
+}
+
+/**
+ * Evaluate a batch of bones without constraints or IK, same as #BKE_pose_eval_bone followed by
+ * #BKE_pose_bone_done for each of them. Used by the dependency graph instead of per bone
+ * operations, which cost more to schedule than to run for such bones.
+ *
+ * The bones are ordered by level in the hierarchy, bones of level `l` are
+ * `pchan_indices[level_offsets[l]]` to `pchan_indices[level_offsets[l + 1] - 1]`.
+ * They only depend on bones of previous levels, so they can be evaluated in parallel.
+ */
+void BKE_pose_eval_bone_batch(struct Depsgraph *depsgraph,
+                              Scene *scene,
+                              Object *object,
+                              const int *pchan_indices,
+                              const int *level_offsets,
+                              const int levels_len)
+{
+  const bArmature *armature = (bArmature *)object->data;
+  if (armature->edbo != NULL) {
+    return;
+  }
+  PoseBoneBatchData data = {
+      .depsgraph = depsgraph,
+      .scene = scene,
+      .object = object,
+      .pchan_indices = pchan_indices,
+  };
+  for (int level = 0; level < levels_len; level++) {
+    const int start = level_offsets[level], end = level_offsets[level + 1];
+    if (end - start >= POSE_BONE_BATCH_PARALLEL_MIN) {
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.min_iter_per_thread = POSE_BONE_BATCH_PARALLEL_MIN / 4;
+      BLI_task_parallel_range(start, end, &data, pose_eval_bone_batch_cb, &settings);
+    }
+    else {
+      for (int i = start; i < end; i++) {
+        const int pchan_index = pchan_indices[i];
+        BKE_pose_eval_bone(depsgraph, scene, object, pchan_index);
+        BKE_pose_bone_done(depsgraph, object, pchan_index);
+      }
+    }
+  }
+}
+
 void BKE_pose_constraints_evaluate(struct Depsgraph *depsgraph,
                                    Scene *scene,
                                    Object *object,
@@ -483,6 +483,8 @@ static BVHTree *bvhtree_from_mesh_verts_create_tree(float epsilon,
       }
       BLI_assert(BLI_bvhtree_get_len(tree) == verts_num_active);
       BLI_bvhtree_balance(tree);
+      /* Used for batched nearest vertex queries (shrinkwrap). */
+      BLI_bvhtree_pack(tree);
     }
   }
 
@@ -1024,6 +1026,8 @@ static BVHTree *bvhtree_from_editmesh_looptri_create_tree(float epsilon,
       }
       BLI_assert(BLI_bvhtree_get_len(tree) == looptri_num_active);
       BLI_bvhtree_balance(tree);
+      /* Triangle trees are queried heavily (snapping, shrinkwrap, data transfer...). */
+      BLI_bvhtree_pack(tree);
     }
   }
 
@@ -1070,6 +1074,8 @@ static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
       }
       BLI_assert(BLI_bvhtree_get_len(tree) == looptri_num_active);
       BLI_bvhtree_balance(tree);
+      /* Triangle trees are queried heavily (snapping, shrinkwrap, data transfer...). */
+      BLI_bvhtree_pack(tree);
     }
   }
 
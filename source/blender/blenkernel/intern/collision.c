@@ -175,7 +175,8 @@ void bvhtree_update_from_mvert(BVHTree *bvhtree,
     }
   }
 
-  BLI_bvhtree_update_tree(bvhtree);
+  /* Rebuild sub-trees that deformed enough to slow down the collision queries. */
+  BLI_bvhtree_update_tree_ex(bvhtree, BVH_REFIT_REBUILD_THRESHOLD);
 }
 
 /* ***************************
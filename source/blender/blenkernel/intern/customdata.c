@@ -26,6 +26,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 /* Since we have versioning code here (CustomData_verify_versions()). */
 #define DNA_DEPRECATED_ALLOW
 
@@ -40,6 +42,7 @@
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
+#include "BLI_scratch_arena.h"
 
 #include "BLT_translation.h"
 
@@ -1621,6 +1624,8 @@ static const LayerTypeInfo LAYERTYPEINFO[CD_NUMTYPES] = {
     {sizeof(short[4][3]), "", 0, NULL, NULL, NULL, NULL, layerSwap_flnor, NULL},
     /* 41: CD_CUSTOMLOOPNORMAL */
     {sizeof(short[2]), "vec2s", 1, NULL, NULL, NULL, NULL, NULL, NULL},
+    /* 42: CD_POSITION */
+    {sizeof(float[3]), "", 0, NULL, NULL, NULL, NULL, NULL, NULL},
 };
 
 static const char *LAYERTYPENAMES[CD_NUMTYPES] = {
@@ -1665,9 +1670,10 @@ static const char *LAYERTYPENAMES[CD_NUMTYPES] = {
     "CDMVertSkin",
     /* 37-38 */ "CDFreestyleEdge",
     "CDFreestyleFace",
-    /* 39-41 */ "CDMLoopTangent",
+    /* 39-42 */ "CDMLoopTangent",
     "CDTessLoopNormal",
     "CDCustomLoopNormal",
+    "CDPosition",
 };
 
 const CustomData_MeshMasks CD_MASK_BAREMESH = {
@@ -1848,6 +1854,111 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Sharing
+ *
+ * Layers copied with #CD_SHARE use the data of the source layer, which is owned by all layers
+ * using it and freed by the last user. Writers have to duplicate the layer first,
+ * the same as for referenced layers.
+ *
+ * Original data isn't shared: sculpt mode and RNA write original mesh layers in place,
+ * so copy-on-write makes full copies. Sharing is only used between evaluated meshes,
+ * currently for the copies edit-mode modifier evaluation makes to apply deformed coordinates.
+ * \{ */
+
+typedef struct CustomDataSharing {
+  /** Number of layers using the data. */
+  int users;
+} CustomDataSharing;
+
+static bool customdata_layer_is_shared(const CustomDataLayer *layer)
+{
+  return (layer->sharing != NULL) && (atomic_add_and_fetch_int32(&layer->sharing->users, 0) > 1);
+}
+
+/**
+ * Add a user to the data of \a layer, the sharing is created on demand.
+ * This only changes run-time data of the layer, so it's valid for source layers
+ * which are copied from multiple threads at once.
+ */
+static CustomDataSharing *customdata_layer_sharing_add_user(const CustomDataLayer *layer)
+{
+  CustomDataLayer *layer_mutable = (CustomDataLayer *)layer;
+  CustomDataSharing *sharing = layer->sharing;
+
+  if (sharing == NULL) {
+    CustomDataSharing *sharing_new = MEM_mallocN(sizeof(*sharing_new), __func__);
+    sharing_new->users = 1;
+    sharing = atomic_cas_ptr((void **)&layer_mutable->sharing, NULL, sharing_new);
+    if (sharing == NULL) {
+      sharing = sharing_new;
+    }
+    else {
+      MEM_freeN(sharing_new);
+    }
+  }
+
+  atomic_add_and_fetch_int32(&sharing->users, 1);
+  return sharing;
+}
+
+static void customdata_data_free(int type, void *data, int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(type);
+
+  if (typeInfo->free) {
+    typeInfo->free(data, totelem, typeInfo->size);
+  }
+  MEM_freeN(data);
+}
+
+/**
+ * Remove the user of \a layer from its shared data, the data is freed when there are no users
+ * left. The layer doesn't use the data afterwards.
+ */
+static void customdata_layer_sharing_remove_user(CustomDataLayer *layer,
+                                                 void *data,
+                                                 const int totelem)
+{
+  if (atomic_sub_and_fetch_int32(&layer->sharing->users, 1) == 0) {
+    if (data) {
+      customdata_data_free(layer->type, data, totelem);
+    }
+    MEM_freeN(layer->sharing);
+  }
+  layer->sharing = NULL;
+}
+
+/**
+ * Make the layer the only owner of its data, copying the first \a totelem elements
+ * when other layers use the data too.
+ */
+static void customdata_layer_unshare(CustomDataLayer *layer, const int totelem)
+{
+  void *data = layer->data;
+
+  if (layer->sharing == NULL) {
+    return;
+  }
+
+  if (customdata_layer_is_shared(layer) && data) {
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+    void *dst_data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD unshare layer");
+    if (typeInfo->copy) {
+      typeInfo->copy(data, dst_data, totelem);
+    }
+    else {
+      memcpy(dst_data, data, (size_t)totelem * typeInfo->size);
+    }
+    layer->data = dst_data;
+  }
+
+  /* Data which isn't copied is kept, the layer was its only user. */
+  customdata_layer_sharing_remove_user(layer, (layer->data != data) ? data : NULL, totelem);
+}
+
+/** \} */
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -1899,6 +2010,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -1910,11 +2022,30 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
+    else if (alloctype == CD_SHARE) {
+      /* Referenced data isn't owned by the source, so it can't be shared. */
+      if ((flag & CD_FLAG_NOFREE) || (data == NULL)) {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_DUPLICATE, data, totelem, layer->name);
+      }
+      else {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_ASSIGN, data, totelem, layer->name);
+        if (newlayer && (newlayer->data == data)) {
+          newlayer->sharing = customdata_layer_sharing_add_user(layer);
+        }
+      }
+    }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
 
     if (newlayer) {
+      if (alloctype == CD_ASSIGN) {
+        /* The ownership of shared data moves to the new layer too. */
+        newlayer->sharing = layer->sharing;
+        ((CustomDataLayer *)layer)->sharing = NULL;
+      }
       newlayer->uid = layer->uid;
 
       newlayer->active = lastactive;
@@ -1931,7 +2062,7 @@ bool CustomData_merge(const struct CustomData *source,
 }
 
 /* NOTE: Take care of referenced layers by yourself! */
-void CustomData_realloc(CustomData *data, int totelem)
+void CustomData_realloc(CustomData *data, int old_size, int new_size)
 {
   int i;
   for (i = 0; i < data->totlayer; i++) {
@@ -1941,7 +2072,10 @@ void CustomData_realloc(CustomData *data, int totelem)
       continue;
     }
     typeInfo = layerType_getInfo(layer->type);
-    layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
+    if (layer->sharing != NULL) {
+      customdata_layer_unshare(layer, MIN2(old_size, new_size));
+    }
+    layer->data = MEM_reallocN(layer->data, (size_t)new_size * typeInfo->size);
   }
 }
 
@@ -1962,18 +2096,11 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
-
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
-    }
+  if (layer->sharing != NULL) {
+    customdata_layer_sharing_remove_user(layer, layer->data, totelem);
+  }
+  else if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+    customdata_data_free(layer->type, layer->data, totelem);
   }
 }
 
@@ -2566,6 +2693,9 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
     layer->flag &= ~CD_FLAG_NOFREE;
   }
+  else if (layer->sharing != NULL) {
+    customdata_layer_unshare(layer, totelem);
+  }
 
   return layer->data;
 }
@@ -2619,7 +2749,18 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & CD_FLAG_NOFREE) || customdata_layer_is_shared(layer);
+}
+
+/**
+ * Check if the data of the active layer of \a type is used by other custom data too,
+ * see #CD_SHARE.
+ */
+bool CustomData_is_shared_layer(const CustomData *data, int type)
+{
+  const int layer_index = CustomData_get_active_layer_index(data, type);
+
+  return (layer_index != -1) && customdata_layer_is_shared(&data->layers[layer_index]);
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -2795,7 +2936,7 @@ void CustomData_copy_layer_type_data(const CustomData *source,
                              count);
 }
 
-void CustomData_free_elem(CustomData *data, int index, int count)
+void CustomData_free_elem(CustomData *data, int index, int count, int totelem)
 {
   int i;
   const LayerTypeInfo *typeInfo;
@@ -2807,6 +2948,11 @@ void CustomData_free_elem(CustomData *data, int index, int count)
       if (typeInfo->free) {
         size_t offset = (size_t)index * typeInfo->size;
 
+        /* Other users keep the elements. */
+        if (data->layers[i].sharing != NULL) {
+          customdata_layer_unshare(&data->layers[i], totelem);
+        }
+
         typeInfo->free(POINTER_OFFSET(data->layers[i].data, offset), count, typeInfo->size);
       }
     }
@@ -2830,7 +2976,7 @@ void CustomData_interp(const CustomData *source,
 
   /* Slow fallback in case we're interpolating a ridiculous number of elements. */
   if (count > SOURCE_BUF_SIZE) {
-    sources = MEM_malloc_arrayN(count, sizeof(*sources), __func__);
+    sources = BLI_scratch_alloc_array((size_t)count, sizeof(*sources), __func__);
   }
 
   /* interpolates a layer at a time */
@@ -2877,7 +3023,7 @@ void CustomData_interp(const CustomData *source,
   }
 
   if (count > SOURCE_BUF_SIZE) {
-    MEM_freeN((void *)sources);
+    BLI_scratch_free((void *)sources);
   }
 }
 
@@ -2922,7 +3068,7 @@ void CustomData_swap(struct CustomData *data, const int index_a, const int index
     const size_t offset_a = size * index_a;
     const size_t offset_b = size * index_b;
 
-    void *buff = size <= sizeof(buff_static) ? buff_static : MEM_mallocN(size, __func__);
+    void *buff = size <= sizeof(buff_static) ? buff_static : BLI_scratch_alloc(size, __func__);
     memcpy(buff, POINTER_OFFSET(data->layers[i].data, offset_a), size);
     memcpy(POINTER_OFFSET(data->layers[i].data, offset_a),
            POINTER_OFFSET(data->layers[i].data, offset_b),
@@ -2930,7 +3076,7 @@ void CustomData_swap(struct CustomData *data, const int index_a, const int index
     memcpy(POINTER_OFFSET(data->layers[i].data, offset_b), buff, size);
 
     if (buff != buff_static) {
-      MEM_freeN(buff);
+      BLI_scratch_free(buff);
     }
   }
 }
@@ -3044,6 +3190,19 @@ const char *CustomData_get_layer_name(const CustomData *data, int type, int n)
   return (layer_index == -1) ? NULL : data->layers[layer_index].name;
 }
 
+/**
+ * The layer doesn't own its previous data after this, callers taking the previous data have
+ * to duplicate shared layers first.
+ */
+static void customdata_layer_set_data(CustomDataLayer *layer, void *ptr)
+{
+  if (layer->sharing != NULL) {
+    BLI_assert(!customdata_layer_is_shared(layer));
+    customdata_layer_sharing_remove_user(layer, NULL, 0);
+  }
+  layer->data = ptr;
+}
+
 void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
 {
   /* get the layer index of the first layer of type */
@@ -3053,7 +3212,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customdata_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3066,7 +3225,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customdata_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3858,7 +4017,7 @@ void CustomData_bmesh_interp(CustomData *data,
 
   /* Slow fallback in case we're interpolating a ridiculous number of elements. */
   if (count > SOURCE_BUF_SIZE) {
-    sources = MEM_malloc_arrayN(count, sizeof(*sources), __func__);
+    sources = BLI_scratch_alloc_array((size_t)count, sizeof(*sources), __func__);
   }
 
   /* interpolates a layer at a time */
@@ -3875,7 +4034,7 @@ void CustomData_bmesh_interp(CustomData *data,
   }
 
   if (count > SOURCE_BUF_SIZE) {
-    MEM_freeN((void *)sources);
+    BLI_scratch_free((void *)sources);
   }
 }
 
@@ -4054,7 +4213,8 @@ void CustomData_file_write_prepare(CustomData *data,
         }
         write_layers_size += chunk_size;
       }
-      write_layers[j++] = *layer;
+      write_layers[j] = *layer;
+      write_layers[j++].sharing = NULL;
     }
   }
   BLI_assert(j == data->totlayer);
@@ -4625,7 +4785,7 @@ static void customdata_data_transfer_interp_generic(const CustomDataTransferLaye
     copy_cd = type_info->copy;
   }
 
-  tmp_dst = MEM_mallocN(data_size, __func__);
+  tmp_dst = BLI_scratch_alloc(data_size, __func__);
 
   if (count > 1 && !interp_cd) {
     int i;
@@ -4698,7 +4858,7 @@ static void customdata_data_transfer_interp_generic(const CustomDataTransferLaye
     }
   }
 
-  MEM_freeN(tmp_dst);
+  BLI_scratch_free(tmp_dst);
 }
 
 /* Normals are special, we need to take care of source & destination spaces... */
@@ -946,10 +946,28 @@ void fcurve_store_samples(FCurve *fcu, void *data, int start, int end, FcuSample
   /* set up sample data */
   fpt = new_fpt = MEM_callocN(sizeof(FPoint) * (end - start + 1), "FPoint Samples");
 
-  /* use the sampling callback at 1-frame intervals from start to end frames */
-  for (cfra = start; cfra <= end; cfra++, fpt++) {
-    fpt->vec[0] = (float)cfra;
-    fpt->vec[1] = sample_cb(fcu, data, (float)cfra);
+  if (sample_cb == fcurve_samplingcb_evalcurve) {
+    /* sample the curve itself in one batch, which reuses keyframe segments between frames */
+    const int samples_len = end - start + 1;
+    float *evaltimes = MEM_malloc_arrayN(samples_len, sizeof(float), __func__);
+    float *values = MEM_malloc_arrayN(samples_len, sizeof(float), __func__);
+    for (cfra = start; cfra <= end; cfra++) {
+      evaltimes[cfra - start] = (float)cfra;
+    }
+    BKE_fcurve_evaluate_samples(fcu, evaltimes, values, samples_len);
+    for (int i = 0; i < samples_len; i++, fpt++) {
+      fpt->vec[0] = evaltimes[i];
+      fpt->vec[1] = values[i];
+    }
+    MEM_freeN(evaltimes);
+    MEM_freeN(values);
+  }
+  else {
+    /* use the sampling callback at 1-frame intervals from start to end frames */
+    for (cfra = start; cfra <= end; cfra++, fpt++) {
+      fpt->vec[0] = (float)cfra;
+      fpt->vec[1] = sample_cb(fcu, data, (float)cfra);
+    }
   }
 
   /* free any existing sample/keyframe data on curve  */
@@ -2601,8 +2619,39 @@ static void berekeny(float f1, float f2, float f3, float f4, float *o, int b)
 
 /* -------------------------- */
 
-/* Calculate F-Curve value for 'evaltime' using BezTriple keyframes */
-static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime)
+/* Find the keyframe ending the segment which contains 'evaltime', trying the segment from the
+ * hint and the one following it (time usually moves forward between evaluations).
+ *
+ * Only times strictly inside a segment and not within the search threshold of its keyframes are
+ * accepted, for sorted keyframes the result is then the same as the one of the binary search. */
+static bool fcurve_segment_hint_lookup(const BezTriple *bezts,
+                                       const int totvert,
+                                       const float evaltime,
+                                       const float threshold,
+                                       const int hint,
+                                       int *r_index)
+{
+  for (int a = max_ii(hint, 1); (a <= hint + 1) && (a < totvert); a++) {
+    const float prevframe = bezts[a - 1].vec[1][0];
+    const float frame = bezts[a].vec[1][0];
+    if ((prevframe < evaltime) && (evaltime < frame) && !IS_EQT(evaltime, prevframe, threshold) &&
+        !IS_EQT(evaltime, frame, threshold)) {
+      *r_index = a;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Calculate F-Curve value for 'evaltime' using BezTriple keyframes
+ *
+ * \param segment_hint: Optional index of the keyframe ending the previously evaluated segment,
+ * used to avoid searching the keyframes and updated with the segment used for 'evaltime'.
+ */
+static float fcurve_eval_keyframes(FCurve *fcu,
+                                   BezTriple *bezts,
+                                   float evaltime,
+                                   int *segment_hint)
 {
   const float eps = 1.e-8f;
   BezTriple *bezt, *prevbezt, *lastbezt;
@@ -2734,7 +2783,16 @@ static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime
      *   Weird errors, like selecting the wrong keyframe range (see T39207), occur.
      *   This lower bound was established in b888a32eee8147b028464336ad2404d8155c64dd.
      */
-    a = binarysearch_bezt_index_ex(bezts, evaltime, fcu->totvert, 0.0001, &exact);
+    const float threshold = 0.0001f;
+    int index;
+    if ((segment_hint != NULL) &&
+        fcurve_segment_hint_lookup(
+            bezts, fcu->totvert, evaltime, threshold, *segment_hint, &index)) {
+      a = index;
+    }
+    else {
+      a = binarysearch_bezt_index_ex(bezts, evaltime, fcu->totvert, threshold, &exact);
+    }
 
     if (exact) {
       /* index returned must be interpreted differently when it sits on top of an existing keyframe
@@ -2751,6 +2809,10 @@ static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime
       prevbezt = (a > 0) ? (bezt - 1) : bezt;
     }
 
+    if (segment_hint != NULL) {
+      *segment_hint = (int)(bezt - bezts);
+    }
+
     /* use if the key is directly on the frame,
      * rare cases this is needed else we get 0.0 instead. */
     /* XXX: consult T39207 for examples of files where failure of these checks can cause issues */
@@ -3077,7 +3139,7 @@ static float fcurve_eval_samples(FCurve *fcu, FPoint *fpts, float evaltime)
 /* Evaluate and return the value of the given F-Curve at the specified frame ("evaltime")
  * Note: this is also used for drivers
  */
-static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue)
+static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue, int *segment_hint)
 {
   float devaltime;
 
@@ -3094,7 +3156,7 @@ static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue)
    *   F-Curve modifier on the stack requested the curve to be evaluated at
    */
   if (fcu->bezt) {
-    cvalue = fcurve_eval_keyframes(fcu, fcu->bezt, devaltime);
+    cvalue = fcurve_eval_keyframes(fcu, fcu->bezt, devaltime, segment_hint);
   }
   else if (fcu->fpt) {
     cvalue = fcurve_eval_samples(fcu, fcu->fpt, devaltime);
@@ -3118,7 +3180,7 @@ float evaluate_fcurve(FCurve *fcu, float evaltime)
 {
   BLI_assert(fcu->driver == NULL);
 
-  return evaluate_fcurve_ex(fcu, evaltime, 0.0);
+  return evaluate_fcurve_ex(fcu, evaltime, 0.0, NULL);
 }
 
 float evaluate_fcurve_only_curve(FCurve *fcu, float evaltime)
@@ -3126,7 +3188,7 @@ float evaluate_fcurve_only_curve(FCurve *fcu, float evaltime)
   /* Can be used to evaluate the (keyframed) fcurve only.
    * Also works for driver-fcurves when the driver itself is not relevant.
    * E.g. when inserting a keyframe in a driver fcurve. */
-  return evaluate_fcurve_ex(fcu, evaltime, 0.0);
+  return evaluate_fcurve_ex(fcu, evaltime, 0.0, NULL);
 }
 
 float evaluate_fcurve_driver(PathResolvedRNA *anim_rna,
@@ -3173,7 +3235,21 @@ float evaluate_fcurve_driver(PathResolvedRNA *anim_rna,
     }
   }
 
-  return evaluate_fcurve_ex(fcu, evaltime, cvalue);
+  return evaluate_fcurve_ex(fcu, evaltime, cvalue, NULL);
+}
+
+/* Evaluate the (keyframed) F-Curve at many frames, like evaluate_fcurve_only_curve().
+ * Consecutive samples reuse the keyframe segment of the previous one when possible, so evaluating
+ * frames in increasing order avoids searching the keyframes for every sample. */
+void BKE_fcurve_evaluate_samples(FCurve *fcu,
+                                 const float *evaltimes,
+                                 float *r_values,
+                                 const int samples_len)
+{
+  int segment_hint = 0;
+  for (int i = 0; i < samples_len; i++) {
+    r_values[i] = evaluate_fcurve_ex(fcu, evaltimes[i], 0.0f, &segment_hint);
+  }
 }
 
 /* Checks if the curve has valid keys, drivers or modifiers that produce an actual curve. */
@@ -3183,8 +3259,15 @@ bool BKE_fcurve_is_empty(FCurve *fcu)
          !list_has_suitable_fmodifier(&fcu->modifiers, 0, FMI_TYPE_GENERATE_CURVE);
 }
 
-/* Calculate the value of the given F-Curve at the given frame, and set its curval */
-float calculate_fcurve(PathResolvedRNA *anim_rna, FCurve *fcu, float evaltime)
+/* Calculate the value of the given F-Curve at the given frame, and set its curval
+ *
+ * \param segment_hint: Optional keyframe segment of the previous evaluation of this F-Curve
+ * (zero when unknown), which is tried before searching the keyframes and then updated.
+ */
+float calculate_fcurve_ex(PathResolvedRNA *anim_rna,
+                          FCurve *fcu,
+                          float evaltime,
+                          int *segment_hint)
 {
   /* only calculate + set curval (overriding the existing value) if curve has
    * any data which warrants this...
@@ -3196,7 +3279,7 @@ float calculate_fcurve(PathResolvedRNA *anim_rna, FCurve *fcu, float evaltime)
       curval = evaluate_fcurve_driver(anim_rna, fcu, fcu->driver, evaltime);
     }
     else {
-      curval = evaluate_fcurve(fcu, evaltime);
+      curval = evaluate_fcurve_ex(fcu, evaltime, 0.0f, segment_hint);
     }
     fcu->curval = curval; /* debug display only, not thread safe! */
     return curval;
@@ -3205,3 +3288,8 @@ float calculate_fcurve(PathResolvedRNA *anim_rna, FCurve *fcu, float evaltime)
     return 0.0f;
   }
 }
+
+float calculate_fcurve(PathResolvedRNA *anim_rna, FCurve *fcu, float evaltime)
+{
+  return calculate_fcurve_ex(anim_rna, fcu, evaltime, NULL);
+}
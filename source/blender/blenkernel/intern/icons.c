@@ -43,6 +43,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
 #include "BLI_linklist_lockfree.h"
+#include "BLI_mempool.h"
 #include "BLI_string.h"
 #include "BLI_fileops.h"
 #include "BLI_threads.h"
@@ -85,6 +86,8 @@ typedef struct DeferredIconDeleteNode {
   int icon_id;
 } DeferredIconDeleteNode;
 static LockfreeLinkList g_icon_delete_queue;
+/* Nodes of the queue, added by any thread (IDs are freed by depsgraph evaluation). */
+static BLI_mempool *g_icon_delete_queue_pool = NULL;
 
 static void icon_free(void *val)
 {
@@ -175,6 +178,8 @@ void BKE_icons_init(int first_dyn_id)
   if (!gIcons) {
     gIcons = BLI_ghash_int_new(__func__);
     BLI_linklist_lockfree_init(&g_icon_delete_queue);
+    g_icon_delete_queue_pool = BLI_mempool_create(
+        sizeof(DeferredIconDeleteNode), 0, 64, BLI_MEMPOOL_CONCURRENT);
   }
 
   if (!gCachedPreviews) {
@@ -196,20 +201,27 @@ void BKE_icons_free(void)
     gCachedPreviews = NULL;
   }
 
-  BLI_linklist_lockfree_free(&g_icon_delete_queue, MEM_freeN);
+  BLI_linklist_lockfree_free(&g_icon_delete_queue, NULL);
+  if (g_icon_delete_queue_pool) {
+    BLI_mempool_destroy(g_icon_delete_queue_pool);
+    g_icon_delete_queue_pool = NULL;
+  }
 }
 
 void BKE_icons_deferred_free(void)
 {
   BLI_assert(BLI_thread_is_main());
 
+  DeferredIconDeleteNode *node_next;
   for (DeferredIconDeleteNode *node =
            (DeferredIconDeleteNode *)BLI_linklist_lockfree_begin(&g_icon_delete_queue);
        node != NULL;
-       node = node->next) {
+       node = node_next) {
+    node_next = node->next;
     BLI_ghash_remove(gIcons, POINTER_FROM_INT(node->icon_id), NULL, icon_free);
+    BLI_mempool_free(g_icon_delete_queue_pool, node);
   }
-  BLI_linklist_lockfree_clear(&g_icon_delete_queue, MEM_freeN);
+  BLI_linklist_lockfree_clear(&g_icon_delete_queue, NULL);
 }
 
 static PreviewImage *previewimg_create_ex(size_t deferred_data_size)
@@ -727,7 +739,7 @@ void BKE_icon_set(const int icon_id, struct Icon *icon)
 
 static void icon_add_to_deferred_delete_queue(int icon_id)
 {
-  DeferredIconDeleteNode *node = MEM_mallocN(sizeof(DeferredIconDeleteNode), __func__);
+  DeferredIconDeleteNode *node = BLI_mempool_alloc(g_icon_delete_queue_pool);
   node->icon_id = icon_id;
   BLI_linklist_lockfree_insert(&g_icon_delete_queue, (LockfreeLinkNode *)node);
 }
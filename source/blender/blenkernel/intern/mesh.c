@@ -587,7 +587,13 @@ void BKE_mesh_copy_data(Main *bmain, Mesh *me_dst, const Mesh *me_src, const int
 
   me_dst->mat = MEM_dupallocN(me_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  eCDAllocType alloc_type = CD_DUPLICATE;
+  if (flag & LIB_ID_COPY_CD_REFERENCE) {
+    alloc_type = CD_REFERENCE;
+  }
+  else if (flag & LIB_ID_COPY_CD_SHARE) {
+    alloc_type = CD_SHARE;
+  }
   CustomData_copy(&me_src->vdata, &me_dst->vdata, mask.vmask, alloc_type, me_dst->totvert);
   CustomData_copy(&me_src->edata, &me_dst->edata, mask.emask, alloc_type, me_dst->totedge);
   CustomData_copy(&me_src->ldata, &me_dst->ldata, mask.lmask, alloc_type, me_dst->totloop);
@@ -600,6 +606,7 @@ void BKE_mesh_copy_data(Main *bmain, Mesh *me_dst, const Mesh *me_src, const int
   }
 
   BKE_mesh_update_customdata_pointers(me_dst, do_tessface);
+  BKE_mesh_runtime_topology_cache_share(me_dst, me_src);
 
   me_dst->edit_mesh = NULL;
 
@@ -1568,6 +1575,11 @@ void BKE_mesh_vert_coords_apply(Mesh *mesh, const float (*vert_coords)[3])
     copy_v3_v3(mv->co, vert_coords[i]);
   }
   mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+
+  float(*positions)[3] = CustomData_get_layer(&mesh->vdata, CD_POSITION);
+  if (positions != NULL && positions != vert_coords) {
+    memcpy(positions, vert_coords, sizeof(*positions) * (size_t)mesh->totvert);
+  }
 }
 
 void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
@@ -1581,6 +1593,11 @@ void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
     mul_v3_m4v3(mv->co, mat, vert_coords[i]);
   }
   mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+
+  float(*positions)[3] = CustomData_get_layer(&mesh->vdata, CD_POSITION);
+  if (positions != NULL) {
+    BKE_mesh_vert_coords_get(mesh, positions);
+  }
 }
 
 void BKE_mesh_vert_normals_apply(Mesh *mesh, const short (*vert_normals)[3])
@@ -1594,6 +1611,85 @@ void BKE_mesh_vert_normals_apply(Mesh *mesh, const short (*vert_normals)[3])
   mesh->runtime.cd_dirty_vert &= ~CD_MASK_NORMAL;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Vertex Positions
+ *
+ * Evaluated meshes can store a copy of their vertex positions as a plain float array
+ * (the #CD_POSITION layer), so code only using positions doesn't read through
+ * the normals and flags of #MVert.
+ *
+ * The layer is temporary: it's not copied to other meshes nor saved, and #MVert.co stays
+ * valid for code which doesn't know about it. #BKE_mesh_vert_coords_apply keeps both in sync,
+ * code writing to the layer directly has to call #BKE_mesh_vert_positions_apply.
+ * \{ */
+
+/**
+ * \return The positions layer, or NULL when the mesh only stores positions in #MVert.
+ */
+const float (*BKE_mesh_vert_positions(const Mesh *mesh))[3]
+{
+  return CustomData_get_layer(&mesh->vdata, CD_POSITION);
+}
+
+/**
+ * Store positions in the layer, adding it when needed.
+ *
+ * \param vert_coords: The positions of the vertices, matching the #MVert.co of the mesh.
+ * When NULL, they are copied from #MVert.co.
+ */
+void BKE_mesh_vert_positions_add(Mesh *mesh, const float (*vert_coords)[3])
+{
+  float(*positions)[3] = CustomData_get_layer(&mesh->vdata, CD_POSITION);
+  if (positions == NULL) {
+    positions = CustomData_add_layer(&mesh->vdata, CD_POSITION, CD_CALLOC, NULL, mesh->totvert);
+    CustomData_set_layer_flag(&mesh->vdata, CD_POSITION, CD_FLAG_TEMPORARY);
+  }
+
+  if (vert_coords != NULL) {
+    memcpy(positions, vert_coords, sizeof(*positions) * (size_t)mesh->totvert);
+  }
+  else {
+    BKE_mesh_vert_coords_get(mesh, positions);
+  }
+}
+
+/**
+ * Get the positions layer for modification, adding it when needed.
+ * Call #BKE_mesh_vert_positions_apply afterwards.
+ */
+float (*BKE_mesh_vert_positions_for_write(Mesh *mesh))[3]
+{
+  if (!CustomData_has_layer(&mesh->vdata, CD_POSITION)) {
+    BKE_mesh_vert_positions_add(mesh, NULL);
+  }
+  return CustomData_get_layer(&mesh->vdata, CD_POSITION);
+}
+
+/**
+ * Copy the positions layer back to #MVert.co, for code which doesn't use the layer.
+ */
+void BKE_mesh_vert_positions_apply(Mesh *mesh)
+{
+  const float(*positions)[3] = CustomData_get_layer(&mesh->vdata, CD_POSITION);
+  if (positions == NULL) {
+    return;
+  }
+
+  MVert *mv = CustomData_duplicate_referenced_layer(&mesh->vdata, CD_MVERT, mesh->totvert);
+  mesh->mvert = mv;
+  for (int i = 0; i < mesh->totvert; i++, mv++) {
+    copy_v3_v3(mv->co, positions[i]);
+  }
+  mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+}
+
+void BKE_mesh_vert_positions_clear(Mesh *mesh)
+{
+  CustomData_free_layers(&mesh->vdata, CD_POSITION, mesh->totvert);
+}
+
+/** \} */
+
 /**
  * Compute 'split' (aka loop, or per face corner's) normals.
  *
@@ -1909,11 +2005,11 @@ void BKE_mesh_split_faces(Mesh *mesh, bool free_loop_normals)
     const bool do_edges = (num_new_edges > 0);
 
     /* Reallocate all vert and edge related data. */
+    CustomData_realloc(&mesh->vdata, mesh->totvert, mesh->totvert + num_new_verts);
     mesh->totvert += num_new_verts;
-    CustomData_realloc(&mesh->vdata, mesh->totvert);
     if (do_edges) {
+      CustomData_realloc(&mesh->edata, mesh->totedge, mesh->totedge + num_new_edges);
       mesh->totedge += num_new_edges;
-      CustomData_realloc(&mesh->edata, mesh->totedge);
     }
     /* Update pointers to a newly allocated memory. */
     BKE_mesh_update_customdata_pointers(mesh, false);
@@ -39,6 +39,7 @@
 #include "BLI_edgehash.h"
 #include "BLI_bitmap.h"
 #include "BLI_polyfill_2d.h"
+#include "BLI_scratch_arena.h"
 #include "BLI_linklist.h"
 #include "BLI_linklist_stack.h"
 #include "BLI_alloca.h"
@@ -48,6 +49,8 @@
 #include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_multires.h"
 #include "BKE_report.h"
 
@@ -65,6 +68,9 @@
 
 static CLG_LogRef LOG = {"bke.mesh_evaluate"};
 
+/* Minimum number of loops to gather vertex normals using a cached map from vertices to loops. */
+#define MESH_NORMALS_VERT_LOOP_MAP_MIN_LOOPS 4096
+
 /* -------------------------------------------------------------------- */
 /** \name Mesh Normal Calculation
  * \{ */
@@ -166,7 +172,7 @@ void BKE_mesh_calc_normals_mapping_ex(MVert *mverts,
   }
 
   if (!pnors) {
-    pnors = MEM_calloc_arrayN((size_t)numPolys, sizeof(float[3]), __func__);
+    pnors = BLI_scratch_calloc_array((size_t)numPolys, sizeof(float[3]), __func__);
   }
   /* NO NEED TO ALLOC YET */
   /* if (!fnors) fnors = MEM_calloc_arrayN(numFaces, sizeof(float[3]), "face nors mesh.c"); */
@@ -202,7 +208,7 @@ void BKE_mesh_calc_normals_mapping_ex(MVert *mverts,
   }
 
   if (pnors != r_polyNors) {
-    MEM_freeN(pnors);
+    BLI_scratch_free(pnors);
   }
   /* if (fnors != r_faceNors) MEM_freeN(fnors); */ /* NO NEED TO ALLOC YET */
 
@@ -216,6 +222,7 @@ typedef struct MeshCalcNormalsData {
   float (*pnors)[3];
   float (*lnors_weighted)[3];
   float (*vnors)[3];
+  const MeshElemMap *vert_loop_map;
 } MeshCalcNormalsData;
 
 static void mesh_calc_normals_poly_cb(void *__restrict userdata,
@@ -228,21 +235,19 @@ static void mesh_calc_normals_poly_cb(void *__restrict userdata,
   BKE_mesh_calc_poly_normal(mp, data->mloop + mp->loopstart, data->mverts, data->pnors[pidx]);
 }
 
-static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
-                                              const int pidx,
-                                              const TaskParallelTLS *__restrict UNUSED(tls))
+/**
+ * Calculate the polygon normal and the angle weighted normals of its loops.
+ *
+ * Called with a constant \a nverts for triangles and quads,
+ * so the loops can be unrolled and the edge-vectors kept in registers.
+ */
+BLI_INLINE void mesh_calc_normals_poly_prepare_loops(const MLoop *ml,
+                                                     const MVert *mverts,
+                                                     const int nverts,
+                                                     float (*edgevecbuf)[3],
+                                                     float pnor[3],
+                                                     float (*lnors_weighted)[3])
 {
-  MeshCalcNormalsData *data = userdata;
-  const MPoly *mp = &data->mpolys[pidx];
-  const MLoop *ml = &data->mloop[mp->loopstart];
-  const MVert *mverts = data->mverts;
-
-  float pnor_temp[3];
-  float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
-  float(*lnors_weighted)[3] = data->lnors_weighted;
-
-  const int nverts = mp->totloop;
-  float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
   int i;
 
   /* Polygon Normal and edge-vector */
@@ -272,12 +277,11 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
 
   /* accumulate angle weighted face normal */
   /* inline version of #accumulate_vertex_normals_poly_v3,
-   * split between this threaded callback and #mesh_calc_normals_poly_accum_cb. */
+   * split between this threaded callback and the accumulation of vertex normals. */
   {
     const float *prev_edge = edgevecbuf[nverts - 1];
 
     for (i = 0; i < nverts; i++) {
-      const int lidx = mp->loopstart + i;
       const float *cur_edge = edgevecbuf[i];
 
       /* calculate angle between the two poly edges incident on
@@ -285,22 +289,48 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
       const float fac = saacos(-dot_v3v3(cur_edge, prev_edge));
 
       /* Store for later accumulation */
-      mul_v3_v3fl(lnors_weighted[lidx], pnor, fac);
+      mul_v3_v3fl(lnors_weighted[i], pnor, fac);
 
       prev_edge = cur_edge;
     }
   }
 }
 
-static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
-                                               const int vidx,
-                                               const TaskParallelTLS *__restrict UNUSED(tls))
+static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
+                                              const int pidx,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
 {
   MeshCalcNormalsData *data = userdata;
+  const MPoly *mp = &data->mpolys[pidx];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  const MVert *mverts = data->mverts;
+
+  float pnor_temp[3];
+  float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
+  float(*lnors_weighted)[3] = &data->lnors_weighted[mp->loopstart];
 
-  MVert *mv = &data->mverts[vidx];
-  float *no = data->vnors[vidx];
+  switch (mp->totloop) {
+    case 3: {
+      float edgevecbuf[3][3];
+      mesh_calc_normals_poly_prepare_loops(ml, mverts, 3, edgevecbuf, pnor, lnors_weighted);
+      break;
+    }
+    case 4: {
+      float edgevecbuf[4][3];
+      mesh_calc_normals_poly_prepare_loops(ml, mverts, 4, edgevecbuf, pnor, lnors_weighted);
+      break;
+    }
+    default: {
+      const int nverts = mp->totloop;
+      float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
+      mesh_calc_normals_poly_prepare_loops(ml, mverts, nverts, edgevecbuf, pnor, lnors_weighted);
+      break;
+    }
+  }
+}
 
+BLI_INLINE void mesh_calc_normals_vert_finalize(MVert *mv, float no[3])
+{
   if (UNLIKELY(normalize_v3(no) == 0.0f)) {
     /* following Mesh convention; we use vertex coordinate itself for normal in this case */
     normalize_v3_v3(no, mv->co);
@@ -309,6 +339,41 @@ static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
   normal_float_to_short_v3(mv->no, no);
 }
 
+static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
+                                               const int vidx,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+
+  mesh_calc_normals_vert_finalize(&data->mverts[vidx], data->vnors[vidx]);
+}
+
+/**
+ * Vertex-centric version of accumulating the weighted loop normals and #finalize_cb,
+ * each vertex gathers the normals of its loops so it can run in parallel.
+ *
+ * Loops are accumulated in the same order as when looping over all loops,
+ * so the results are exactly the same.
+ */
+static void mesh_calc_normals_poly_gather_cb(void *__restrict userdata,
+                                             const int vidx,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const MeshElemMap *map_elem = &data->vert_loop_map[vidx];
+  const float(*lnors_weighted)[3] = (const float(*)[3])data->lnors_weighted;
+
+  float no_temp[3];
+  float *no = data->vnors ? data->vnors[vidx] : no_temp;
+
+  zero_v3(no);
+  for (int i = 0; i < map_elem->count; i++) {
+    add_v3_v3(no, lnors_weighted[map_elem->indices[i]]);
+  }
+
+  mesh_calc_normals_vert_finalize(&data->mverts[vidx], no);
+}
+
 void BKE_mesh_calc_normals_poly(MVert *mverts,
                                 float (*r_vertnors)[3],
                                 int numVerts,
@@ -318,6 +383,33 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
                                 int numPolys,
                                 float (*r_polynors)[3],
                                 const bool only_face_normals)
+{
+  BKE_mesh_calc_normals_poly_ex(mverts,
+                                r_vertnors,
+                                numVerts,
+                                mloop,
+                                mpolys,
+                                numLoops,
+                                numPolys,
+                                r_polynors,
+                                only_face_normals,
+                                NULL);
+}
+
+/**
+ * \param vert_loop_map: Optional map from vertices to their loops sorted by index
+ * (see #BKE_mesh_vert_loop_map_create_parallel), used to calculate vertex normals in parallel.
+ */
+void BKE_mesh_calc_normals_poly_ex(MVert *mverts,
+                                   float (*r_vertnors)[3],
+                                   int numVerts,
+                                   const MLoop *mloop,
+                                   const MPoly *mpolys,
+                                   int numLoops,
+                                   int numPolys,
+                                   float (*r_polynors)[3],
+                                   const bool only_face_normals,
+                                   const MeshElemMap *vert_loop_map)
 {
   float(*pnors)[3] = r_polynors;
 
@@ -341,13 +433,16 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   }
 
   float(*vnors)[3] = r_vertnors;
-  float(*lnors_weighted)[3] = MEM_malloc_arrayN(
+  float(*lnors_weighted)[3] = BLI_scratch_alloc_array(
       (size_t)numLoops, sizeof(*lnors_weighted), __func__);
   bool free_vnors = false;
 
   /* first go through and calculate normals for all the polys */
-  if (vnors == NULL) {
-    vnors = MEM_calloc_arrayN((size_t)numVerts, sizeof(*vnors), __func__);
+  if (vert_loop_map != NULL) {
+    /* Vertex normals are gathered, no need to clear them. */
+  }
+  else if (vnors == NULL) {
+    vnors = BLI_scratch_calloc_array((size_t)numVerts, sizeof(*vnors), __func__);
     free_vnors = true;
   }
   else {
@@ -361,26 +456,51 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
       .pnors = pnors,
       .lnors_weighted = lnors_weighted,
       .vnors = vnors,
+      .vert_loop_map = vert_loop_map,
   };
 
   /* Compute poly normals, and prepare weighted loop normals. */
   BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
 
-  /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+  if (vert_loop_map != NULL) {
+    /* Accumulate weighted loop normals into vertex ones, normalize and validate them. */
+    BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_gather_cb, &settings);
   }
+  else {
+    /* Actually accumulate weighted loop normals into vertex ones. */
+    /* Unfortunately, not possible to thread that without a map from vertices to loops
+     * (not in a reasonable, totally lock- and barrier-free fashion),
+     * since several loops will point to the same vertex... */
+    for (int lidx = 0; lidx < numLoops; lidx++) {
+      add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+    }
 
-  /* Normalize and validate computed vertex normals. */
-  BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
+    /* Normalize and validate computed vertex normals. */
+    BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
+  }
 
   if (free_vnors) {
-    MEM_freeN(vnors);
+    BLI_scratch_free(vnors);
+  }
+  BLI_scratch_free(lnors_weighted);
+}
+
+/**
+ * \return The map to calculate vertex normals of \a mesh with, see #BKE_mesh_calc_normals_poly_ex.
+ * NULL when it's not worth creating (or caching) it.
+ */
+const MeshElemMap *BKE_mesh_calc_normals_vert_loop_map(Mesh *mesh)
+{
+  /* Original meshes have their topology changed in place by editing tools,
+   * only cache the map for evaluated meshes. */
+  if ((mesh->id.tag & (LIB_TAG_COPIED_ON_WRITE | LIB_TAG_NO_MAIN)) == 0) {
+    return NULL;
+  }
+  /* Accumulating vertex normals of small meshes is faster than creating the map. */
+  if (mesh->totloop < MESH_NORMALS_VERT_LOOP_MAP_MIN_LOOPS) {
+    return NULL;
   }
-  MEM_freeN(lnors_weighted);
+  return BKE_mesh_runtime_vert_loop_map_ensure(mesh);
 }
 
 void BKE_mesh_ensure_normals(Mesh *mesh)
@@ -407,15 +527,17 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
     }
 
     /* calculate poly/vert normals */
-    BKE_mesh_calc_normals_poly(mesh->mvert,
-                               NULL,
-                               mesh->totvert,
-                               mesh->mloop,
-                               mesh->mpoly,
-                               mesh->totloop,
-                               mesh->totpoly,
-                               poly_nors,
-                               !do_vert_normals);
+    BKE_mesh_calc_normals_poly_ex(mesh->mvert,
+                                  NULL,
+                                  mesh->totvert,
+                                  mesh->mloop,
+                                  mesh->mpoly,
+                                  mesh->totloop,
+                                  mesh->totpoly,
+                                  poly_nors,
+                                  !do_vert_normals,
+                                  do_vert_normals ? BKE_mesh_calc_normals_vert_loop_map(mesh) :
+                                                    NULL);
 
     if (do_add_poly_nors_cddata) {
       CustomData_add_layer(&mesh->pdata, CD_NORMAL, CD_ASSIGN, poly_nors, mesh->totpoly);
@@ -433,15 +555,16 @@ void BKE_mesh_calc_normals(Mesh *mesh)
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(BKE_mesh_calc_normals);
 #endif
-  BKE_mesh_calc_normals_poly(mesh->mvert,
-                             NULL,
-                             mesh->totvert,
-                             mesh->mloop,
-                             mesh->mpoly,
-                             mesh->totloop,
-                             mesh->totpoly,
-                             NULL,
-                             false);
+  BKE_mesh_calc_normals_poly_ex(mesh->mvert,
+                                NULL,
+                                mesh->totvert,
+                                mesh->mloop,
+                                mesh->mpoly,
+                                mesh->totloop,
+                                mesh->totpoly,
+                                NULL,
+                                false,
+                                BKE_mesh_calc_normals_vert_loop_map(mesh));
 #ifdef DEBUG_TIME
   TIMEIT_END_AVERAGED(BKE_mesh_calc_normals);
 #endif
@@ -455,10 +578,10 @@ void BKE_mesh_calc_normals_looptri(MVert *mverts,
                                    int looptri_num,
                                    float (*r_tri_nors)[3])
 {
-  float(*tnorms)[3] = MEM_calloc_arrayN((size_t)numVerts, sizeof(*tnorms), "tnorms");
-  float(*fnors)[3] = (r_tri_nors) ?
-                         r_tri_nors :
-                         MEM_calloc_arrayN((size_t)looptri_num, sizeof(*fnors), "meshnormals");
+  float(*tnorms)[3] = BLI_scratch_calloc_array((size_t)numVerts, sizeof(*tnorms), "tnorms");
+  float(*fnors)[3] = (r_tri_nors) ? r_tri_nors :
+                                    BLI_scratch_calloc_array(
+                                        (size_t)looptri_num, sizeof(*fnors), "meshnormals");
   int i;
 
   if (!tnorms || !fnors) {
@@ -498,10 +621,11 @@ void BKE_mesh_calc_normals_looptri(MVert *mverts,
   }
 
 cleanup:
-  MEM_freeN(tnorms);
-
-  if (fnors != r_tri_nors) {
-    MEM_freeN(fnors);
+  if (fnors && fnors != r_tri_nors) {
+    BLI_scratch_free(fnors);
+  }
+  if (tnorms) {
+    BLI_scratch_free(tnorms);
   }
 }
 
@@ -938,10 +1062,11 @@ void BKE_edges_sharp_from_angle_set(const struct MVert *mverts,
   }
 
   /* Mapping edge -> loops. See BKE_mesh_normals_loop_split() for details. */
-  int(*edge_to_loops)[2] = MEM_calloc_arrayN((size_t)numEdges, sizeof(*edge_to_loops), __func__);
+  int(*edge_to_loops)[2] = BLI_scratch_calloc_array(
+      (size_t)numEdges, sizeof(*edge_to_loops), __func__);
 
   /* Simple mapping from a loop to its polygon index. */
-  int *loop_to_poly = MEM_malloc_arrayN((size_t)numLoops, sizeof(*loop_to_poly), __func__);
+  int *loop_to_poly = BLI_scratch_alloc_array((size_t)numLoops, sizeof(*loop_to_poly), __func__);
 
   LoopSplitTaskDataCommon common_data = {
       .mverts = mverts,
@@ -957,8 +1082,8 @@ void BKE_edges_sharp_from_angle_set(const struct MVert *mverts,
 
   mesh_edges_sharp_tag(&common_data, true, split_angle, true);
 
-  MEM_freeN(edge_to_loops);
-  MEM_freeN(loop_to_poly);
+  BLI_scratch_free(loop_to_poly);
+  BLI_scratch_free(edge_to_loops);
 }
 
 void BKE_mesh_loop_manifold_fan_around_vert_next(const MLoop *mloops,
@@ -1655,12 +1780,13 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
    * However, if needed, we can store the negated value of loop index instead of INDEX_INVALID
    * to retrieve the real value later in code).
    * Note also that lose edges always have both values set to 0! */
-  int(*edge_to_loops)[2] = MEM_calloc_arrayN((size_t)numEdges, sizeof(*edge_to_loops), __func__);
+  int(*edge_to_loops)[2] = BLI_scratch_calloc_array(
+      (size_t)numEdges, sizeof(*edge_to_loops), __func__);
 
   /* Simple mapping from a loop to its polygon index. */
-  int *loop_to_poly = r_loop_to_poly ?
-                          r_loop_to_poly :
-                          MEM_malloc_arrayN((size_t)numLoops, sizeof(*loop_to_poly), __func__);
+  int *loop_to_poly = r_loop_to_poly ? r_loop_to_poly :
+                                       BLI_scratch_alloc_array(
+                                           (size_t)numLoops, sizeof(*loop_to_poly), __func__);
 
   /* When using custom loop normals, disable the angle feature! */
   const bool check_angle = (split_angle < (float)M_PI) && (clnors_data == NULL);
@@ -1717,10 +1843,10 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
     BLI_task_pool_free(task_pool);
   }
 
-  MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
-    MEM_freeN(loop_to_poly);
+    BLI_scratch_free(loop_to_poly);
   }
+  BLI_scratch_free(edge_to_loops);
 
   if (r_lnors_spacearr) {
     if (r_lnors_spacearr == &_lnors_spacearr) {
@@ -30,11 +30,14 @@
 #include "BLI_utildefines.h"
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "BKE_mesh_mapping.h"
 #include "BKE_customdata.h"
 #include "BLI_memarena.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"
 
 /* -------------------------------------------------------------------- */
@@ -282,6 +285,199 @@ void BKE_mesh_vert_loop_map_create(MeshElemMap **r_map,
   mesh_vert_poly_or_loop_map_create(r_map, r_mem, mpoly, mloop, totvert, totpoly, totloop, true);
 }
 
+/**
+ * Elements and the elements using them, for #mesh_elem_map_create_parallel.
+ */
+typedef enum eMeshElemMapType {
+  MESH_ELEM_MAP_VERT_LOOP,
+  MESH_ELEM_MAP_VERT_POLY,
+  MESH_ELEM_MAP_VERT_EDGE,
+  MESH_ELEM_MAP_EDGE_POLY,
+} eMeshElemMapType;
+
+typedef struct MeshElemMapParallelData {
+  MeshElemMap *map;
+  eMeshElemMapType type;
+  const MEdge *medge;
+  const MPoly *mpoly;
+  const MLoop *mloop;
+  /** Count the users when false, add them when true. */
+  bool do_fill;
+} MeshElemMapParallelData;
+
+BLI_INLINE void mesh_elem_map_parallel_add(MeshElemMapParallelData *data,
+                                           const uint elem,
+                                           const int user)
+{
+  MeshElemMap *map_elem = &data->map[elem];
+  if (data->do_fill) {
+    map_elem->indices[atomic_fetch_and_add_int32(&map_elem->count, 1)] = user;
+  }
+  else {
+    atomic_add_and_fetch_int32(&map_elem->count, 1);
+  }
+}
+
+static void mesh_elem_map_parallel_users_cb(void *__restrict userdata,
+                                            const int user,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshElemMapParallelData *data = userdata;
+
+  switch (data->type) {
+    case MESH_ELEM_MAP_VERT_LOOP: {
+      mesh_elem_map_parallel_add(data, data->mloop[user].v, user);
+      break;
+    }
+    case MESH_ELEM_MAP_VERT_EDGE: {
+      const MEdge *me = &data->medge[user];
+      mesh_elem_map_parallel_add(data, me->v1, user);
+      mesh_elem_map_parallel_add(data, me->v2, user);
+      break;
+    }
+    case MESH_ELEM_MAP_VERT_POLY:
+    case MESH_ELEM_MAP_EDGE_POLY: {
+      const MPoly *mp = &data->mpoly[user];
+      const MLoop *ml = &data->mloop[mp->loopstart];
+      const bool use_verts = (data->type == MESH_ELEM_MAP_VERT_POLY);
+      for (int j = 0; j < mp->totloop; j++, ml++) {
+        mesh_elem_map_parallel_add(data, use_verts ? ml->v : ml->e, user);
+      }
+      break;
+    }
+  }
+}
+
+static void mesh_elem_map_parallel_sort_cb(void *__restrict userdata,
+                                           const int elem,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshElemMapParallelData *data = userdata;
+  int *indices = data->map[elem].indices;
+  const int count = data->map[elem].count;
+
+  /* Insertion sort, elements have few users. */
+  for (int i = 1; i < count; i++) {
+    const int index = indices[i];
+    int j = i;
+    for (; j > 0 && indices[j - 1] > index; j--) {
+      indices[j] = indices[j - 1];
+    }
+    indices[j] = index;
+  }
+}
+
+/**
+ * Generates a map from \a totelem elements to their \a totuser users in parallel.
+ *
+ * The order in which threads add the users isn't defined, so the users are sorted afterwards.
+ * This gives the same maps as the single threaded functions, which loop over the users in order.
+ */
+static void mesh_elem_map_create_parallel(MeshElemMap **r_map,
+                                          int **r_mem,
+                                          const eMeshElemMapType type,
+                                          const MEdge *medge,
+                                          const MPoly *mpoly,
+                                          const MLoop *mloop,
+                                          const int totelem,
+                                          const int totuser,
+                                          const int totindices)
+{
+  MeshElemMap *map = MEM_callocN(sizeof(MeshElemMap) * (size_t)totelem, __func__);
+  int *indices = MEM_mallocN(sizeof(int) * (size_t)totindices, __func__);
+
+  MeshElemMapParallelData data = {
+      .map = map,
+      .type = type,
+      .medge = medge,
+      .mpoly = mpoly,
+      .mloop = mloop,
+      .do_fill = false,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
+  /* Count number of users for each element. */
+  BLI_task_parallel_range(0, totuser, &data, mesh_elem_map_parallel_users_cb, &settings);
+
+  /* Assign indices mem. */
+  int *index_iter = indices;
+  for (int i = 0; i < totelem; i++) {
+    map[i].indices = index_iter;
+    index_iter += map[i].count;
+
+    /* Reset 'count' for use as index when filling. */
+    map[i].count = 0;
+  }
+
+  /* Find the users. */
+  data.do_fill = true;
+  BLI_task_parallel_range(0, totuser, &data, mesh_elem_map_parallel_users_cb, &settings);
+  BLI_task_parallel_range(0, totelem, &data, mesh_elem_map_parallel_sort_cb, &settings);
+
+  *r_map = map;
+  *r_mem = indices;
+}
+
+/**
+ * Same as #BKE_mesh_vert_loop_map_create, but built in parallel,
+ * with the loops of every vertex sorted by index.
+ *
+ * Accumulating values of loops in the order of this map
+ * gives the same results as accumulating them in the order of the loops.
+ */
+void BKE_mesh_vert_loop_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const MLoop *mloop,
+                                            int totvert,
+                                            int totloop)
+{
+  mesh_elem_map_create_parallel(
+      r_map, r_mem, MESH_ELEM_MAP_VERT_LOOP, NULL, NULL, mloop, totvert, totloop, totloop);
+}
+
+/**
+ * Same as #BKE_mesh_vert_poly_map_create, but built in parallel.
+ */
+void BKE_mesh_vert_poly_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const MPoly *mpoly,
+                                            const MLoop *mloop,
+                                            int totvert,
+                                            int totpoly,
+                                            int totloop)
+{
+  mesh_elem_map_create_parallel(
+      r_map, r_mem, MESH_ELEM_MAP_VERT_POLY, NULL, mpoly, mloop, totvert, totpoly, totloop);
+}
+
+/**
+ * Same as #BKE_mesh_vert_edge_map_create, but built in parallel.
+ */
+void BKE_mesh_vert_edge_map_create_parallel(
+    MeshElemMap **r_map, int **r_mem, const MEdge *medge, int totvert, int totedge)
+{
+  mesh_elem_map_create_parallel(
+      r_map, r_mem, MESH_ELEM_MAP_VERT_EDGE, medge, NULL, NULL, totvert, totedge, totedge * 2);
+}
+
+/**
+ * Same as #BKE_mesh_edge_poly_map_create, but built in parallel.
+ */
+void BKE_mesh_edge_poly_map_create_parallel(MeshElemMap **r_map,
+                                            int **r_mem,
+                                            const int totedge,
+                                            const MPoly *mpoly,
+                                            const int totpoly,
+                                            const MLoop *mloop,
+                                            const int totloop)
+{
+  mesh_elem_map_create_parallel(
+      r_map, r_mem, MESH_ELEM_MAP_EDGE_POLY, NULL, mpoly, mloop, totedge, totpoly, totloop);
+}
+
 /**
  * Generates a map where the key is the edge and the value
  * is a list of looptris that use that edge.
@@ -33,6 +33,7 @@
 #include "BLI_alloca.h"
 #include "BLI_astar.h"
 #include "BLI_bitmap.h"
+#include "BLI_kdtree.h"
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_polyfill_2d.h"
@@ -78,6 +79,55 @@ static bool mesh_remap_bvhtree_query_nearest(BVHTreeFromMesh *treedata,
   }
 }
 
+/* Number of points the kd-tree scans linearly instead of visiting them as nodes. */
+#define MREMAP_KDTREE_BUCKET_LEN 8
+
+/**
+ * Find the nearest source vertex of all destination vertices at once,
+ * using a multi-threaded kd-tree search.
+ *
+ * \return An array of \a numverts_dst items,
+ * with -1 indices (and #FLT_MAX distances) when there are no source vertices.
+ */
+static KDTreeNearest_3d *mesh_remap_kdtree_query_nearest_verts(
+    const SpaceTransform *space_transform,
+    const MVert *verts_dst,
+    const int numverts_dst,
+    const Mesh *me_src)
+{
+  KDTreeNearest_3d *nearest = MEM_mallocN(sizeof(*nearest) * (size_t)numverts_dst, __func__);
+  float(*vcos_dst)[3] = MEM_mallocN(sizeof(*vcos_dst) * (size_t)numverts_dst, __func__);
+  KDTree_3d *tree = BLI_kdtree_3d_new((uint)me_src->totvert);
+  int i;
+
+  for (i = 0; i < me_src->totvert; i++) {
+    BLI_kdtree_3d_insert(tree, i, me_src->mvert[i].co);
+  }
+  BLI_kdtree_3d_balance_ex(tree, MREMAP_KDTREE_BUCKET_LEN);
+
+  for (i = 0; i < numverts_dst; i++) {
+    copy_v3_v3(vcos_dst[i], verts_dst[i].co);
+
+    /* Convert the vertex to tree coordinates, if needed. */
+    if (space_transform) {
+      BLI_space_transform_apply(space_transform, vcos_dst[i]);
+    }
+  }
+
+  if (BLI_kdtree_3d_find_nearest_n_batch(
+          tree, (const float(*)[3])vcos_dst, (uint)numverts_dst, nearest, 1) == 0) {
+    for (i = 0; i < numverts_dst; i++) {
+      nearest[i].index = -1;
+      nearest[i].dist = FLT_MAX;
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(vcos_dst);
+
+  return nearest;
+}
+
 static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
                                              BVHTreeRayHit *rayhit,
                                              const float co[3],
@@ -135,28 +185,15 @@ float BKE_mesh_remap_calc_difference_from_mesh(const SpaceTransform *space_trans
                                                const int numverts_dst,
                                                Mesh *me_src)
 {
-  BVHTreeFromMesh treedata = {NULL};
-  BVHTreeNearest nearest = {0};
-  float hit_dist;
-
   float result = 0.0f;
   int i;
 
-  BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-  nearest.index = -1;
+  KDTreeNearest_3d *nearest = mesh_remap_kdtree_query_nearest_verts(
+      space_transform, verts_dst, numverts_dst, me_src);
 
   for (i = 0; i < numverts_dst; i++) {
-    float tmp_co[3];
-
-    copy_v3_v3(tmp_co, verts_dst[i].co);
-
-    /* Convert the vertex to tree coordinates, if needed. */
-    if (space_transform) {
-      BLI_space_transform_apply(space_transform, tmp_co);
-    }
-
-    if (mesh_remap_bvhtree_query_nearest(&treedata, &nearest, tmp_co, FLT_MAX, &hit_dist)) {
-      result += 1.0f / (hit_dist + 1.0f);
+    if (nearest[i].index != -1) {
+      result += 1.0f / (nearest[i].dist + 1.0f);
     }
     else {
       /* No source for this dest vertex! */
@@ -164,6 +201,8 @@ float BKE_mesh_remap_calc_difference_from_mesh(const SpaceTransform *space_trans
     }
   }
 
+  MEM_freeN(nearest);
+
   result = ((float)numverts_dst / result) - 1.0f;
 
 #if 0
@@ -525,26 +564,21 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
     float tmp_co[3], tmp_no[3];
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
-      BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
+      KDTreeNearest_3d *vert_nearest = mesh_remap_kdtree_query_nearest_verts(
+          space_transform, verts_dst, numverts_dst, me_src);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+        if ((vert_nearest[i].index != -1) && (vert_nearest[i].dist <= max_dist)) {
+          mesh_remap_item_define(
+              r_map, i, vert_nearest[i].dist, 0, 1, &vert_nearest[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(vert_nearest);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
@@ -749,13 +783,10 @@ void BKE_mesh_remap_calc_edges_from_mesh(const int mode,
     float tmp_co[3], tmp_no[3];
 
     if (mode == MREMAP_MODE_EDGE_VERT_NEAREST) {
-      const int num_verts_src = me_src->totvert;
-      const int num_edges_src = me_src->totedge;
       MEdge *edges_src = me_src->medge;
       float(*vcos_src)[3] = BKE_mesh_vert_coords_alloc(me_src, NULL);
 
-      MeshElemMap *vert_to_edge_src_map;
-      int *vert_to_edge_src_map_mem;
+      const MeshElemMap *vert_to_edge_src_map = BKE_mesh_runtime_vert_edge_map_ensure(me_src);
 
       struct {
         float hit_dist;
@@ -767,12 +798,6 @@ void BKE_mesh_remap_calc_edges_from_mesh(const int mode,
         v_dst_to_src_map[i].hit_dist = -1.0f;
       }
 
-      BKE_mesh_vert_edge_map_create(&vert_to_edge_src_map,
-                                    &vert_to_edge_src_map_mem,
-                                    edges_src,
-                                    num_verts_src,
-                                    num_edges_src);
-
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
       nearest.index = -1;
 
@@ -872,8 +897,6 @@ void BKE_mesh_remap_calc_edges_from_mesh(const int mode,
 
       MEM_freeN(vcos_src);
       MEM_freeN(v_dst_to_src_map);
-      MEM_freeN(vert_to_edge_src_map);
-      MEM_freeN(vert_to_edge_src_map_mem);
     }
     else if (mode == MREMAP_MODE_EDGE_NEAREST) {
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_EDGES, 2);
@@ -1069,7 +1092,7 @@ static void mesh_island_to_astar_graph_edge_process(MeshIslandStore *islands,
                                                     MLoop *loops,
                                                     const int edge_idx,
                                                     BLI_bitmap *done_edges,
-                                                    MeshElemMap *edge_to_poly_map,
+                                                    const MeshElemMap *edge_to_poly_map,
                                                     const bool is_edge_innercut,
                                                     int *poly_island_index_map,
                                                     float (*poly_centers)[3],
@@ -1123,7 +1146,7 @@ static void mesh_island_to_astar_graph_edge_process(MeshIslandStore *islands,
 static void mesh_island_to_astar_graph(MeshIslandStore *islands,
                                        const int island_index,
                                        MVert *verts,
-                                       MeshElemMap *edge_to_poly_map,
+                                       const MeshElemMap *edge_to_poly_map,
                                        const int numedges,
                                        MLoop *loops,
                                        MPoly *polys,
@@ -1313,12 +1336,10 @@ void BKE_mesh_remap_calc_loops_from_mesh(const int mode,
 
     float(*poly_cents_src)[3] = NULL;
 
-    MeshElemMap *vert_to_loop_map_src = NULL;
-    int *vert_to_loop_map_src_buff = NULL;
-    MeshElemMap *vert_to_poly_map_src = NULL;
-    int *vert_to_poly_map_src_buff = NULL;
-    MeshElemMap *edge_to_poly_map_src = NULL;
-    int *edge_to_poly_map_src_buff = NULL;
+    /* Cached by the source mesh. */
+    const MeshElemMap *vert_to_loop_map_src = NULL;
+    const MeshElemMap *vert_to_poly_map_src = NULL;
+    const MeshElemMap *edge_to_poly_map_src = NULL;
     MeshElemMap *poly_to_looptri_map_src = NULL;
     int *poly_to_looptri_map_src_buff = NULL;
 
@@ -1427,33 +1448,14 @@ void BKE_mesh_remap_calc_loops_from_mesh(const int mode,
     }
 
     if (use_from_vert) {
-      BKE_mesh_vert_loop_map_create(&vert_to_loop_map_src,
-                                    &vert_to_loop_map_src_buff,
-                                    polys_src,
-                                    loops_src,
-                                    num_verts_src,
-                                    num_polys_src,
-                                    num_loops_src);
+      vert_to_loop_map_src = BKE_mesh_runtime_vert_loop_map_ensure(me_src);
       if (mode & MREMAP_USE_POLY) {
-        BKE_mesh_vert_poly_map_create(&vert_to_poly_map_src,
-                                      &vert_to_poly_map_src_buff,
-                                      polys_src,
-                                      loops_src,
-                                      num_verts_src,
-                                      num_polys_src,
-                                      num_loops_src);
+        vert_to_poly_map_src = BKE_mesh_runtime_vert_poly_map_ensure(me_src);
       }
     }
 
     /* Needed for islands (or plain mesh) to AStar graph conversion. */
-    BKE_mesh_edge_poly_map_create(&edge_to_poly_map_src,
-                                  &edge_to_poly_map_src_buff,
-                                  edges_src,
-                                  num_edges_src,
-                                  polys_src,
-                                  num_polys_src,
-                                  loops_src,
-                                  num_loops_src);
+    edge_to_poly_map_src = BKE_mesh_runtime_edge_poly_map_ensure(me_src);
     if (use_from_vert) {
       loop_to_poly_map_src = MEM_mallocN(sizeof(*loop_to_poly_map_src) * (size_t)num_loops_src,
                                          __func__);
@@ -1644,7 +1646,7 @@ void BKE_mesh_remap_calc_loops_from_mesh(const int mode,
         ml_dst = &loops_dst[mp_dst->loopstart];
         for (plidx_dst = 0; plidx_dst < mp_dst->totloop; plidx_dst++, ml_dst++) {
           if (use_from_vert) {
-            MeshElemMap *vert_to_refelem_map_src = NULL;
+            const MeshElemMap *vert_to_refelem_map_src = NULL;
 
             copy_v3_v3(tmp_co, verts_dst[ml_dst->v].co);
             nearest.index = -1;
@@ -2151,24 +2153,6 @@ void BKE_mesh_remap_calc_loops_from_mesh(const int mode,
     if (vcos_src) {
       MEM_freeN(vcos_src);
     }
-    if (vert_to_loop_map_src) {
-      MEM_freeN(vert_to_loop_map_src);
-    }
-    if (vert_to_loop_map_src_buff) {
-      MEM_freeN(vert_to_loop_map_src_buff);
-    }
-    if (vert_to_poly_map_src) {
-      MEM_freeN(vert_to_poly_map_src);
-    }
-    if (vert_to_poly_map_src_buff) {
-      MEM_freeN(vert_to_poly_map_src_buff);
-    }
-    if (edge_to_poly_map_src) {
-      MEM_freeN(edge_to_poly_map_src);
-    }
-    if (edge_to_poly_map_src_buff) {
-      MEM_freeN(edge_to_poly_map_src_buff);
-    }
     if (poly_to_looptri_map_src) {
       MEM_freeN(poly_to_looptri_map_src);
     }
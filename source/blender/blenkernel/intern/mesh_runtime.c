@@ -29,12 +29,14 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_object_types.h"
 
+#include "BLI_math_base.h"
 #include "BLI_math_geom.h"
 #include "BLI_threads.h"
 
 #include "BKE_bvhutils.h"
 #include "BKE_library.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_mesh_runtime.h"
 #include "BKE_subdiv_ccg.h"
 #include "BKE_shrinkwrap.h"
@@ -69,6 +71,8 @@ void BKE_mesh_runtime_reset_on_copy(Mesh *mesh, const int UNUSED(flag))
   memset(&runtime->looptris, 0, sizeof(runtime->looptris));
   runtime->bvh_cache = NULL;
   runtime->shrinkwrap_data = NULL;
+  runtime->topology_cache = NULL;
+  runtime->vertex_weights = NULL;
 
   mesh->runtime.eval_mutex = MEM_mallocN(sizeof(ThreadMutex), "mesh runtime eval_mutex");
   BLI_mutex_init(mesh->runtime.eval_mutex);
@@ -229,6 +233,8 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
 {
   bvhcache_free(&mesh->runtime.bvh_cache);
   MEM_SAFE_FREE(mesh->runtime.looptris.array);
+  BKE_mesh_runtime_topology_cache_clear(mesh);
+  BKE_mesh_runtime_vertex_weights_clear(mesh);
   /* TODO(sergey): Does this really belong here? */
   if (mesh->runtime.subdiv_ccg != NULL) {
     BKE_subdiv_ccg_destroy(mesh->runtime.subdiv_ccg);
@@ -239,6 +245,297 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Mesh Topology Cache
+ *
+ * Maps between mesh elements, built on first use and kept until the topology changes.
+ *
+ * Evaluated copies referencing the same topology arrays share one reference counted cache,
+ * so a map built for one modifier is reused by the following ones and by the draw code.
+ *
+ * The cache isn't validated when used: code changing the topology of a mesh in place
+ * has to call #BKE_mesh_runtime_clear_geometry or #BKE_mesh_runtime_topology_cache_clear
+ * (the topology functions of 'mesh_validate.c' do), like for the other runtime caches.
+ * Clearing only drops the reference of that mesh, copies sharing the cache keep using it.
+ * \{ */
+
+typedef enum eMeshTopologyMapType {
+  MESH_TOPOLOGY_MAP_VERT_LOOP = 0,
+  MESH_TOPOLOGY_MAP_VERT_POLY,
+  MESH_TOPOLOGY_MAP_VERT_EDGE,
+  MESH_TOPOLOGY_MAP_EDGE_POLY,
+} eMeshTopologyMapType;
+#define MESH_TOPOLOGY_MAP_TOT (MESH_TOPOLOGY_MAP_EDGE_POLY + 1)
+
+typedef struct MeshTopologyCache {
+  /** Number of meshes using this cache. */
+  int users;
+  char _pad[4];
+
+  /** Serializes building of the maps, reading them doesn't lock. */
+  ThreadMutex build_mutex;
+
+  MeshElemMap *maps[MESH_TOPOLOGY_MAP_TOT];
+  int *maps_mem[MESH_TOPOLOGY_MAP_TOT];
+} MeshTopologyCache;
+
+static MeshTopologyCache *mesh_topology_cache_create(void)
+{
+  MeshTopologyCache *cache = MEM_callocN(sizeof(*cache), __func__);
+  cache->users = 1;
+  BLI_mutex_init(&cache->build_mutex);
+  return cache;
+}
+
+static void mesh_topology_cache_release(MeshTopologyCache *cache)
+{
+  if (atomic_sub_and_fetch_int32(&cache->users, 1) != 0) {
+    return;
+  }
+  for (int i = 0; i < MESH_TOPOLOGY_MAP_TOT; i++) {
+    MEM_SAFE_FREE(cache->maps[i]);
+    MEM_SAFE_FREE(cache->maps_mem[i]);
+  }
+  BLI_mutex_end(&cache->build_mutex);
+  MEM_freeN(cache);
+}
+
+/**
+ * Get the cache of the mesh, creating it when needed.
+ *
+ * Thread safe, as long as the topology of the mesh isn't modified meanwhile.
+ */
+static MeshTopologyCache *mesh_topology_cache_ensure(const Mesh *mesh)
+{
+  Mesh_Runtime *runtime = (Mesh_Runtime *)&mesh->runtime;
+  MeshTopologyCache *cache = runtime->topology_cache;
+
+  if (cache == NULL) {
+    MeshTopologyCache *cache_new = mesh_topology_cache_create();
+    cache = atomic_cas_ptr((void **)&runtime->topology_cache, NULL, cache_new);
+    if (cache == NULL) {
+      cache = cache_new;
+    }
+    else {
+      /* Another thread was faster. */
+      mesh_topology_cache_release(cache_new);
+    }
+  }
+  return cache;
+}
+
+static const MeshElemMap *mesh_topology_map_ensure(Mesh *mesh, const eMeshTopologyMapType type)
+{
+  MeshTopologyCache *cache = mesh_topology_cache_ensure(mesh);
+  MeshElemMap *map = cache->maps[type];
+
+  if (map == NULL) {
+    BLI_mutex_lock(&cache->build_mutex);
+    /* Another thread may have built the map meanwhile. */
+    if (cache->maps[type] == NULL) {
+      int *map_mem;
+      switch (type) {
+        case MESH_TOPOLOGY_MAP_VERT_LOOP:
+          BKE_mesh_vert_loop_map_create_parallel(
+              &map, &map_mem, mesh->mloop, mesh->totvert, mesh->totloop);
+          break;
+        case MESH_TOPOLOGY_MAP_VERT_POLY:
+          BKE_mesh_vert_poly_map_create_parallel(&map,
+                                                 &map_mem,
+                                                 mesh->mpoly,
+                                                 mesh->mloop,
+                                                 mesh->totvert,
+                                                 mesh->totpoly,
+                                                 mesh->totloop);
+          break;
+        case MESH_TOPOLOGY_MAP_VERT_EDGE:
+          BKE_mesh_vert_edge_map_create_parallel(
+              &map, &map_mem, mesh->medge, mesh->totvert, mesh->totedge);
+          break;
+        case MESH_TOPOLOGY_MAP_EDGE_POLY:
+          BKE_mesh_edge_poly_map_create_parallel(&map,
+                                                 &map_mem,
+                                                 mesh->totedge,
+                                                 mesh->mpoly,
+                                                 mesh->totpoly,
+                                                 mesh->mloop,
+                                                 mesh->totloop);
+          break;
+      }
+      cache->maps_mem[type] = map_mem;
+      /* Publish the map only once it is complete. */
+      atomic_cas_ptr((void **)&cache->maps[type], NULL, map);
+    }
+    map = cache->maps[type];
+    BLI_mutex_unlock(&cache->build_mutex);
+  }
+  return map;
+}
+
+/**
+ * Map from vertices to the loops using them, sorted by loop index,
+ * see #BKE_mesh_vert_loop_map_create_parallel.
+ */
+const MeshElemMap *BKE_mesh_runtime_vert_loop_map_ensure(Mesh *mesh)
+{
+  return mesh_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_LOOP);
+}
+
+/**
+ * Map from vertices to the polygons using them, like #BKE_mesh_vert_poly_map_create.
+ */
+const MeshElemMap *BKE_mesh_runtime_vert_poly_map_ensure(Mesh *mesh)
+{
+  return mesh_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_POLY);
+}
+
+/**
+ * Map from vertices to the edges using them, like #BKE_mesh_vert_edge_map_create.
+ */
+const MeshElemMap *BKE_mesh_runtime_vert_edge_map_ensure(Mesh *mesh)
+{
+  return mesh_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_EDGE);
+}
+
+/**
+ * Map from edges to the polygons using them, like #BKE_mesh_edge_poly_map_create.
+ */
+const MeshElemMap *BKE_mesh_runtime_edge_poly_map_ensure(Mesh *mesh)
+{
+  return mesh_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_EDGE_POLY);
+}
+
+/**
+ * Let \a me_dst use the topology cache of \a me_src, when it references the same topology.
+ * Used when copying evaluated meshes, so maps are only built once for all the copies.
+ */
+void BKE_mesh_runtime_topology_cache_share(Mesh *me_dst, const Mesh *me_src)
+{
+  BLI_assert(me_dst->runtime.topology_cache == NULL);
+
+  if ((me_src->id.tag & (LIB_TAG_COPIED_ON_WRITE | LIB_TAG_NO_MAIN)) == 0) {
+    /* Original meshes are edited in place, they don't use the cache. */
+    return;
+  }
+  if (!(me_dst->medge == me_src->medge && me_dst->mpoly == me_src->mpoly &&
+        me_dst->mloop == me_src->mloop && me_dst->totvert == me_src->totvert)) {
+    return;
+  }
+
+  MeshTopologyCache *cache = mesh_topology_cache_ensure(me_src);
+  atomic_add_and_fetch_int32(&cache->users, 1);
+  me_dst->runtime.topology_cache = cache;
+}
+
+/**
+ * Stop using the topology cache, the maps are freed when no other mesh uses them.
+ * Call when changing the topology of \a mesh in place.
+ */
+void BKE_mesh_runtime_topology_cache_clear(Mesh *mesh)
+{
+  if (mesh->runtime.topology_cache != NULL) {
+    mesh_topology_cache_release(mesh->runtime.topology_cache);
+    mesh->runtime.topology_cache = NULL;
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Mesh Vertex Weights
+ *
+ * The deform weights of all vertices packed in one array, vertex after vertex,
+ * so deforming doesn't have to follow a pointer per vertex.
+ *
+ * Only built for the copy-on-write mesh of an object, which the armature deform uses
+ * for every evaluation until the mesh is copied again. Original meshes and evaluated results
+ * are modified in place so they keep using #Mesh.dvert directly.
+ * \{ */
+
+static MeshVertexWeights *mesh_vertex_weights_create(const Mesh *mesh)
+{
+  MeshVertexWeights *vertex_weights = MEM_mallocN(sizeof(*vertex_weights), __func__);
+  const MDeformVert *dvert = mesh->dvert;
+  const int totvert = mesh->totvert;
+
+  int *offsets = MEM_malloc_arrayN((size_t)totvert + 1, sizeof(*offsets), __func__);
+  int totweight = 0;
+  for (int i = 0; i < totvert; i++) {
+    offsets[i] = totweight;
+    totweight += dvert[i].totweight;
+  }
+  offsets[totvert] = totweight;
+
+  MDeformWeight *weights = MEM_malloc_arrayN(
+      (size_t)max_ii(totweight, 1), sizeof(*weights), __func__);
+  for (int i = 0; i < totvert; i++) {
+    if (dvert[i].totweight != 0) {
+      memcpy(&weights[offsets[i]], dvert[i].dw, sizeof(*weights) * (size_t)dvert[i].totweight);
+    }
+  }
+
+  vertex_weights->offsets = offsets;
+  vertex_weights->weights = weights;
+  vertex_weights->dvert = dvert;
+  vertex_weights->totvert = totvert;
+  return vertex_weights;
+}
+
+static void mesh_vertex_weights_free(MeshVertexWeights *vertex_weights)
+{
+  MEM_freeN(vertex_weights->offsets);
+  MEM_freeN(vertex_weights->weights);
+  MEM_freeN(vertex_weights);
+}
+
+/**
+ * Get the packed deform weights of the copy-on-write \a mesh, building them on first use.
+ *
+ * Returns NULL when the mesh has no deform weights or isn't a copy-on-write datablock,
+ * callers then read #Mesh.dvert. Thread safe.
+ */
+const MeshVertexWeights *BKE_mesh_runtime_vertex_weights_ensure(Mesh *mesh)
+{
+  if ((mesh->id.tag & (LIB_TAG_COPIED_ON_WRITE | LIB_TAG_COPIED_ON_WRITE_EVAL_RESULT)) !=
+      LIB_TAG_COPIED_ON_WRITE) {
+    return NULL;
+  }
+  if (mesh->dvert == NULL) {
+    return NULL;
+  }
+
+  MeshVertexWeights *vertex_weights = mesh->runtime.vertex_weights;
+  if (vertex_weights == NULL) {
+    MeshVertexWeights *vertex_weights_new = mesh_vertex_weights_create(mesh);
+    vertex_weights = atomic_cas_ptr(
+        (void **)&mesh->runtime.vertex_weights, NULL, vertex_weights_new);
+    if (vertex_weights == NULL) {
+      vertex_weights = vertex_weights_new;
+    }
+    else {
+      /* Another thread was faster. */
+      mesh_vertex_weights_free(vertex_weights_new);
+    }
+  }
+
+  if (vertex_weights->dvert != mesh->dvert || vertex_weights->totvert != mesh->totvert) {
+    /* The weights were replaced without clearing the runtime data, other threads may still be
+     * reading the table so leave freeing it to #BKE_mesh_runtime_clear_geometry. */
+    return NULL;
+  }
+  return vertex_weights;
+}
+
+void BKE_mesh_runtime_vertex_weights_clear(Mesh *mesh)
+{
+  if (mesh->runtime.vertex_weights != NULL) {
+    mesh_vertex_weights_free(mesh->runtime.vertex_weights);
+    mesh->runtime.vertex_weights = NULL;
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Mesh Batch Cache Callbacks
  * \{ */
@@ -42,6 +42,7 @@
 #include "BKE_customdata.h"
 #include "BKE_deform.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
 
 #include "DEG_depsgraph.h"
 
@@ -897,6 +898,10 @@ bool BKE_mesh_validate_arrays(Mesh *mesh,
 
   BLI_assert((*r_changed == false) || (do_fixes == true));
 
+  if (*r_changed) {
+    BKE_mesh_runtime_topology_cache_clear(mesh);
+  }
+
   return is_valid;
 }
 
@@ -1175,7 +1180,7 @@ void BKE_mesh_strip_loose_faces(Mesh *me)
     }
   }
   if (a != b) {
-    CustomData_free_elem(&me->fdata, b, a - b);
+    CustomData_free_elem(&me->fdata, b, a - b, a);
     me->totface = b;
   }
 }
@@ -1224,7 +1229,7 @@ void BKE_mesh_strip_loose_polysloops(Mesh *me)
     }
   }
   if (a != b) {
-    CustomData_free_elem(&me->pdata, b, a - b);
+    CustomData_free_elem(&me->pdata, b, a - b, a);
     me->totpoly = b;
   }
 
@@ -1245,7 +1250,7 @@ void BKE_mesh_strip_loose_polysloops(Mesh *me)
     }
   }
   if (a != b) {
-    CustomData_free_elem(&me->ldata, b, a - b);
+    CustomData_free_elem(&me->ldata, b, a - b, a);
     me->totloop = b;
   }
 
@@ -1256,6 +1261,8 @@ void BKE_mesh_strip_loose_polysloops(Mesh *me)
   }
 
   MEM_freeN(new_idx);
+
+  BKE_mesh_runtime_topology_cache_clear(me);
 }
 
 void BKE_mesh_strip_loose_edges(Mesh *me)
@@ -1279,7 +1286,7 @@ void BKE_mesh_strip_loose_edges(Mesh *me)
     }
   }
   if (a != b) {
-    CustomData_free_elem(&me->edata, b, a - b);
+    CustomData_free_elem(&me->edata, b, a - b, a);
     me->totedge = b;
   }
 
@@ -1291,6 +1298,8 @@ void BKE_mesh_strip_loose_edges(Mesh *me)
   }
 
   MEM_freeN(new_idx);
+
+  BKE_mesh_runtime_topology_cache_clear(me);
 }
 /** \} */
 
@@ -1485,6 +1494,8 @@ void BKE_mesh_calc_edges_legacy(Mesh *me, const bool use_old)
   MEdge *medge;
   int totedge = 0;
 
+  BKE_mesh_runtime_topology_cache_clear(me);
+
   mesh_calc_edges_mdata(me->mvert,
                         me->mface,
                         me->mloop,
@@ -1607,6 +1618,8 @@ void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
   mesh->medge = CustomData_get_layer(&mesh->edata, CD_MEDGE);
 
   BLI_edgehash_free(eh, NULL);
+
+  BKE_mesh_runtime_topology_cache_clear(mesh);
 }
 
 void BKE_mesh_calc_edges_loose(Mesh *mesh)
@@ -1684,6 +1697,8 @@ void BKE_mesh_calc_edges_tessface(Mesh *mesh)
   mesh->medge = CustomData_get_layer(&mesh->edata, CD_MEDGE);
 
   BLI_edgeset_free(eh);
+
+  BKE_mesh_runtime_topology_cache_clear(mesh);
 }
 
 /** \} */
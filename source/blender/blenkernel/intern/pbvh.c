@@ -25,6 +25,7 @@
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
 #include "BLI_ghash.h"
+#include "BLI_openhash.h"
 #include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
@@ -253,12 +254,11 @@ void pbvh_grow_nodes(PBVH *bvh, int totnode)
 /* Add a vertex to the map, with a positive value for unique vertices and
  * a negative value for additional vertices */
 static int map_insert_vert(
-    PBVH *bvh, GHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
+    PBVH *bvh, IntHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
 {
-  void *key, **value_p;
+  int *value_p;
 
-  key = POINTER_FROM_INT(vertex);
-  if (!BLI_ghash_ensure_p(map, key, &value_p)) {
+  if (!BLI_inthash_ensure_p(map, vertex, &value_p)) {
     int value_i;
     if (BLI_BITMAP_TEST(bvh->vert_bitmap, vertex) == 0) {
       BLI_BITMAP_ENABLE(bvh->vert_bitmap, vertex);
@@ -269,11 +269,11 @@ static int map_insert_vert(
       value_i = ~(*face_verts);
       (*face_verts)++;
     }
-    *value_p = POINTER_FROM_INT(value_i);
+    *value_p = value_i;
     return value_i;
   }
   else {
-    return POINTER_AS_INT(*value_p);
+    return *value_p;
   }
 }
 
@@ -286,7 +286,7 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
   const int totface = node->totprim;
 
   /* reserve size is rough guess */
-  GHash *map = BLI_ghash_int_new_ex("build_mesh_leaf_node gh", 2 * totface);
+  IntHash *map = BLI_inthash_new_ex("build_mesh_leaf_node gh", 2 * totface);
 
   int(*face_vert_indices)[3] = MEM_mallocN(sizeof(int[3]) * totface, "bvh node face vert indices");
 
@@ -309,16 +309,15 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
   node->vert_indices = vert_indices;
 
   /* Build the vertex list, unique verts first */
-  GHashIterator gh_iter;
-  GHASH_ITER (gh_iter, map) {
-    void *value = BLI_ghashIterator_getValue(&gh_iter);
-    int ndx = POINTER_AS_INT(value);
+  IntHashIterator ih_iter;
+  INTHASH_ITER (ih_iter, map) {
+    int ndx = BLI_inthashIterator_getValue(&ih_iter);
 
     if (ndx < 0) {
       ndx = -ndx + node->uniq_verts - 1;
     }
 
-    vert_indices[ndx] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+    vert_indices[ndx] = BLI_inthashIterator_getKey(&ih_iter);
   }
 
   for (int i = 0; i < totface; i++) {
@@ -335,7 +334,7 @@ static void build_mesh_leaf_node(PBVH *bvh, PBVHNode *node)
 
   BKE_pbvh_node_fully_hidden_set(node, !has_visible);
 
-  BLI_ghash_free(map, NULL, NULL);
+  BLI_inthash_free(map);
 }
 
 static void update_vb(PBVH *bvh, PBVHNode *node, BBC *prim_bbc, int offset, int count)
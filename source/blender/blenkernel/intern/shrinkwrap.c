@@ -341,89 +341,83 @@ void BKE_shrinkwrap_compute_boundary_data(struct Mesh *mesh)
  * Shrinkwrap to the nearest vertex
  *
  * it builds a kdtree of vertexs we can attach to and then
- * for each vertex performs a nearest vertex search on the tree
+ * performs a batched nearest vertex search on the tree for all weighted vertices
  */
-static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
-                                                 const int i,
-                                                 const TaskParallelTLS *__restrict tls)
+static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
 {
-  ShrinkwrapCalcCBData *data = userdata;
-
-  ShrinkwrapCalcData *calc = data->calc;
-  BVHTreeFromMesh *treeData = &data->tree->treeData;
-  BVHTreeNearest *nearest = tls->userdata_chunk;
-
-  float *co = calc->vertexCos[i];
-  float tmp_co[3];
-  float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
-
-  if (calc->invert_vgroup) {
-    weight = 1.0f - weight;
-  }
+  BVHTreeFromMesh *treeData = &calc->tree->treeData;
 
-  if (weight == 0.0f) {
-    return;
-  }
+  int *verts_index = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*verts_index), __func__);
+  float *verts_weight = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*verts_weight), __func__);
+  float(*tree_co)[3] = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*tree_co), __func__);
+  int verts_num = 0;
 
-  /* Convert the vertex to tree coordinates */
-  if (calc->vert) {
-    copy_v3_v3(tmp_co, calc->vert[i].co);
-  }
-  else {
-    copy_v3_v3(tmp_co, co);
-  }
-  BLI_space_transform_apply(&calc->local2target, tmp_co);
+  for (int i = 0; i < calc->numVerts; i++) {
+    float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
 
-  /* Use local proximity heuristics (to reduce the nearest search)
-   *
-   * If we already had an hit before.. we assume this vertex is going to have a close hit to that
-   * other vertex so we can initiate the "nearest.dist" with the expected value to that last hit.
-   * This will lead in pruning of the search tree. */
-  if (nearest->index != -1) {
-    nearest->dist_sq = len_squared_v3v3(tmp_co, nearest->co);
-  }
-  else {
-    nearest->dist_sq = FLT_MAX;
-  }
+    if (calc->invert_vgroup) {
+      weight = 1.0f - weight;
+    }
 
-  BLI_bvhtree_find_nearest(treeData->tree, tmp_co, nearest, treeData->nearest_callback, treeData);
+    if (weight == 0.0f) {
+      continue;
+    }
 
-  /* Found the nearest vertex */
-  if (nearest->index != -1) {
-    /* Adjusting the vertex weight,
-     * so that after interpolating it keeps a certain distance from the nearest position */
-    if (nearest->dist_sq > FLT_EPSILON) {
-      const float dist = sqrtf(nearest->dist_sq);
-      weight *= (dist - calc->keepDist) / dist;
+    /* Convert the vertex to tree coordinates */
+    float *tmp_co = tree_co[verts_num];
+    if (calc->vert) {
+      copy_v3_v3(tmp_co, calc->vert[i].co);
+    }
+    else {
+      copy_v3_v3(tmp_co, calc->vertexCos[i]);
     }
+    BLI_space_transform_apply(&calc->local2target, tmp_co);
+
+    verts_index[verts_num] = i;
+    verts_weight[verts_num] = weight;
+    verts_num++;
+  }
+
+  BVHTreeNearest *nearest = MEM_malloc_arrayN((size_t)verts_num, sizeof(*nearest), __func__);
+  for (int j = 0; j < verts_num; j++) {
+    nearest[j].index = -1;
+    nearest[j].dist_sq = FLT_MAX;
+  }
+
+  BLI_bvhtree_find_nearest_batch(treeData->tree,
+                                 (const float(*)[3])tree_co,
+                                 verts_num,
+                                 nearest,
+                                 treeData->nearest_callback,
+                                 treeData,
+                                 0);
+
+  for (int j = 0; j < verts_num; j++) {
+    /* Found the nearest vertex */
+    if (nearest[j].index != -1) {
+      float *co = calc->vertexCos[verts_index[j]];
+      float weight = verts_weight[j];
+      float tmp_co[3];
+
+      /* Adjusting the vertex weight,
+       * so that after interpolating it keeps a certain distance from the nearest position */
+      if (nearest[j].dist_sq > FLT_EPSILON) {
+        const float dist = sqrtf(nearest[j].dist_sq);
+        weight *= (dist - calc->keepDist) / dist;
+      }
 
-    /* Convert the coordinates back to mesh coordinates */
-    copy_v3_v3(tmp_co, nearest->co);
-    BLI_space_transform_invert(&calc->local2target, tmp_co);
+      /* Convert the coordinates back to mesh coordinates */
+      copy_v3_v3(tmp_co, nearest[j].co);
+      BLI_space_transform_invert(&calc->local2target, tmp_co);
 
-    interp_v3_v3v3(co, co, tmp_co, weight); /* linear interpolation */
+      interp_v3_v3v3(co, co, tmp_co, weight); /* linear interpolation */
+    }
   }
-}
-
-static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
-{
-  BVHTreeNearest nearest = NULL_BVHTreeNearest;
-
-  /* Setup nearest */
-  nearest.index = -1;
-  nearest.dist_sq = FLT_MAX;
 
-  ShrinkwrapCalcCBData data = {
-      .calc = calc,
-      .tree = calc->tree,
-  };
-  TaskParallelSettings settings;
-  BLI_parallel_range_settings_defaults(&settings);
-  settings.use_threading = (calc->numVerts > BKE_MESH_OMP_LIMIT);
-  settings.userdata_chunk = &nearest;
-  settings.userdata_chunk_size = sizeof(nearest);
-  BLI_task_parallel_range(
-      0, calc->numVerts, &data, shrinkwrap_calc_nearest_vertex_cb_ex, &settings);
+  MEM_freeN(nearest);
+  MEM_freeN(tree_co);
+  MEM_freeN(verts_weight);
+  MEM_freeN(verts_index);
 }
 
 /*
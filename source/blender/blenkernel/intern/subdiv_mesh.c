@@ -381,7 +381,7 @@ static void loop_interpolation_from_corner(const SubdivMeshContext *ctx,
     LoopsOfPtex loops_of_ptex;
     loops_of_ptex_get(ctx, &loops_of_ptex, coarse_poly, corner);
     /* Ptex face corner corresponds to a poly loop with same index. */
-    CustomData_free_elem(&loop_interpolation->loop_data_storage, 0, 1);
+    CustomData_free_elem(&loop_interpolation->loop_data_storage, 0, 1, 4);
     CustomData_copy_data(
         loop_data, &loop_interpolation->loop_data_storage, coarse_poly->loopstart + corner, 0, 1);
     /* Interpolate remaining ptex face corners, which hits loops
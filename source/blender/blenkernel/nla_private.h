@@ -41,6 +41,9 @@ typedef struct NlaEvalStrip {
   short strip_mode;  /* which end of the strip are we looking at */
 
   float strip_time; /* time at which which strip is being evaluated */
+
+  /* Values of the action F-Curves evaluated ahead of blending, or NULL. */
+  float *fcurve_values;
 } NlaEvalStrip;
 
 /* NlaEvalStrip->strip_mode */
@@ -138,6 +141,12 @@ typedef struct NlaEvalData {
 
   /* Evaluation result shapshot. */
   NlaEvalSnapshot eval_snapshot;
+
+  /* Channels affected by the F-Curves of each action (bAction -> NlaEvalActionChannels),
+   * only when the data is kept between evaluations. */
+  GHash *action_channels;
+  /* Some channel is a property of another ID than the evaluated one. */
+  bool has_foreign_channels;
 } NlaEvalData;
 
 /* Information about the currently edited strip and ones below it for keyframing. */
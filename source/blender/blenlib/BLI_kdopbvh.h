@@ -105,6 +105,9 @@ enum {
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
+/* Rebuild sub-trees whose excess area doubled, see #BLI_bvhtree_update_tree_ex. */
+#define BVH_REFIT_REBUILD_THRESHOLD 1.0f
+
 /* callback must update nearest in case it finds a nearest result */
 typedef void (*BVHTree_NearestPointCallback)(void *userdata,
                                              int index,
@@ -154,6 +157,9 @@ void BLI_bvhtree_balance(BVHTree *tree);
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
+void BLI_bvhtree_update_tree_ex(BVHTree *tree, const float rebuild_threshold);
+
+bool BLI_bvhtree_pack(BVHTree *tree);
 
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
@@ -193,6 +199,16 @@ int BLI_bvhtree_find_nearest(BVHTree *tree,
                              BVHTree_NearestPointCallback callback,
                              void *userdata);
 
+/* multi-threaded find nearest for an array of coordinates,
+ * nearest must be an initialized array of co_num elements */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_num,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag);
+
 int BLI_bvhtree_find_nearest_first(BVHTree *tree,
                                    const float co[3],
                                    const float dist_sq,
@@ -215,6 +231,18 @@ int BLI_bvhtree_ray_cast(BVHTree *tree,
                          BVHTree_RayCastCallback callback,
                          void *userdata);
 
+/* multi-threaded ray-cast for arrays of rays,
+ * hits must be an initialized array of rays_num elements */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
+
 void BLI_bvhtree_ray_cast_all_ex(BVHTree *tree,
                                  const float co[3],
                                  const float dir[3],
@@ -37,6 +37,7 @@ typedef struct KDTreeNearest {
 KDTree *BLI_kdtree_nd_(new)(unsigned int maxsize);
 void BLI_kdtree_nd_(free)(KDTree *tree);
 void BLI_kdtree_nd_(balance)(KDTree *tree) ATTR_NONNULL(1);
+void BLI_kdtree_nd_(balance_ex)(KDTree *tree, const uint bucket_len) ATTR_NONNULL(1);
 
 void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS]) ATTR_NONNULL(1, 3);
 int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
@@ -66,6 +67,20 @@ void BLI_kdtree_nd_(range_search_cb)(
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
     void *user_data);
 
+/* Multi-threaded searches for arrays of coordinates. */
+int BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                         const float (*co)[KD_DIMS],
+                                         const uint co_len,
+                                         KDTreeNearest *r_nearest,
+                                         const uint nearest_len_capacity) ATTR_NONNULL(1);
+int BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                       const float (*co)[KD_DIMS],
+                                       const uint co_len,
+                                       const float range,
+                                       const uint nearest_len_max,
+                                       uint **r_nearest_offset,
+                                       KDTreeNearest **r_nearest) ATTR_NONNULL(1, 6, 7);
+
 int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
                                          const float range,
                                          bool use_index_order,
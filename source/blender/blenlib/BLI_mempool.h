@@ -83,6 +83,13 @@ enum {
    * order of allocation when no chunks have been freed.
    */
   BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+  /** allow allocating and freeing elements from multiple threads at once.
+   *
+   * \note other functions (including iteration, clearing and destroying)
+   * still require the pool not to be modified by other threads.
+   * \note the order of iteration isn't the order of allocation.
+   */
+  BLI_MEMPOOL_CONCURRENT = (1 << 1),
 };
 
 void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -0,0 +1,73 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_OPENHASH_H__
+#define __BLI_OPENHASH_H__
+
+/** \file
+ * \ingroup bli
+ * \brief Open addressing hash tables with typed keys and values.
+ *
+ * Unlike #GHash there is no allocation per entry: entries are stored in one array
+ * (which is what iterators walk over) and the hash only stores indices into it.
+ * As with #GHash, the table must not be modified while iterating over it.
+ *
+ * For edge keys see #EdgeHash.
+ */
+
+/* (void *) -> (void *) version */
+#define OPENHASH_KEY void *
+#define OPENHASH_VALUE void *
+#define OPENHASH_PREFIX_ID BLI_ptrhash
+#define OPENHASH_ITER_PREFIX_ID BLI_ptrhashIterator
+#define OpenHash PtrHash
+#define OpenHashEntry PtrHashEntry
+#define OpenHashIterator PtrHashIterator
+#include "BLI_openhash_impl.h"
+#undef OPENHASH_KEY
+#undef OPENHASH_VALUE
+#undef OPENHASH_PREFIX_ID
+#undef OPENHASH_ITER_PREFIX_ID
+#undef OpenHash
+#undef OpenHashEntry
+#undef OpenHashIterator
+
+/* (int) -> (int) version */
+#define OPENHASH_KEY int
+#define OPENHASH_VALUE int
+#define OPENHASH_PREFIX_ID BLI_inthash
+#define OPENHASH_ITER_PREFIX_ID BLI_inthashIterator
+#define OpenHash IntHash
+#define OpenHashEntry IntHashEntry
+#define OpenHashIterator IntHashIterator
+#include "BLI_openhash_impl.h"
+#undef OPENHASH_KEY
+#undef OPENHASH_VALUE
+#undef OPENHASH_PREFIX_ID
+#undef OPENHASH_ITER_PREFIX_ID
+#undef OpenHash
+#undef OpenHashEntry
+#undef OpenHashIterator
+
+#define PTRHASH_ITER(ohi_, oh_) \
+  for (BLI_ptrhashIterator_init(&(ohi_), oh_); BLI_ptrhashIterator_done(&(ohi_)) == false; \
+       BLI_ptrhashIterator_step(&(ohi_)))
+
+#define INTHASH_ITER(ohi_, oh_) \
+  for (BLI_inthashIterator_init(&(ohi_), oh_); BLI_inthashIterator_done(&(ohi_)) == false; \
+       BLI_inthashIterator_step(&(ohi_)))
+
+#endif /* __BLI_OPENHASH_H__ */
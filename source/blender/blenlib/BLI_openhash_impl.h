@@ -0,0 +1,98 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ * \brief Open addressing hash table, included once per key/value type.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_utildefines.h"
+
+#define _BLI_OPENHASH_CONCAT_AUX(MACRO_ARG1, MACRO_ARG2) MACRO_ARG1##MACRO_ARG2
+#define _BLI_OPENHASH_CONCAT(MACRO_ARG1, MACRO_ARG2) _BLI_OPENHASH_CONCAT_AUX(MACRO_ARG1, MACRO_ARG2)
+#define BLI_openhash_(id) _BLI_OPENHASH_CONCAT(OPENHASH_PREFIX_ID, _##id)
+#define BLI_openhashIterator_(id) _BLI_OPENHASH_CONCAT(OPENHASH_ITER_PREFIX_ID, _##id)
+
+struct OpenHash;
+typedef struct OpenHash OpenHash;
+
+typedef struct OpenHashEntry {
+  OPENHASH_KEY key;
+  OPENHASH_VALUE value;
+} OpenHashEntry;
+
+typedef struct OpenHashIterator {
+  OpenHashEntry *entries;
+  unsigned int length;
+  unsigned int index;
+} OpenHashIterator;
+
+OpenHash *BLI_openhash_(new_ex)(const char *info,
+                                const unsigned int nentries_reserve) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT;
+OpenHash *BLI_openhash_(new)(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_openhash_(free)(OpenHash *oh);
+void BLI_openhash_(reserve)(OpenHash *oh, const unsigned int nentries_reserve);
+void BLI_openhash_(insert)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE value);
+bool BLI_openhash_(reinsert)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE value);
+OPENHASH_VALUE BLI_openhash_(lookup)(const OpenHash *oh,
+                                     OPENHASH_KEY key) ATTR_WARN_UNUSED_RESULT;
+OPENHASH_VALUE BLI_openhash_(lookup_default)(const OpenHash *oh,
+                                             OPENHASH_KEY key,
+                                             OPENHASH_VALUE value_default)
+    ATTR_WARN_UNUSED_RESULT;
+OPENHASH_VALUE *BLI_openhash_(lookup_p)(OpenHash *oh, OPENHASH_KEY key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_openhash_(ensure_p)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE **r_value)
+    ATTR_WARN_UNUSED_RESULT;
+bool BLI_openhash_(haskey)(const OpenHash *oh, OPENHASH_KEY key) ATTR_WARN_UNUSED_RESULT;
+bool BLI_openhash_(remove)(OpenHash *oh, OPENHASH_KEY key);
+bool BLI_openhash_(pop)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE *r_value);
+unsigned int BLI_openhash_(len)(const OpenHash *oh) ATTR_WARN_UNUSED_RESULT;
+void BLI_openhash_(clear_ex)(OpenHash *oh, const unsigned int nentries_reserve);
+void BLI_openhash_(clear)(OpenHash *oh);
+
+void BLI_openhashIterator_(init)(OpenHashIterator *ohi, OpenHash *oh);
+
+BLI_INLINE void BLI_openhashIterator_(step)(OpenHashIterator *ohi)
+{
+  ohi->index++;
+}
+BLI_INLINE bool BLI_openhashIterator_(done)(const OpenHashIterator *ohi)
+{
+  return ohi->index >= ohi->length;
+}
+BLI_INLINE OPENHASH_KEY BLI_openhashIterator_(getKey)(const OpenHashIterator *ohi)
+{
+  return ohi->entries[ohi->index].key;
+}
+BLI_INLINE OPENHASH_VALUE BLI_openhashIterator_(getValue)(const OpenHashIterator *ohi)
+{
+  return ohi->entries[ohi->index].value;
+}
+BLI_INLINE OPENHASH_VALUE *BLI_openhashIterator_(getValue_p)(OpenHashIterator *ohi)
+{
+  return &ohi->entries[ohi->index].value;
+}
+BLI_INLINE void BLI_openhashIterator_(setValue)(OpenHashIterator *ohi, OPENHASH_VALUE value)
+{
+  ohi->entries[ohi->index].value = value;
+}
+
+#undef _BLI_OPENHASH_CONCAT_AUX
+#undef _BLI_OPENHASH_CONCAT
+#undef BLI_openhash_
+#undef BLI_openhashIterator_
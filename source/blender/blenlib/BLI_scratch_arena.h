@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLI_SCRATCH_ARENA_H__
+#define __BLI_SCRATCH_ARENA_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * Scratch memory for temporary buffers allocated during an evaluation
+ * (such as a dependency graph evaluation).
+ *
+ * A #ScratchArena is bound to the threads doing the evaluation, each thread allocates from its
+ * own bump allocator, without locking. Memory is only reclaimed when it's freed in the reverse
+ * order of allocation, or when the arena is reset at the end of the evaluation.
+ * Resetting keeps the memory for the next evaluation, so evaluating repeatedly (e.g. during
+ * animation playback) doesn't need to allocate memory.
+ *
+ * When no arena is bound to the calling thread the memory is allocated with #MEM_mallocN,
+ * so functions may use #BLI_scratch_alloc and #BLI_scratch_free for their temporary buffers
+ * regardless of where they are called from.
+ *
+ * \note Only use for buffers which are freed by the function allocating them
+ * (or before the evaluation ends), the memory is reused after the arena is reset.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ScratchArena;
+typedef struct ScratchArena ScratchArena;
+
+ScratchArena *BLI_scratch_arena_new(const char *name) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void BLI_scratch_arena_free(ScratchArena *arena) ATTR_NONNULL(1);
+void BLI_scratch_arena_reset(ScratchArena *arena) ATTR_NONNULL(1);
+ScratchArena *BLI_scratch_arena_bind(ScratchArena *arena);
+void BLI_scratch_arena_stats(const ScratchArena *arena, size_t *r_reserved, size_t *r_used_peak)
+    ATTR_NONNULL(1, 2, 3);
+
+void *BLI_scratch_alloc(size_t size, const char *name) ATTR_WARN_UNUSED_RESULT ATTR_MALLOC
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *BLI_scratch_calloc(size_t size, const char *name) ATTR_WARN_UNUSED_RESULT ATTR_MALLOC
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *BLI_scratch_alloc_array(size_t len, size_t size, const char *name) ATTR_WARN_UNUSED_RESULT
+    ATTR_MALLOC ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *BLI_scratch_calloc_array(size_t len, size_t size, const char *name) ATTR_WARN_UNUSED_RESULT
+    ATTR_MALLOC ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void BLI_scratch_free(void *ptr) ATTR_NONNULL(1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_SCRATCH_ARENA_H__ */
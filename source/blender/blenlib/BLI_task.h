@@ -36,8 +36,9 @@ struct BLI_mempool;
 
 /* Task Scheduler
  *
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Depending
+ * on the backend, either a single queue holds the task from all pools, or every
+ * thread has its own deque and idle threads steal work from busy ones.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -50,10 +51,27 @@ enum {
   TASK_SCHEDULER_SINGLE_THREAD = 1,
 };
 
+typedef enum eTaskSchedulerBackend {
+  /* All tasks go through a single queue protected by a mutex. */
+  TASK_SCHEDULER_BACKEND_QUEUE = 0,
+  /* Each thread pushes to and pops from its own deque, idle threads steal the
+   * oldest tasks from other threads' deques. Nested pools and parallel ranges
+   * push to the deque of the thread they are created from, so they are executed
+   * by that thread and whichever threads are idle, without extra threads. */
+  TASK_SCHEDULER_BACKEND_WORK_STEALING = 1,
+} eTaskSchedulerBackend;
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads);
+TaskScheduler *BLI_task_scheduler_create_ex(int num_threads, eTaskSchedulerBackend backend);
 void BLI_task_scheduler_free(TaskScheduler *scheduler);
 
 int BLI_task_scheduler_num_threads(TaskScheduler *scheduler);
+eTaskSchedulerBackend BLI_task_scheduler_backend(TaskScheduler *scheduler);
+
+/* Backend used by schedulers created with #BLI_task_scheduler_create(),
+ * must be set before the global scheduler is created. */
+void BLI_task_scheduler_backend_default_set(eTaskSchedulerBackend backend);
+eTaskSchedulerBackend BLI_task_scheduler_backend_default_get(void);
 
 /* Task Pool
  *
@@ -36,10 +36,17 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * Optionally a flattened 4-wide copy of the tree can be built with #BLI_bvhtree_pack,
+ * ray-cast and nearest queries then test 4 child bounds at once (#BVHPackedNode).
  */
 
 #include <assert.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_utildefines.h"
@@ -48,6 +55,7 @@
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_heap_simple.h"
 
 #include "BLI_strict_flags.h"
@@ -68,10 +76,17 @@
  */
 #ifdef DEBUG
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 0
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD 0
 #else
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
+/* Branches with more leafs than this are split using all threads, see #split_leafs_binned. */
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD 16384
 #endif
 
+/* Number of leafs handled by each task of #split_leafs_binned & #refit_kdop_hull_parallel. */
+#define KDOPBVH_SPLIT_BLOCK_SIZE 4096
+#define KDOPBVH_SPLIT_BINS 1024
+
 /* -------------------------------------------------------------------- */
 /** \name Struct Definitions
  * \{ */
@@ -90,12 +105,52 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
+/* Number of children tested at once by the packed layout. */
+#define BVH_PACKED_WIDTH 4
+#define BVH_PACKED_EMPTY INT_MIN
+/**
+ * Enough for balanced trees with many more leafs than fit in memory,
+ * deeper (degenerate) trees are not packed, see #BLI_bvhtree_pack.
+ */
+#define BVH_PACKED_STACK_SIZE 256
+
+/**
+ * A node of the flattened tree built by #BLI_bvhtree_pack,
+ * aligned and sized to two cache lines.
+ *
+ * Only the axis aligned part of the k-DOP is stored, per axis so the bounds
+ * of all children can be loaded into one SIMD register.
+ */
+typedef struct BVHPackedNode {
+  float bv_min[3][BVH_PACKED_WIDTH];
+  float bv_max[3][BVH_PACKED_WIDTH];
+  /**
+   * >= 0: index of a packed child node.
+   * Otherwise #BVH_PACKED_EMPTY or the bitwise not of the leaf index in #BVHTree.nodearray.
+   */
+  int child[BVH_PACKED_WIDTH];
+  int _pad[4];
+} BVHPackedNode;
+
+BLI_STATIC_ASSERT(sizeof(BVHPackedNode) == 128, "over sized")
+
+typedef struct BVHPacked {
+  BVHPackedNode *nodes;
+  /** The nodes the bounds of each child have been copied from (used to refit). */
+  const BVHNode **nodes_src;
+  int totnode;
+  /** Depth of the deepest packed node, the root having depth 0. */
+  int depth;
+} BVHPacked;
+
 /* keep under 26 bytes for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
   BVHNode *nodearray;  /* pre-alloc branch nodes */
   BVHNode **nodechild; /* pre-alloc childs for nodes */
   float *nodebv;       /* pre-alloc bounding-volumes for nodes */
+  BVHPacked *packed;   /* optional, see #BLI_bvhtree_pack */
+  float *branch_quality; /* per branch, see #BLI_bvhtree_update_tree_ex */
   float epsilon;       /* epslion is used for inflation of the k-dop      */
   int totleaf;         /* leafs */
   int totbranch;
@@ -105,8 +160,8 @@ struct BVHTree {
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 64) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 40),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -372,18 +427,12 @@ static void create_kdop_hull(
   }
 }
 
-/**
- * \note depends on the fact that the BVH's for each face is already built
- */
-static void refit_kdop_hull(const BVHTree *tree, BVHNode *node, int start, int end)
+static void refit_kdop_hull_range(const BVHTree *tree, float *__restrict bv, int start, int end)
 {
   float newmin, newmax;
-  float *__restrict bv = node->bv;
   int j;
   axis_t axis_iter;
 
-  node_minmax_init(tree, node);
-
   for (j = start; j < end; j++) {
     float *__restrict node_bv = tree->nodes[j]->bv;
 
@@ -402,6 +451,73 @@ static void refit_kdop_hull(const BVHTree *tree, BVHNode *node, int start, int e
   }
 }
 
+/**
+ * \note depends on the fact that the BVH's for each face is already built
+ */
+static void refit_kdop_hull(const BVHTree *tree, BVHNode *node, int start, int end)
+{
+  node_minmax_init(tree, node);
+  refit_kdop_hull_range(tree, node->bv, start, end);
+}
+
+typedef struct BVHRefitData {
+  const BVHTree *tree;
+  float *bv;
+  int start, end;
+} BVHRefitData;
+
+static void refit_kdop_hull_parallel_cb(void *__restrict userdata,
+                                        const int block,
+                                        const TaskParallelTLS *__restrict tls)
+{
+  const BVHRefitData *data = userdata;
+  const int start = data->start + block * KDOPBVH_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_BLOCK_SIZE, data->end);
+  refit_kdop_hull_range(data->tree, tls->userdata_chunk, start, end);
+}
+
+static void refit_kdop_hull_parallel_finalize(void *__restrict userdata,
+                                              void *__restrict userdata_chunk)
+{
+  const BVHRefitData *data = userdata;
+  const BVHTree *tree = data->tree;
+  const float *bv_chunk = userdata_chunk;
+
+  for (axis_t axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+    data->bv[(2 * axis_iter)] = min_ff(data->bv[(2 * axis_iter)], bv_chunk[(2 * axis_iter)]);
+    data->bv[(2 * axis_iter) + 1] = max_ff(data->bv[(2 * axis_iter) + 1],
+                                           bv_chunk[(2 * axis_iter) + 1]);
+  }
+}
+
+/**
+ * Multi-threaded #refit_kdop_hull, for branches with many leafs.
+ */
+static void refit_kdop_hull_parallel(const BVHTree *tree, BVHNode *node, int start, int end)
+{
+  float bv_chunk[26];
+  BVHRefitData data = {
+      .tree = tree,
+      .bv = node->bv,
+      .start = start,
+      .end = end,
+  };
+
+  node_minmax_init(tree, node);
+  memcpy(bv_chunk, node->bv, sizeof(float) * (size_t)(tree->stop_axis * 2));
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.userdata_chunk = bv_chunk;
+  settings.userdata_chunk_size = sizeof(bv_chunk);
+  settings.func_finalize = refit_kdop_hull_parallel_finalize;
+  BLI_task_parallel_range(0,
+                          (end - start + KDOPBVH_SPLIT_BLOCK_SIZE - 1) / KDOPBVH_SPLIT_BLOCK_SIZE,
+                          &data,
+                          refit_kdop_hull_parallel_cb,
+                          &settings);
+}
+
 /**
  * only supports x,y,z axis in the moment
  * but we should use a plain and simple function here for speed sake */
@@ -684,6 +800,133 @@ static void split_leafs(BVHNode **leafs_array,
   }
 }
 
+typedef struct BVHSplitBinnedData {
+  BVHNode **leafs_array;
+  BVHNode **leafs_tmp;
+  int start, end;
+  int split_axis;
+  float key_min, key_scale;
+  /** Per block: the number of leafs in each bin, then the write offset of each bin. */
+  int (*bins)[KDOPBVH_SPLIT_BINS];
+} BVHSplitBinnedData;
+
+BLI_INLINE int split_leafs_binned_bin(const BVHSplitBinnedData *data, const BVHNode *node)
+{
+  const int bin = (int)((node->bv[data->split_axis] - data->key_min) * data->key_scale);
+  return CLAMPIS(bin, 0, KDOPBVH_SPLIT_BINS - 1);
+}
+
+static void split_leafs_binned_count_cb(void *__restrict userdata,
+                                        const int block,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHSplitBinnedData *data = userdata;
+  int *bins = data->bins[block];
+  const int start = data->start + block * KDOPBVH_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_BLOCK_SIZE, data->end);
+
+  for (int j = start; j < end; j++) {
+    bins[split_leafs_binned_bin(data, data->leafs_array[j])]++;
+  }
+}
+
+static void split_leafs_binned_scatter_cb(void *__restrict userdata,
+                                          const int block,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHSplitBinnedData *data = userdata;
+  int *offsets = data->bins[block];
+  const int start = data->start + block * KDOPBVH_SPLIT_BLOCK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_BLOCK_SIZE, data->end);
+
+  for (int j = start; j < end; j++) {
+    BVHNode *node = data->leafs_array[j];
+    data->leafs_tmp[offsets[split_leafs_binned_bin(data, node)]++] = node;
+  }
+}
+
+/**
+ * Multi-threaded version of #split_leafs, for branches with many leafs.
+ *
+ * The leafs are first sorted into bins along the \a split_axis (a parallel counting sort),
+ * then only the bins containing a partition boundary need #partition_nth_element.
+ * The result is a valid partition as described for #split_leafs.
+ *
+ * \param bv: Bounds of all leafs in the range.
+ */
+static void split_leafs_binned(BVHNode **leafs_array,
+                               const int nth[],
+                               const int partitions,
+                               const int split_axis,
+                               const float *bv)
+{
+  const int start = nth[0];
+  const int end = nth[partitions];
+  const float key_min = bv[split_axis & ~1];
+  const float key_max = bv[split_axis | 1];
+
+  if (!(key_max > key_min)) {
+    split_leafs(leafs_array, nth, partitions, split_axis);
+    return;
+  }
+
+  const int blocks_num = (end - start + KDOPBVH_SPLIT_BLOCK_SIZE - 1) / KDOPBVH_SPLIT_BLOCK_SIZE;
+  int bins_start[KDOPBVH_SPLIT_BINS + 1];
+
+  BVHSplitBinnedData data = {
+      .leafs_array = leafs_array,
+      .leafs_tmp = MEM_mallocN(sizeof(*data.leafs_tmp) * (size_t)(end - start), __func__),
+      .start = start,
+      .end = end,
+      .split_axis = split_axis,
+      .key_min = key_min,
+      .key_scale = (float)KDOPBVH_SPLIT_BINS / (key_max - key_min),
+      .bins = MEM_callocN(sizeof(*data.bins) * (size_t)blocks_num, __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+
+  BLI_task_parallel_range(0, blocks_num, &data, split_leafs_binned_count_cb, &settings);
+
+  /* Convert counts to offsets, keeping the order of blocks within each bin. */
+  int offset = 0;
+  for (int bin = 0; bin < KDOPBVH_SPLIT_BINS; bin++) {
+    bins_start[bin] = offset;
+    for (int block = 0; block < blocks_num; block++) {
+      const int count = data.bins[block][bin];
+      data.bins[block][bin] = offset;
+      offset += count;
+    }
+  }
+  bins_start[KDOPBVH_SPLIT_BINS] = offset;
+  BLI_assert(offset == end - start);
+
+  BLI_task_parallel_range(0, blocks_num, &data, split_leafs_binned_scatter_cb, &settings);
+
+  memcpy(&leafs_array[start], data.leafs_tmp, sizeof(*leafs_array) * (size_t)(end - start));
+
+  /* Bins are ordered, only partition within the bins a boundary falls into. */
+  int bin = 0;
+  for (int i = 1; i < partitions; i++) {
+    const int n = nth[i];
+    if (n >= end) {
+      break;
+    }
+    while (start + bins_start[bin + 1] <= n) {
+      bin++;
+    }
+    const int bin_begin = start + bins_start[bin];
+    if (n != bin_begin) {
+      partition_nth_element(
+          leafs_array, max_ii(bin_begin, nth[i - 1]), start + bins_start[bin + 1], n, split_axis);
+    }
+  }
+
+  MEM_freeN(data.leafs_tmp);
+  MEM_freeN(data.bins);
+}
+
 typedef struct BVHDivNodesData {
   const BVHTree *tree;
   BVHNode *branches_array;
@@ -697,6 +940,9 @@ typedef struct BVHDivNodesData {
   int depth;
   int i;
   int first_of_next_level;
+
+  /** Use threads to split each branch, when a level has fewer branches than threads. */
+  bool use_threading_split;
 } BVHDivNodesData;
 
 static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
@@ -716,7 +962,12 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
 
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  if (data->use_threading_split) {
+    refit_kdop_hull_parallel(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
+  else {
+    refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
   split_axis = get_largest_axis(parent->bv);
 
   /* Save split axis (this can be used on raytracing to speedup the query time) */
@@ -735,7 +986,13 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
     nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
   }
 
-  split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  if (data->use_threading_split) {
+    split_leafs_binned(
+        data->leafs_array, nth_positions, data->tree_type, split_axis, parent->bv);
+  }
+  else {
+    split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  }
 
   /* Setup children and totnode counters
    * Not really needed but currently most of BVH code
@@ -765,6 +1022,39 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
   parent->totnode = (char)k;
 }
 
+/**
+ * Divide the branches [i_begin, i_stop) of one level.
+ */
+static void non_recursive_bvh_div_nodes_level(BVHDivNodesData *cb_data,
+                                              const int i_begin,
+                                              const int i_stop,
+                                              const int num_leafs)
+{
+  const int level_len = i_stop - i_begin;
+  const BVHBuildHelper *data = cb_data->data;
+  const int level_leafs = implicit_leafs_index(data, cb_data->depth, i_stop - cb_data->i) -
+                          implicit_leafs_index(data, cb_data->depth, i_begin - cb_data->i);
+  const bool use_threading = (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD);
+
+  /* The first levels have few large branches, use all threads for each of them instead. */
+  cb_data->use_threading_split = use_threading && (level_len < BLI_system_thread_count()) &&
+                                 (level_leafs / level_len > KDOPBVH_THREAD_SPLIT_THRESHOLD);
+
+  if (!cb_data->use_threading_split) {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = use_threading;
+    BLI_task_parallel_range(
+        i_begin, i_stop, cb_data, non_recursive_bvh_div_nodes_task_cb, &settings);
+  }
+  else {
+    TaskParallelTLS tls = {0};
+    for (int i_task = i_begin; i_task < i_stop; i_task++) {
+      non_recursive_bvh_div_nodes_task_cb(cb_data, i_task, &tls);
+    }
+  }
+}
+
 /**
  * This functions builds an optimal implicit tree from the given leafs.
  * Where optimal stands for:
@@ -841,22 +1131,285 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
     cb_data.i = i;
     cb_data.depth = depth;
 
-    if (true) {
-      TaskParallelSettings settings;
-      BLI_parallel_range_settings_defaults(&settings);
-      settings.use_threading = (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD);
-      BLI_task_parallel_range(i, i_stop, &cb_data, non_recursive_bvh_div_nodes_task_cb, &settings);
+    non_recursive_bvh_div_nodes_level(&cb_data, i, i_stop, num_leafs);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Packed Layout
+ *
+ * A flattened copy of the tree with up to #BVH_PACKED_WIDTH children per node,
+ * binary trees are collapsed by pulling grand-children up into free child slots.
+ * \{ */
+
+static void bvhtree_packed_free(BVHTree *tree)
+{
+  if (tree->packed) {
+    MEM_freeN(tree->packed->nodes);
+    MEM_freeN((void *)tree->packed->nodes_src);
+    MEM_freeN(tree->packed);
+    tree->packed = NULL;
+  }
+}
+
+static void bvhtree_packed_node_set_bounds(BVHPackedNode *pnode, const int i, const BVHNode *node)
+{
+  for (int axis = 0; axis < 3; axis++) {
+    pnode->bv_min[axis][i] = node->bv[2 * axis];
+    pnode->bv_max[axis][i] = node->bv[2 * axis + 1];
+  }
+}
+
+static int bvhtree_packed_build_recursive(const BVHTree *tree,
+                                          BVHPacked *packed,
+                                          const BVHNode *node,
+                                          const int depth)
+{
+  const BVHNode *slots[BVH_PACKED_WIDTH];
+  int slots_len = 0;
+  bool changed;
+
+  BLI_assert(node->totnode <= BVH_PACKED_WIDTH);
+  for (int i = 0; i < node->totnode; i++) {
+    slots[slots_len++] = node->children[i];
+  }
+
+  /* Replace branches by their children while they fit. */
+  do {
+    changed = false;
+    for (int i = 0; i < slots_len; i++) {
+      const BVHNode *slot = slots[i];
+      if (slot->totnode != 0 && slots_len + slot->totnode - 1 <= BVH_PACKED_WIDTH) {
+        slots[i] = slot->children[0];
+        for (int j = 1; j < slot->totnode; j++) {
+          slots[slots_len++] = slot->children[j];
+        }
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  const int index = packed->totnode++;
+  BVHPackedNode *pnode = &packed->nodes[index];
+  packed->depth = max_ii(packed->depth, depth);
+  const BVHNode **pnode_src = &packed->nodes_src[index * BVH_PACKED_WIDTH];
+
+  for (int i = 0; i < BVH_PACKED_WIDTH; i++) {
+    if (i < slots_len) {
+      bvhtree_packed_node_set_bounds(pnode, i, slots[i]);
+      pnode_src[i] = slots[i];
+      if (slots[i]->totnode == 0) {
+        pnode->child[i] = ~(int)(slots[i] - tree->nodearray);
+      }
+      else {
+        pnode->child[i] = bvhtree_packed_build_recursive(tree, packed, slots[i], depth + 1);
+      }
     }
     else {
-      /* Less hassle for debugging. */
-      TaskParallelTLS tls = {0};
-      for (int i_task = i; i_task < i_stop; i_task++) {
-        non_recursive_bvh_div_nodes_task_cb(&cb_data, i_task, &tls);
+      /* Unused, the traversal skips empty children. */
+      for (int axis = 0; axis < 3; axis++) {
+        pnode->bv_min[axis][i] = FLT_MAX;
+        pnode->bv_max[axis][i] = -FLT_MAX;
+      }
+      pnode_src[i] = NULL;
+      pnode->child[i] = BVH_PACKED_EMPTY;
+    }
+  }
+
+  return index;
+}
+
+typedef struct BVHPackedStackItem {
+  int child;
+  float dist;
+} BVHPackedStackItem;
+
+/**
+ * Push the children of \a pnode closer than \a dist_max, sorted so the nearest is popped first.
+ */
+BLI_INLINE void bvhtree_packed_stack_push(BVHPackedStackItem *stack,
+                                          int *stack_len,
+                                          const BVHPackedNode *pnode,
+                                          const float dist[BVH_PACKED_WIDTH],
+                                          const float dist_max)
+{
+  BVHPackedStackItem *items = &stack[*stack_len];
+  int items_len = 0;
+
+  BLI_assert(*stack_len + BVH_PACKED_WIDTH <= BVH_PACKED_STACK_SIZE);
+
+  for (int i = 0; i < BVH_PACKED_WIDTH; i++) {
+    if (dist[i] < dist_max && pnode->child[i] != BVH_PACKED_EMPTY) {
+      int j;
+      for (j = items_len++; j > 0 && items[j - 1].dist < dist[i]; j--) {
+        items[j] = items[j - 1];
       }
+      items[j].child = pnode->child[i];
+      items[j].dist = dist[i];
+    }
+  }
+  *stack_len += items_len;
+}
+
+static void bvhtree_packed_refit(BVHTree *tree)
+{
+  BVHPacked *packed = tree->packed;
+  for (int index = 0; index < packed->totnode; index++) {
+    BVHPackedNode *pnode = &packed->nodes[index];
+    const BVHNode **pnode_src = &packed->nodes_src[index * BVH_PACKED_WIDTH];
+    for (int i = 0; i < BVH_PACKED_WIDTH; i++) {
+      if (pnode_src[i]) {
+        bvhtree_packed_node_set_bounds(pnode, i, pnode_src[i]);
+      }
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Refit Quality
+ *
+ * Refitting keeps the structure of the tree, deforming can make siblings overlap
+ * so much that a rebuild of the affected sub-trees pays off.
+ * \{ */
+
+/**
+ * Surface area like measure of a k-DOP (the half surface area for AABB's).
+ */
+static float node_area(const BVHTree *tree, const BVHNode *node)
+{
+  float area = 0.0f;
+  for (axis_t axis_a = tree->start_axis; axis_a < tree->stop_axis; axis_a++) {
+    const float extent_a = node->bv[(2 * axis_a) + 1] - node->bv[(2 * axis_a)];
+    for (axis_t axis_b = axis_a + 1; axis_b < tree->stop_axis; axis_b++) {
+      area += extent_a * (node->bv[(2 * axis_b) + 1] - node->bv[(2 * axis_b)]);
+    }
+  }
+  return area;
+}
+
+/**
+ * Area of the children in excess of the area of \a node,
+ * this grows as the children overlap more, making queries visit more of them.
+ */
+static float node_quality(const BVHTree *tree, const BVHNode *node)
+{
+  const float area = node_area(tree, node);
+  float area_children = 0.0f;
+
+  for (int i = 0; i < node->totnode; i++) {
+    area_children += node_area(tree, node->children[i]);
+  }
+
+  return (area > 0.0f) ? max_ff(area_children / area - 1.0f, 0.0f) : 0.0f;
+}
+
+/**
+ * Store the quality of branches [branch_begin, branch_end) (implicit tree indices, root is 1).
+ */
+static void bvhtree_branch_quality_calc(BVHTree *tree,
+                                        const int branch_begin,
+                                        const int branch_end)
+{
+  const BVHNode *branches_array = tree->nodearray + (tree->totleaf - 1);
+  for (int branch = branch_begin; branch < branch_end; branch++) {
+    tree->branch_quality[branch - 1] = node_quality(tree, &branches_array[branch]);
+  }
+}
+
+/**
+ * Collect the top-most branches which lost quality past \a threshold.
+ */
+static void bvhtree_find_degraded_recursive(const BVHTree *tree,
+                                            const BVHNode *node,
+                                            const float threshold,
+                                            int *r_branches,
+                                            int *r_branches_len)
+{
+  const BVHNode *branches_array = tree->nodearray + (tree->totleaf - 1);
+  bool has_branch_children = false;
+
+  for (int i = 0; i < node->totnode; i++) {
+    if (node->children[i]->totnode != 0) {
+      has_branch_children = true;
+      break;
+    }
+  }
+
+  /* Rebuilding only moves leafs between children, nothing to gain when they're all leafs. */
+  if (!has_branch_children) {
+    return;
+  }
+
+  const int branch = (int)(node - branches_array);
+  const float quality_built = tree->branch_quality[branch - 1];
+  /* Without overlap when built there's no factor to grow by,
+   * compare the excess area relative to the branch itself with the threshold instead. */
+  const float quality_max = (quality_built > 0.0f) ? quality_built * (1.0f + threshold) :
+                                                     threshold;
+  if (node_quality(tree, node) > quality_max) {
+    r_branches[(*r_branches_len)++] = branch;
+    return;
+  }
+
+  for (int i = 0; i < node->totnode; i++) {
+    if (node->children[i]->totnode != 0) {
+      bvhtree_find_degraded_recursive(
+          tree, node->children[i], threshold, r_branches, r_branches_len);
     }
   }
 }
 
+/**
+ * Re-divide the leafs of \a branch (implicit tree index) between the branches below it,
+ * the same way #BLI_bvhtree_balance does.
+ */
+static void bvhtree_rebuild_subtree(BVHTree *tree, const BVHBuildHelper *build_data, int branch)
+{
+  const int tree_type = tree->tree_type;
+  const int tree_offset = 2 - tree->tree_type;
+  const int num_branches = tree->totbranch;
+  int i = 1, depth = 1;
+
+  BVHDivNodesData cb_data = {
+      .tree = tree,
+      .branches_array = tree->nodearray + (tree->totleaf - 1),
+      .leafs_array = tree->nodes,
+      .tree_type = tree_type,
+      .tree_offset = tree_offset,
+      .data = build_data,
+  };
+
+  /* Find the level of the branch. */
+  while (branch >= i * tree_type + tree_offset) {
+    i = i * tree_type + tree_offset;
+    depth++;
+  }
+
+  /* Branches of the sub-tree on each level are contiguous. */
+  for (int begin = branch, end = branch + 1; begin <= num_branches;
+       begin = begin * tree_type + tree_offset, end = end * tree_type + tree_offset) {
+    cb_data.first_of_next_level = i * tree_type + tree_offset;
+    cb_data.i = i;
+    cb_data.depth = depth;
+
+    non_recursive_bvh_div_nodes_level(
+        &cb_data, begin, min_ii(end, num_branches + 1), tree->totleaf);
+
+    i = cb_data.first_of_next_level;
+    depth++;
+  }
+
+  /* Children bounds are only known once the levels below are done. */
+  for (int begin = branch, end = branch + 1; begin <= num_branches;
+       begin = begin * tree_type + tree_offset, end = end * tree_type + tree_offset) {
+    bvhtree_branch_quality_calc(tree, begin, min_ii(end, num_branches + 1));
+  }
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -945,6 +1498,8 @@ void BLI_bvhtree_free(BVHTree *tree)
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
     MEM_SAFE_FREE(tree->nodechild);
+    MEM_SAFE_FREE(tree->branch_quality);
+    bvhtree_packed_free(tree);
     MEM_freeN(tree);
   }
 }
@@ -1032,9 +1587,25 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
-/* call BLI_bvhtree_update_node() first for every node/point/triangle */
-void BLI_bvhtree_update_tree(BVHTree *tree)
+/**
+ * Refit the bounding volumes, call #BLI_bvhtree_update_node() first for every node.
+ *
+ * \param rebuild_threshold: When positive, sub-trees are rebuilt when the area of their
+ * children in excess of their own area grew by more than this factor since they were built
+ * (1.0 for twice the area), or by more than this factor of their own area for sub-trees built
+ * without overlapping children. This keeps queries fast on meshes that deform a lot.
+ * The first call with a threshold takes the current bounds as reference.
+ */
+void BLI_bvhtree_update_tree_ex(BVHTree *tree, const float rebuild_threshold)
 {
+  /* Only trees refit with a threshold need the reference quality, the branch bounds
+   * haven't been joined yet so they still are the ones of the previous update. */
+  if (rebuild_threshold > 0.0f && tree->branch_quality == NULL && tree->totbranch != 0) {
+    tree->branch_quality = MEM_mallocN(sizeof(*tree->branch_quality) * (size_t)tree->totbranch,
+                                       __func__);
+    bvhtree_branch_quality_calc(tree, 1, tree->totbranch + 1);
+  }
+
   /* Update bottom=>top
    * TRICKY: the way we build the tree all the childs have an index greater than the parent
    * This allows us todo a bottom up update by starting on the bigger numbered branch */
@@ -1045,6 +1616,41 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   for (; index >= root; index--) {
     node_join(tree, *index);
   }
+
+  bool rebuilt = false;
+  if (rebuild_threshold > 0.0f && tree->totleaf > 1) {
+    int *branches = MEM_mallocN(sizeof(*branches) * (size_t)tree->totbranch, __func__);
+    int branches_len = 0;
+
+    bvhtree_find_degraded_recursive(
+        tree, tree->nodes[tree->totleaf], rebuild_threshold, branches, &branches_len);
+
+    if (branches_len != 0) {
+      BVHBuildHelper build_data;
+      build_implicit_tree_helper(tree, &build_data);
+      for (int i = 0; i < branches_len; i++) {
+        bvhtree_rebuild_subtree(tree, &build_data, branches[i]);
+      }
+      rebuilt = true;
+    }
+    MEM_freeN(branches);
+  }
+
+  if (tree->packed) {
+    if (rebuilt) {
+      /* Leafs moved, the packed layout refers to them directly. */
+      BLI_bvhtree_pack(tree);
+    }
+    else {
+      bvhtree_packed_refit(tree);
+    }
+  }
+}
+
+/* call BLI_bvhtree_update_node() first for every node/point/triangle */
+void BLI_bvhtree_update_tree(BVHTree *tree)
+{
+  BLI_bvhtree_update_tree_ex(tree, 0.0f);
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
@@ -1068,6 +1674,47 @@ float BLI_bvhtree_get_epsilon(const BVHTree *tree)
   return tree->epsilon;
 }
 
+/**
+ * Build a flattened 4-wide copy of the tree, used by ray-cast and nearest queries
+ * to test the bounds of multiple children at once.
+ *
+ * Call after #BLI_bvhtree_balance, #BLI_bvhtree_update_tree keeps the copy up to date.
+ * Trees with more than 4 children per node or without x/y/z axes (18-DOP) are left as is.
+ *
+ * \return true when the tree has been packed.
+ */
+bool BLI_bvhtree_pack(BVHTree *tree)
+{
+  bvhtree_packed_free(tree);
+
+  if (tree->totleaf == 0 || tree->tree_type > BVH_PACKED_WIDTH || tree->start_axis != 0) {
+    return false;
+  }
+
+  BVHPacked *packed = MEM_mallocN(sizeof(*packed), __func__);
+  /* Each packed node uses at least one branch. */
+  packed->nodes = MEM_mallocN_aligned(
+      sizeof(*packed->nodes) * (size_t)tree->totbranch, 64, "BVHPackedNode");
+  packed->nodes_src = MEM_mallocN(
+      sizeof(*packed->nodes_src) * (size_t)(tree->totbranch * BVH_PACKED_WIDTH), __func__);
+  packed->totnode = 0;
+  packed->depth = 0;
+
+  bvhtree_packed_build_recursive(tree, packed, tree->nodes[tree->totleaf], 0);
+  BLI_assert(packed->totnode <= tree->totbranch);
+
+  /* Each level adds at most (width - 1) items to the traversal stack,
+   * degenerate trees that would overflow it keep using the regular traversal. */
+  if (1 + packed->depth * (BVH_PACKED_WIDTH - 1) > BVH_PACKED_STACK_SIZE) {
+    tree->packed = packed;
+    bvhtree_packed_free(tree);
+    return false;
+  }
+
+  tree->packed = packed;
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1459,6 +2106,63 @@ static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
   dfs_find_nearest_dfs(data, node);
 }
 
+/* Packed layout method, see #BLI_bvhtree_pack */
+static void packed_nearest_test(const BVHPackedNode *pnode,
+                                const float co[3],
+                                float r_dist_sq[BVH_PACKED_WIDTH])
+{
+#ifdef __SSE2__
+  const __m128 zero = _mm_setzero_ps();
+  __m128 dist_sq = zero;
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 p = _mm_set1_ps(co[axis]);
+    const __m128 d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(pnode->bv_min[axis]), p),
+                                           _mm_sub_ps(p, _mm_load_ps(pnode->bv_max[axis]))),
+                                zero);
+    dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(d, d));
+  }
+  _mm_storeu_ps(r_dist_sq, dist_sq);
+#else
+  for (int i = 0; i < BVH_PACKED_WIDTH; i++) {
+    r_dist_sq[i] = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      const float d = max_fff(
+          pnode->bv_min[axis][i] - co[axis], co[axis] - pnode->bv_max[axis][i], 0.0f);
+      r_dist_sq[i] += d * d;
+    }
+  }
+#endif
+}
+
+static void packed_find_nearest(BVHNearestData *data)
+{
+  const BVHTree *tree = data->tree;
+  const BVHPacked *packed = tree->packed;
+  BVHPackedStackItem stack[BVH_PACKED_STACK_SIZE];
+  int stack_len = 0;
+
+  stack[stack_len].child = 0;
+  stack[stack_len].dist = 0.0f;
+  stack_len++;
+
+  while (stack_len) {
+    const BVHPackedStackItem item = stack[--stack_len];
+    if (item.dist >= data->nearest.dist_sq) {
+      continue;
+    }
+
+    if (item.child < 0) {
+      dfs_find_nearest_dfs(data, &tree->nodearray[~item.child]);
+    }
+    else {
+      const BVHPackedNode *pnode = &packed->nodes[item.child];
+      float dist_sq[BVH_PACKED_WIDTH];
+      packed_nearest_test(pnode, data->proj, dist_sq);
+      bvhtree_packed_stack_push(stack, &stack_len, pnode, dist_sq, data->nearest.dist_sq);
+    }
+  }
+}
+
 /* Priority queue method */
 static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHNode *node)
 {
@@ -1540,6 +2244,9 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
     if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
       heap_find_nearest_begin(&data, root);
     }
+    else if (tree->packed) {
+      packed_find_nearest(&data);
+    }
     else {
       dfs_find_nearest_begin(&data, root);
     }
@@ -1562,6 +2269,54 @@ int BLI_bvhtree_find_nearest(BVHTree *tree,
   return BLI_bvhtree_find_nearest_ex(tree, co, nearest, callback, userdata, 0);
 }
 
+typedef struct BVHNearestBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_cb(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHNearestBatchData *data = userdata;
+  BLI_bvhtree_find_nearest_ex(
+      data->tree, data->co[i], &data->nearest[i], data->callback, data->userdata, data->flag);
+}
+
+/**
+ * Multi-threaded version of #BLI_bvhtree_find_nearest_ex, for \a co_num coordinates.
+ *
+ * \param nearest: Initialized by the caller (as for a single search),
+ * receives the result of each search.
+ * \note The callback must be thread-safe.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int co_num,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  BVHNearestBatchData data = {
+      .tree = tree,
+      .co = co,
+      .nearest = nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, co_num, &data, bvhtree_find_nearest_batch_cb, &settings);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1769,6 +2524,85 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   }
 }
 
+/* Packed layout method, see #BLI_bvhtree_pack */
+static void packed_raycast_test(const BVHPackedNode *pnode,
+                                const float origin[3],
+                                const float idir[3],
+                                const float radius,
+                                const float dist_max,
+                                float r_dist[BVH_PACKED_WIDTH])
+{
+#ifdef __SSE2__
+  const __m128 r = _mm_set1_ps(radius);
+  __m128 t_near = _mm_set1_ps(-FLT_MAX);
+  __m128 t_far = _mm_set1_ps(FLT_MAX);
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 o = _mm_set1_ps(origin[axis]);
+    const __m128 id = _mm_set1_ps(idir[axis]);
+    const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_load_ps(pnode->bv_min[axis]), r), o),
+                                 id);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_load_ps(pnode->bv_max[axis]), r), o),
+                                 id);
+    t_near = _mm_max_ps(t_near, _mm_min_ps(t0, t1));
+    t_far = _mm_min_ps(t_far, _mm_max_ps(t0, t1));
+  }
+  const __m128 hit = _mm_and_ps(
+      _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, _mm_setzero_ps())),
+      _mm_cmplt_ps(t_near, _mm_set1_ps(dist_max)));
+  _mm_storeu_ps(r_dist,
+                _mm_or_ps(_mm_and_ps(hit, t_near), _mm_andnot_ps(hit, _mm_set1_ps(FLT_MAX))));
+#else
+  for (int i = 0; i < BVH_PACKED_WIDTH; i++) {
+    float t_near = -FLT_MAX, t_far = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+      const float t0 = (pnode->bv_min[axis][i] - radius - origin[axis]) * idir[axis];
+      const float t1 = (pnode->bv_max[axis][i] + radius - origin[axis]) * idir[axis];
+      t_near = max_ff(t_near, min_ff(t0, t1));
+      t_far = min_ff(t_far, max_ff(t0, t1));
+    }
+    r_dist[i] = (t_near <= t_far && t_far >= 0.0f && t_near < dist_max) ? t_near : FLT_MAX;
+  }
+#endif
+}
+
+static void packed_raycast(BVHRayCastData *data)
+{
+  const BVHTree *tree = data->tree;
+  const BVHPacked *packed = tree->packed;
+  BVHPackedStackItem stack[BVH_PACKED_STACK_SIZE];
+  int stack_len = 0;
+  float idir[3];
+
+  /* Avoid infinite values, (0 * inf) would give NaN for axis aligned rays. */
+  for (int axis = 0; axis < 3; axis++) {
+    const float d = data->ray.direction[axis];
+    idir[axis] = 1.0f / ((fabsf(d) > 1e-20f) ? d : copysignf(1e-20f, d));
+  }
+
+  stack[stack_len].child = 0;
+  stack[stack_len].dist = -FLT_MAX;
+  stack_len++;
+
+  while (stack_len) {
+    const BVHPackedStackItem item = stack[--stack_len];
+    if (item.dist >= data->hit.dist) {
+      continue;
+    }
+
+    if (item.child < 0) {
+      /* Handles the leaf exactly as the non packed traversal does. */
+      dfs_raycast(data, &tree->nodearray[~item.child]);
+    }
+    else {
+      const BVHPackedNode *pnode = &packed->nodes[item.child];
+      float dist[BVH_PACKED_WIDTH];
+      packed_raycast_test(
+          pnode, data->ray.origin, idir, data->ray.radius, data->hit.dist, dist);
+      bvhtree_packed_stack_push(stack, &stack_len, pnode, dist, data->hit.dist);
+    }
+  }
+}
+
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
@@ -1871,8 +2705,13 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
   }
 
   if (root) {
-    dfs_raycast(&data, root);
-    //      iterative_raycast(&data, root);
+    if (tree->packed) {
+      packed_raycast(&data);
+    }
+    else {
+      dfs_raycast(&data, root);
+      //      iterative_raycast(&data, root);
+    }
   }
 
   if (hit) {
@@ -1894,6 +2733,66 @@ int BLI_bvhtree_ray_cast(BVHTree *tree,
       tree, co, dir, radius, hit, callback, userdata, BVH_RAYCAST_DEFAULT);
 }
 
+typedef struct BVHRayCastBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  float radius;
+  BVHTreeRayHit *hits;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *data = userdata;
+  BLI_bvhtree_ray_cast_ex(data->tree,
+                          data->co[i],
+                          data->dir[i],
+                          data->radius,
+                          &data->hits[i],
+                          data->callback,
+                          data->userdata,
+                          data->flag);
+}
+
+/**
+ * Multi-threaded version of #BLI_bvhtree_ray_cast_ex, casting \a rays_num rays.
+ *
+ * \param hits: Initialized by the caller (as for a single ray-cast),
+ * receives the result of each ray.
+ * \note The callback must be thread-safe.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  BVHRayCastBatchData data = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .radius = radius,
+      .hits = hits,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, rays_num, &data, bvhtree_ray_cast_batch_cb, &settings);
+}
+
 float BLI_bvhtree_bb_raycast(const float bv[6],
                              const float light_start[3],
                              const float light_end[3],
@@ -27,6 +27,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Allocating and freeing elements from multiple threads
+ *   (optionally when using the #BLI_MEMPOOL_CONCURRENT flag).
  */
 
 #include <string.h>
@@ -86,6 +88,15 @@
 static bool mempool_debug_memset = false;
 #endif
 
+/* Number of free element caches of concurrent pools. */
+#define MEMPOOL_THREAD_CACHES 32
+
+#ifdef _MSC_VER
+#  define MEMPOOL_THREAD_LOCAL __declspec(thread)
+#else
+#  define MEMPOOL_THREAD_LOCAL __thread
+#endif
+
 /**
  * A free element from #BLI_mempool_chunk. Data is cast to this type and stored in
  * #BLI_mempool.free as a single linked list, each item #BLI_mempool.esize large.
@@ -106,6 +117,27 @@ typedef struct BLI_mempool_chunk {
   struct BLI_mempool_chunk *next;
 } BLI_mempool_chunk;
 
+/**
+ * Free elements used by one thread at a time, for pools with the #BLI_MEMPOOL_CONCURRENT flag.
+ *
+ * A thread claims a cache for the duration of a single allocation or free,
+ * threads which can't claim a cache use the locked free list of the pool instead.
+ */
+typedef struct BLI_mempool_thread_cache {
+  /** Free elements taken from the pool, from the shared list or a new chunk. */
+  BLI_freenode *free;
+  /** Elements freed into this cache, moved to the shared list when there are too many. */
+  BLI_freenode *freed;
+  BLI_freenode *freed_tail;
+  uint freed_len;
+  /** Change of the number of used elements, negative when freeing elements of other threads. */
+  int totused;
+  /** Set while a thread uses this cache. */
+  uint in_use;
+  /** Avoid false sharing between threads using neighboring caches. */
+  char _pad[28];
+} BLI_mempool_thread_cache;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -135,6 +167,12 @@ struct BLI_mempool {
   /** Number of elements allocated in total. */
   uint totalloc;
 #endif
+  /** Caches of free elements, only for pools with the #BLI_MEMPOOL_CONCURRENT flag.
+   * Then \a free is shared by all threads and \a totused doesn't include the caches. */
+  BLI_mempool_thread_cache *thread_caches;
+  /** Free elements of threads which couldn't claim a cache, locked by \a free_locked_lock. */
+  BLI_freenode *free_locked;
+  uint free_locked_lock;
 };
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
@@ -184,6 +222,41 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
   return MEM_mallocN(sizeof(BLI_mempool_chunk) + (size_t)pool->csize, "BLI_Mempool Chunk");
 }
 
+/**
+ * Link the elements of \a mpchunk into a list of free elements, starting at its first element.
+ *
+ * \return The last element of the list.
+ */
+static BLI_freenode *mempool_chunk_link_free(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  const uint esize = pool->esize;
+  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+  uint j;
+
+  /* loop through the allocated data, building the pointer structures */
+  j = pool->pchunk;
+  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode->freeword = FREEWORD;
+      curnode = curnode->next;
+    }
+  }
+  else {
+    while (j--) {
+      curnode->next = NODE_STEP_NEXT(curnode);
+      curnode = curnode->next;
+    }
+  }
+
+  /* terminate the list (rewind one)
+   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
+  curnode = NODE_STEP_PREV(curnode);
+  curnode->next = NULL;
+
+  return curnode;
+}
+
 /**
  * Initialize a chunk and add into \a pool->chunks
  *
@@ -197,9 +270,7 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
                                        BLI_mempool_chunk *mpchunk,
                                        BLI_freenode *last_tail)
 {
-  const uint esize = pool->esize;
-  BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-  uint j;
+  BLI_freenode *curnode;
 
   /* append */
   if (pool->chunk_tail) {
@@ -214,29 +285,10 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool,
   pool->chunk_tail = mpchunk;
 
   if (UNLIKELY(pool->free == NULL)) {
-    pool->free = curnode;
-  }
-
-  /* loop through the allocated data, building the pointer structures */
-  j = pool->pchunk;
-  if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode->freeword = FREEWORD;
-      curnode = curnode->next;
-    }
-  }
-  else {
-    while (j--) {
-      curnode->next = NODE_STEP_NEXT(curnode);
-      curnode = curnode->next;
-    }
+    pool->free = CHUNK_DATA(mpchunk);
   }
 
-  /* terminate the list (rewind one)
-   * will be overwritten if 'curnode' gets passed in again as 'last_tail' */
-  curnode = NODE_STEP_PREV(curnode);
-  curnode->next = NULL;
+  curnode = mempool_chunk_link_free(pool, mpchunk);
 
 #ifdef USE_TOTALLOC
   pool->totalloc += pool->pchunk;
@@ -265,6 +317,238 @@ static void mempool_chunk_free_all(BLI_mempool_chunk *mpchunk)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Concurrent Pools
+ *
+ * Pools with the #BLI_MEMPOOL_CONCURRENT flag mostly don't use locks, threads allocate from
+ * and free into a cache claimed for the duration of the call (typically the same cache
+ * every time, so caches don't move between CPU's). Caches take their elements from the shared
+ * free list of the pool, or from a new chunk when that is empty.
+ *
+ * With more threads than caches, the remaining threads allocate from and free into
+ * a free list protected by a lock (an atomic flag, makesdna uses pools without BLI_threads),
+ * which is also refilled from the shared free list.
+ * So new chunks are only allocated when no free elements are left.
+ *
+ * The shared free list is only ever emptied as a whole, so the compare-and-swap operations
+ * on it don't suffer from the ABA problem. Chunks are appended, and only freed when the pool
+ * isn't used by multiple threads (clearing or destroying it).
+ * \{ */
+
+/* The thread index plus one (zero when not assigned yet), selects the cache used first. */
+static MEMPOOL_THREAD_LOCAL uint mempool_thread_index = 0;
+static uint mempool_threads_num = 0;
+
+static BLI_mempool_thread_cache *mempool_thread_cache_claim(BLI_mempool *pool)
+{
+  if (UNLIKELY(mempool_thread_index == 0)) {
+    mempool_thread_index = atomic_fetch_and_add_u(&mempool_threads_num, 1) + 1;
+  }
+  const uint index_first = mempool_thread_index - 1;
+  for (uint i = 0; i < MEMPOOL_THREAD_CACHES; i++) {
+    BLI_mempool_thread_cache *cache =
+        &pool->thread_caches[(index_first + i) % MEMPOOL_THREAD_CACHES];
+    if (atomic_cas_uint32(&cache->in_use, 0, 1) == 0) {
+      return cache;
+    }
+  }
+  return NULL;
+}
+
+static void mempool_thread_cache_release(BLI_mempool_thread_cache *cache)
+{
+  atomic_fetch_and_and_uint32(&cache->in_use, 0);
+}
+
+/** Add the list of free elements from \a head to \a tail to the shared free list. */
+static void mempool_free_shared_push(BLI_mempool *pool, BLI_freenode *head, BLI_freenode *tail)
+{
+  BLI_freenode *free_shared;
+  do {
+    free_shared = pool->free;
+    tail->next = free_shared;
+  } while (atomic_cas_ptr((void **)&pool->free, free_shared, head) != free_shared);
+}
+
+/** Take all elements of the shared free list. */
+static BLI_freenode *mempool_free_shared_take(BLI_mempool *pool)
+{
+  BLI_freenode *free_shared;
+  do {
+    free_shared = pool->free;
+  } while (free_shared != NULL &&
+           atomic_cas_ptr((void **)&pool->free, free_shared, NULL) != free_shared);
+  return free_shared;
+}
+
+static void mempool_free_locked_lock(BLI_mempool *pool)
+{
+  while (atomic_cas_uint32(&pool->free_locked_lock, 0, 1) != 0) {
+    /* pass */
+  }
+}
+
+static void mempool_free_locked_unlock(BLI_mempool *pool)
+{
+  atomic_fetch_and_and_uint32(&pool->free_locked_lock, 0);
+}
+
+/** Take all elements freed by threads which couldn't claim a cache. */
+static BLI_freenode *mempool_free_locked_take(BLI_mempool *pool)
+{
+  BLI_freenode *free_locked = NULL;
+  if (pool->free_locked != NULL) {
+    mempool_free_locked_lock(pool);
+    free_locked = pool->free_locked;
+    pool->free_locked = NULL;
+    mempool_free_locked_unlock(pool);
+  }
+  return free_locked;
+}
+
+/**
+ * Append a chunk while other threads may do the same.
+ *
+ * A thread which finds the tail lagging behind helps to move it forward,
+ * so no thread has to wait for another one.
+ */
+static void mempool_chunk_append_concurrent(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+  mpchunk->next = NULL;
+  while (true) {
+    BLI_mempool_chunk *tail = pool->chunk_tail;
+    if (tail == NULL) {
+      if (atomic_cas_ptr((void **)&pool->chunks, NULL, mpchunk) == NULL) {
+        atomic_cas_ptr((void **)&pool->chunk_tail, NULL, mpchunk);
+        return;
+      }
+      atomic_cas_ptr((void **)&pool->chunk_tail, NULL, pool->chunks);
+    }
+    else if (atomic_cas_ptr((void **)&tail->next, NULL, mpchunk) == NULL) {
+      atomic_cas_ptr((void **)&pool->chunk_tail, tail, mpchunk);
+      return;
+    }
+    else {
+      atomic_cas_ptr((void **)&pool->chunk_tail, tail, tail->next);
+    }
+  }
+}
+
+/**
+ * Allocate a new chunk.
+ *
+ * \return The list of its elements, \a r_tail is set to the last one.
+ */
+static BLI_freenode *mempool_chunk_add_concurrent(BLI_mempool *pool, BLI_freenode **r_tail)
+{
+  BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+  *r_tail = mempool_chunk_link_free(pool, mpchunk);
+  mempool_chunk_append_concurrent(pool, mpchunk);
+#ifdef USE_TOTALLOC
+  atomic_add_and_fetch_u(&pool->totalloc, pool->pchunk);
+#endif
+  return CHUNK_DATA(mpchunk);
+}
+
+static BLI_freenode *mempool_alloc_concurrent(BLI_mempool *pool)
+{
+  BLI_mempool_thread_cache *cache = mempool_thread_cache_claim(pool);
+  BLI_freenode *free_pop;
+
+  if (LIKELY(cache != NULL)) {
+    if (cache->freed != NULL) {
+      /* Reuse recently freed elements first, they are likely still cached by the CPU. */
+      free_pop = cache->freed;
+      cache->freed = free_pop->next;
+      if (--cache->freed_len == 0) {
+        cache->freed_tail = NULL;
+      }
+    }
+    else {
+      if (cache->free == NULL) {
+        cache->free = mempool_free_shared_take(pool);
+        if (cache->free == NULL) {
+          cache->free = mempool_free_locked_take(pool);
+        }
+        if (cache->free == NULL) {
+          BLI_freenode *tail;
+          cache->free = mempool_chunk_add_concurrent(pool, &tail);
+        }
+      }
+      free_pop = cache->free;
+      cache->free = free_pop->next;
+    }
+    cache->totused++;
+    mempool_thread_cache_release(cache);
+  }
+  else {
+    /* All caches are in use, only happens with more threads than caches. */
+    mempool_free_locked_lock(pool);
+    if (pool->free_locked == NULL) {
+      pool->free_locked = mempool_free_shared_take(pool);
+      if (pool->free_locked == NULL) {
+        BLI_freenode *tail;
+        pool->free_locked = mempool_chunk_add_concurrent(pool, &tail);
+      }
+    }
+    free_pop = pool->free_locked;
+    pool->free_locked = free_pop->next;
+    mempool_free_locked_unlock(pool);
+    atomic_add_and_fetch_u(&pool->totused, 1);
+  }
+
+  return free_pop;
+}
+
+static void mempool_free_concurrent(BLI_mempool *pool, BLI_freenode *newhead)
+{
+  BLI_mempool_thread_cache *cache = mempool_thread_cache_claim(pool);
+
+  if (LIKELY(cache != NULL)) {
+    newhead->next = cache->freed;
+    if (cache->freed == NULL) {
+      cache->freed_tail = newhead;
+    }
+    cache->freed = newhead;
+    cache->totused--;
+    /* Make elements freed by this thread available for others. */
+    if (UNLIKELY(++cache->freed_len >= pool->pchunk)) {
+      mempool_free_shared_push(pool, cache->freed, cache->freed_tail);
+      cache->freed = NULL;
+      cache->freed_tail = NULL;
+      cache->freed_len = 0;
+    }
+    mempool_thread_cache_release(cache);
+  }
+  else {
+    mempool_free_locked_lock(pool);
+    newhead->next = pool->free_locked;
+    pool->free_locked = newhead;
+    mempool_free_locked_unlock(pool);
+    atomic_sub_and_fetch_u(&pool->totused, 1);
+  }
+}
+
+static void mempool_thread_caches_clear(BLI_mempool *pool)
+{
+  memset(pool->thread_caches, 0, sizeof(*pool->thread_caches) * MEMPOOL_THREAD_CACHES);
+  pool->free_locked = NULL;
+}
+
+/** Number of used elements, including the ones counted by the caches of concurrent pools. */
+static uint mempool_totused(const BLI_mempool *pool)
+{
+  uint totused = pool->totused;
+  if (pool->thread_caches != NULL) {
+    for (uint i = 0; i < MEMPOOL_THREAD_CACHES; i++) {
+      totused += (uint)pool->thread_caches[i].totused;
+    }
+  }
+  return totused;
+}
+
+/** \} */
+
 BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag)
 {
   BLI_mempool *pool;
@@ -315,6 +599,15 @@ BLI_mempool *BLI_mempool_create(uint esize, uint totelem, uint pchunk, uint flag
   pool->totalloc = 0;
 #endif
   pool->totused = 0;
+  pool->thread_caches = NULL;
+  pool->free_locked = NULL;
+  pool->free_locked_lock = 0;
+
+  if (flag & BLI_MEMPOOL_CONCURRENT) {
+    pool->thread_caches = MEM_mallocN_aligned(
+        sizeof(*pool->thread_caches) * MEMPOOL_THREAD_CACHES, 64, "BLI_Mempool thread caches");
+    mempool_thread_caches_clear(pool);
+  }
 
   if (totelem) {
     /* Allocate the actual chunks. */
@@ -335,23 +628,28 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
 {
   BLI_freenode *free_pop;
 
-  if (UNLIKELY(pool->free == NULL)) {
-    /* Need to allocate a new chunk. */
-    BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
-    mempool_chunk_add(pool, mpchunk, NULL);
+  if (pool->flag & BLI_MEMPOOL_CONCURRENT) {
+    free_pop = mempool_alloc_concurrent(pool);
   }
+  else {
+    if (UNLIKELY(pool->free == NULL)) {
+      /* Need to allocate a new chunk. */
+      BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+      mempool_chunk_add(pool, mpchunk, NULL);
+    }
 
-  free_pop = pool->free;
+    free_pop = pool->free;
 
-  BLI_assert(pool->chunk_tail->next == NULL);
+    BLI_assert(pool->chunk_tail->next == NULL);
+
+    pool->free = free_pop->next;
+    pool->totused++;
+  }
 
   if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
     free_pop->freeword = USEDWORD;
   }
 
-  pool->free = free_pop->next;
-  pool->totused++;
-
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
 #endif
@@ -404,6 +702,15 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
     newhead->freeword = FREEWORD;
   }
 
+  if (pool->flag & BLI_MEMPOOL_CONCURRENT) {
+    /* Chunks are kept, other threads may allocate from them. */
+    mempool_free_concurrent(pool, newhead);
+#ifdef WITH_MEM_VALGRIND
+    VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+    return;
+  }
+
   newhead->next = pool->free;
   pool->free = newhead;
 
@@ -451,16 +758,19 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
   }
 }
 
+/**
+ * \note For concurrent pools this is only exact when no other thread uses the pool.
+ */
 int BLI_mempool_len(BLI_mempool *pool)
 {
-  return (int)pool->totused;
+  return (int)mempool_totused(pool);
 }
 
 void *BLI_mempool_findelem(BLI_mempool *pool, uint index)
 {
   BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
 
-  if (index < pool->totused) {
+  if (index < mempool_totused(pool)) {
     /* We could have some faster mem chunk stepping code inline. */
     BLI_mempool_iter iter;
     void *elem;
@@ -491,7 +801,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
   while ((elem = BLI_mempool_iterstep(&iter))) {
     *p++ = elem;
   }
-  BLI_assert((uint)(p - data) == pool->totused);
+  BLI_assert((uint)(p - data) == mempool_totused(pool));
 }
 
 /**
@@ -499,7 +809,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
  */
 void **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr)
 {
-  void **data = MEM_mallocN((size_t)pool->totused * sizeof(void *), allocstr);
+  void **data = MEM_mallocN((size_t)mempool_totused(pool) * sizeof(void *), allocstr);
   BLI_mempool_as_table(pool, data);
   return data;
 }
@@ -518,7 +828,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
     memcpy(p, elem, (size_t)esize);
     p = NODE_STEP_NEXT(p);
   }
-  BLI_assert((uint)(p - (char *)data) == pool->totused * esize);
+  BLI_assert((uint)(p - (char *)data) == mempool_totused(pool) * esize);
 }
 
 /**
@@ -526,7 +836,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
  */
 void *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr)
 {
-  char *data = MEM_mallocN((size_t)(pool->totused * pool->esize), allocstr);
+  char *data = MEM_mallocN((size_t)(mempool_totused(pool) * pool->esize), allocstr);
   BLI_mempool_as_array(pool, data);
   return data;
 }
@@ -729,6 +1039,9 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
   /* re-initialize */
   pool->free = NULL;
   pool->totused = 0;
+  if (pool->thread_caches != NULL) {
+    mempool_thread_caches_clear(pool);
+  }
 #ifdef USE_TOTALLOC
   pool->totalloc = 0;
 #endif
@@ -758,6 +1071,10 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
   mempool_chunk_free_all(pool->chunks);
 
+  if (pool->thread_caches != NULL) {
+    MEM_freeN(pool->thread_caches);
+  }
+
 #ifdef WITH_MEM_VALGRIND
   VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -0,0 +1,203 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Read-only memory mapped files.
+ *
+ * Reading from a mapping of a file which is truncated or can't be read (network drives...)
+ * raises SIGBUS instead of returning an error. A signal handler catches these for the mapped
+ * files, replaces their memory by zeros and flags them, so reading can fail gracefully
+ * (see #BLI_mmap_any_io_error). On WIN32 mapped files can't be truncated.
+ */
+
+#include <string.h>
+
+#include "BLI_mmap.h"
+#include "BLI_fileops.h"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "atomic_ops.h"
+
+#ifndef WIN32
+#  include <pthread.h>
+#  include <signal.h>
+#  include <sys/mman.h> /* for mmap */
+#else
+#  include "mmap_win.h"
+#endif
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  /* Set by the signal handler, when reading from the mapping failed. */
+  volatile bool io_error;
+};
+
+#ifndef WIN32
+
+/**
+ * The signal handler can't lock, it looks up files in these slots,
+ * files are only mapped (and otherwise read instead) when a free slot is found.
+ */
+#  define MMAP_FILES_MAX 64
+static BLI_mmap_file *volatile mmap_files[MMAP_FILES_MAX];
+
+static struct sigaction sigbus_handler_prev;
+static pthread_once_t sigbus_handler_once = PTHREAD_ONCE_INIT;
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  const char *error_addr = (const char *)siginfo->si_addr;
+
+  for (int i = 0; i < MMAP_FILES_MAX; i++) {
+    BLI_mmap_file *file = mmap_files[i];
+    if (file && error_addr >= file->memory && error_addr < file->memory + file->length) {
+      file->io_error = true;
+      /* Replace the mapped memory by zeros, so the faulting read can continue. */
+      mmap(file->memory,
+           file->length,
+           PROT_READ,
+           MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS,
+           -1,
+           0);
+      return;
+    }
+  }
+
+  /* Not caused by a mapped file. */
+  if (sigbus_handler_prev.sa_flags & SA_SIGINFO) {
+    sigbus_handler_prev.sa_sigaction(sig, siginfo, ptr);
+  }
+  else if (!ELEM(sigbus_handler_prev.sa_handler, SIG_DFL, SIG_IGN)) {
+    sigbus_handler_prev.sa_handler(sig);
+  }
+  else {
+    /* Faults again with the default action. */
+    signal(SIGBUS, SIG_DFL);
+  }
+}
+
+static void sigbus_handler_install(void)
+{
+  struct sigaction newact = {{NULL}};
+  newact.sa_flags = SA_SIGINFO;
+  newact.sa_sigaction = sigbus_handler;
+  sigemptyset(&newact.sa_mask);
+  sigaction(SIGBUS, &newact, &sigbus_handler_prev);
+}
+
+static bool sigbus_handler_add(BLI_mmap_file *file)
+{
+  pthread_once(&sigbus_handler_once, sigbus_handler_install);
+
+  for (int i = 0; i < MMAP_FILES_MAX; i++) {
+    if (atomic_cas_ptr((void **)&mmap_files[i], NULL, file) == NULL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void sigbus_handler_remove(BLI_mmap_file *file)
+{
+  for (int i = 0; i < MMAP_FILES_MAX; i++) {
+    if (atomic_cas_ptr((void **)&mmap_files[i], file, NULL) == file) {
+      return;
+    }
+  }
+  BLI_assert(0);
+}
+
+#endif /* WIN32 */
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  void *memory;
+  size_t length = BLI_file_descriptor_size(fd);
+
+  if (ELEM(length, 0, (size_t)-1)) {
+    return NULL;
+  }
+
+  /* Private read-only mapping of the whole file. */
+  memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+
+  BLI_mmap_file *file = MEM_callocN(sizeof(*file), __func__);
+  file->memory = memory;
+  file->length = length;
+
+#ifndef WIN32
+  if (!sigbus_handler_add(file)) {
+    munmap(file->memory, file->length);
+    MEM_freeN(file);
+    return NULL;
+  }
+#endif
+
+  return file;
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If a previous read failed, the memory doesn't hold the file contents anymore. */
+  if (file->io_error) {
+    return false;
+  }
+
+  /* Check for overflow as well as reading past the end. */
+  if (offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+  memcpy(dest, file->memory + offset, length);
+
+  return !file->io_error;
+}
+
+void *BLI_mmap_get_pointer(BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+bool BLI_mmap_any_io_error(const BLI_mmap_file *file)
+{
+  return file->io_error;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifndef WIN32
+  sigbus_handler_remove(file);
+#endif
+  munmap(file->memory, file->length);
+  MEM_freeN(file);
+}
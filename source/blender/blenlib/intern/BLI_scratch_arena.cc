@@ -0,0 +1,320 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Every thread bound to an arena gets a #ScratchThread (a bump allocator) of the arena.
+ * It's cached by the thread until the arena is reset, so binding the same arena again
+ * (e.g. for every operation of a dependency graph evaluation) doesn't need to lock.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_scratch_arena.h"
+#include "BLI_utildefines.h"
+
+/* Alignment of all allocations, also the size of the header in front of them. */
+#define SCRATCH_ALIGN 16
+#define SCRATCH_PADUP(num) (((num) + (SCRATCH_ALIGN - 1)) & ~(size_t)(SCRATCH_ALIGN - 1))
+
+/* Minimum size of memory chunks, larger chunks are used for large allocations. */
+#define SCRATCH_CHUNK_SIZE (1 << 20)
+
+/* Keep the memory of an evaluation using less than a quarter of it, for the next evaluation. */
+#define SCRATCH_SHRINK_FACTOR 4
+
+struct ScratchThread;
+
+struct ScratchHead {
+  /* NULL when allocated with #MEM_mallocN. */
+  ScratchThread *owner;
+  /* Size including this header. */
+  size_t size;
+};
+BLI_STATIC_ASSERT(sizeof(ScratchHead) <= SCRATCH_ALIGN, "header must fit alignment")
+
+struct ScratchChunk {
+  ScratchChunk *next;
+  size_t size;
+};
+#define SCRATCH_CHUNK_DATA(chunk) ((char *)(chunk) + SCRATCH_PADUP(sizeof(ScratchChunk)))
+
+struct ScratchThread {
+  ScratchArena *arena;
+  /* All threads of the arena. */
+  ScratchThread *next;
+  /* Threads not in use since the last reset. */
+  ScratchThread *next_free;
+
+  /* Chunks, the chunk allocated from first. */
+  ScratchChunk *chunks;
+  char *pos, *end;
+
+  /* Memory of all chunks. */
+  size_t reserved;
+  /* Memory in use since the last reset, excluding unused space at the end of chunks. */
+  size_t used, used_peak;
+};
+
+struct ScratchArena {
+  const char *name;
+  std::mutex mutex;
+  ScratchThread *threads;
+  ScratchThread *threads_free;
+  /* Unique for every arena and reset, to detect threads caching an outdated #ScratchThread. */
+  uint64_t generation;
+
+  MEM_CXX_CLASS_ALLOC_FUNCS("ScratchArena")
+};
+
+static std::atomic<uint64_t> scratch_generation(0);
+
+struct ScratchThreadLocal {
+  /* Allocated from, NULL when no arena is bound. */
+  ScratchThread *active;
+  /* Reused when binding an arena with the same generation. */
+  ScratchThread *cached;
+  uint64_t cached_generation;
+};
+
+static thread_local ScratchThreadLocal scratch_local = {NULL, NULL, 0};
+
+/* -------------------------------------------------------------------- */
+/** \name Chunks
+ * \{ */
+
+static void scratch_thread_chunk_add(ScratchThread *thread, size_t size)
+{
+  /* Grow geometrically, so evaluations needing more memory than before only add a few chunks. */
+  size = MAX3(size, (size_t)SCRATCH_CHUNK_SIZE, thread->reserved);
+  ScratchChunk *chunk = (ScratchChunk *)MEM_mallocN_aligned(
+      SCRATCH_PADUP(sizeof(ScratchChunk)) + size, SCRATCH_ALIGN, thread->arena->name);
+  chunk->size = size;
+  chunk->next = thread->chunks;
+  thread->chunks = chunk;
+  thread->reserved += size;
+  thread->pos = SCRATCH_CHUNK_DATA(chunk);
+  thread->end = thread->pos + size;
+}
+
+static void scratch_thread_chunks_free(ScratchThread *thread)
+{
+  ScratchChunk *chunk = thread->chunks;
+  while (chunk) {
+    ScratchChunk *chunk_next = chunk->next;
+    MEM_freeN(chunk);
+    chunk = chunk_next;
+  }
+  thread->chunks = NULL;
+  thread->pos = thread->end = NULL;
+  thread->reserved = 0;
+}
+
+static void scratch_thread_reset(ScratchThread *thread)
+{
+  /* Replace multiple chunks by a single chunk large enough for all allocations of the last
+   * evaluation, and shrink when it only needed a fraction of the memory. */
+  const size_t size = thread->used_peak;
+  if (thread->chunks &&
+      (thread->chunks->next || (thread->reserved > SCRATCH_CHUNK_SIZE &&
+                                thread->reserved / SCRATCH_SHRINK_FACTOR > size))) {
+    scratch_thread_chunks_free(thread);
+    if (size != 0) {
+      scratch_thread_chunk_add(thread, size);
+    }
+  }
+  else if (thread->chunks) {
+    thread->pos = SCRATCH_CHUNK_DATA(thread->chunks);
+  }
+  thread->used = 0;
+  thread->used_peak = 0;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Arena
+ * \{ */
+
+ScratchArena *BLI_scratch_arena_new(const char *name)
+{
+  ScratchArena *arena = new ScratchArena();
+  arena->name = name;
+  arena->threads = NULL;
+  arena->threads_free = NULL;
+  arena->generation = ++scratch_generation;
+  return arena;
+}
+
+/**
+ * Free the arena and all its memory, no thread may have the arena bound.
+ */
+void BLI_scratch_arena_free(ScratchArena *arena)
+{
+  ScratchThread *thread = arena->threads;
+  while (thread) {
+    ScratchThread *thread_next = thread->next;
+    scratch_thread_chunks_free(thread);
+    MEM_freeN(thread);
+    thread = thread_next;
+  }
+  delete arena;
+}
+
+/**
+ * Invalidate all memory allocated from the arena, keeping it for reuse.
+ * Call at the end of the evaluation, no thread may have the arena bound.
+ */
+void BLI_scratch_arena_reset(ScratchArena *arena)
+{
+  std::lock_guard<std::mutex> lock(arena->mutex);
+  arena->generation = ++scratch_generation;
+  arena->threads_free = NULL;
+  for (ScratchThread *thread = arena->threads; thread; thread = thread->next) {
+    scratch_thread_reset(thread);
+    thread->next_free = arena->threads_free;
+    arena->threads_free = thread;
+  }
+}
+
+/**
+ * Allocate scratch memory of the calling thread from \a arena (or with #MEM_mallocN when NULL).
+ *
+ * \return The arena bound before, to restore when done.
+ */
+ScratchArena *BLI_scratch_arena_bind(ScratchArena *arena)
+{
+  ScratchThreadLocal &local = scratch_local;
+  ScratchArena *arena_prev = local.active ? local.active->arena : NULL;
+
+  if (arena == NULL) {
+    local.active = NULL;
+  }
+  else if (local.cached && local.cached_generation == arena->generation) {
+    local.active = local.cached;
+  }
+  else {
+    std::lock_guard<std::mutex> lock(arena->mutex);
+    ScratchThread *thread = arena->threads_free;
+    if (thread) {
+      arena->threads_free = thread->next_free;
+    }
+    else {
+      thread = (ScratchThread *)MEM_callocN(sizeof(*thread), __func__);
+      thread->arena = arena;
+      thread->next = arena->threads;
+      arena->threads = thread;
+    }
+    local.active = local.cached = thread;
+    local.cached_generation = arena->generation;
+  }
+  return arena_prev;
+}
+
+/**
+ * \param r_reserved: Memory kept by the arena.
+ * \param r_used_peak: Peak memory used since the last reset.
+ */
+void BLI_scratch_arena_stats(const ScratchArena *arena, size_t *r_reserved, size_t *r_used_peak)
+{
+  *r_reserved = 0;
+  *r_used_peak = 0;
+  for (const ScratchThread *thread = arena->threads; thread; thread = thread->next) {
+    *r_reserved += thread->reserved;
+    *r_used_peak += thread->used_peak;
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Allocation
+ * \{ */
+
+void *BLI_scratch_alloc(size_t size, const char *name)
+{
+  ScratchThread *thread = scratch_local.active;
+  const size_t size_alloc = SCRATCH_ALIGN + SCRATCH_PADUP(size);
+  ScratchHead *head;
+
+  if (thread == NULL) {
+    head = (ScratchHead *)MEM_mallocN_aligned(size_alloc, SCRATCH_ALIGN, name);
+    head->owner = NULL;
+  }
+  else {
+    if (UNLIKELY((size_t)(thread->end - thread->pos) < size_alloc)) {
+      scratch_thread_chunk_add(thread, size_alloc);
+    }
+    head = (ScratchHead *)thread->pos;
+    head->owner = thread;
+    thread->pos += size_alloc;
+    thread->used += size_alloc;
+    if (thread->used > thread->used_peak) {
+      thread->used_peak = thread->used;
+    }
+  }
+  head->size = size_alloc;
+  return (char *)head + SCRATCH_ALIGN;
+}
+
+void *BLI_scratch_calloc(size_t size, const char *name)
+{
+  void *ptr = BLI_scratch_alloc(size, name);
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+void *BLI_scratch_alloc_array(size_t len, size_t size, const char *name)
+{
+  if (UNLIKELY(size != 0 && len > SIZE_MAX / size)) {
+    /* Let the allocator report the overflow. */
+    return MEM_malloc_arrayN(len, size, name);
+  }
+  return BLI_scratch_alloc(len * size, name);
+}
+
+void *BLI_scratch_calloc_array(size_t len, size_t size, const char *name)
+{
+  if (UNLIKELY(size != 0 && len > SIZE_MAX / size)) {
+    return MEM_calloc_arrayN(len, size, name);
+  }
+  return BLI_scratch_calloc(len * size, name);
+}
+
+/**
+ * Memory allocated from an arena is only reused before the arena is reset when it was the last
+ * allocation of the calling thread, so freeing in reverse order of allocation is preferred.
+ */
+void BLI_scratch_free(void *ptr)
+{
+  ScratchHead *head = (ScratchHead *)((char *)ptr - SCRATCH_ALIGN);
+  ScratchThread *thread = head->owner;
+
+  if (thread == NULL) {
+    MEM_freeN(head);
+  }
+  else if (thread == scratch_local.active && (char *)head + head->size == thread->pos) {
+    thread->pos = (char *)head;
+    thread->used -= head->size;
+  }
+}
+
+/** \} */
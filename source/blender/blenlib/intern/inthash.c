@@ -0,0 +1,32 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * An (int -> int) open addressing hash table.
+ */
+
+#define OPENHASH_KEY int
+#define OPENHASH_VALUE int
+#define OPENHASH_PREFIX_ID BLI_inthash
+#define OPENHASH_ITER_PREFIX_ID BLI_inthashIterator
+#define OpenHash IntHash
+#define OpenHashEntry IntHashEntry
+#define OpenHashIterator IntHashIterator
+/* Perturbed probing takes care of clustering, so the key can be used as is. */
+#define OPENHASH_HASH(key) ((uint32_t)(key))
+#include "openhash_impl.h"
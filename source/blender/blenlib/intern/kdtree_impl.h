@@ -22,6 +22,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree_impl.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -46,6 +47,13 @@ struct KDTree {
   KDTreeNode *nodes;
   uint nodes_len;
   uint root;
+  /**
+   * Number of points below which batched queries scan a sub-tree linearly
+   * (zero when disabled), see #BLI_kdtree_3d_balance_ex.
+   */
+  uint bucket_len;
+  /** Coordinates in node order, only allocated when buckets are used. */
+  float (*nodes_co)[KD_DIMS];
 #ifdef DEBUG
   bool is_balanced;        /* ensure we call balance first */
   uint nodes_len_capacity; /* max size of the tree */
@@ -56,6 +64,9 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
+#define KD_BATCH_STACK_LEN 64  /* stack size for the implicit sub-tree ranges (depth + 1) */
+#define KD_BATCH_BLOCK_LEN 256 /* number of range searches per parallel task */
+
 #define KD_NODE_UNSET ((uint)-1)
 
 /**
@@ -104,6 +115,8 @@ KDTree *BLI_kdtree_nd_(new)(uint nodes_len_capacity)
   tree->nodes = MEM_mallocN(sizeof(KDTreeNode) * nodes_len_capacity, "KDTreeNode");
   tree->nodes_len = 0;
   tree->root = KD_NODE_ROOT_IS_INIT;
+  tree->bucket_len = 0;
+  tree->nodes_co = NULL;
 
 #ifdef DEBUG
   tree->is_balanced = false;
@@ -117,6 +130,7 @@ void BLI_kdtree_nd_(free)(KDTree *tree)
 {
   if (tree) {
     MEM_freeN(tree->nodes);
+    MEM_SAFE_FREE(tree->nodes_co);
     MEM_freeN(tree);
   }
 }
@@ -202,6 +216,21 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
 }
 
 void BLI_kdtree_nd_(balance)(KDTree *tree)
+{
+  BLI_kdtree_nd_(balance_ex)(tree, 0);
+}
+
+/**
+ * Balance the tree, optionally storing leaf buckets for batched queries.
+ *
+ * Balancing always places the root of a sub-tree at the median of its (contiguous) node range,
+ * so the sub-tree ranges are known without reading the child links.
+ * Batched queries use this to scan sub-trees of at most \a bucket_len points
+ * as flat arrays (using a compact copy of the coordinates) instead of visiting each node.
+ *
+ * \param bucket_len: Zero to disable buckets, values around 8..16 work well.
+ */
+void BLI_kdtree_nd_(balance_ex)(KDTree *tree, const uint bucket_len)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
     for (uint i = 0; i < tree->nodes_len; i++) {
@@ -212,6 +241,15 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
 
   tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
 
+  MEM_SAFE_FREE(tree->nodes_co);
+  tree->bucket_len = bucket_len;
+  if (bucket_len && tree->nodes_len) {
+    tree->nodes_co = MEM_mallocN(sizeof(*tree->nodes_co) * tree->nodes_len, __func__);
+    for (uint i = 0; i < tree->nodes_len; i++) {
+      copy_vn_vn(tree->nodes_co[i], tree->nodes[i].co);
+    }
+  }
+
 #ifdef DEBUG
   tree->is_balanced = true;
 #endif
@@ -611,6 +649,13 @@ static int nearest_cmp_dist(const void *a, const void *b)
   else if (kda->dist > kdb->dist) {
     return 1;
   }
+  /* Sort by index so the order of equally distant points is predictable. */
+  else if (kda->index < kdb->index) {
+    return -1;
+  }
+  else if (kda->index > kdb->index) {
+    return 1;
+  }
   else {
     return 0;
   }
@@ -637,40 +682,26 @@ static void nearest_add_in_range(KDTreeNearest **r_nearest,
 }
 
 /**
- * Range search returns number of points nearest_len, with results in nearest
- *
- * \param r_nearest: Allocated array of nearest nearest_len (caller is responsible for freeing).
+ * Add all points in \a range of \a co to \a r_nearest (unsorted),
+ * growing the array as needed.
  */
-int BLI_kdtree_nd_(range_search_with_len_squared_cb)(
-    const KDTree *tree,
-    const float co[KD_DIMS],
-    KDTreeNearest **r_nearest,
-    const float range,
-    float (*len_sq_fn)(const float co_search[KD_DIMS],
-                       const float co_test[KD_DIMS],
-                       const void *user_data),
-    const void *user_data)
+static void kdtree_range_search_append(const KDTree *tree,
+                                       const float co[KD_DIMS],
+                                       const float range,
+                                       float (*len_sq_fn)(const float co_search[KD_DIMS],
+                                                          const float co_test[KD_DIMS],
+                                                          const void *user_data),
+                                       const void *user_data,
+                                       KDTreeNearest **r_nearest,
+                                       uint *r_nearest_len,
+                                       uint *r_nearest_len_capacity)
 {
   const KDTreeNode *nodes = tree->nodes;
   uint *stack, stack_default[KD_STACK_INIT];
-  KDTreeNearest *nearest = NULL;
   const float range_sq = range * range;
   float dist_sq;
   uint stack_len_capacity, cur = 0;
-  uint nearest_len = 0, nearest_len_capacity = 0;
-
-#ifdef DEBUG
-  BLI_assert(tree->is_balanced == true);
-#endif
-
-  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
-    return 0;
-  }
-
-  if (len_sq_fn == NULL) {
-    len_sq_fn = len_squared_vnvn_cb;
-    BLI_assert(user_data == NULL);
-  }
+  uint nearest_len = *r_nearest_len;
 
   stack = stack_default;
   stack_len_capacity = ARRAY_SIZE(stack_default);
@@ -694,7 +725,7 @@ int BLI_kdtree_nd_(range_search_with_len_squared_cb)(
       dist_sq = len_sq_fn(co, node->co, user_data);
       if (dist_sq <= range_sq) {
         nearest_add_in_range(
-            &nearest, nearest_len++, &nearest_len_capacity, node->index, dist_sq, node->co);
+            r_nearest, nearest_len++, r_nearest_len_capacity, node->index, dist_sq, node->co);
       }
 
       if (node->left != KD_NODE_UNSET) {
@@ -714,6 +745,43 @@ int BLI_kdtree_nd_(range_search_with_len_squared_cb)(
     MEM_freeN(stack);
   }
 
+  *r_nearest_len = nearest_len;
+}
+
+/**
+ * Range search returns number of points nearest_len, with results in nearest
+ *
+ * \param r_nearest: Allocated array of nearest nearest_len (caller is responsible for freeing).
+ */
+int BLI_kdtree_nd_(range_search_with_len_squared_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    KDTreeNearest **r_nearest,
+    const float range,
+    float (*len_sq_fn)(const float co_search[KD_DIMS],
+                       const float co_test[KD_DIMS],
+                       const void *user_data),
+    const void *user_data)
+{
+  KDTreeNearest *nearest = NULL;
+  uint nearest_len = 0, nearest_len_capacity = 0;
+
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    return 0;
+  }
+
+  if (len_sq_fn == NULL) {
+    len_sq_fn = len_squared_vnvn_cb;
+    BLI_assert(user_data == NULL);
+  }
+
+  kdtree_range_search_append(
+      tree, co, range, len_sq_fn, user_data, &nearest, &nearest_len, &nearest_len_capacity);
+
   if (nearest_len) {
     qsort(nearest, nearest_len, sizeof(KDTreeNearest), nearest_cmp_dist);
   }
@@ -806,6 +874,346 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Run many searches in parallel, optionally scanning leaf buckets
+ * (see #BLI_kdtree_3d_balance_ex).
+ * \{ */
+
+/** A sub-tree as a range of nodes, with a lower bound of its distance to the search point. */
+typedef struct KDTreeBucketRange {
+  uint lo, hi;
+  float dist_sq;
+} KDTreeBucketRange;
+
+static uint kdtree_find_nearest_n_bucketed(const KDTree *tree,
+                                           const float co[KD_DIMS],
+                                           KDTreeNearest r_nearest[],
+                                           const uint nearest_len_capacity)
+{
+  const KDTreeNode *nodes = tree->nodes;
+  const float(*nodes_co)[KD_DIMS] = (const float(*)[KD_DIMS])tree->nodes_co;
+  KDTreeBucketRange stack[KD_BATCH_STACK_LEN];
+  uint cur = 0, nearest_len = 0;
+
+  stack[cur].lo = 0;
+  stack[cur].hi = tree->nodes_len;
+  stack[cur].dist_sq = 0.0f;
+  cur++;
+
+  while (cur--) {
+    const uint lo = stack[cur].lo, hi = stack[cur].hi;
+    const float bound_sq = stack[cur].dist_sq;
+
+    if (nearest_len == nearest_len_capacity && bound_sq >= r_nearest[nearest_len - 1].dist) {
+      continue;
+    }
+
+    if (hi - lo <= tree->bucket_len) {
+      for (uint i = lo; i < hi; i++) {
+        const float dist_sq = len_squared_vnvn(nodes_co[i], co);
+        if (nearest_len < nearest_len_capacity || dist_sq < r_nearest[nearest_len - 1].dist) {
+          nearest_ordered_insert(
+              r_nearest, &nearest_len, nearest_len_capacity, nodes[i].index, dist_sq, nodes_co[i]);
+        }
+      }
+      continue;
+    }
+
+    const uint mid = lo + ((hi - lo) / 2);
+    const KDTreeNode *node = &nodes[mid];
+    const float dist_sq = len_squared_vnvn(node->co, co);
+    if (nearest_len < nearest_len_capacity || dist_sq < r_nearest[nearest_len - 1].dist) {
+      nearest_ordered_insert(
+          r_nearest, &nearest_len, nearest_len_capacity, node->index, dist_sq, node->co);
+    }
+
+    /* Push the far side first, so the near side is searched first. */
+    const float plane_dist = co[node->d] - node->co[node->d];
+    const bool is_left = (plane_dist < 0.0f);
+    BLI_assert(cur + 2 <= KD_BATCH_STACK_LEN);
+    stack[cur].lo = is_left ? mid + 1 : lo;
+    stack[cur].hi = is_left ? hi : mid;
+    stack[cur].dist_sq = max_ff(bound_sq, SQUARE(plane_dist));
+    cur++;
+    stack[cur].lo = is_left ? lo : mid + 1;
+    stack[cur].hi = is_left ? mid : hi;
+    stack[cur].dist_sq = bound_sq;
+    cur++;
+  }
+
+  for (uint i = 0; i < nearest_len; i++) {
+    r_nearest[i].dist = sqrtf(r_nearest[i].dist);
+  }
+
+  return nearest_len;
+}
+
+static void kdtree_range_search_bucketed_append(const KDTree *tree,
+                                                const float co[KD_DIMS],
+                                                const float range,
+                                                KDTreeNearest **r_nearest,
+                                                uint *r_nearest_len,
+                                                uint *r_nearest_len_capacity)
+{
+  const KDTreeNode *nodes = tree->nodes;
+  const float(*nodes_co)[KD_DIMS] = (const float(*)[KD_DIMS])tree->nodes_co;
+  const float range_sq = range * range;
+  KDTreeBucketRange stack[KD_BATCH_STACK_LEN];
+  uint cur = 0;
+  uint nearest_len = *r_nearest_len;
+
+  stack[cur].lo = 0;
+  stack[cur].hi = tree->nodes_len;
+  cur++;
+
+  while (cur--) {
+    const uint lo = stack[cur].lo, hi = stack[cur].hi;
+
+    if (hi - lo <= tree->bucket_len) {
+      for (uint i = lo; i < hi; i++) {
+        const float dist_sq = len_squared_vnvn(nodes_co[i], co);
+        if (dist_sq <= range_sq) {
+          nearest_add_in_range(r_nearest,
+                               nearest_len++,
+                               r_nearest_len_capacity,
+                               nodes[i].index,
+                               dist_sq,
+                               nodes_co[i]);
+        }
+      }
+      continue;
+    }
+
+    const uint mid = lo + ((hi - lo) / 2);
+    const KDTreeNode *node = &nodes[mid];
+
+    BLI_assert(cur + 2 <= KD_BATCH_STACK_LEN);
+    if (co[node->d] + range < node->co[node->d]) {
+      stack[cur].lo = lo;
+      stack[cur].hi = mid;
+      cur++;
+    }
+    else if (co[node->d] - range > node->co[node->d]) {
+      stack[cur].lo = mid + 1;
+      stack[cur].hi = hi;
+      cur++;
+    }
+    else {
+      const float dist_sq = len_squared_vnvn(node->co, co);
+      if (dist_sq <= range_sq) {
+        nearest_add_in_range(
+            r_nearest, nearest_len++, r_nearest_len_capacity, node->index, dist_sq, node->co);
+      }
+      stack[cur].lo = lo;
+      stack[cur].hi = mid;
+      cur++;
+      stack[cur].lo = mid + 1;
+      stack[cur].hi = hi;
+      cur++;
+    }
+  }
+
+  *r_nearest_len = nearest_len;
+}
+
+/** Results of the range searches of one block of #KD_BATCH_BLOCK_LEN points. */
+typedef struct KDTreeBatchBlock {
+  KDTreeNearest *nearest;
+  uint nearest_len;
+  uint nearest_len_capacity;
+} KDTreeBatchBlock;
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  uint co_len;
+
+  /* Find nearest. */
+  KDTreeNearest *nearest;
+  uint nearest_len_capacity;
+
+  /* Range search. */
+  float range;
+  uint nearest_len_max;
+  uint *nearest_offset;
+  KDTreeBatchBlock *blocks;
+} KDTreeBatchData;
+
+static void kdtree_find_nearest_n_batch_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeNearest *nearest = &data->nearest[(size_t)i * data->nearest_len_capacity];
+
+  if (data->tree->nodes_co) {
+    kdtree_find_nearest_n_bucketed(data->tree, data->co[i], nearest, data->nearest_len_capacity);
+  }
+  else {
+    BLI_kdtree_nd_(find_nearest_n)(data->tree, data->co[i], nearest, data->nearest_len_capacity);
+  }
+}
+
+/**
+ * Multi-threaded version of #BLI_kdtree_3d_find_nearest_n, for \a co_len coordinates.
+ *
+ * \param r_nearest: An array sized at least `co_len * nearest_len_capacity`,
+ * the results for `co[i]` start at `r_nearest[i * nearest_len_capacity]`.
+ * \return The number of points found for each coordinate
+ * (the same for all, since it only depends on the size of the tree).
+ */
+int BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                         const float (*co)[KD_DIMS],
+                                         const uint co_len,
+                                         KDTreeNearest *r_nearest,
+                                         const uint nearest_len_capacity)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY((tree->root == KD_NODE_UNSET) || nearest_len_capacity == 0 || co_len == 0)) {
+    return 0;
+  }
+
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .co_len = co_len,
+      .nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_find_nearest_n_batch_cb, &settings);
+
+  return (int)MIN2(nearest_len_capacity, tree->nodes_len);
+}
+
+static void kdtree_range_search_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeBatchBlock *block = &data->blocks[i];
+  const uint co_end = MIN2(((uint)i + 1) * KD_BATCH_BLOCK_LEN, data->co_len);
+
+  for (uint co_index = (uint)i * KD_BATCH_BLOCK_LEN; co_index < co_end; co_index++) {
+    const uint nearest_start = block->nearest_len;
+
+    if (data->tree->nodes_co) {
+      kdtree_range_search_bucketed_append(data->tree,
+                                          data->co[co_index],
+                                          data->range,
+                                          &block->nearest,
+                                          &block->nearest_len,
+                                          &block->nearest_len_capacity);
+    }
+    else {
+      kdtree_range_search_append(data->tree,
+                                 data->co[co_index],
+                                 data->range,
+                                 len_squared_vnvn_cb,
+                                 NULL,
+                                 &block->nearest,
+                                 &block->nearest_len,
+                                 &block->nearest_len_capacity);
+    }
+
+    uint nearest_len = block->nearest_len - nearest_start;
+    if (nearest_len > 1) {
+      qsort(&block->nearest[nearest_start], nearest_len, sizeof(KDTreeNearest), nearest_cmp_dist);
+    }
+    if (data->nearest_len_max && nearest_len > data->nearest_len_max) {
+      nearest_len = data->nearest_len_max;
+      block->nearest_len = nearest_start + nearest_len;
+    }
+    /* Offsets are accumulated once all searches are done. */
+    data->nearest_offset[co_index + 1] = nearest_len;
+  }
+}
+
+/**
+ * Multi-threaded version of #BLI_kdtree_3d_range_search, for \a co_len coordinates.
+ *
+ * Results are stored in compressed sparse row form: the points found for `co[i]`
+ * are `r_nearest[r_nearest_offset[i]]` up to (not including) `r_nearest[r_nearest_offset[i + 1]]`,
+ * sorted by distance.
+ *
+ * \param nearest_len_max: When non-zero,
+ * only keep this many of the nearest points for each search.
+ * \param r_nearest_offset: Allocated array of `co_len + 1` offsets.
+ * \param r_nearest: Allocated array of all the points found (NULL when none are found).
+ * \return The total number of points found.
+ */
+int BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                       const float (*co)[KD_DIMS],
+                                       const uint co_len,
+                                       const float range,
+                                       const uint nearest_len_max,
+                                       uint **r_nearest_offset,
+                                       KDTreeNearest **r_nearest)
+{
+  uint *nearest_offset = MEM_callocN(sizeof(*nearest_offset) * (co_len + 1), __func__);
+  KDTreeNearest *nearest = NULL;
+
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  *r_nearest_offset = nearest_offset;
+  *r_nearest = NULL;
+
+  if (UNLIKELY((tree->root == KD_NODE_UNSET) || co_len == 0)) {
+    return 0;
+  }
+
+  const uint blocks_len = (co_len + (KD_BATCH_BLOCK_LEN - 1)) / KD_BATCH_BLOCK_LEN;
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .co_len = co_len,
+      .range = range,
+      .nearest_len_max = nearest_len_max,
+      .nearest_offset = nearest_offset,
+      .blocks = MEM_callocN(sizeof(*data.blocks) * blocks_len, __func__),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, (int)blocks_len, &data, kdtree_range_search_batch_cb, &settings);
+
+  for (uint i = 0; i < co_len; i++) {
+    nearest_offset[i + 1] += nearest_offset[i];
+  }
+
+  const uint nearest_len = nearest_offset[co_len];
+  if (nearest_len) {
+    nearest = MEM_mallocN(sizeof(*nearest) * nearest_len, __func__);
+  }
+
+  for (uint i = 0; i < blocks_len; i++) {
+    KDTreeBatchBlock *block = &data.blocks[i];
+    if (block->nearest) {
+      memcpy(&nearest[nearest_offset[i * KD_BATCH_BLOCK_LEN]],
+             block->nearest,
+             sizeof(*nearest) * block->nearest_len);
+      MEM_freeN(block->nearest);
+    }
+  }
+  MEM_freeN(data.blocks);
+
+  *r_nearest = nearest;
+
+  return (int)nearest_len;
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
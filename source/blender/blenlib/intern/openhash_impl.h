@@ -0,0 +1,390 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Open addressing hash table, see BLI_openhash.h.
+ *
+ * The layout follows #EdgeHash: entries are kept densely packed in insertion order
+ * (removal moves the last entry into the gap), and a separate map of slots stores
+ * indices into the entries array, probed the same way as Python's dict.
+ *
+ * Expects OPENHASH_HASH(key) to be defined by the including file.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_openhash_impl.h"
+#include "BLI_strict_flags.h"
+
+#define _CONCAT_AUX(MACRO_ARG1, MACRO_ARG2) MACRO_ARG1##MACRO_ARG2
+#define _CONCAT(MACRO_ARG1, MACRO_ARG2) _CONCAT_AUX(MACRO_ARG1, MACRO_ARG2)
+#define BLI_openhash_(id) _CONCAT(OPENHASH_PREFIX_ID, _##id)
+#define BLI_openhashIterator_(id) _CONCAT(OPENHASH_ITER_PREFIX_ID, _##id)
+
+struct OpenHash {
+  OpenHashEntry *entries;
+  int32_t *map;
+  uint32_t slot_mask;
+  uint capacity_exp;
+  uint length;
+  uint dummy_count;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Helper Macros & Defines
+ * \{ */
+
+#define ENTRIES_CAPACITY(container) (uint)(1 << (container)->capacity_exp)
+#define MAP_CAPACITY(container) (uint)(1 << ((container)->capacity_exp + 1))
+#define CLEAR_MAP(container) \
+  memset((container)->map, 0xFF, sizeof(int32_t) * MAP_CAPACITY(container))
+#define UPDATE_SLOT_MASK(container) \
+  { \
+    (container)->slot_mask = MAP_CAPACITY(container) - 1; \
+  } \
+  ((void)0)
+#define PERTURB_SHIFT 5
+
+#define ITER_SLOTS(CONTAINER, KEY, SLOT, INDEX) \
+  uint32_t hash = OPENHASH_HASH(KEY); \
+  uint32_t mask = (CONTAINER)->slot_mask; \
+  uint32_t perturb = hash; \
+  int32_t *map = (CONTAINER)->map; \
+  uint32_t SLOT = mask & hash; \
+  int INDEX = map[SLOT]; \
+  for (;; SLOT = mask & ((5 * SLOT) + 1 + perturb), perturb >>= PERTURB_SHIFT, INDEX = map[SLOT])
+
+#define SLOT_EMPTY -1
+#define SLOT_DUMMY -2
+
+#define CAPACITY_EXP_DEFAULT 3
+
+#define OH_INDEX_HAS_KEY(oh, index, key_) ((index) >= 0 && (oh)->entries[index].key == (key_))
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Utility API
+ * \{ */
+
+static uint calc_capacity_exp_for_reserve(uint reserve)
+{
+  uint result = 1;
+  while (reserve >>= 1) {
+    result++;
+  }
+  return result;
+}
+
+BLI_INLINE void openhash_insert_index(OpenHash *oh, OPENHASH_KEY key, uint entry_index)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (index == SLOT_EMPTY) {
+      oh->map[slot] = (int32_t)entry_index;
+      break;
+    }
+  }
+}
+
+BLI_INLINE OpenHashEntry *openhash_insert_at_slot(OpenHash *oh,
+                                                  uint slot,
+                                                  OPENHASH_KEY key,
+                                                  OPENHASH_VALUE value)
+{
+  OpenHashEntry *entry = &oh->entries[oh->length];
+  entry->key = key;
+  entry->value = value;
+  oh->map[slot] = (int32_t)oh->length;
+  oh->length++;
+  return entry;
+}
+
+static void openhash_resize(OpenHash *oh, const uint capacity_exp)
+{
+  oh->capacity_exp = capacity_exp;
+  UPDATE_SLOT_MASK(oh);
+  oh->dummy_count = 0;
+  oh->entries = MEM_reallocN(oh->entries, sizeof(OpenHashEntry) * ENTRIES_CAPACITY(oh));
+  oh->map = MEM_reallocN(oh->map, sizeof(int32_t) * MAP_CAPACITY(oh));
+  CLEAR_MAP(oh);
+  for (uint i = 0; i < oh->length; i++) {
+    openhash_insert_index(oh, oh->entries[i].key, i);
+  }
+}
+
+BLI_INLINE bool openhash_ensure_can_insert(OpenHash *oh)
+{
+  if (UNLIKELY(ENTRIES_CAPACITY(oh) <= oh->length + oh->dummy_count)) {
+    openhash_resize(oh, oh->capacity_exp + 1);
+    return true;
+  }
+  return false;
+}
+
+BLI_INLINE OpenHashEntry *openhash_insert(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE value)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (index == SLOT_EMPTY) {
+      return openhash_insert_at_slot(oh, slot, key, value);
+    }
+    else if (index == SLOT_DUMMY) {
+      oh->dummy_count--;
+      return openhash_insert_at_slot(oh, slot, key, value);
+    }
+  }
+}
+
+BLI_INLINE OpenHashEntry *openhash_lookup_entry(const OpenHash *oh, OPENHASH_KEY key)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (OH_INDEX_HAS_KEY(oh, index, key)) {
+      return &oh->entries[index];
+    }
+    else if (index == SLOT_EMPTY) {
+      return NULL;
+    }
+  }
+}
+
+BLI_INLINE void openhash_change_index(OpenHash *oh, OPENHASH_KEY key, int new_index)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (OH_INDEX_HAS_KEY(oh, index, key)) {
+      oh->map[slot] = new_index;
+      break;
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Open Hash API
+ * \{ */
+
+OpenHash *BLI_openhash_(new_ex)(const char *info, const uint nentries_reserve)
+{
+  OpenHash *oh = MEM_mallocN(sizeof(OpenHash), info);
+  oh->capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  UPDATE_SLOT_MASK(oh);
+  oh->length = 0;
+  oh->dummy_count = 0;
+  oh->entries = MEM_malloc_arrayN(sizeof(OpenHashEntry), ENTRIES_CAPACITY(oh), "oh entries");
+  oh->map = MEM_malloc_arrayN(sizeof(int32_t), MAP_CAPACITY(oh), "oh map");
+  CLEAR_MAP(oh);
+  return oh;
+}
+
+OpenHash *BLI_openhash_(new)(const char *info)
+{
+  return BLI_openhash_(new_ex)(info, 1 << CAPACITY_EXP_DEFAULT);
+}
+
+void BLI_openhash_(free)(OpenHash *oh)
+{
+  MEM_freeN(oh->map);
+  MEM_freeN(oh->entries);
+  MEM_freeN(oh);
+}
+
+/**
+ * Grow the table so \a nentries_reserve entries fit without further resizing.
+ */
+void BLI_openhash_(reserve)(OpenHash *oh, const uint nentries_reserve)
+{
+  const uint capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  if (capacity_exp > oh->capacity_exp) {
+    openhash_resize(oh, capacity_exp);
+  }
+}
+
+/**
+ * Insert a key into the hash with given value, does not check for duplicates.
+ */
+void BLI_openhash_(insert)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE value)
+{
+  BLI_assert(!BLI_openhash_(haskey)(oh, key));
+  openhash_ensure_can_insert(oh);
+  openhash_insert(oh, key, value);
+}
+
+/**
+ * Assign a new value to a key that may already be in the hash.
+ *
+ * \return true if a new key has been added.
+ */
+bool BLI_openhash_(reinsert)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE value)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (OH_INDEX_HAS_KEY(oh, index, key)) {
+      oh->entries[index].value = value;
+      return false;
+    }
+    else if (index == SLOT_EMPTY) {
+      if (openhash_ensure_can_insert(oh)) {
+        openhash_insert(oh, key, value);
+      }
+      else {
+        openhash_insert_at_slot(oh, slot, key, value);
+      }
+      return true;
+    }
+  }
+}
+
+/**
+ * Return value for given key, or a zero value (NULL for pointers) if the key does not exist.
+ * See #lookup_p and #lookup_default when zero values need to be told apart.
+ */
+OPENHASH_VALUE BLI_openhash_(lookup)(const OpenHash *oh, OPENHASH_KEY key)
+{
+  OpenHashEntry *entry = openhash_lookup_entry(oh, key);
+  return entry ? entry->value : (OPENHASH_VALUE)0;
+}
+
+/**
+ * A version of #lookup which accepts a fallback argument.
+ */
+OPENHASH_VALUE BLI_openhash_(lookup_default)(const OpenHash *oh,
+                                             OPENHASH_KEY key,
+                                             OPENHASH_VALUE value_default)
+{
+  OpenHashEntry *entry = openhash_lookup_entry(oh, key);
+  return entry ? entry->value : value_default;
+}
+
+/**
+ * Return pointer to the value for given key, or NULL if the key does not exist.
+ */
+OPENHASH_VALUE *BLI_openhash_(lookup_p)(OpenHash *oh, OPENHASH_KEY key)
+{
+  OpenHashEntry *entry = openhash_lookup_entry(oh, key);
+  return entry ? &entry->value : NULL;
+}
+
+/**
+ * Ensure \a key exists in the hash, returning a pointer to its value.
+ *
+ * \returns true when the value didn't need to be added.
+ * (when false, the caller _must_ initialize the value).
+ */
+bool BLI_openhash_(ensure_p)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE **r_value)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (OH_INDEX_HAS_KEY(oh, index, key)) {
+      *r_value = &oh->entries[index].value;
+      return true;
+    }
+    else if (index == SLOT_EMPTY) {
+      if (openhash_ensure_can_insert(oh)) {
+        *r_value = &openhash_insert(oh, key, (OPENHASH_VALUE)0)->value;
+      }
+      else {
+        *r_value = &openhash_insert_at_slot(oh, slot, key, (OPENHASH_VALUE)0)->value;
+      }
+      return false;
+    }
+  }
+}
+
+bool BLI_openhash_(haskey)(const OpenHash *oh, OPENHASH_KEY key)
+{
+  return openhash_lookup_entry(oh, key) != NULL;
+}
+
+/**
+ * Remove \a key from the hash, returning its value in \a r_value (when not NULL).
+ *
+ * \note The last entry is moved into the place of the removed one,
+ * so this must not be called while iterating.
+ * \return true if \a key was found and removed.
+ */
+bool BLI_openhash_(pop)(OpenHash *oh, OPENHASH_KEY key, OPENHASH_VALUE *r_value)
+{
+  ITER_SLOTS (oh, key, slot, index) {
+    if (OH_INDEX_HAS_KEY(oh, index, key)) {
+      if (r_value) {
+        *r_value = oh->entries[index].value;
+      }
+      oh->length--;
+      oh->dummy_count++;
+      oh->map[slot] = SLOT_DUMMY;
+      oh->entries[index] = oh->entries[oh->length];
+      if ((uint)index < oh->length) {
+        openhash_change_index(oh, oh->entries[index].key, index);
+      }
+      return true;
+    }
+    else if (index == SLOT_EMPTY) {
+      return false;
+    }
+  }
+}
+
+bool BLI_openhash_(remove)(OpenHash *oh, OPENHASH_KEY key)
+{
+  return BLI_openhash_(pop)(oh, key, NULL);
+}
+
+uint BLI_openhash_(len)(const OpenHash *oh)
+{
+  return oh->length;
+}
+
+/**
+ * Remove all entries, keeping enough memory for \a nentries_reserve entries.
+ */
+void BLI_openhash_(clear_ex)(OpenHash *oh, const uint nentries_reserve)
+{
+  const uint capacity_exp = calc_capacity_exp_for_reserve(nentries_reserve);
+  oh->length = 0;
+  oh->dummy_count = 0;
+  if (capacity_exp != oh->capacity_exp) {
+    openhash_resize(oh, capacity_exp);
+  }
+  else {
+    CLEAR_MAP(oh);
+  }
+}
+
+void BLI_openhash_(clear)(OpenHash *oh)
+{
+  BLI_openhash_(clear_ex)(oh, 1 << CAPACITY_EXP_DEFAULT);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Open Hash Iterator API
+ * \{ */
+
+/**
+ * Init an iterator, which steps exactly #len times before being done.
+ * The hash table must not be mutated while the iterator is in use.
+ */
+void BLI_openhashIterator_(init)(OpenHashIterator *ohi, OpenHash *oh)
+{
+  ohi->entries = oh->entries;
+  ohi->length = oh->length;
+  ohi->index = 0;
+}
+
+/** \} */
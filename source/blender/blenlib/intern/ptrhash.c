@@ -0,0 +1,40 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * A (pointer -> pointer) open addressing hash table.
+ */
+
+#include "BLI_utildefines.h"
+
+/* Same as #BLI_ghashutil_ptrhash, inlined since it's called for every probe. */
+BLI_INLINE uint ptrhash_calc_hash(const void *key)
+{
+  size_t y = (size_t)key;
+  return (uint)(y >> 4) | ((uint)y << (8 * sizeof(uint) - 4));
+}
+
+#define OPENHASH_KEY void *
+#define OPENHASH_VALUE void *
+#define OPENHASH_PREFIX_ID BLI_ptrhash
+#define OPENHASH_ITER_PREFIX_ID BLI_ptrhashIterator
+#define OpenHash PtrHash
+#define OpenHashEntry PtrHashEntry
+#define OpenHashIterator PtrHashIterator
+#define OPENHASH_HASH(key) ptrhash_calc_hash(key)
+#include "openhash_impl.h"
@@ -58,6 +58,14 @@
  */
 #define DELAYED_QUEUE_SIZE 4096
 
+/* Number of tasks a single thread's deque can hold when using the work stealing
+ * backend. Tasks pushed to a full deque go to the scheduler's global queue.
+ *
+ * Must be a power of two.
+ */
+#define DEQUE_SIZE 1024
+#define DEQUE_MASK (DEQUE_SIZE - 1)
+
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id) \
     do { \
@@ -157,6 +165,23 @@ typedef struct TaskThreadLocalStorage {
   Task *delayed_queue[DELAYED_QUEUE_SIZE];
 } TaskThreadLocalStorage;
 
+/* Per-thread deque used by the work stealing backend.
+ *
+ * The owner thread pushes and pops tasks at the tail, so it keeps working on the
+ * most recently spawned (and most likely still cached) work. Other threads steal
+ * from the head, which holds the oldest and typically the biggest chunks of work.
+ *
+ * The lock is only contended when somebody is stealing, which only happens when
+ * a thread ran out of its own work.
+ */
+typedef struct TaskDeque {
+  SpinLock lock;
+  /* Ring buffer of tasks, indexed by head and tail masked with DEQUE_MASK. */
+  Task *tasks[DEQUE_SIZE];
+  /* Index of the oldest task and one past the newest task. */
+  volatile uint head, tail;
+} TaskDeque;
+
 struct TaskPool {
   TaskScheduler *scheduler;
 
@@ -207,6 +232,14 @@ struct TaskScheduler {
   int num_threads;
   bool background_thread_only;
 
+  eTaskSchedulerBackend backend;
+  /* Number of tasks in all threads' deques, used by the work stealing backend to
+   * decide whether an idle thread can go to sleep. */
+  size_t num_queued_tasks;
+  /* Number of worker threads waiting on queue_cond, so pushing to a deque only
+   * needs to lock the queue mutex when there is somebody to wake up. */
+  int num_sleeping_threads;
+
   ListBase queue;
   ThreadMutex queue_mutex;
   ThreadCondition queue_cond;
@@ -225,8 +258,11 @@ typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
   TaskThreadLocalStorage tls;
+  TaskDeque deque;
 } TaskThread;
 
+static eTaskSchedulerBackend task_scheduler_backend_default = TASK_SCHEDULER_BACKEND_QUEUE;
+
 /* Helper */
 BLI_INLINE void task_data_free(Task *task, const int thread_id)
 {
@@ -326,6 +362,139 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
+/* Work Stealing Deque */
+
+static void task_deque_init(TaskDeque *deque)
+{
+  BLI_spin_init(&deque->lock);
+  deque->head = 0;
+  deque->tail = 0;
+}
+
+static void task_deque_end(TaskDeque *deque)
+{
+  for (uint i = deque->head; i != deque->tail; i++) {
+    Task *task = deque->tasks[i & DEQUE_MASK];
+    task_data_free(task, 0);
+    MEM_freeN(task);
+  }
+  BLI_spin_end(&deque->lock);
+}
+
+BLI_INLINE bool task_deque_is_empty(const TaskDeque *deque)
+{
+  /* Unlocked check, only used to avoid taking the lock of an empty deque. */
+  return deque->head == deque->tail;
+}
+
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+  bool success = false;
+  BLI_spin_lock(&deque->lock);
+  if (deque->tail - deque->head < DEQUE_SIZE) {
+    deque->tasks[deque->tail & DEQUE_MASK] = task;
+    deque->tail++;
+    success = true;
+  }
+  BLI_spin_unlock(&deque->lock);
+  return success;
+}
+
+/* Take a task out of the deque: from the tail when called by the owner thread,
+ * from the head when stealing.
+ *
+ * If pool is not NULL only tasks of that pool are considered. This is used by
+ * threads waiting for a pool to finish, picking up tasks from other pools there
+ * could lead to a deadlock.
+ */
+static Task *task_deque_take(TaskDeque *deque, TaskPool *pool, const bool from_tail)
+{
+  if (task_deque_is_empty(deque)) {
+    return NULL;
+  }
+
+  Task *task = NULL;
+  BLI_spin_lock(&deque->lock);
+
+  const uint head = deque->head, tail = deque->tail;
+  if (from_tail) {
+    for (uint i = tail; i != head; i--) {
+      Task *current_task = deque->tasks[(i - 1) & DEQUE_MASK];
+      if (pool == NULL || current_task->pool == pool) {
+        task = current_task;
+        /* Close the gap by moving newer tasks one slot down. */
+        for (uint j = i; j != tail; j++) {
+          deque->tasks[(j - 1) & DEQUE_MASK] = deque->tasks[j & DEQUE_MASK];
+        }
+        deque->tail = tail - 1;
+        break;
+      }
+    }
+  }
+  else {
+    for (uint i = head; i != tail; i++) {
+      Task *current_task = deque->tasks[i & DEQUE_MASK];
+      if (pool == NULL || current_task->pool == pool) {
+        task = current_task;
+        /* Close the gap by moving older tasks one slot up. */
+        for (uint j = i; j != head; j--) {
+          deque->tasks[j & DEQUE_MASK] = deque->tasks[(j - 1) & DEQUE_MASK];
+        }
+        deque->head = head + 1;
+        break;
+      }
+    }
+  }
+
+  BLI_spin_unlock(&deque->lock);
+  return task;
+}
+
+/* Free all tasks of the given pool which are still in the deque,
+ * returns the number of freed tasks. */
+static size_t task_deque_clear(TaskDeque *deque, TaskPool *pool)
+{
+  if (task_deque_is_empty(deque)) {
+    return 0;
+  }
+
+  size_t done = 0;
+  BLI_spin_lock(&deque->lock);
+
+  uint new_tail = deque->head;
+  for (uint i = deque->head; i != deque->tail; i++) {
+    Task *task = deque->tasks[i & DEQUE_MASK];
+    if (task->pool == pool) {
+      task_data_free(task, pool->thread_id);
+      MEM_freeN(task);
+      done++;
+    }
+    else {
+      deque->tasks[new_tail & DEQUE_MASK] = task;
+      new_tail++;
+    }
+  }
+  deque->tail = new_tail;
+
+  BLI_spin_unlock(&deque->lock);
+  return done;
+}
+
+/* Deque to push tasks to from the given thread, NULL if the scheduler does not
+ * use work stealing or the thread is not one of the scheduler's threads. */
+BLI_INLINE TaskDeque *get_task_deque(TaskPool *pool, const int thread_id)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  if (scheduler->backend != TASK_SCHEDULER_BACKEND_WORK_STEALING || thread_id == -1) {
+    return NULL;
+  }
+  if (pool->use_local_tls && thread_id == 0) {
+    return NULL;
+  }
+  BLI_assert(thread_id <= scheduler->num_threads);
+  return &scheduler->task_threads[thread_id].deque;
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
@@ -404,6 +573,115 @@ static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task
   return true;
 }
 
+static void task_scheduler_wakeup(TaskScheduler *scheduler, const bool all)
+{
+  /* Only bother locking the queue if there is anyone to wake up. */
+  if (atomic_add_and_fetch_int32(&scheduler->num_sleeping_threads, 0) == 0) {
+    return;
+  }
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  if (all) {
+    BLI_condition_notify_all(&scheduler->queue_cond);
+  }
+  else {
+    BLI_condition_notify_one(&scheduler->queue_cond);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+static bool task_scheduler_push_deque(TaskScheduler *scheduler, TaskDeque *deque, Task *task)
+{
+  /* Count the task before it becomes visible, so a thread stealing it right away
+   * never sees the counter going below zero. */
+  atomic_add_and_fetch_z(&scheduler->num_queued_tasks, 1);
+  if (!task_deque_push(deque, task)) {
+    atomic_sub_and_fetch_z(&scheduler->num_queued_tasks, 1);
+    return false;
+  }
+  return true;
+}
+
+/* Find a task for the work stealing backend. The thread's own deque is checked
+ * first, then other threads' deques are stolen from, and finally the global
+ * queue is checked, which holds tasks pushed from outside of scheduler threads.
+ *
+ * thread_id is -1 for threads which do not own a deque.
+ * If pool is not NULL only tasks of that pool are returned.
+ */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler,
+                                      const int thread_id,
+                                      TaskPool *pool)
+{
+  const int num_deques = scheduler->num_threads + 1;
+  Task *task = NULL;
+
+  if (thread_id != -1) {
+    task = task_deque_take(&scheduler->task_threads[thread_id].deque, pool, true);
+  }
+  /* Start stealing from the next thread, so victims are spread between threads. */
+  for (int i = 1; task == NULL && i <= num_deques; i++) {
+    const int victim_id = (thread_id + i) % num_deques;
+    if (victim_id != thread_id) {
+      task = task_deque_take(&scheduler->task_threads[victim_id].deque, pool, false);
+    }
+  }
+
+  if (task != NULL) {
+    atomic_sub_and_fetch_z(&scheduler->num_queued_tasks, 1);
+    return task;
+  }
+
+  /* Unlocked check, the queue is re-checked under the lock before going to sleep. */
+  if (scheduler->queue.first != NULL) {
+    BLI_mutex_lock(&scheduler->queue_mutex);
+    for (Task *current_task = scheduler->queue.first; current_task != NULL;
+         current_task = current_task->next) {
+      if (pool == NULL || current_task->pool == pool) {
+        task = current_task;
+        BLI_remlink(&scheduler->queue, task);
+        break;
+      }
+    }
+    BLI_mutex_unlock(&scheduler->queue_mutex);
+  }
+
+  return task;
+}
+
+static bool task_scheduler_thread_wait_steal(TaskThread *thread, Task **task)
+{
+  TaskScheduler *scheduler = thread->scheduler;
+
+  while (!scheduler->do_exit) {
+    *task = task_scheduler_find_task(scheduler, thread->id, NULL);
+    if (*task != NULL) {
+      return true;
+    }
+
+    BLI_mutex_lock(&scheduler->queue_mutex);
+    atomic_add_and_fetch_int32(&scheduler->num_sleeping_threads, 1);
+    /* Check again after announcing that we go to sleep: a task pushed to a deque
+     * in the meantime is either seen here, or its push will see this thread as
+     * sleeping and wake it up. */
+    if (!scheduler->do_exit && scheduler->queue.first == NULL &&
+        atomic_add_and_fetch_z(&scheduler->num_queued_tasks, 0) == 0) {
+      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+    }
+    atomic_sub_and_fetch_int32(&scheduler->num_sleeping_threads, 1);
+    BLI_mutex_unlock(&scheduler->queue_mutex);
+  }
+
+  return false;
+}
+
+BLI_INLINE bool task_scheduler_thread_next_task(TaskThread *thread, Task **task)
+{
+  if (thread->scheduler->backend == TASK_SCHEDULER_BACKEND_WORK_STEALING) {
+    return task_scheduler_thread_wait_steal(thread, task);
+  }
+  return task_scheduler_thread_wait_pop(thread->scheduler, task);
+}
+
 BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
 {
   BLI_assert(!tls->do_delayed_push);
@@ -442,7 +720,7 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+  while (task_scheduler_thread_next_task(thread, &task)) {
     TaskPool *pool = task->pool;
 
     /* run task */
@@ -463,7 +741,22 @@ static void *task_scheduler_thread_run(void *thread_p)
   return NULL;
 }
 
+void BLI_task_scheduler_backend_default_set(eTaskSchedulerBackend backend)
+{
+  task_scheduler_backend_default = backend;
+}
+
+eTaskSchedulerBackend BLI_task_scheduler_backend_default_get(void)
+{
+  return task_scheduler_backend_default;
+}
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
+{
+  return BLI_task_scheduler_create_ex(num_threads, task_scheduler_backend_default);
+}
+
+TaskScheduler *BLI_task_scheduler_create_ex(int num_threads, eTaskSchedulerBackend backend)
 {
   TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
 
@@ -493,12 +786,22 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
     num_threads = 1;
   }
 
+  /* The background-only thread must skip tasks of regular pools, which stealing
+   * can not do efficiently, and there is nobody to steal from anyway. */
+  scheduler->backend = scheduler->background_thread_only ? TASK_SCHEDULER_BACKEND_QUEUE :
+                                                           backend;
+
   scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
                                         "TaskScheduler task threads");
 
   /* Initialize TLS for main thread. */
   initialize_task_tls(&scheduler->task_threads[0].tls);
 
+  /* Deques must be ready before any thread starts stealing from them. */
+  for (int i = 0; i < num_threads + 1; i++) {
+    task_deque_init(&scheduler->task_threads[i].deque);
+  }
+
   pthread_key_create(&scheduler->tls_id_key, NULL);
 
   /* launch threads that will be waiting for work */
@@ -564,6 +867,7 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
       TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
       free_task_tls(tls);
+      task_deque_end(&scheduler->task_threads[i].deque);
     }
 
     MEM_freeN(scheduler->task_threads);
@@ -589,10 +893,25 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
   return scheduler->num_threads + 1;
 }
 
-static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+eTaskSchedulerBackend BLI_task_scheduler_backend(TaskScheduler *scheduler)
+{
+  return scheduler->backend;
+}
+
+static void task_scheduler_push(TaskScheduler *scheduler,
+                                Task *task,
+                                TaskPriority priority,
+                                TaskDeque *deque)
 {
   task_pool_num_increase(task->pool, 1);
 
+  /* Deque of the pushing thread, priority is not used here since the owner
+   * will pick up newest tasks first anyway. */
+  if (deque != NULL && task_scheduler_push_deque(scheduler, deque, task)) {
+    task_scheduler_wakeup(scheduler, false);
+    return;
+  }
+
   /* add task to queue */
   BLI_mutex_lock(&scheduler->queue_mutex);
 
@@ -649,6 +968,16 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
+  if (scheduler->backend == TASK_SCHEDULER_BACKEND_WORK_STEALING) {
+    for (int i = 0; i < scheduler->num_threads + 1; i++) {
+      const size_t done_deque = task_deque_clear(&scheduler->task_threads[i].deque, pool);
+      if (done_deque != 0) {
+        atomic_sub_and_fetch_z(&scheduler->num_queued_tasks, done_deque);
+        done += done_deque;
+      }
+    }
+  }
+
   /* notify done */
   task_pool_num_decrease(pool, done);
 }
@@ -827,6 +1156,16 @@ static void task_pool_push(TaskPool *pool,
     atomic_fetch_and_add_z(&pool->num_suspended, 1);
     return;
   }
+  /* With work stealing the thread's own deque replaces the local and delayed
+   * queues: it is as cheap to push to, and other threads can pick tasks up. */
+  if (pool->scheduler->backend == TASK_SCHEDULER_BACKEND_WORK_STEALING) {
+    TaskDeque *deque = get_task_deque(pool, thread_id);
+    if (deque != NULL) {
+      ASSERT_THREAD_ID(pool->scheduler, thread_id);
+    }
+    task_scheduler_push(pool->scheduler, task, priority, deque);
+    return;
+  }
   /* Populate to any local queue first, this is cheapest push ever. */
   if (task_can_use_local_queues(pool, thread_id)) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
@@ -852,7 +1191,7 @@ static void task_pool_push(TaskPool *pool,
   /* Do push to a global execution pool, slowest possible method,
    * causes quite reasonable amount of threading overhead.
    */
-  task_scheduler_push(pool->scheduler, task, priority);
+  task_scheduler_push(pool->scheduler, task, priority, NULL);
 }
 
 void BLI_task_pool_push_ex(TaskPool *pool,
@@ -881,6 +1220,58 @@ void BLI_task_pool_push_from_thread(TaskPool *pool,
   task_pool_push(pool, run, taskdata, free_taskdata, NULL, priority, thread_id);
 }
 
+/* Move tasks of a suspended pool to the deque of the thread which is about to
+ * work on the pool, so they are executed by this thread and stolen by idle ones. */
+static void task_pool_push_suspended_to_deque(TaskPool *pool)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  TaskDeque *deque = get_task_deque(pool, pool->thread_id);
+  Task *task;
+
+  while ((task = BLI_pophead(&pool->suspended_queue))) {
+    if (deque == NULL || !task_scheduler_push_deque(scheduler, deque, task)) {
+      BLI_mutex_lock(&scheduler->queue_mutex);
+      BLI_addtail(&scheduler->queue, task);
+      BLI_mutex_unlock(&scheduler->queue_mutex);
+    }
+  }
+
+  task_scheduler_wakeup(scheduler, true);
+}
+
+static void task_pool_work_and_wait_steal(TaskPool *pool)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  /* Pools created from threads not managed by the scheduler have no deque. */
+  const int deque_thread_id = pool->use_local_tls ? -1 : pool->thread_id;
+
+  BLI_mutex_lock(&pool->num_mutex);
+
+  while (pool->num != 0) {
+    BLI_mutex_unlock(&pool->num_mutex);
+
+    /* Only run tasks from this pool, others might be waiting on us. */
+    Task *task = task_scheduler_find_task(scheduler, deque_thread_id, pool);
+
+    if (task != NULL) {
+      task->run(pool, task->taskdata, pool->thread_id);
+      task_free(pool, task, pool->thread_id);
+      task_pool_num_decrease(pool, 1);
+    }
+
+    BLI_mutex_lock(&pool->num_mutex);
+    if (pool->num == 0) {
+      break;
+    }
+
+    if (task == NULL) {
+      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+    }
+  }
+
+  BLI_mutex_unlock(&pool->num_mutex);
+}
+
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
   TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
@@ -889,12 +1280,17 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
   if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
     if (pool->num_suspended) {
       task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
+      if (scheduler->backend == TASK_SCHEDULER_BACKEND_WORK_STEALING) {
+        task_pool_push_suspended_to_deque(pool);
+      }
+      else {
+        BLI_mutex_lock(&scheduler->queue_mutex);
 
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
+        BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
 
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
+        BLI_condition_notify_all(&scheduler->queue_cond);
+        BLI_mutex_unlock(&scheduler->queue_mutex);
+      }
 
       pool->num_suspended = 0;
     }
@@ -904,6 +1300,11 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 
   ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
+  if (scheduler->backend == TASK_SCHEDULER_BACKEND_WORK_STEALING) {
+    task_pool_work_and_wait_steal(pool);
+    return;
+  }
+
   handle_local_queue(tls, pool->thread_id);
 
   BLI_mutex_lock(&pool->num_mutex);
@@ -102,6 +102,8 @@ BlendFileData *BLO_read_from_memfile(struct Main *oldmain,
 void BLO_blendfiledata_free(BlendFileData *bfd);
 
 BlendHandle *BLO_blendhandle_from_file(const char *filepath, struct ReportList *reports);
+BlendHandle *BLO_blendhandle_from_file_lazy_index(const char *filepath,
+                                                  struct ReportList *reports);
 BlendHandle *BLO_blendhandle_from_memory(const void *mem, int memsize);
 
 struct LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh,
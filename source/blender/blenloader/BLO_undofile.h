@@ -25,15 +25,19 @@
  * \ingroup blenloader
  */
 
+struct MemFileChunkData;
 struct Scene;
 
 typedef struct {
   void *next, *prev;
-  const char *buf;
+  /**
+   * Reference counted contents, shared by all chunks (of any #MemFile) with the same data.
+   * Access using #BLO_memfile_chunk_buf (with the memfile pinned) since the data may be
+   * compressed.
+   */
+  struct MemFileChunkData *data;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
-  bool is_identical;
 } MemFileChunk;
 
 typedef struct MemFile {
@@ -52,10 +56,18 @@ extern void memfile_chunk_add(MemFile *memfile,
                               const char *buf,
                               unsigned int size,
                               MemFileChunk **compchunk_step);
+extern void memfile_write_end(MemFile *compare);
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
+extern void BLO_memfile_pin(MemFile *memfile);
+extern void BLO_memfile_unpin(MemFile *memfile);
+extern const char *BLO_memfile_chunk_buf(MemFileChunk *chunk);
+extern void BLO_memfile_chunk_store_stats(size_t *r_chunks_len,
+                                          size_t *r_size_resident,
+                                          size_t *r_size_compressed);
+extern void BLO_memfile_chunk_store_wait(void);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
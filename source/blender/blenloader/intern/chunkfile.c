@@ -0,0 +1,669 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Chunked compressed .blend file reading & writing, see chunkfile.h for the file layout.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#  include "BLI_winstuff.h"
+#endif
+
+#include "zlib.h"
+
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_endian_switch.h"
+#include "BLI_fileops.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "chunkfile.h"
+
+#define CHUNKFILE_VERSION 1
+#define CHUNKFILE_CHUNK_SIZE (1 << 20)
+/** Sanity check for reading. */
+#define CHUNKFILE_CHUNK_SIZE_MAX (1 << 26)
+#define CHUNKFILE_FOOTER_MAGIC "BZCT"
+
+#define CHUNKFILE_HEADER_LEN 16
+#define CHUNKFILE_FOOTER_LEN 16
+
+/** Upper bound of the LZO compressed size of \a size bytes. */
+#define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+
+typedef struct ChunkFileEntry {
+  uint64_t offset;
+  uint size;
+  uint raw_size;
+} ChunkFileEntry;
+
+BLI_STATIC_ASSERT(sizeof(ChunkFileEntry) == 16, "ChunkFileEntry is written to files")
+
+/**
+ * Number of chunks compressed or decompressed at once,
+ * enough to keep all threads busy.
+ */
+static uint chunkfile_batch_len(void)
+{
+  return (uint)CLAMPIS(BLI_system_thread_count() * 2, 2, 64);
+}
+
+bool blo_chunkfile_codec_is_supported(const eChunkFileCodec codec)
+{
+  switch (codec) {
+    case CHUNKFILE_CODEC_DEFLATE:
+      return true;
+    case CHUNKFILE_CODEC_LZO:
+#ifdef WITH_LZO
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Endian Conversion
+ *
+ * Chunk file headers are always little endian.
+ * \{ */
+
+static void chunkfile_entries_endian_switch(ChunkFileEntry *chunks, const uint chunks_len)
+{
+#ifdef __BIG_ENDIAN__
+  for (uint i = 0; i < chunks_len; i++) {
+    BLI_endian_switch_uint64(&chunks[i].offset);
+    BLI_endian_switch_uint32(&chunks[i].size);
+    BLI_endian_switch_uint32(&chunks[i].raw_size);
+  }
+#else
+  UNUSED_VARS(chunks, chunks_len);
+#endif
+}
+
+static void chunkfile_uint_endian_switch(uint *val)
+{
+#ifdef __BIG_ENDIAN__
+  BLI_endian_switch_uint32(val);
+#else
+  UNUSED_VARS(val);
+#endif
+}
+
+static void chunkfile_uint64_endian_switch(uint64_t *val)
+{
+#ifdef __BIG_ENDIAN__
+  BLI_endian_switch_uint64(val);
+#else
+  UNUSED_VARS(val);
+#endif
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Compression
+ * \{ */
+
+/**
+ * \return The compressed size, zero when the data doesn't compress
+ * (it's then stored uncompressed).
+ */
+static uint chunkfile_compress(const eChunkFileCodec codec,
+                               const char *raw,
+                               const uint raw_len,
+                               char *data,
+                               const uint data_len_max,
+                               void *work_mem)
+{
+  switch (codec) {
+    case CHUNKFILE_CODEC_DEFLATE: {
+      uLongf data_len = data_len_max;
+      if (compress2((Bytef *)data, &data_len, (const Bytef *)raw, raw_len, 1) != Z_OK) {
+        return 0;
+      }
+      return (data_len < raw_len) ? (uint)data_len : 0;
+    }
+    case CHUNKFILE_CODEC_LZO: {
+#ifdef WITH_LZO
+      lzo_uint data_len = data_len_max;
+      if (lzo1x_1_compress(
+              (const uchar *)raw, raw_len, (uchar *)data, &data_len, work_mem) != LZO_E_OK) {
+        return 0;
+      }
+      return (data_len < raw_len) ? (uint)data_len : 0;
+#else
+      UNUSED_VARS(work_mem);
+      break;
+#endif
+    }
+  }
+  UNUSED_VARS(work_mem);
+  BLI_assert(0);
+  return 0;
+}
+
+static uint chunkfile_compress_bound(const eChunkFileCodec codec, const uint raw_len)
+{
+  switch (codec) {
+    case CHUNKFILE_CODEC_DEFLATE:
+      return (uint)compressBound(raw_len);
+    case CHUNKFILE_CODEC_LZO:
+      return LZO_OUT_LEN(raw_len);
+  }
+  return raw_len;
+}
+
+static bool chunkfile_decompress(const eChunkFileCodec codec,
+                                 const char *data,
+                                 const uint data_len,
+                                 char *raw,
+                                 const uint raw_len)
+{
+  if (data_len == raw_len) {
+    memcpy(raw, data, raw_len);
+    return true;
+  }
+
+  switch (codec) {
+    case CHUNKFILE_CODEC_DEFLATE: {
+      uLongf len = raw_len;
+      return (uncompress((Bytef *)raw, &len, (const Bytef *)data, data_len) == Z_OK) &&
+             (len == raw_len);
+    }
+    case CHUNKFILE_CODEC_LZO: {
+#ifdef WITH_LZO
+      lzo_uint len = raw_len;
+      return (lzo1x_decompress_safe(
+                  (const uchar *)data, data_len, (uchar *)raw, &len, NULL) == LZO_E_OK) &&
+             (len == raw_len);
+#else
+      break;
+#endif
+    }
+  }
+  return false;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ *
+ * Chunks are filled on the calling thread and compressed in a task pool as soon as they're full,
+ * once a batch of chunks is compressed they're written in order.
+ * \{ */
+
+typedef struct ChunkFileWriteTask {
+  /** Uncompressed data, #CHUNKFILE_CHUNK_SIZE bytes. */
+  char *raw;
+  uint raw_len;
+  /** Compressed data, zero #ChunkFileWriteTask.data_len when stored uncompressed. */
+  char *data;
+  uint data_len;
+  void *work_mem;
+} ChunkFileWriteTask;
+
+struct ChunkFileWriter {
+  int filedes;
+  eChunkFileCodec codec;
+  bool error;
+
+  TaskPool *pool;
+  ChunkFileWriteTask *batch;
+  uint batch_len, batch_len_max;
+
+  ChunkFileEntry *chunks;
+  uint chunks_len, chunks_len_alloc;
+
+  uint64_t file_offset;
+};
+
+static bool chunkfile_write_data(ChunkFileWriter *cw, const void *data, size_t data_len)
+{
+  if (cw->error) {
+    return false;
+  }
+  const char *data_iter = data;
+  while (data_len) {
+    const int len = (int)MIN2(data_len, INT_MAX);
+    if (write(cw->filedes, data_iter, (uint)len) != len) {
+      cw->error = true;
+      return false;
+    }
+    data_iter += len;
+    data_len -= (size_t)len;
+    cw->file_offset += (uint64_t)len;
+  }
+  return true;
+}
+
+static void chunkfile_compress_task(TaskPool *__restrict pool,
+                                    void *taskdata,
+                                    int UNUSED(threadid))
+{
+  ChunkFileWriter *cw = BLI_task_pool_userdata(pool);
+  ChunkFileWriteTask *task = taskdata;
+  task->data_len = chunkfile_compress(cw->codec,
+                                      task->raw,
+                                      task->raw_len,
+                                      task->data,
+                                      chunkfile_compress_bound(cw->codec, CHUNKFILE_CHUNK_SIZE),
+                                      task->work_mem);
+}
+
+/** Wait for the compression of the current batch and write it. */
+static void chunkfile_writer_flush(ChunkFileWriter *cw)
+{
+  BLI_task_pool_work_and_wait(cw->pool);
+
+  for (uint i = 0; i < cw->batch_len; i++) {
+    ChunkFileWriteTask *task = &cw->batch[i];
+    const bool is_compressed = (task->data_len != 0);
+
+    if (cw->chunks_len == cw->chunks_len_alloc) {
+      cw->chunks_len_alloc = MAX2(cw->chunks_len_alloc * 2, 64);
+      cw->chunks = MEM_reallocN(cw->chunks, sizeof(*cw->chunks) * cw->chunks_len_alloc);
+    }
+    ChunkFileEntry *chunk = &cw->chunks[cw->chunks_len++];
+    chunk->offset = cw->file_offset;
+    chunk->size = is_compressed ? task->data_len : task->raw_len;
+    chunk->raw_size = task->raw_len;
+
+    chunkfile_write_data(cw, is_compressed ? task->data : task->raw, chunk->size);
+    task->raw_len = 0;
+  }
+  cw->batch_len = 0;
+}
+
+ChunkFileWriter *blo_chunkfile_writer_open(const char *filepath, const eChunkFileCodec codec)
+{
+  BLI_assert(blo_chunkfile_codec_is_supported(codec));
+
+  const int file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+  if (file == -1) {
+    return NULL;
+  }
+
+  ChunkFileWriter *cw = MEM_callocN(sizeof(*cw), __func__);
+  cw->filedes = file;
+  cw->codec = codec;
+  cw->pool = BLI_task_pool_create(BLI_task_scheduler_get(), cw);
+  cw->batch_len_max = chunkfile_batch_len();
+  cw->batch = MEM_callocN(sizeof(*cw->batch) * cw->batch_len_max, __func__);
+
+  const uint data_len_max = chunkfile_compress_bound(codec, CHUNKFILE_CHUNK_SIZE);
+  for (uint i = 0; i < cw->batch_len_max; i++) {
+    ChunkFileWriteTask *task = &cw->batch[i];
+    task->raw = MEM_mallocN(CHUNKFILE_CHUNK_SIZE, __func__);
+    task->data = MEM_mallocN(data_len_max, __func__);
+#ifdef WITH_LZO
+    if (codec == CHUNKFILE_CODEC_LZO) {
+      task->work_mem = MEM_mallocN(LZO1X_MEM_COMPRESS, __func__);
+    }
+#endif
+  }
+
+  char header[CHUNKFILE_HEADER_LEN] = {0};
+  memcpy(header, CHUNKFILE_MAGIC, CHUNKFILE_MAGIC_LEN);
+  header[8] = CHUNKFILE_VERSION;
+  header[9] = (char)codec;
+  uint chunk_size = CHUNKFILE_CHUNK_SIZE;
+  chunkfile_uint_endian_switch(&chunk_size);
+  memcpy(&header[12], &chunk_size, sizeof(chunk_size));
+  chunkfile_write_data(cw, header, sizeof(header));
+
+  return cw;
+}
+
+bool blo_chunkfile_writer_write(ChunkFileWriter *cw, const void *data, size_t data_len)
+{
+  const char *data_iter = data;
+  while (data_len && !cw->error) {
+    ChunkFileWriteTask *task = &cw->batch[cw->batch_len];
+    const uint len = (uint)MIN2(data_len, (size_t)(CHUNKFILE_CHUNK_SIZE - task->raw_len));
+    memcpy(task->raw + task->raw_len, data_iter, len);
+    task->raw_len += len;
+    data_iter += len;
+    data_len -= len;
+
+    if (task->raw_len == CHUNKFILE_CHUNK_SIZE) {
+      BLI_task_pool_push(cw->pool, chunkfile_compress_task, task, false, TASK_PRIORITY_HIGH);
+      if (++cw->batch_len == cw->batch_len_max) {
+        chunkfile_writer_flush(cw);
+      }
+    }
+  }
+  return !cw->error;
+}
+
+/**
+ * Write any remaining data, the chunk table and close the file.
+ * \return Success.
+ */
+bool blo_chunkfile_writer_close(ChunkFileWriter *cw)
+{
+  ChunkFileWriteTask *task = &cw->batch[cw->batch_len];
+  if (task->raw_len) {
+    BLI_task_pool_push(cw->pool, chunkfile_compress_task, task, false, TASK_PRIORITY_HIGH);
+    cw->batch_len++;
+  }
+  chunkfile_writer_flush(cw);
+
+  /* Chunk table & footer. */
+  uint64_t table_offset = cw->file_offset;
+  uint chunks_len = cw->chunks_len;
+  chunkfile_entries_endian_switch(cw->chunks, chunks_len);
+  chunkfile_write_data(cw, cw->chunks, sizeof(*cw->chunks) * chunks_len);
+
+  char footer[CHUNKFILE_FOOTER_LEN];
+  chunkfile_uint64_endian_switch(&table_offset);
+  chunkfile_uint_endian_switch(&chunks_len);
+  memcpy(&footer[0], &table_offset, sizeof(table_offset));
+  memcpy(&footer[8], &chunks_len, sizeof(chunks_len));
+  memcpy(&footer[12], CHUNKFILE_FOOTER_MAGIC, 4);
+  chunkfile_write_data(cw, footer, sizeof(footer));
+
+  bool ok = !cw->error;
+  if (close(cw->filedes) == -1) {
+    ok = false;
+  }
+
+  BLI_task_pool_free(cw->pool);
+  for (uint i = 0; i < cw->batch_len_max; i++) {
+    MEM_freeN(cw->batch[i].raw);
+    MEM_freeN(cw->batch[i].data);
+    MEM_SAFE_FREE(cw->batch[i].work_mem);
+  }
+  MEM_freeN(cw->batch);
+  MEM_SAFE_FREE(cw->chunks);
+  MEM_freeN(cw);
+
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ *
+ * Decompressed chunks are kept in a window of consecutive chunks.
+ * Reading past the window decompresses the next batch of chunks in parallel,
+ * seeking elsewhere only decompresses the chunk needed.
+ * \{ */
+
+struct ChunkFileReader {
+  int filedes;
+  eChunkFileCodec codec;
+  uint chunk_size;
+
+  ChunkFileEntry *chunks;
+  uint chunks_len;
+  /** Uncompressed size of the file. */
+  uint64_t raw_len;
+
+  /** Decompressed chunks `[window_first, window_first + window_len)`. */
+  char **window;
+  uint window_first, window_len, window_len_max;
+  /** Compressed data of the window. */
+  char *window_data;
+  size_t window_data_len_alloc;
+  bool window_error;
+
+  /** Uncompressed read position. */
+  uint64_t offset;
+};
+
+static void chunkfile_decompress_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ChunkFileReader *cr = userdata;
+  const ChunkFileEntry *chunk = &cr->chunks[cr->window_first + (uint)i];
+  const char *data = cr->window_data + (chunk->offset - cr->chunks[cr->window_first].offset);
+  if (!chunkfile_decompress(cr->codec, data, chunk->size, cr->window[i], chunk->raw_size)) {
+    cr->window_error = true;
+  }
+}
+
+static bool chunkfile_read_data(int filedes, uint64_t offset, void *buffer, size_t len)
+{
+  if (lseek(filedes, (off64_t)offset, SEEK_SET) == -1) {
+    return false;
+  }
+  char *buffer_iter = buffer;
+  while (len) {
+    const int len_step = (int)MIN2(len, INT_MAX);
+    if (read(filedes, buffer_iter, (uint)len_step) != len_step) {
+      return false;
+    }
+    buffer_iter += len_step;
+    len -= (size_t)len_step;
+  }
+  return true;
+}
+
+/** Make \a chunk_first and following chunks available in the window. */
+static bool chunkfile_window_load(ChunkFileReader *cr, const uint chunk_first, const uint len)
+{
+  BLI_assert(chunk_first < cr->chunks_len);
+  const uint window_len = MIN3(len, cr->window_len_max, cr->chunks_len - chunk_first);
+  const ChunkFileEntry *chunk_last = &cr->chunks[chunk_first + window_len - 1];
+  const size_t data_len = (size_t)(chunk_last->offset + chunk_last->size -
+                                   cr->chunks[chunk_first].offset);
+
+  cr->window_first = chunk_first;
+  cr->window_len = 0;
+
+  if (data_len > cr->window_data_len_alloc) {
+    MEM_SAFE_FREE(cr->window_data);
+    cr->window_data = MEM_mallocN(data_len, __func__);
+    cr->window_data_len_alloc = data_len;
+  }
+
+  /* Chunks are stored contiguously, read them all at once. */
+  if (!chunkfile_read_data(
+          cr->filedes, cr->chunks[chunk_first].offset, cr->window_data, data_len)) {
+    return false;
+  }
+
+  cr->window_error = false;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (window_len > 1);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, (int)window_len, cr, chunkfile_decompress_cb, &settings);
+
+  if (cr->window_error) {
+    return false;
+  }
+  cr->window_len = window_len;
+  return true;
+}
+
+/**
+ * Open a chunked file, \a filedes is only read from (the caller must close it).
+ * \return NULL when the file isn't a valid chunked file (or its codec isn't supported).
+ */
+ChunkFileReader *blo_chunkfile_reader_open(int filedes)
+{
+  char header[CHUNKFILE_HEADER_LEN];
+  char footer[CHUNKFILE_FOOTER_LEN];
+
+  if (!chunkfile_read_data(filedes, 0, header, sizeof(header)) ||
+      memcmp(header, CHUNKFILE_MAGIC, CHUNKFILE_MAGIC_LEN) != 0 ||
+      (header[8] != CHUNKFILE_VERSION) ||
+      !blo_chunkfile_codec_is_supported((eChunkFileCodec)header[9])) {
+    return NULL;
+  }
+
+  const off64_t file_len = lseek(filedes, 0, SEEK_END);
+  if ((file_len < CHUNKFILE_HEADER_LEN + CHUNKFILE_FOOTER_LEN) ||
+      !chunkfile_read_data(
+          filedes, (uint64_t)(file_len - CHUNKFILE_FOOTER_LEN), footer, sizeof(footer)) ||
+      memcmp(&footer[12], CHUNKFILE_FOOTER_MAGIC, 4) != 0) {
+    return NULL;
+  }
+
+  uint chunk_size;
+  uint64_t table_offset;
+  uint chunks_len;
+  memcpy(&chunk_size, &header[12], sizeof(chunk_size));
+  memcpy(&table_offset, &footer[0], sizeof(table_offset));
+  memcpy(&chunks_len, &footer[8], sizeof(chunks_len));
+  chunkfile_uint_endian_switch(&chunk_size);
+  chunkfile_uint64_endian_switch(&table_offset);
+  chunkfile_uint_endian_switch(&chunks_len);
+
+  if ((chunks_len == 0) || (chunk_size == 0) || (chunk_size > CHUNKFILE_CHUNK_SIZE_MAX) ||
+      (table_offset + (uint64_t)chunks_len * sizeof(ChunkFileEntry) + CHUNKFILE_FOOTER_LEN !=
+       (uint64_t)file_len)) {
+    return NULL;
+  }
+
+  ChunkFileReader *cr = MEM_callocN(sizeof(*cr), __func__);
+  cr->filedes = filedes;
+  cr->codec = (eChunkFileCodec)header[9];
+  cr->chunk_size = chunk_size;
+  cr->chunks_len = chunks_len;
+  cr->chunks = MEM_mallocN(sizeof(*cr->chunks) * chunks_len, __func__);
+
+  bool ok = chunkfile_read_data(
+      filedes, table_offset, cr->chunks, sizeof(*cr->chunks) * chunks_len);
+  if (ok) {
+    chunkfile_entries_endian_switch(cr->chunks, chunks_len);
+    /* All chunks but the last have the same size, so offsets can be mapped to chunks directly. */
+    for (uint i = 0; i < chunks_len; i++) {
+      const ChunkFileEntry *chunk = &cr->chunks[i];
+      if ((i + 1 < chunks_len) ? (chunk->raw_size != chunk_size) :
+                                 (chunk->raw_size > chunk_size || chunk->raw_size == 0)) {
+        ok = false;
+        break;
+      }
+      if ((chunk->size > chunk->raw_size) || (chunk->offset + chunk->size > table_offset)) {
+        ok = false;
+        break;
+      }
+    }
+  }
+  if (!ok) {
+    blo_chunkfile_reader_close(cr);
+    return NULL;
+  }
+
+  cr->raw_len = (uint64_t)(chunks_len - 1) * chunk_size + cr->chunks[chunks_len - 1].raw_size;
+  cr->window_len_max = chunkfile_batch_len();
+  cr->window = MEM_mallocN(sizeof(*cr->window) * cr->window_len_max, __func__);
+  for (uint i = 0; i < cr->window_len_max; i++) {
+    cr->window[i] = MEM_mallocN(chunk_size, __func__);
+  }
+
+  return cr;
+}
+
+/**
+ * \return The number of bytes read (less than \a size at the end of the file), or -1 on error.
+ */
+int blo_chunkfile_reader_read(ChunkFileReader *cr, void *buffer, uint size)
+{
+  uint read_len = 0;
+
+  while (read_len < size && cr->offset < cr->raw_len) {
+    const uint chunk_index = (uint)(cr->offset / cr->chunk_size);
+    if (chunk_index < cr->window_first || chunk_index >= cr->window_first + cr->window_len) {
+      /* Decompress ahead when reading sequentially. */
+      const bool is_sequential = (cr->window_len != 0) &&
+                                 (chunk_index == cr->window_first + cr->window_len);
+      if (!chunkfile_window_load(cr, chunk_index, is_sequential ? cr->window_len_max : 1)) {
+        return -1;
+      }
+    }
+
+    const ChunkFileEntry *chunk = &cr->chunks[chunk_index];
+    const uint chunk_offset = (uint)(cr->offset % cr->chunk_size);
+    const uint len = MIN2(size - read_len, chunk->raw_size - chunk_offset);
+    memcpy((char *)buffer + read_len,
+           cr->window[chunk_index - cr->window_first] + chunk_offset,
+           len);
+    read_len += len;
+    cr->offset += len;
+  }
+
+  return (int)read_len;
+}
+
+/**
+ * Seek in the uncompressed data.
+ * \return The new offset, or -1 on error.
+ */
+int64_t blo_chunkfile_reader_seek(ChunkFileReader *cr, int64_t offset, int whence)
+{
+  int64_t offset_new;
+  switch (whence) {
+    case SEEK_SET:
+      offset_new = offset;
+      break;
+    case SEEK_CUR:
+      offset_new = (int64_t)cr->offset + offset;
+      break;
+    case SEEK_END:
+      offset_new = (int64_t)cr->raw_len + offset;
+      break;
+    default:
+      return -1;
+  }
+  if (offset_new < 0 || (uint64_t)offset_new > cr->raw_len) {
+    return -1;
+  }
+  cr->offset = (uint64_t)offset_new;
+  return offset_new;
+}
+
+void blo_chunkfile_reader_close(ChunkFileReader *cr)
+{
+  if (cr->window) {
+    for (uint i = 0; i < cr->window_len_max; i++) {
+      MEM_freeN(cr->window[i]);
+    }
+    MEM_freeN(cr->window);
+  }
+  MEM_SAFE_FREE(cr->window_data);
+  MEM_freeN(cr->chunks);
+  MEM_freeN(cr);
+}
+
+/** \} */
@@ -0,0 +1,65 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Chunked compressed .blend files.
+ *
+ * The uncompressed file is split into chunks which are compressed independently,
+ * so they can be compressed and decompressed in parallel, and reading can seek.
+ *
+ * File layout (all values little endian):
+ * - Header (16 bytes):
+ *   - `char magic[8]`: #CHUNKFILE_MAGIC, starts with "BLENDER" so the file is recognized
+ *     as a blend file, older versions report it as unsupported (unknown pointer size).
+ *   - `uchar version, codec; ushort reserved;`
+ *   - `uint chunk_size`: Uncompressed size of all chunks but the last.
+ * - The compressed chunks.
+ * - The chunk table: `uint64 offset; uint size, raw_size;` for each chunk,
+ *   chunks with `size == raw_size` are stored uncompressed.
+ * - Footer (16 bytes): `uint64 table_offset; uint chunks_len; char magic[4];`
+ */
+
+#ifndef __CHUNKFILE_H__
+#define __CHUNKFILE_H__
+
+#include "BLI_sys_types.h"
+
+#define CHUNKFILE_MAGIC "BLENDERZ"
+#define CHUNKFILE_MAGIC_LEN 8
+
+typedef enum eChunkFileCodec {
+  CHUNKFILE_CODEC_DEFLATE = 1,
+  /** Only supported when built with LZO. */
+  CHUNKFILE_CODEC_LZO = 2,
+} eChunkFileCodec;
+
+typedef struct ChunkFileWriter ChunkFileWriter;
+typedef struct ChunkFileReader ChunkFileReader;
+
+bool blo_chunkfile_codec_is_supported(const eChunkFileCodec codec);
+
+ChunkFileWriter *blo_chunkfile_writer_open(const char *filepath, const eChunkFileCodec codec);
+bool blo_chunkfile_writer_write(ChunkFileWriter *cw, const void *data, size_t data_len);
+bool blo_chunkfile_writer_close(ChunkFileWriter *cw);
+
+ChunkFileReader *blo_chunkfile_reader_open(int filedes);
+int blo_chunkfile_reader_read(ChunkFileReader *cr, void *buffer, uint size);
+int64_t blo_chunkfile_reader_seek(ChunkFileReader *cr, int64_t offset, int whence);
+void blo_chunkfile_reader_close(ChunkFileReader *cr);
+
+#endif /* __CHUNKFILE_H__ */
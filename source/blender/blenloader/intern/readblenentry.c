@@ -76,6 +76,26 @@ BlendHandle *BLO_blendhandle_from_file(const char *filepath, ReportList *reports
   return bh;
 }
 
+/**
+ * Open a blendhandle from a file path, for reading some of the data-blocks it contains.
+ *
+ * Only ID blocks are indexed when opening, the data blocks of an ID are indexed once it's read
+ * (when linking or appending it, or reading its preview). Reading IDs isn't deferred.
+ * This is faster for large libraries of which only a few data-blocks are used.
+ *
+ * \param filepath: The file path to open.
+ * \param reports: Report errors in opening the file (can be NULL).
+ * \return A handle on success, or NULL on failure.
+ */
+BlendHandle *BLO_blendhandle_from_file_lazy_index(const char *filepath, ReportList *reports)
+{
+  BlendHandle *bh;
+
+  bh = (BlendHandle *)blo_filedata_from_file_lazy_index(filepath, reports);
+
+  return bh;
+}
+
 /**
  * Open a blendhandle from memory.
  *
@@ -195,6 +215,8 @@ LinkNode *BLO_blendhandle_get_previews(BlendHandle *bh, int ofblocktype, int *to
           BLI_linklist_prepend(&previews, new_prv);
           tot++;
           looking = 1;
+          /* The preview is stored in the data following the ID. */
+          blo_bhead_data_index_ensure(fd, bhead);
           break;
         default:
           break;
@@ -100,7 +100,11 @@
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_ghash.h"
+#include "BLI_task.h"
+
+#include "PIL_time.h"
 
 #include "BLT_translation.h"
 
@@ -156,6 +160,7 @@
 
 #include "RE_engine.h"
 
+#include "chunkfile.h"
 #include "readfile.h"
 
 #include <errno.h>
@@ -222,6 +227,37 @@
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
+/**
+ * Map uncompressed files into memory instead of reading them.
+ *
+ * Reading data on demand (see #USE_BHEAD_READ_ON_DEMAND) is then a copy from the mapping
+ * instead of seeking & reading for every block, blocks which need converting are converted
+ * directly from the mapping. The file contents are only held once in the page cache,
+ * also when the same library is read by multiple processes.
+ */
+#define USE_MMAP_READ
+
+/**
+ * Files opened for linking (#FD_FLAGS_LAZY_INDEX) only index ID blocks up-front,
+ * the data blocks of an ID are indexed when it's read (see #blo_bhead_data_index_ensure).
+ * Libraries often contain many more IDs than are linked from them.
+ *
+ * Only the indexing is deferred, linked IDs are still read & linked when linking.
+ *
+ * Depends on #USE_BHEAD_READ_ON_DEMAND to skip the data.
+ */
+#define USE_BHEAD_LAZY_INDEX
+
+/**
+ * Read & link the direct data of some ID types in parallel.
+ * While reading the file, only the ID and the location of its data are stored,
+ * the data is read & linked once all blocks have been indexed (see #direct_link_deferred_all).
+ *
+ * Only used when reading a block's data can be done from multiple threads,
+ * see #direct_link_deferred_is_supported.
+ */
+#define USE_PARALLEL_DIRECT_LINK
+
 /* use GHash for BHead name-based lookups (speeds up linking) */
 #define USE_GHASH_BHEAD
 
@@ -257,6 +293,11 @@ typedef struct BHeadN {
   off64_t file_offset;
   /** When set, the remainder of this allocation is the data, otherwise it needs to be read. */
   bool has_data;
+#endif
+#ifdef USE_BHEAD_LAZY_INDEX
+  /** Offset of the data blocks following this one which haven't been indexed (zero when none),
+   * see #blo_bhead_data_index_ensure. */
+  off64_t data_skipped_offset;
 #endif
   struct BHead bhead;
 } BHeadN;
@@ -766,128 +807,186 @@ static void bh8_from_bh4(BHead *bhead, BHead4 *bhead4)
   }
 }
 
-static BHeadN *get_bhead(FileData *fd)
+/**
+ * Read the next block header, converted for the current platform.
+ * Returns false at the end of the file.
+ */
+static bool bhead_read_header(FileData *fd, BHead *r_bhead)
 {
-  BHeadN *new_bhead = NULL;
   int readsize;
 
-  if (fd) {
-    if (!fd->is_eof) {
-      /* initializing to zero isn't strictly needed but shuts valgrind up
-       * since uninitialized memory gets compared */
-      BHead8 bhead8 = {0};
-      BHead4 bhead4 = {0};
-      BHead bhead = {0};
-
-      /* First read the bhead structure.
-       * Depending on the platform the file was written on this can
-       * be a big or little endian BHead4 or BHead8 structure.
-       *
-       * As usual 'ENDB' (the last *partial* bhead of the file)
-       * needs some special handling. We don't want to EOF just yet.
-       */
-      if (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) {
-        bhead4.code = DATA;
-        readsize = fd->read(fd, &bhead4, sizeof(bhead4));
+  if (fd->is_eof) {
+    return false;
+  }
 
-        if (readsize == sizeof(bhead4) || bhead4.code == ENDB) {
-          if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
-            switch_endian_bh4(&bhead4);
-          }
+  /* initializing to zero isn't strictly needed but shuts valgrind up
+   * since uninitialized memory gets compared */
+  BHead8 bhead8 = {0};
+  BHead4 bhead4 = {0};
+  BHead bhead = {0};
 
-          if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
-            bh8_from_bh4(&bhead, &bhead4);
-          }
-          else {
-            /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
-            BLI_assert(sizeof(bhead) == sizeof(bhead4));
-            memcpy(&bhead, &bhead4, MIN2(sizeof(bhead), sizeof(bhead4)));
-          }
-        }
-        else {
-          fd->is_eof = true;
-          bhead.len = 0;
-        }
-      }
-      else {
-        bhead8.code = DATA;
-        readsize = fd->read(fd, &bhead8, sizeof(bhead8));
+  /* First read the bhead structure.
+   * Depending on the platform the file was written on this can
+   * be a big or little endian BHead4 or BHead8 structure.
+   *
+   * As usual 'ENDB' (the last *partial* bhead of the file)
+   * needs some special handling. We don't want to EOF just yet.
+   */
+  if (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) {
+    bhead4.code = DATA;
+    readsize = fd->read(fd, &bhead4, sizeof(bhead4));
 
-        if (readsize == sizeof(bhead8) || bhead8.code == ENDB) {
-          if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
-            switch_endian_bh8(&bhead8);
-          }
+    if (readsize == sizeof(bhead4) || bhead4.code == ENDB) {
+      if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+        switch_endian_bh4(&bhead4);
+      }
 
-          if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
-            bh4_from_bh8(&bhead, &bhead8, (fd->flags & FD_FLAGS_SWITCH_ENDIAN));
-          }
-          else {
-            /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
-            BLI_assert(sizeof(bhead) == sizeof(bhead8));
-            memcpy(&bhead, &bhead8, MIN2(sizeof(bhead), sizeof(bhead8)));
-          }
-        }
-        else {
-          fd->is_eof = true;
-          bhead.len = 0;
-        }
+      if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
+        bh8_from_bh4(&bhead, &bhead4);
+      }
+      else {
+        /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
+        BLI_assert(sizeof(bhead) == sizeof(bhead4));
+        memcpy(&bhead, &bhead4, MIN2(sizeof(bhead), sizeof(bhead4)));
       }
+    }
+    else {
+      fd->is_eof = true;
+      bhead.len = 0;
+    }
+  }
+  else {
+    bhead8.code = DATA;
+    readsize = fd->read(fd, &bhead8, sizeof(bhead8));
 
-      /* make sure people are not trying to pass bad blend files */
-      if (bhead.len < 0) {
-        fd->is_eof = true;
+    if (readsize == sizeof(bhead8) || bhead8.code == ENDB) {
+      if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+        switch_endian_bh8(&bhead8);
       }
 
-      /* bhead now contains the (converted) bhead structure. Now read
-       * the associated data and put everything in a BHeadN (creative naming !)
-       */
-      if (fd->is_eof) {
-        /* pass */
+      if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
+        bh4_from_bh8(&bhead, &bhead8, (fd->flags & FD_FLAGS_SWITCH_ENDIAN));
       }
+      else {
+        /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
+        BLI_assert(sizeof(bhead) == sizeof(bhead8));
+        memcpy(&bhead, &bhead8, MIN2(sizeof(bhead), sizeof(bhead8)));
+      }
+    }
+    else {
+      fd->is_eof = true;
+      bhead.len = 0;
+    }
+  }
+
+  /* make sure people are not trying to pass bad blend files */
+  if (bhead.len < 0) {
+    fd->is_eof = true;
+  }
+
+  *r_bhead = bhead;
+  return !fd->is_eof;
+}
+
+/**
+ * Read the data following a block header (\a bhead) and put everything in a BHeadN
+ * (creative naming !), the BHeadN isn't added to #FileData.bhead_list.
+ */
+static BHeadN *bhead_new_from_header(FileData *fd, const BHead *bhead)
+{
+  BHeadN *new_bhead = NULL;
+  int readsize;
+
 #ifdef USE_BHEAD_READ_ON_DEMAND
-      else if (fd->seek != NULL && BHEAD_USE_READ_ON_DEMAND(&bhead)) {
-        /* Delay reading bhead content. */
-        new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
-        if (new_bhead) {
-          new_bhead->next = new_bhead->prev = NULL;
-          new_bhead->file_offset = fd->file_offset;
-          new_bhead->has_data = false;
-          new_bhead->bhead = bhead;
-          off64_t seek_new = fd->seek(fd, bhead.len, SEEK_CUR);
-          if (seek_new == -1) {
-            fd->is_eof = true;
-            MEM_freeN(new_bhead);
-            new_bhead = NULL;
-          }
-          BLI_assert(fd->file_offset == seek_new);
-        }
-        else {
-          fd->is_eof = true;
-        }
+  if (fd->seek != NULL && BHEAD_USE_READ_ON_DEMAND(bhead)) {
+    /* Delay reading bhead content. */
+    new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
+    if (new_bhead) {
+      new_bhead->next = new_bhead->prev = NULL;
+      new_bhead->file_offset = fd->file_offset;
+      new_bhead->has_data = false;
+#  ifdef USE_BHEAD_LAZY_INDEX
+      new_bhead->data_skipped_offset = 0;
+#  endif
+      new_bhead->bhead = *bhead;
+      off64_t seek_new = fd->seek(fd, bhead->len, SEEK_CUR);
+      if (seek_new == -1) {
+        fd->is_eof = true;
+        MEM_freeN(new_bhead);
+        new_bhead = NULL;
       }
+      BLI_assert(fd->file_offset == seek_new);
+    }
+    else {
+      fd->is_eof = true;
+    }
+    return new_bhead;
+  }
 #endif
-      else {
-        new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
-        if (new_bhead) {
-          new_bhead->next = new_bhead->prev = NULL;
+
+  new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead->len, "new_bhead");
+  if (new_bhead) {
+    new_bhead->next = new_bhead->prev = NULL;
 #ifdef USE_BHEAD_READ_ON_DEMAND
-          new_bhead->file_offset = 0; /* don't seek. */
-          new_bhead->has_data = true;
+    new_bhead->file_offset = 0; /* don't seek. */
+    new_bhead->has_data = true;
 #endif
-          new_bhead->bhead = bhead;
+#ifdef USE_BHEAD_LAZY_INDEX
+    new_bhead->data_skipped_offset = 0;
+#endif
+    new_bhead->bhead = *bhead;
 
-          readsize = fd->read(fd, new_bhead + 1, bhead.len);
+    readsize = fd->read(fd, new_bhead + 1, bhead->len);
 
-          if (readsize != bhead.len) {
-            fd->is_eof = true;
-            MEM_freeN(new_bhead);
-            new_bhead = NULL;
-          }
-        }
-        else {
+    if (readsize != bhead->len) {
+      fd->is_eof = true;
+      MEM_freeN(new_bhead);
+      new_bhead = NULL;
+    }
+  }
+  else {
+    fd->is_eof = true;
+  }
+
+  return new_bhead;
+}
+
+static BHeadN *get_bhead(FileData *fd)
+{
+  BHeadN *new_bhead = NULL;
+
+  if (fd) {
+    BHead bhead;
+#ifdef USE_BHEAD_LAZY_INDEX
+    off64_t header_offset = fd->file_offset;
+#endif
+    bool is_valid = bhead_read_header(fd, &bhead);
+
+#ifdef USE_BHEAD_LAZY_INDEX
+    if (fd->flags & FD_FLAGS_LAZY_INDEX) {
+      /* Skip data blocks, they're indexed when the data of the block they follow is needed,
+       * see #blo_bhead_data_index_ensure. */
+      off64_t data_skipped_offset = 0;
+      while (is_valid && bhead.code == DATA) {
+        if (data_skipped_offset == 0) {
+          data_skipped_offset = header_offset;
+        }
+        if (fd->seek(fd, bhead.len, SEEK_CUR) == -1) {
           fd->is_eof = true;
+          is_valid = false;
+          break;
         }
+        header_offset = fd->file_offset;
+        is_valid = bhead_read_header(fd, &bhead);
       }
+      if ((data_skipped_offset != 0) && (fd->bhead_list.last != NULL)) {
+        ((BHeadN *)fd->bhead_list.last)->data_skipped_offset = data_skipped_offset;
+      }
+    }
+#endif
+
+    if (is_valid) {
+      new_bhead = bhead_new_from_header(fd, &bhead);
     }
   }
 
@@ -901,6 +1000,53 @@ static BHeadN *get_bhead(FileData *fd)
   return new_bhead;
 }
 
+#ifdef USE_BHEAD_LAZY_INDEX
+/**
+ * Ensure the data blocks following \a thisblock are indexed,
+ * needed before reading the data of an ID from files read with #FD_FLAGS_LAZY_INDEX.
+ */
+void blo_bhead_data_index_ensure(FileData *fd, BHead *thisblock)
+{
+  if ((fd->flags & FD_FLAGS_LAZY_INDEX) == 0) {
+    return;
+  }
+
+  BHeadN *bheadn = BHEADN_FROM_BHEAD(thisblock);
+  if (bheadn->next == NULL) {
+    /* Reading the next block sets the offset of the data that's skipped. */
+    get_bhead(fd);
+  }
+  if (bheadn->data_skipped_offset == 0) {
+    return;
+  }
+
+  const off64_t offset_backup = fd->file_offset;
+  const bool is_eof_backup = fd->is_eof;
+  fd->is_eof = false;
+
+  if (fd->seek(fd, bheadn->data_skipped_offset, SEEK_SET) != -1) {
+    BHeadN *prev = bheadn;
+    BHead bhead;
+    while (bhead_read_header(fd, &bhead) && (bhead.code == DATA)) {
+      BHeadN *new_bhead = bhead_new_from_header(fd, &bhead);
+      if (new_bhead == NULL) {
+        break;
+      }
+      BLI_insertlinkafter(&fd->bhead_list, prev, new_bhead);
+      prev = new_bhead;
+    }
+  }
+  bheadn->data_skipped_offset = 0;
+
+  fd->seek(fd, offset_backup, SEEK_SET);
+  fd->is_eof = is_eof_backup;
+}
+#else
+void blo_bhead_data_index_ensure(FileData *UNUSED(fd), BHead *UNUSED(thisblock))
+{
+}
+#endif /* USE_BHEAD_LAZY_INDEX */
+
 BHead *blo_bhead_first(FileData *fd)
 {
   BHeadN *new_bhead;
@@ -961,6 +1107,16 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   bool success = true;
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
   BLI_assert(new_bhead->has_data == false && new_bhead->file_offset != 0);
+#  ifdef USE_MMAP_READ
+  if (fd->mmap_file != NULL) {
+    /* Doesn't change the file offset, so this can be used from multiple threads.
+     * Fails for blocks past the end of the file, or when the file can't be read anymore. */
+    return BLI_mmap_read(fd->mmap_file,
+                         buf,
+                         (size_t)new_bhead->file_offset,
+                         (size_t)new_bhead->bhead.len);
+  }
+#  endif
   off64_t offset_backup = fd->file_offset;
   if (UNLIKELY(fd->seek(fd, new_bhead->file_offset, SEEK_SET) == -1)) {
     success = false;
@@ -976,6 +1132,32 @@ static bool blo_bhead_read_data(FileData *fd, BHead *thisblock, void *buf)
   return success;
 }
 
+#  ifdef USE_MMAP_READ
+/**
+ * Access the data of a block that has not been read directly from the mapped file (read-only).
+ * Returns NULL when the file isn't mapped, or the data isn't aligned for access in-place.
+ */
+static const void *blo_bhead_data_mapped(FileData *fd, BHead *thisblock)
+{
+  BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  if ((fd->mmap_file == NULL) || new_bhead->has_data) {
+    return NULL;
+  }
+  /* Blocks past the end of the file are handled (as errors) by reading them. */
+  const size_t mmap_size = BLI_mmap_get_length(fd->mmap_file);
+  if ((size_t)new_bhead->file_offset > mmap_size ||
+      (size_t)new_bhead->bhead.len > mmap_size - (size_t)new_bhead->file_offset) {
+    return NULL;
+  }
+  const char *data = (const char *)BLI_mmap_get_pointer(fd->mmap_file) +
+                     new_bhead->file_offset;
+  if (((uintptr_t)data & (sizeof(void *) - 1)) != 0) {
+    return NULL;
+  }
+  return data;
+}
+#  endif
+
 static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
 {
   BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
@@ -1069,6 +1251,8 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
       if (fd->filesdna) {
         blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
         fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
+        fd->reconstruct_info = DNA_reconstruct_info_create(
+            fd->filesdna, fd->memsdna, fd->compflags, do_endian_swap);
         /* used to retrieve ID names from (bhead+1) */
         fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
 
@@ -1155,6 +1339,52 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+#ifdef USE_MMAP_READ
+/* Memory mapped file reading. */
+
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+  /* Don't read more bytes than there are available in the mapping. */
+  const size_t mmap_size = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t offset = (size_t)filedata->file_offset;
+  const int readsize = (offset < mmap_size) ? (int)MIN2((size_t)size, mmap_size - offset) : 0;
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, offset, (size_t)readsize)) {
+    return -1;
+  }
+  filedata->file_offset += readsize;
+
+  return (readsize);
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  off64_t offset_new;
+  switch (whence) {
+    case SEEK_SET:
+      offset_new = offset;
+      break;
+    case SEEK_CUR:
+      offset_new = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      offset_new = (off64_t)BLI_mmap_get_length(filedata->mmap_file) + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  /* Seeking past the end would be allowed for a file,
+   * don't allow it since this is used to skip over data that's read on demand. */
+  if (offset_new < 0 || offset_new > (off64_t)BLI_mmap_get_length(filedata->mmap_file)) {
+    return -1;
+  }
+
+  filedata->file_offset = offset_new;
+  return filedata->file_offset;
+}
+#endif /* USE_MMAP_READ */
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
@@ -1171,6 +1401,28 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
   return (readsize);
 }
 
+/* Chunked compressed file reading. */
+
+static int fd_read_chunkfile_from_file(FileData *filedata, void *buffer, uint size)
+{
+  int readsize = blo_chunkfile_reader_read(filedata->chunkfile, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return (readsize);
+}
+
+static off64_t fd_seek_chunkfile_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  filedata->file_offset = blo_chunkfile_reader_seek(filedata->chunkfile, offset, whence);
+  return filedata->file_offset;
+}
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
@@ -1238,7 +1490,9 @@ static int fd_read_from_memfile(FileData *filedata, void *buffer, uint size)
         readsize = chunk->size - chunkoffset;
       }
 
-      memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+      memcpy(POINTER_OFFSET(buffer, totread),
+             BLO_memfile_chunk_buf(chunk) + chunkoffset,
+             readsize);
       totread += readsize;
       filedata->file_offset += readsize;
       seek += readsize;
@@ -1297,12 +1551,15 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  ChunkFileReader *chunkfile = NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
-  char header[7];
+  char header[CHUNKFILE_MAGIC_LEN];
 
   /* Regular file. */
   errno = 0;
-  if (read(file, header, sizeof(header)) != sizeof(header)) {
+  const int header_len = read(file, header, sizeof(header));
+  if (header_len < 7) {
     BKE_reportf(reports,
                 RPT_WARNING,
                 "Unable to read '%s': %s",
@@ -1314,10 +1571,33 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     lseek(file, 0, SEEK_SET);
   }
 
+  /* Chunked compressed file, check before the regular file as it shares the "BLENDER" prefix. */
+  if ((header_len == CHUNKFILE_MAGIC_LEN) &&
+      (memcmp(header, CHUNKFILE_MAGIC, CHUNKFILE_MAGIC_LEN) == 0)) {
+    chunkfile = blo_chunkfile_reader_open(file);
+    if (chunkfile == NULL) {
+      BKE_reportf(reports, RPT_WARNING, "Unable to read '%s': corrupt file", filepath);
+      return NULL;
+    }
+    read_fn = fd_read_chunkfile_from_file;
+    seek_fn = fd_seek_chunkfile_from_file;
+  }
+
   /* Regular file. */
-  if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+  if ((read_fn == NULL) && (memcmp(header, "BLENDER", 7) == 0)) {
+#ifdef USE_MMAP_READ
+    /* Failure is not an error, the file is read instead. */
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    if (read_fn == NULL)
+#endif
+    {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
   }
 
   /* Gzip file. */
@@ -1351,6 +1631,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->chunkfile = chunkfile;
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1377,20 +1659,46 @@ static FileData *blo_filedata_from_file_open(const char *filepath, ReportList *r
   return fd;
 }
 
-/* cannot be called with relative paths anymore! */
-/* on each new library added, it now checks for the current FileData and expands relativeness */
-FileData *blo_filedata_from_file(const char *filepath, ReportList *reports)
+static FileData *blo_filedata_from_file_ex(const char *filepath,
+                                           ReportList *reports,
+                                           const bool use_lazy_index)
 {
   FileData *fd = blo_filedata_from_file_open(filepath, reports);
   if (fd != NULL) {
     /* needed for library_append and read_libraries */
     BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
 
+#ifdef USE_BHEAD_LAZY_INDEX
+    /* Skipping data needs it to be read on demand. */
+    if (use_lazy_index && (fd->seek != NULL)) {
+      fd->flags |= FD_FLAGS_LAZY_INDEX;
+    }
+#else
+    UNUSED_VARS(use_lazy_index);
+#endif
+
     return blo_decode_and_check(fd, reports);
   }
   return NULL;
 }
 
+/* cannot be called with relative paths anymore! */
+/* on each new library added, it now checks for the current FileData and expands relativeness */
+FileData *blo_filedata_from_file(const char *filepath, ReportList *reports)
+{
+  return blo_filedata_from_file_ex(filepath, reports, false);
+}
+
+/**
+ * Same as #blo_filedata_from_file, but only ID blocks are indexed when opening the file,
+ * the data blocks of IDs are indexed as they are read (see #USE_BHEAD_LAZY_INDEX).
+ * Use when only some IDs are read, e.g. for linking.
+ */
+FileData *blo_filedata_from_file_lazy_index(const char *filepath, ReportList *reports)
+{
+  return blo_filedata_from_file_ex(filepath, reports, true);
+}
+
 /**
  * Same as blo_filedata_from_file(), but does not reads DNA data, only header.
  * Use it for light access (e.g. thumbnail reading).
@@ -1488,6 +1796,8 @@ FileData *blo_filedata_from_memfile(MemFile *memfile, ReportList *reports)
   else {
     FileData *fd = filedata_new();
     fd->memfile = memfile;
+    /* Decompressed once, instead of locking the store for every chunk that is read. */
+    BLO_memfile_pin(memfile);
 
     fd->read = fd_read_from_memfile;
     fd->flags |= FD_FLAGS_NOT_MY_BUFFER;
@@ -1507,6 +1817,22 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+    if (fd->chunkfile != NULL) {
+      blo_chunkfile_reader_close(fd->chunkfile);
+    }
+
+#ifdef USE_MMAP_READ
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+#endif
+
+    if (fd->memfile != NULL) {
+      BLO_memfile_unpin(fd->memfile);
+    }
+
+    MEM_SAFE_FREE(fd->direct_link_deferred);
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -1531,6 +1857,9 @@ void blo_filedata_free(FileData *fd)
     }
 #endif
 
+    if (fd->reconstruct_info) {
+      DNA_reconstruct_info_free(fd->reconstruct_info);
+    }
     if (fd->filesdna) {
       DNA_sdna_free(fd->filesdna);
     }
@@ -2212,20 +2541,9 @@ void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd)
 /** \name DNA Struct Loading
  * \{ */
 
-static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
+static void switch_endian_structs(const DNA_ReconstructInfo *reconstruct_info, BHead *bhead)
 {
-  int blocksize, nblocks;
-  char *data;
-
-  data = (char *)(bhead + 1);
-  blocksize = filesdna->types_size[filesdna->structs[bhead->SDNAnr][0]];
-
-  nblocks = bhead->nr;
-  while (nblocks--) {
-    DNA_struct_switch_endian(filesdna, bhead->SDNAnr, data);
-
-    data += blocksize;
-  }
+  DNA_struct_switch_endian_blocks(reconstruct_info, bhead->SDNAnr, bhead->nr, bhead + 1);
 }
 
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
@@ -2248,13 +2566,18 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
         }
       }
 #endif
-      switch_endian_structs(fd->filesdna, bh);
+      switch_endian_structs(fd->reconstruct_info, bh);
     }
 
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+        const void *data = NULL;
 #ifdef USE_BHEAD_READ_ON_DEMAND
-        if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+#  ifdef USE_MMAP_READ
+        /* Convert from the mapped file, without reading the data first. */
+        data = blo_bhead_data_mapped(fd, bh);
+#  endif
+        if ((data == NULL) && (BHEADN_FROM_BHEAD(bh)->has_data == false)) {
           bh = blo_bhead_read_full(fd, bh);
           if (UNLIKELY(bh == NULL)) {
             fd->flags &= ~FD_FLAGS_FILE_OK;
@@ -2262,8 +2585,17 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
           }
         }
 #endif
-        temp = DNA_struct_reconstruct(
-            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh + 1));
+        if (data == NULL) {
+          data = (bh + 1);
+        }
+        temp = DNA_struct_reconstruct(fd->reconstruct_info, bh->SDNAnr, bh->nr, data);
+#if defined(USE_BHEAD_READ_ON_DEMAND) && defined(USE_MMAP_READ)
+        /* Converted from the mapping, which reads as zeros once the file can't be read. */
+        if (fd->mmap_file != NULL && UNLIKELY(BLI_mmap_any_io_error(fd->mmap_file))) {
+          fd->flags &= ~FD_FLAGS_FILE_OK;
+          MEM_SAFE_FREE(temp);
+        }
+#endif
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -3296,6 +3628,7 @@ static void direct_link_animdata(FileData *fd, AnimData *adt)
   link_list(fd, &adt->drivers);
   direct_link_fcurves(fd, &adt->drivers);
   adt->driver_array = NULL;
+  adt->path_cache = NULL;
 
   /* link overrides */
   // TODO...
@@ -5039,6 +5372,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
@@ -9288,6 +9622,7 @@ static const char *dataname(short id_code)
 
 static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *allocname)
 {
+  blo_bhead_data_index_ensure(fd, bhead);
   bhead = blo_bhead_next(fd, bhead);
 
   while (bhead && bhead->code == DATA) {
@@ -9313,150 +9648,19 @@ static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *a
   return bhead;
 }
 
-static BHead *read_libblock(FileData *fd,
-                            Main *main,
-                            BHead *bhead,
-                            const int tag,
-                            const bool placeholder_set_indirect_extern,
-                            ID **r_id)
+/**
+ * Read the direct data of an ID (following \a bhead) and link it.
+ * Returns the block after the data.
+ */
+static BHead *read_libblock_data(FileData *fd, Main *main, BHead *bhead, ID *id, const int tag)
 {
-  /* this routine reads a libblock and its direct data. Use link functions to connect it all
-   */
-  ID *id;
-  ListBase *lb;
-  const char *allocname;
   bool wrong_id = false;
 
-  /* In undo case, most libs and linked data should be kept as is from previous state
-   * (see BLO_read_from_memfile).
-   * However, some needed by the snapshot being read may have been removed in previous one,
-   * and would go missing.
-   * This leads e.g. to disappearing objects in some undo/redo case, see T34446.
-   * That means we have to carefully check whether current lib or
-   * libdata already exits in old main, if it does we merely copy it over into new main area,
-   * otherwise we have to do a full read of that bhead... */
-  if (fd->memfile && ELEM(bhead->code, ID_LI, ID_LINK_PLACEHOLDER)) {
-    const char *idname = blo_bhead_id_name(fd, bhead);
+  /* need a name for the mallocN, just for debugging and sane prints on leaks */
+  const char *allocname = dataname(GS(id->name));
 
-    DEBUG_PRINTF("Checking %s...\n", idname);
-
-    if (bhead->code == ID_LI) {
-      Main *libmain = fd->old_mainlist->first;
-      /* Skip oldmain itself... */
-      for (libmain = libmain->next; libmain; libmain = libmain->next) {
-        DEBUG_PRINTF("... against %s: ", libmain->curlib ? libmain->curlib->id.name : "<NULL>");
-        if (libmain->curlib && STREQ(idname, libmain->curlib->id.name)) {
-          Main *oldmain = fd->old_mainlist->first;
-          DEBUG_PRINTF("FOUND!\n");
-          /* In case of a library, we need to re-add its main to fd->mainlist,
-           * because if we have later a missing ID_LINK_PLACEHOLDER,
-           * we need to get the correct lib it is linked to!
-           * Order is crucial, we cannot bulk-add it in BLO_read_from_memfile()
-           * like it used to be. */
-          BLI_remlink(fd->old_mainlist, libmain);
-          BLI_remlink_safe(&oldmain->libraries, libmain->curlib);
-          BLI_addtail(fd->mainlist, libmain);
-          BLI_addtail(&main->libraries, libmain->curlib);
-
-          if (r_id) {
-            *r_id = NULL; /* Just in case... */
-          }
-          return blo_bhead_next(fd, bhead);
-        }
-        DEBUG_PRINTF("nothing...\n");
-      }
-    }
-    else {
-      DEBUG_PRINTF("... in %s (%s): ",
-                   main->curlib ? main->curlib->id.name : "<NULL>",
-                   main->curlib ? main->curlib->name : "<NULL>");
-      if ((id = BKE_libblock_find_name(main, GS(idname), idname + 2))) {
-        DEBUG_PRINTF("FOUND!\n");
-        /* Even though we found our linked ID,
-         * there is no guarantee its address is still the same. */
-        if (id != bhead->old) {
-          oldnewmap_insert(fd->libmap, bhead->old, id, GS(id->name));
-        }
-
-        /* No need to do anything else for ID_LINK_PLACEHOLDER,
-         * it's assumed already present in its lib's main. */
-        if (r_id) {
-          *r_id = NULL; /* Just in case... */
-        }
-        return blo_bhead_next(fd, bhead);
-      }
-      DEBUG_PRINTF("nothing...\n");
-    }
-  }
-
-  /* read libblock */
-  id = read_struct(fd, bhead, "lib block");
-
-  if (id) {
-    const short idcode = GS(id->name);
-    /* do after read_struct, for dna reconstruct */
-    lb = which_libbase(main, idcode);
-    if (lb) {
-      /* for ID_LINK_PLACEHOLDER check */
-      oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
-
-      BLI_addtail(lb, id);
-    }
-    else {
-      /* unknown ID type */
-      printf("%s: unknown id code '%c%c'\n", __func__, (idcode & 0xff), (idcode >> 8));
-      MEM_freeN(id);
-      id = NULL;
-    }
-  }
-
-  if (r_id) {
-    *r_id = id;
-  }
-  if (!id) {
-    return blo_bhead_next(fd, bhead);
-  }
-
-  id->lib = main->curlib;
-  id->us = ID_FAKE_USERS(id);
-  id->icon_id = 0;
-  id->newid = NULL; /* Needed because .blend may have been saved with crap value here... */
-  id->orig_id = NULL;
-
-  /* NOTE: It is important to not clear the recalc flags for undo/redo.
-   * Preserving recalc flags on redo/undo is the only way to make dependency graph detect
-   * that animation is to be evaluated on undo/redo. If this is not enforced by the recalc
-   * flags dependency graph does not do animation update to avoid loss of unkeyed changes.,
-   * which conflicts with undo/redo of changes to animation data itself.
-   *
-   * But for regular file load we clear the flag, since the flags might have been changed since
-   * the version the file has been saved with. */
-  if (!fd->memfile) {
-    id->recalc = 0;
-  }
-
-  /* this case cannot be direct_linked: it's just the ID part */
-  if (bhead->code == ID_LINK_PLACEHOLDER) {
-    /* That way, we know which data-lock needs do_versions (required currently for linking). */
-    id->tag = tag | LIB_TAG_ID_LINK_PLACEHOLDER | LIB_TAG_NEED_LINK | LIB_TAG_NEW;
-
-    if (placeholder_set_indirect_extern) {
-      if (id->flag & LIB_INDIRECT_WEAK_LINK) {
-        id->tag |= LIB_TAG_INDIRECT;
-      }
-      else {
-        id->tag |= LIB_TAG_EXTERN;
-      }
-    }
-
-    return blo_bhead_next(fd, bhead);
-  }
-
-  /* need a name for the mallocN, just for debugging and sane prints on leaks */
-  allocname = dataname(GS(id->name));
-
-  /* read all data into fd->datamap */
-  bhead = read_data_into_oldnewmap(fd, bhead, allocname);
+  /* read all data into fd->datamap */
+  bhead = read_data_into_oldnewmap(fd, bhead, allocname);
 
   /* init pointers direct data */
   direct_link_id(fd, id);
@@ -9586,6 +9790,261 @@ static BHead *read_libblock(FileData *fd,
   return (bhead);
 }
 
+#ifdef USE_PARALLEL_DIRECT_LINK
+
+typedef struct DirectLinkDeferred {
+  Main *main;
+  ID *id;
+  /** The ID block, its data follows. */
+  BHead *bhead;
+  int tag;
+  bool is_ok;
+} DirectLinkDeferred;
+
+static BHead *blo_bhead_skip_data(FileData *fd, BHead *bhead)
+{
+  bhead = blo_bhead_next(fd, bhead);
+  while (bhead && bhead->code == DATA) {
+    bhead = blo_bhead_next(fd, bhead);
+  }
+  return bhead;
+}
+
+/**
+ * Reading data-blocks which haven't been read yet must not change the file offset,
+ * only memory mapped files support this. Otherwise all data must have been read already.
+ */
+static bool direct_link_deferred_is_supported(const FileData *fd)
+{
+  /* Indexing data while it's read isn't thread-safe. */
+  if (fd->flags & FD_FLAGS_LAZY_INDEX) {
+    return false;
+  }
+#  ifdef USE_MMAP_READ
+  if (fd->mmap_file != NULL) {
+    return true;
+  }
+#  endif
+  return (fd->seek == NULL);
+}
+
+/**
+ * ID types which direct data can be linked from any thread:
+ * only using the #FileData they're given, without adding to lookups shared between IDs.
+ * These are also the types which usually contain the most data.
+ */
+static bool direct_link_deferred_is_threadsafe(const short idcode)
+{
+  return ELEM(idcode, ID_ME, ID_KE, ID_AC);
+}
+
+static void direct_link_deferred_add(
+    FileData *fd, Main *main, ID *id, BHead *bhead, const int tag)
+{
+  if (fd->direct_link_deferred_len == fd->direct_link_deferred_alloc) {
+    fd->direct_link_deferred_alloc = max_ii(fd->direct_link_deferred_alloc * 2, 64);
+    fd->direct_link_deferred = MEM_reallocN(
+        fd->direct_link_deferred,
+        sizeof(*fd->direct_link_deferred) * (size_t)fd->direct_link_deferred_alloc);
+  }
+  DirectLinkDeferred *dl = &fd->direct_link_deferred[fd->direct_link_deferred_len++];
+  dl->main = main;
+  dl->id = id;
+  dl->bhead = bhead;
+  dl->tag = tag;
+  dl->is_ok = true;
+}
+
+static void direct_link_deferred_cb(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  FileData *fd = userdata;
+  DirectLinkDeferred *dl = &fd->direct_link_deferred[index];
+
+  /* Each ID gets its own data map, everything else is only read. */
+  FileData fd_task = *fd;
+  fd_task.datamap = oldnewmap_new();
+
+  read_libblock_data(&fd_task, dl->main, dl->bhead, dl->id, dl->tag);
+  dl->is_ok = (fd_task.flags & FD_FLAGS_FILE_OK) != 0;
+
+  oldnewmap_free(fd_task.datamap);
+}
+
+/** Read & link the data of all IDs added by #direct_link_deferred_add. */
+static void direct_link_deferred_all(FileData *fd)
+{
+  const int len = fd->direct_link_deferred_len;
+  if (len == 0) {
+    return;
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, len, fd, direct_link_deferred_cb, &settings);
+
+  for (int i = 0; i < len; i++) {
+    if (!fd->direct_link_deferred[i].is_ok) {
+      fd->flags &= ~FD_FLAGS_FILE_OK;
+    }
+  }
+
+  MEM_SAFE_FREE(fd->direct_link_deferred);
+  fd->direct_link_deferred_len = fd->direct_link_deferred_alloc = 0;
+}
+
+#endif /* USE_PARALLEL_DIRECT_LINK */
+
+static BHead *read_libblock(FileData *fd,
+                            Main *main,
+                            BHead *bhead,
+                            const int tag,
+                            const bool placeholder_set_indirect_extern,
+                            ID **r_id)
+{
+  /* this routine reads a libblock and its direct data. Use link functions to connect it all
+   */
+  ID *id;
+  ListBase *lb;
+
+  /* In undo case, most libs and linked data should be kept as is from previous state
+   * (see BLO_read_from_memfile).
+   * However, some needed by the snapshot being read may have been removed in previous one,
+   * and would go missing.
+   * This leads e.g. to disappearing objects in some undo/redo case, see T34446.
+   * That means we have to carefully check whether current lib or
+   * libdata already exits in old main, if it does we merely copy it over into new main area,
+   * otherwise we have to do a full read of that bhead... */
+  if (fd->memfile && ELEM(bhead->code, ID_LI, ID_LINK_PLACEHOLDER)) {
+    const char *idname = blo_bhead_id_name(fd, bhead);
+
+    DEBUG_PRINTF("Checking %s...\n", idname);
+
+    if (bhead->code == ID_LI) {
+      Main *libmain = fd->old_mainlist->first;
+      /* Skip oldmain itself... */
+      for (libmain = libmain->next; libmain; libmain = libmain->next) {
+        DEBUG_PRINTF("... against %s: ", libmain->curlib ? libmain->curlib->id.name : "<NULL>");
+        if (libmain->curlib && STREQ(idname, libmain->curlib->id.name)) {
+          Main *oldmain = fd->old_mainlist->first;
+          DEBUG_PRINTF("FOUND!\n");
+          /* In case of a library, we need to re-add its main to fd->mainlist,
+           * because if we have later a missing ID_LINK_PLACEHOLDER,
+           * we need to get the correct lib it is linked to!
+           * Order is crucial, we cannot bulk-add it in BLO_read_from_memfile()
+           * like it used to be. */
+          BLI_remlink(fd->old_mainlist, libmain);
+          BLI_remlink_safe(&oldmain->libraries, libmain->curlib);
+          BLI_addtail(fd->mainlist, libmain);
+          BLI_addtail(&main->libraries, libmain->curlib);
+
+          if (r_id) {
+            *r_id = NULL; /* Just in case... */
+          }
+          return blo_bhead_next(fd, bhead);
+        }
+        DEBUG_PRINTF("nothing...\n");
+      }
+    }
+    else {
+      DEBUG_PRINTF("... in %s (%s): ",
+                   main->curlib ? main->curlib->id.name : "<NULL>",
+                   main->curlib ? main->curlib->name : "<NULL>");
+      if ((id = BKE_libblock_find_name(main, GS(idname), idname + 2))) {
+        DEBUG_PRINTF("FOUND!\n");
+        /* Even though we found our linked ID,
+         * there is no guarantee its address is still the same. */
+        if (id != bhead->old) {
+          oldnewmap_insert(fd->libmap, bhead->old, id, GS(id->name));
+        }
+
+        /* No need to do anything else for ID_LINK_PLACEHOLDER,
+         * it's assumed already present in its lib's main. */
+        if (r_id) {
+          *r_id = NULL; /* Just in case... */
+        }
+        return blo_bhead_next(fd, bhead);
+      }
+      DEBUG_PRINTF("nothing...\n");
+    }
+  }
+
+  /* read libblock */
+  id = read_struct(fd, bhead, "lib block");
+
+  if (id) {
+    const short idcode = GS(id->name);
+    /* do after read_struct, for dna reconstruct */
+    lb = which_libbase(main, idcode);
+    if (lb) {
+      /* for ID_LINK_PLACEHOLDER check */
+      oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
+
+      BLI_addtail(lb, id);
+    }
+    else {
+      /* unknown ID type */
+      printf("%s: unknown id code '%c%c'\n", __func__, (idcode & 0xff), (idcode >> 8));
+      MEM_freeN(id);
+      id = NULL;
+    }
+  }
+
+  if (r_id) {
+    *r_id = id;
+  }
+  if (!id) {
+    return blo_bhead_next(fd, bhead);
+  }
+
+  id->lib = main->curlib;
+  id->us = ID_FAKE_USERS(id);
+  id->icon_id = 0;
+  id->newid = NULL; /* Needed because .blend may have been saved with crap value here... */
+  id->orig_id = NULL;
+
+  /* NOTE: It is important to not clear the recalc flags for undo/redo.
+   * Preserving recalc flags on redo/undo is the only way to make dependency graph detect
+   * that animation is to be evaluated on undo/redo. If this is not enforced by the recalc
+   * flags dependency graph does not do animation update to avoid loss of unkeyed changes.,
+   * which conflicts with undo/redo of changes to animation data itself.
+   *
+   * But for regular file load we clear the flag, since the flags might have been changed since
+   * the version the file has been saved with. */
+  if (!fd->memfile) {
+    id->recalc = 0;
+  }
+
+  /* this case cannot be direct_linked: it's just the ID part */
+  if (bhead->code == ID_LINK_PLACEHOLDER) {
+    /* That way, we know which data-lock needs do_versions (required currently for linking). */
+    id->tag = tag | LIB_TAG_ID_LINK_PLACEHOLDER | LIB_TAG_NEED_LINK | LIB_TAG_NEW;
+
+    if (placeholder_set_indirect_extern) {
+      if (id->flag & LIB_INDIRECT_WEAK_LINK) {
+        id->tag |= LIB_TAG_INDIRECT;
+      }
+      else {
+        id->tag |= LIB_TAG_EXTERN;
+      }
+    }
+
+    return blo_bhead_next(fd, bhead);
+  }
+
+#ifdef USE_PARALLEL_DIRECT_LINK
+  if (fd->direct_link_deferred_use && direct_link_deferred_is_threadsafe(GS(id->name))) {
+    /* Only index the data, it's read & linked by #direct_link_deferred_all. */
+    direct_link_deferred_add(fd, main, id, bhead, tag);
+    return blo_bhead_skip_data(fd, bhead);
+  }
+#endif
+
+  return read_libblock_data(fd, main, bhead, id, tag);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -9977,6 +10436,12 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  const double time_start = PIL_check_seconds_timer();
+
+#ifdef USE_PARALLEL_DIRECT_LINK
+  fd->direct_link_deferred_use = direct_link_deferred_is_supported(fd);
+#endif
+
   while (bhead) {
     switch (bhead->code) {
       case DATA:
@@ -10028,6 +10493,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  const double time_read = PIL_check_seconds_timer();
+
+#ifdef USE_PARALLEL_DIRECT_LINK
+  const int direct_link_deferred_len = fd->direct_link_deferred_len;
+  direct_link_deferred_all(fd);
+  fd->direct_link_deferred_use = false;
+#endif
+
+  const double time_direct_link = PIL_check_seconds_timer();
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -10039,13 +10514,20 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  const double time_versioning = PIL_check_seconds_timer();
+  double time_libraries = time_versioning, time_lib_link = time_versioning;
+
   if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
     read_libraries(fd, &mainlist);
 
     blo_join_main(&mainlist);
 
+    time_libraries = PIL_check_seconds_timer();
+
     lib_link_all(fd, bfd->main);
 
+    time_lib_link = PIL_check_seconds_timer();
+
     /* Skip in undo case. */
     if (fd->memfile == NULL) {
       /* Yep, second splitting... but this is a very cheap operation, so no big deal. */
@@ -10081,6 +10563,21 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
 
+  if (G.debug & G_DEBUG_IO) {
+    const double time_end = PIL_check_seconds_timer();
+    printf("%s: '%s' (%s)\n", __func__, filepath, fd->memfile ? "undo" : "file");
+    printf("  read:              %8.3f ms\n", (time_read - time_start) * 1000.0);
+#ifdef USE_PARALLEL_DIRECT_LINK
+    printf("  direct link:       %8.3f ms (%d IDs in parallel)\n",
+           (time_direct_link - time_read) * 1000.0,
+           direct_link_deferred_len);
+#endif
+    printf("  versioning:        %8.3f ms\n", (time_versioning - time_direct_link) * 1000.0);
+    printf("  libraries:         %8.3f ms\n", (time_libraries - time_versioning) * 1000.0);
+    printf("  lib link:          %8.3f ms\n", (time_lib_link - time_libraries) * 1000.0);
+    printf("  after linking:     %8.3f ms\n", (time_end - time_lib_link) * 1000.0);
+  }
+
   return bfd;
 }
 
@@ -12089,7 +12586,7 @@ static FileData *read_library_file_data(FileData *basefd,
                      mainptr->curlib->filepath,
                      mainptr->curlib->name,
                      library_parent_filepath(mainptr->curlib));
-    fd = blo_filedata_from_file(mainptr->curlib->filepath, basefd->reports);
+    fd = blo_filedata_from_file_lazy_index(mainptr->curlib->filepath, basefd->reports);
   }
 
   if (fd) {
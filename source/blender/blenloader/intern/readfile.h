@@ -30,6 +30,8 @@
 #include "DNA_space_types.h"
 #include "DNA_windowmanager_types.h" /* for ReportType */
 
+struct ChunkFileReader;
+struct DirectLinkDeferred;
 struct Key;
 struct MemFile;
 struct Object;
@@ -46,6 +48,8 @@ enum eFileDataFlag {
   FD_FLAGS_NOT_MY_BUFFER = 1 << 4,
   /* XXX Unused in practice (checked once but never set). */
   FD_FLAGS_NOT_MY_LIBMAP = 1 << 5,
+  /** Only ID blocks are indexed up-front, see #blo_bhead_data_index_ensure. */
+  FD_FLAGS_LAZY_INDEX = 1 << 6,
 };
 
 /* Disallow since it's 32bit on ms-windows. */
@@ -81,9 +85,18 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Read-only mapping of an uncompressed file (when supported), see #USE_MMAP_READ. */
+  struct BLI_mmap_file *mmap_file;
+  /** Chunked compressed file reading, see #blo_chunkfile_reader_open. */
+  struct ChunkFileReader *chunkfile;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
+  /** IDs which data is read & linked in parallel, see #USE_PARALLEL_DIRECT_LINK. */
+  struct DirectLinkDeferred *direct_link_deferred;
+  int direct_link_deferred_len, direct_link_deferred_alloc;
+  bool direct_link_deferred_use;
+
   /** Now only in use for library appending. */
   char relabase[FILE_MAX];
 
@@ -92,6 +105,8 @@ typedef struct FileData {
   const struct SDNA *memsdna;
   /** Array of #eSDNA_StructCompare. */
   const char *compflags;
+  /** Plans to convert structs from #filesdna to #memsdna. */
+  struct DNA_ReconstructInfo *reconstruct_info;
 
   int fileversion;
   /** Used to retrieve ID names from (bhead+1). */
@@ -134,6 +149,7 @@ void blo_split_main(ListBase *mainlist, struct Main *main);
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath);
 
 FileData *blo_filedata_from_file(const char *filepath, struct ReportList *reports);
+FileData *blo_filedata_from_file_lazy_index(const char *filepath, struct ReportList *reports);
 FileData *blo_filedata_from_memory(const void *buffer, int buffersize, struct ReportList *reports);
 FileData *blo_filedata_from_memfile(struct MemFile *memfile, struct ReportList *reports);
 
@@ -155,6 +171,7 @@ void blo_filedata_free(FileData *fd);
 BHead *blo_bhead_first(FileData *fd);
 BHead *blo_bhead_next(FileData *fd, BHead *thisblock);
 BHead *blo_bhead_prev(FileData *fd, BHead *thisblock);
+void blo_bhead_data_index_ensure(FileData *fd, BHead *thisblock);
 
 const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead);
 
@@ -36,11 +36,24 @@
 #  include <io.h>
 #endif
 
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,73 +65,516 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Store
+ *
+ * The contents of chunks are stored once, in a store shared by all memfiles,
+ * no matter which undo step or file offset they're written at.
+ * Data is looked up by hash and reference counted by the chunks using it.
+ *
+ * Large writes are split at content defined boundaries (found using a rolling hash,
+ * as #BLI_array_store does), so a change to part of a large array
+ * only stores the data around the change again,
+ * even when it changes the size (and offset of all data after it).
+ *
+ * Data that's only used by older undo steps is compressed in the background,
+ * and decompressed again when those steps are read.
+ * \{ */
+
+#ifdef WITH_LZO
+#  define USE_CHUNK_COMPRESS
+#endif
+
+/** Writes are split into chunks no larger than this. */
+#define CHUNK_SIZE_MAX (1u << 16)
+/** Writes are only split into chunks larger than this. */
+#define CHUNK_SIZE_MIN (1u << 12)
+/** Chunks end where these bits of the rolling hash are zero (every 8kb on average). */
+#define CHUNK_BOUNDARY_MASK 0xfff80000u
+
+#ifdef USE_CHUNK_COMPRESS
+/** Upper bound of the LZO compressed size of \a size bytes. */
+#  define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+#endif
+
+typedef enum eChunkDataState {
+  /** Stored in #MemFileChunkData.buf */
+  CHUNK_DATA_RESIDENT = 0,
+  /** Scheduled for compression, #MemFileChunkData.buf is valid until it's done. */
+  CHUNK_DATA_COMPRESS_PENDING = 1,
+  /** Stored in #MemFileChunkData.buf_compressed */
+  CHUNK_DATA_COMPRESSED = 2,
+} eChunkDataState;
+
+typedef struct MemFileChunkData {
+  /** Uncompressed contents, NULL when compressed. */
+  char *buf;
+  uint size;
+  /** Hash of the uncompressed contents. */
+  uint hash;
+  /** Chunks using this data and compression tasks holding it. */
+  int users;
+  /** The #memfile_store step this data was last written in. */
+  uint step;
+  /** #eChunkDataState, only accessed with #memfile_store_mutex locked. */
+  int state;
+  /** Memfiles being read which use this data, it's kept resident meanwhile. */
+  int pins;
+#ifdef USE_CHUNK_COMPRESS
+  /** Compressing didn't save enough memory, don't try again. */
+  bool is_incompressible;
+  /**
+   * Held by a compression task, which may still be reading #MemFileChunkData.buf after the
+   * compression was canceled. Only cleared by that task, no other task is scheduled meanwhile.
+   */
+  bool is_compress_scheduled;
+  char *buf_compressed;
+  uint size_compressed;
+#endif
+} MemFileChunkData;
+
+static struct {
+  /** #MemFileChunkData looked up by contents. */
+  GSet *chunks;
+  /** Number of #MemFileChunk using the store, it's freed when there are none left. */
+  int users;
+  /** Incremented every time a memfile is written. */
+  uint step;
+
+  /* Statistics. */
+  size_t chunks_len;
+  size_t size_resident;
+  size_t size_compressed;
+
+#ifdef USE_CHUNK_COMPRESS
+  TaskPool *task_pool;
+#endif
+} memfile_store = {NULL};
+
+/** Locks #memfile_store and the #MemFileChunkData it contains. */
+static ThreadMutex memfile_store_mutex = BLI_MUTEX_INITIALIZER;
+
+/** Rolling hash values for every byte value. */
+static uint chunk_gear_table[256];
+
+static uint chunk_data_hash(const void *key)
+{
+  return ((const MemFileChunkData *)key)->hash;
+}
+
+#ifdef USE_CHUNK_COMPRESS
+static void chunk_data_decompress(const MemFileChunkData *cd, char *r_buf)
+{
+  lzo_uint size = cd->size;
+  const int err = lzo1x_decompress_safe(
+      (const uchar *)cd->buf_compressed, cd->size_compressed, (uchar *)r_buf, &size, NULL);
+  BLI_assert((err == LZO_E_OK) && (size == cd->size));
+  UNUSED_VARS_NDEBUG(err);
+}
+#endif
+
+static bool chunk_data_cmp(const void *a, const void *b)
+{
+  const MemFileChunkData *cd_a = a;
+  const MemFileChunkData *cd_b = b;
+  if (cd_a == cd_b) {
+    return false;
+  }
+  if ((cd_a->hash != cd_b->hash) || (cd_a->size != cd_b->size)) {
+    return true;
+  }
+#ifdef USE_CHUNK_COMPRESS
+  if ((cd_a->buf == NULL) || (cd_b->buf == NULL)) {
+    /* Compressed data is still looked up, so identical data is never stored twice.
+     * Only compared when the hashes match, so it is most likely identical. */
+    char *buf_a = cd_a->buf ? cd_a->buf : MEM_mallocN(cd_a->size, __func__);
+    char *buf_b = cd_b->buf ? cd_b->buf : MEM_mallocN(cd_b->size, __func__);
+    if (buf_a != cd_a->buf) {
+      chunk_data_decompress(cd_a, buf_a);
+    }
+    if (buf_b != cd_b->buf) {
+      chunk_data_decompress(cd_b, buf_b);
+    }
+    const bool is_different = (memcmp(buf_a, buf_b, cd_a->size) != 0);
+    if (buf_a != cd_a->buf) {
+      MEM_freeN(buf_a);
+    }
+    if (buf_b != cd_b->buf) {
+      MEM_freeN(buf_b);
+    }
+    return is_different;
+  }
+#endif
+  return (memcmp(cd_a->buf, cd_b->buf, cd_a->size) != 0);
+}
+
+static void memfile_store_ensure(void)
+{
+  if (memfile_store.chunks == NULL) {
+    memfile_store.chunks = BLI_gset_new(chunk_data_hash, chunk_data_cmp, __func__);
+    for (uint i = 0; i < ARRAY_SIZE(chunk_gear_table); i++) {
+      chunk_gear_table[i] = BLI_hash_int(i);
+    }
+  }
+}
+
+/** Free the store when it's unused, called with #memfile_store_mutex locked. */
+static void memfile_store_free_locked(void)
+{
+  if ((memfile_store.users != 0) || (memfile_store.chunks == NULL)) {
+    return;
+  }
+
+#ifdef USE_CHUNK_COMPRESS
+  if (memfile_store.task_pool) {
+    /* Tasks release the data they hold, they need the lock to do so. */
+    TaskPool *task_pool = memfile_store.task_pool;
+    memfile_store.task_pool = NULL;
+    BLI_mutex_unlock(&memfile_store_mutex);
+    BLI_task_pool_work_and_wait(task_pool);
+    BLI_task_pool_free(task_pool);
+    BLI_mutex_lock(&memfile_store_mutex);
+
+    /* Memfiles may have been written meanwhile. */
+    if ((memfile_store.users != 0) || (memfile_store.chunks == NULL)) {
+      return;
+    }
+  }
+#endif
+
+  BLI_assert(memfile_store.chunks_len == 0);
+  BLI_gset_free(memfile_store.chunks, NULL);
+  memfile_store.chunks = NULL;
+}
+
+/**
+ * Find the size of the next chunk of \a buf (content defined, so the same data
+ * is split the same way, no matter where it's located).
+ */
+static uint chunk_size_find(const uchar *buf, const uint size)
+{
+  const uint end = MIN2(size, CHUNK_SIZE_MAX);
+  uint hash = 0;
+  for (uint i = CHUNK_SIZE_MIN; i < end; i++) {
+    hash = (hash << 1) + chunk_gear_table[buf[i]];
+    if ((hash & CHUNK_BOUNDARY_MASK) == 0) {
+      return i + 1;
+    }
+  }
+  return end;
+}
+
+/** Find data with the same contents in the store or add a copy of it. */
+static MemFileChunkData *chunk_data_lookup_or_add(MemFile *memfile, const char *buf, uint size)
+{
+  MemFileChunkData cd_key = {
+      .buf = (char *)buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+  };
+
+  MemFileChunkData *cd = BLI_gset_lookup(memfile_store.chunks, &cd_key);
+  if (cd == NULL) {
+    cd = MEM_callocN(sizeof(*cd), "MemFileChunkData");
+    cd->buf = MEM_mallocN(size, "Chunk buffer");
+    memcpy(cd->buf, buf, size);
+    cd->size = size;
+    cd->hash = cd_key.hash;
+    cd->state = CHUNK_DATA_RESIDENT;
+    BLI_gset_insert(memfile_store.chunks, cd);
+
+    memfile_store.chunks_len += 1;
+    memfile_store.size_resident += size;
+    memfile->size += size;
+  }
+  return cd;
+}
+
+static void chunk_data_release_locked(MemFileChunkData *cd)
+{
+  BLI_assert(cd->users > 0);
+  cd->users -= 1;
+  if (cd->users != 0) {
+    return;
+  }
+
+  BLI_gset_remove(memfile_store.chunks, cd, NULL);
+  if (cd->buf) {
+    memfile_store.size_resident -= cd->size;
+    MEM_freeN(cd->buf);
+  }
+#ifdef USE_CHUNK_COMPRESS
+  if (cd->buf_compressed) {
+    memfile_store.size_compressed -= cd->size_compressed;
+    MEM_freeN(cd->buf_compressed);
+  }
+#endif
+  memfile_store.chunks_len -= 1;
+  MEM_freeN(cd);
+}
+
+static void chunk_data_ensure_resident_locked(MemFileChunkData *cd)
+{
+  if (cd->state == CHUNK_DATA_COMPRESS_PENDING) {
+    /* Cancel, the task checks the state before it replaces the data. */
+    cd->state = CHUNK_DATA_RESIDENT;
+  }
+#ifdef USE_CHUNK_COMPRESS
+  else if (cd->state == CHUNK_DATA_COMPRESSED) {
+    cd->buf = MEM_mallocN(cd->size, "Chunk buffer");
+    chunk_data_decompress(cd, cd->buf);
+
+    memfile_store.size_compressed -= cd->size_compressed;
+    memfile_store.size_resident += cd->size;
+    MEM_freeN(cd->buf_compressed);
+    cd->buf_compressed = NULL;
+    cd->size_compressed = 0;
+    cd->state = CHUNK_DATA_RESIDENT;
+  }
+#endif
+}
+
+#ifdef USE_CHUNK_COMPRESS
+
+typedef struct ChunkCompressTask {
+  MemFileChunkData **chunks;
+  int chunks_len;
+} ChunkCompressTask;
+
+static void chunk_data_compress_task(TaskPool *__restrict UNUSED(pool),
+                                     void *taskdata,
+                                     int UNUSED(threadid))
+{
+  ChunkCompressTask *task = taskdata;
+  void *work_mem = MEM_mallocN(LZO1X_MEM_COMPRESS, __func__);
+  char *buf_compressed = MEM_mallocN(LZO_OUT_LEN(CHUNK_SIZE_MAX), __func__);
+
+  for (int i = 0; i < task->chunks_len; i++) {
+    MemFileChunkData *cd = task->chunks[i];
+
+    BLI_mutex_lock(&memfile_store_mutex);
+    const bool is_pending = (cd->state == CHUNK_DATA_COMPRESS_PENDING);
+    BLI_mutex_unlock(&memfile_store_mutex);
+
+    /* Reading the data without the lock is fine, only this task replaces it
+     * (no other task is scheduled for it until this one is done)
+     * and it's not freed while this task holds it. */
+    lzo_uint size_compressed = 0;
+    if (is_pending && (lzo1x_1_compress((const uchar *)cd->buf,
+                                        cd->size,
+                                        (uchar *)buf_compressed,
+                                        &size_compressed,
+                                        work_mem) != LZO_E_OK)) {
+      size_compressed = 0;
+    }
+
+    BLI_mutex_lock(&memfile_store_mutex);
+    if (cd->state == CHUNK_DATA_COMPRESS_PENDING) {
+      if ((size_compressed != 0) && (size_compressed < cd->size - cd->size / 4)) {
+        cd->buf_compressed = MEM_mallocN(size_compressed, "Chunk buffer compressed");
+        memcpy(cd->buf_compressed, buf_compressed, size_compressed);
+        cd->size_compressed = (uint)size_compressed;
+        MEM_freeN(cd->buf);
+        cd->buf = NULL;
+        cd->state = CHUNK_DATA_COMPRESSED;
+
+        memfile_store.size_resident -= cd->size;
+        memfile_store.size_compressed += cd->size_compressed;
+      }
+      else {
+        cd->is_incompressible = true;
+        cd->state = CHUNK_DATA_RESIDENT;
+      }
+    }
+    cd->is_compress_scheduled = false;
+    chunk_data_release_locked(cd);
+    BLI_mutex_unlock(&memfile_store_mutex);
+  }
+
+  MEM_freeN(buf_compressed);
+  MEM_freeN(work_mem);
+  MEM_freeN(task->chunks);
+}
+
+/** Compress data of \a compare that wasn't written again by the last step. */
+static void memfile_compress_unused(MemFile *compare)
+{
+  ChunkCompressTask *task = MEM_mallocN(sizeof(*task), __func__);
+  task->chunks = MEM_mallocN(sizeof(*task->chunks) * (size_t)BLI_listbase_count(&compare->chunks),
+                             __func__);
+  task->chunks_len = 0;
+
+  BLI_mutex_lock(&memfile_store_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &compare->chunks) {
+    MemFileChunkData *cd = chunk->data;
+    if ((cd->step != memfile_store.step) && (cd->state == CHUNK_DATA_RESIDENT) &&
+        (cd->pins == 0) && (cd->is_incompressible == false) &&
+        (cd->is_compress_scheduled == false)) {
+      cd->state = CHUNK_DATA_COMPRESS_PENDING;
+      cd->is_compress_scheduled = true;
+      cd->users += 1;
+      task->chunks[task->chunks_len++] = cd;
+    }
+  }
+  BLI_mutex_unlock(&memfile_store_mutex);
+
+  if (task->chunks_len == 0) {
+    MEM_freeN(task->chunks);
+    MEM_freeN(task);
+    return;
+  }
+
+  if (memfile_store.task_pool == NULL) {
+    memfile_store.task_pool = BLI_task_pool_create_background(BLI_task_scheduler_get(), NULL);
+  }
+  BLI_task_pool_push(
+      memfile_store.task_pool, chunk_data_compress_task, task, true, TASK_PRIORITY_LOW);
+}
+
+#endif /* USE_CHUNK_COMPRESS */
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
+  BLI_mutex_lock(&memfile_store_mutex);
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    chunk_data_release_locked(chunk->data);
+    memfile_store.users -= 1;
     MEM_freeN(chunk);
   }
   memfile->size = 0;
+
+  /* Checked with the lock held, memfiles may be written meanwhile. */
+  memfile_store_free_locked();
+  BLI_mutex_unlock(&memfile_store_mutex);
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
-void BLO_memfile_merge(MemFile *first, MemFile *second)
+void BLO_memfile_merge(MemFile *first, MemFile *UNUSED(second))
 {
-  MemFileChunk *fc, *sc;
+  /* Data used by both memfiles is reference counted, nothing to transfer. */
+  BLO_memfile_free(first);
+}
 
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
+void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChunk **compchunk_step)
+{
+  BLI_mutex_lock(&memfile_store_mutex);
+  memfile_store_ensure();
+
+  while (size != 0) {
+    MemFileChunkData *cd = NULL;
+    uint chunk_size = 0;
+
+    /* Most data is unchanged, compare with the chunk at the same position first. */
+    if (*compchunk_step != NULL) {
+      MemFileChunk *compchunk = *compchunk_step;
+      if ((compchunk->size <= size) && (compchunk->data->buf != NULL) &&
+          (memcmp(compchunk->data->buf, buf, compchunk->size) == 0)) {
+        cd = compchunk->data;
+        chunk_size = compchunk->size;
       }
+      *compchunk_step = compchunk->next;
     }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
+
+    if (cd == NULL) {
+      chunk_size = (size > CHUNK_SIZE_MIN) ? chunk_size_find((const uchar *)buf, size) : size;
+      cd = chunk_data_lookup_or_add(memfile, buf, chunk_size);
     }
+
+    /* Used again, cancel pending compression. */
+    chunk_data_ensure_resident_locked(cd);
+    cd->users += 1;
+    cd->step = memfile_store.step;
+
+    MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
+    curchunk->data = cd;
+    curchunk->size = chunk_size;
+    BLI_addtail(&memfile->chunks, curchunk);
+    memfile_store.users += 1;
+
+    buf += chunk_size;
+    size -= chunk_size;
   }
 
-  BLO_memfile_free(first);
+  BLI_mutex_unlock(&memfile_store_mutex);
 }
 
-void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChunk **compchunk_step)
+/**
+ * Called after writing a memfile, \a compare is the memfile of the previous step (can be NULL).
+ */
+void memfile_write_end(MemFile *compare)
 {
-  MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
-  curchunk->size = size;
-  curchunk->buf = NULL;
-  curchunk->is_identical = false;
-  BLI_addtail(&memfile->chunks, curchunk);
-
-  /* we compare compchunk with buf */
-  if (*compchunk_step != NULL) {
-    MemFileChunk *compchunk = *compchunk_step;
-    if (compchunk->size == curchunk->size) {
-      if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
-        curchunk->is_identical = true;
-      }
-    }
-    *compchunk_step = compchunk->next;
+#ifdef USE_CHUNK_COMPRESS
+  if (compare != NULL) {
+    memfile_compress_unused(compare);
   }
+#else
+  UNUSED_VARS(compare);
+#endif
+  memfile_store.step += 1;
+}
 
-  /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+/**
+ * Decompress the contents of all chunks of \a memfile and keep them resident,
+ * so they can be accessed without locking until #BLO_memfile_unpin.
+ */
+void BLO_memfile_pin(MemFile *memfile)
+{
+  BLI_mutex_lock(&memfile_store_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    MemFileChunkData *cd = chunk->data;
+    chunk_data_ensure_resident_locked(cd);
+    cd->pins += 1;
   }
+  BLI_mutex_unlock(&memfile_store_mutex);
+}
+
+void BLO_memfile_unpin(MemFile *memfile)
+{
+  BLI_mutex_lock(&memfile_store_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    BLI_assert(chunk->data->pins > 0);
+    chunk->data->pins -= 1;
+  }
+  BLI_mutex_unlock(&memfile_store_mutex);
+}
+
+/**
+ * The contents of \a chunk, its memfile must be pinned (see #BLO_memfile_pin).
+ */
+const char *BLO_memfile_chunk_buf(MemFileChunk *chunk)
+{
+  /* Compression tasks only replace data which isn't pinned, the buffer stays valid. */
+  BLI_assert(chunk->data->pins > 0);
+  return chunk->data->buf;
+}
+
+void BLO_memfile_chunk_store_stats(size_t *r_chunks_len,
+                                   size_t *r_size_resident,
+                                   size_t *r_size_compressed)
+{
+  BLI_mutex_lock(&memfile_store_mutex);
+  *r_chunks_len = memfile_store.chunks_len;
+  *r_size_resident = memfile_store.size_resident;
+  *r_size_compressed = memfile_store.size_compressed;
+  BLI_mutex_unlock(&memfile_store_mutex);
+}
+
+/**
+ * Wait for background compression to finish (for reliable statistics).
+ */
+void BLO_memfile_chunk_store_wait(void)
+{
+#ifdef USE_CHUNK_COMPRESS
+  if (memfile_store.task_pool) {
+    BLI_task_pool_work_and_wait(memfile_store.task_pool);
+  }
+#endif
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -177,11 +633,13 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
     return false;
   }
 
+  BLO_memfile_pin(memfile);
   for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
-    if ((size_t)write(file, chunk->buf, chunk->size) != chunk->size) {
+    if ((size_t)write(file, BLO_memfile_chunk_buf(chunk), chunk->size) != chunk->size) {
       break;
     }
   }
+  BLO_memfile_unpin(memfile);
 
   close(file);
 
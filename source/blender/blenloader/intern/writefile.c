@@ -174,6 +174,7 @@
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
 
+#include "chunkfile.h"
 #include "readfile.h"
 
 /* for SDNA_TYPE_FROM_STRUCT() macro */
@@ -200,6 +201,8 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_CHUNKED_DEFLATE,
+  WW_WRAP_CHUNKED_LZO,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -216,6 +219,7 @@ struct WriteWrap {
   union {
     int file_handle;
     gzFile gz_handle;
+    ChunkFileWriter *chunk_writer;
   } _user_data;
 };
 
@@ -273,6 +277,29 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* chunked (compressed in parallel) */
+#define FILE_HANDLE(ww) (ww)->_user_data.chunk_writer
+
+static bool ww_open_chunked_deflate(WriteWrap *ww, const char *filepath)
+{
+  FILE_HANDLE(ww) = blo_chunkfile_writer_open(filepath, CHUNKFILE_CODEC_DEFLATE);
+  return (FILE_HANDLE(ww) != NULL);
+}
+static bool ww_open_chunked_lzo(WriteWrap *ww, const char *filepath)
+{
+  FILE_HANDLE(ww) = blo_chunkfile_writer_open(filepath, CHUNKFILE_CODEC_LZO);
+  return (FILE_HANDLE(ww) != NULL);
+}
+static bool ww_close_chunked(WriteWrap *ww)
+{
+  return blo_chunkfile_writer_close(FILE_HANDLE(ww));
+}
+static size_t ww_write_chunked(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  return blo_chunkfile_writer_write(FILE_HANDLE(ww), buf, buf_len) ? buf_len : 0;
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -287,6 +314,16 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+    case WW_WRAP_CHUNKED_DEFLATE:
+    case WW_WRAP_CHUNKED_LZO: {
+      r_ww->open = (ww_type == WW_WRAP_CHUNKED_LZO) ? ww_open_chunked_lzo :
+                                                      ww_open_chunked_deflate;
+      r_ww->close = ww_close_chunked;
+      r_ww->write = ww_write_chunked;
+      /* Chunks are already buffered. */
+      r_ww->use_buf = false;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -487,6 +524,10 @@ static bool mywrite_end(WriteData *wd)
     wd->buf_used_len = 0;
   }
 
+  if (wd->use_memfile) {
+    memfile_write_end(wd->mem.compare);
+  }
+
   const bool err = wd->error;
   writedata_free(wd);
 
@@ -4067,7 +4108,14 @@ bool BLO_write_file(Main *mainvar,
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
   if (write_flags & G_FILE_COMPRESS) {
-    ww_type = WW_WRAP_ZLIB;
+    if (write_flags & G_FILE_COMPRESS_FAST) {
+      /* Not readable by older versions, only written when asked for. */
+      ww_type = blo_chunkfile_codec_is_supported(CHUNKFILE_CODEC_LZO) ? WW_WRAP_CHUNKED_LZO :
+                                                                        WW_WRAP_CHUNKED_DEFLATE;
+    }
+    else {
+      ww_type = WW_WRAP_ZLIB;
+    }
   }
   else {
     ww_type = WW_WRAP_NONE;
@@ -28,6 +28,7 @@
 #include "BLI_linklist_stack.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_openhash.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
@@ -2137,7 +2138,7 @@ int BM_mesh_elem_count(BMesh *bm, const char htype)
 void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const uint *face_idx)
 {
   /* Mapping old to new pointers. */
-  GHash *vptr_map = NULL, *eptr_map = NULL, *fptr_map = NULL;
+  PtrHash *vptr_map = NULL, *eptr_map = NULL, *fptr_map = NULL;
   BMIter iter, iterl;
   BMVert *ve;
   BMEdge *ed;
@@ -2161,7 +2162,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
     const int cd_vert_pyptr = CustomData_get_offset(&bm->vdata, CD_BM_ELEM_PYPTR);
 
     /* Init the old-to-new vert pointers mapping */
-    vptr_map = BLI_ghash_ptr_new_ex("BM_mesh_remap vert pointers mapping", bm->totvert);
+    vptr_map = BLI_ptrhash_new_ex("BM_mesh_remap vert pointers mapping", bm->totvert);
 
     /* Make a copy of all vertices. */
     verts_pool = bm->vtable;
@@ -2188,7 +2189,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
       printf(
           "mapping vert from %d to %d (%p/%p to %p)\n", i, *new_idx, *vep, verts_pool[i], new_vep);
 #endif
-      BLI_ghash_insert(vptr_map, *vep, new_vep);
+      BLI_ptrhash_insert(vptr_map, *vep, new_vep);
       if (cd_vert_pyptr != -1) {
         void **pyptr = BM_ELEM_CD_GET_VOID_P(((BMElem *)new_vep), cd_vert_pyptr);
         *pyptr = pyptrs[*new_idx];
@@ -2213,7 +2214,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
     const int cd_edge_pyptr = CustomData_get_offset(&bm->edata, CD_BM_ELEM_PYPTR);
 
     /* Init the old-to-new vert pointers mapping */
-    eptr_map = BLI_ghash_ptr_new_ex("BM_mesh_remap edge pointers mapping", bm->totedge);
+    eptr_map = BLI_ptrhash_new_ex("BM_mesh_remap edge pointers mapping", bm->totedge);
 
     /* Make a copy of all vertices. */
     edges_pool = bm->etable;
@@ -2235,7 +2236,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
     for (i = totedge; i--; new_idx--, ed--, edp--) {
       BMEdge *new_edp = edges_pool[*new_idx];
       *new_edp = *ed;
-      BLI_ghash_insert(eptr_map, *edp, new_edp);
+      BLI_ptrhash_insert(eptr_map, *edp, new_edp);
 #if 0
       printf(
           "mapping edge from %d to %d (%p/%p to %p)\n", i, *new_idx, *edp, edges_pool[i], new_edp);
@@ -2264,7 +2265,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
     const int cd_poly_pyptr = CustomData_get_offset(&bm->pdata, CD_BM_ELEM_PYPTR);
 
     /* Init the old-to-new vert pointers mapping */
-    fptr_map = BLI_ghash_ptr_new_ex("BM_mesh_remap face pointers mapping", bm->totface);
+    fptr_map = BLI_ptrhash_new_ex("BM_mesh_remap face pointers mapping", bm->totface);
 
     /* Make a copy of all vertices. */
     faces_pool = bm->ftable;
@@ -2286,7 +2287,7 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
     for (i = totface; i--; new_idx--, fa--, fap--) {
       BMFace *new_fap = faces_pool[*new_idx];
       *new_fap = *fa;
-      BLI_ghash_insert(fptr_map, *fap, new_fap);
+      BLI_ptrhash_insert(fptr_map, *fap, new_fap);
       if (cd_poly_pyptr != -1) {
         void **pyptr = BM_ELEM_CD_GET_VOID_P(((BMElem *)new_fap), cd_poly_pyptr);
         *pyptr = pyptrs[*new_idx];
@@ -2306,9 +2307,9 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
   /* Verts' pointers, only edge pointers... */
   if (eptr_map) {
     BM_ITER_MESH (ve, &iter, bm, BM_VERTS_OF_MESH) {
-      /*          printf("Vert e: %p -> %p\n", ve->e, BLI_ghash_lookup(eptr_map, ve->e));*/
+      /*          printf("Vert e: %p -> %p\n", ve->e, BLI_ptrhash_lookup(eptr_map, ve->e));*/
       if (ve->e) {
-        ve->e = BLI_ghash_lookup(eptr_map, ve->e);
+        ve->e = BLI_ptrhash_lookup(eptr_map, ve->e);
         BLI_assert(ve->e);
       }
     }
@@ -2320,26 +2321,26 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
   if (vptr_map || eptr_map) {
     BM_ITER_MESH (ed, &iter, bm, BM_EDGES_OF_MESH) {
       if (vptr_map) {
-        /* printf("Edge v1: %p -> %p\n", ed->v1, BLI_ghash_lookup(vptr_map, ed->v1));*/
-        /* printf("Edge v2: %p -> %p\n", ed->v2, BLI_ghash_lookup(vptr_map, ed->v2));*/
-        ed->v1 = BLI_ghash_lookup(vptr_map, ed->v1);
-        ed->v2 = BLI_ghash_lookup(vptr_map, ed->v2);
+        /* printf("Edge v1: %p -> %p\n", ed->v1, BLI_ptrhash_lookup(vptr_map, ed->v1));*/
+        /* printf("Edge v2: %p -> %p\n", ed->v2, BLI_ptrhash_lookup(vptr_map, ed->v2));*/
+        ed->v1 = BLI_ptrhash_lookup(vptr_map, ed->v1);
+        ed->v2 = BLI_ptrhash_lookup(vptr_map, ed->v2);
         BLI_assert(ed->v1);
         BLI_assert(ed->v2);
       }
       if (eptr_map) {
         /* printf("Edge v1_disk_link prev: %p -> %p\n", ed->v1_disk_link.prev,*/
-        /*        BLI_ghash_lookup(eptr_map, ed->v1_disk_link.prev));*/
+        /*        BLI_ptrhash_lookup(eptr_map, ed->v1_disk_link.prev));*/
         /* printf("Edge v1_disk_link next: %p -> %p\n", ed->v1_disk_link.next,*/
-        /*        BLI_ghash_lookup(eptr_map, ed->v1_disk_link.next));*/
+        /*        BLI_ptrhash_lookup(eptr_map, ed->v1_disk_link.next));*/
         /* printf("Edge v2_disk_link prev: %p -> %p\n", ed->v2_disk_link.prev,*/
-        /*        BLI_ghash_lookup(eptr_map, ed->v2_disk_link.prev));*/
+        /*        BLI_ptrhash_lookup(eptr_map, ed->v2_disk_link.prev));*/
         /* printf("Edge v2_disk_link next: %p -> %p\n", ed->v2_disk_link.next,*/
-        /*        BLI_ghash_lookup(eptr_map, ed->v2_disk_link.next));*/
-        ed->v1_disk_link.prev = BLI_ghash_lookup(eptr_map, ed->v1_disk_link.prev);
-        ed->v1_disk_link.next = BLI_ghash_lookup(eptr_map, ed->v1_disk_link.next);
-        ed->v2_disk_link.prev = BLI_ghash_lookup(eptr_map, ed->v2_disk_link.prev);
-        ed->v2_disk_link.next = BLI_ghash_lookup(eptr_map, ed->v2_disk_link.next);
+        /*        BLI_ptrhash_lookup(eptr_map, ed->v2_disk_link.next));*/
+        ed->v1_disk_link.prev = BLI_ptrhash_lookup(eptr_map, ed->v1_disk_link.prev);
+        ed->v1_disk_link.next = BLI_ptrhash_lookup(eptr_map, ed->v1_disk_link.next);
+        ed->v2_disk_link.prev = BLI_ptrhash_lookup(eptr_map, ed->v2_disk_link.prev);
+        ed->v2_disk_link.next = BLI_ptrhash_lookup(eptr_map, ed->v2_disk_link.next);
         BLI_assert(ed->v1_disk_link.prev);
         BLI_assert(ed->v1_disk_link.next);
         BLI_assert(ed->v2_disk_link.prev);
@@ -2352,18 +2353,18 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
   BM_ITER_MESH (fa, &iter, bm, BM_FACES_OF_MESH) {
     BM_ITER_ELEM (lo, &iterl, fa, BM_LOOPS_OF_FACE) {
       if (vptr_map) {
-        /*              printf("Loop v: %p -> %p\n", lo->v, BLI_ghash_lookup(vptr_map, lo->v));*/
-        lo->v = BLI_ghash_lookup(vptr_map, lo->v);
+        /*              printf("Loop v: %p -> %p\n", lo->v, BLI_ptrhash_lookup(vptr_map, lo->v));*/
+        lo->v = BLI_ptrhash_lookup(vptr_map, lo->v);
         BLI_assert(lo->v);
       }
       if (eptr_map) {
-        /*              printf("Loop e: %p -> %p\n", lo->e, BLI_ghash_lookup(eptr_map, lo->e));*/
-        lo->e = BLI_ghash_lookup(eptr_map, lo->e);
+        /*              printf("Loop e: %p -> %p\n", lo->e, BLI_ptrhash_lookup(eptr_map, lo->e));*/
+        lo->e = BLI_ptrhash_lookup(eptr_map, lo->e);
         BLI_assert(lo->e);
       }
       if (fptr_map) {
-        /*              printf("Loop f: %p -> %p\n", lo->f, BLI_ghash_lookup(fptr_map, lo->f));*/
-        lo->f = BLI_ghash_lookup(fptr_map, lo->f);
+        /*              printf("Loop f: %p -> %p\n", lo->f, BLI_ptrhash_lookup(fptr_map, lo->f));*/
+        lo->f = BLI_ptrhash_lookup(fptr_map, lo->f);
         BLI_assert(lo->f);
       }
     }
@@ -2376,19 +2377,19 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
       switch (ese->htype) {
         case BM_VERT:
           if (vptr_map) {
-            ese->ele = BLI_ghash_lookup(vptr_map, ese->ele);
+            ese->ele = BLI_ptrhash_lookup(vptr_map, ese->ele);
             BLI_assert(ese->ele);
           }
           break;
         case BM_EDGE:
           if (eptr_map) {
-            ese->ele = BLI_ghash_lookup(eptr_map, ese->ele);
+            ese->ele = BLI_ptrhash_lookup(eptr_map, ese->ele);
             BLI_assert(ese->ele);
           }
           break;
         case BM_FACE:
           if (fptr_map) {
-            ese->ele = BLI_ghash_lookup(fptr_map, ese->ele);
+            ese->ele = BLI_ptrhash_lookup(fptr_map, ese->ele);
             BLI_assert(ese->ele);
           }
           break;
@@ -2398,19 +2399,19 @@ void BM_mesh_remap(BMesh *bm, const uint *vert_idx, const uint *edge_idx, const
 
   if (fptr_map) {
     if (bm->act_face) {
-      bm->act_face = BLI_ghash_lookup(fptr_map, bm->act_face);
+      bm->act_face = BLI_ptrhash_lookup(fptr_map, bm->act_face);
       BLI_assert(bm->act_face);
     }
   }
 
   if (vptr_map) {
-    BLI_ghash_free(vptr_map, NULL, NULL);
+    BLI_ptrhash_free(vptr_map);
   }
   if (eptr_map) {
-    BLI_ghash_free(eptr_map, NULL, NULL);
+    BLI_ptrhash_free(eptr_map);
   }
   if (fptr_map) {
-    BLI_ghash_free(fptr_map, NULL, NULL);
+    BLI_ptrhash_free(fptr_map);
   }
 }
 
@@ -24,6 +24,7 @@
 
 #include "BLI_math.h"
 #include "BLI_alloca.h"
+#include "BLI_openhash.h"
 
 #include "bmesh.h"
 
@@ -45,7 +46,7 @@ static BMVert *bmo_vert_copy(BMOperator *op,
                              BMesh *bm_dst,
                              BMesh *bm_src,
                              BMVert *v_src,
-                             GHash *vhash)
+                             PtrHash *vhash)
 {
   BMVert *v_dst;
 
@@ -55,7 +56,7 @@ static BMVert *bmo_vert_copy(BMOperator *op,
   BMO_slot_map_elem_insert(op, slot_vertmap_out, v_dst, v_src);
 
   /* Insert new vertex into the vert hash */
-  BLI_ghash_insert(vhash, v_src, v_dst);
+  BLI_ptrhash_insert(vhash, v_src, v_dst);
 
   /* Copy attributes */
   BM_elem_attrs_copy(bm_src, bm_dst, v_src, v_dst);
@@ -77,8 +78,8 @@ static BMEdge *bmo_edge_copy(BMOperator *op,
                              BMesh *bm_dst,
                              BMesh *bm_src,
                              BMEdge *e_src,
-                             GHash *vhash,
-                             GHash *ehash,
+                             PtrHash *vhash,
+                             PtrHash *ehash,
                              const bool use_edge_flip_from_face)
 {
   BMEdge *e_dst;
@@ -101,8 +102,8 @@ static BMEdge *bmo_edge_copy(BMOperator *op,
   }
 
   /* Lookup v1 and v2 */
-  e_dst_v1 = BLI_ghash_lookup(vhash, e_src->v1);
-  e_dst_v2 = BLI_ghash_lookup(vhash, e_src->v2);
+  e_dst_v1 = BLI_ptrhash_lookup(vhash, e_src->v1);
+  e_dst_v2 = BLI_ptrhash_lookup(vhash, e_src->v2);
 
   /* Create a new edge */
   e_dst = BM_edge_create(bm_dst, e_dst_v1, e_dst_v2, NULL, BM_CREATE_SKIP_CD);
@@ -117,7 +118,7 @@ static BMEdge *bmo_edge_copy(BMOperator *op,
   }
 
   /* Insert new edge into the edge hash */
-  BLI_ghash_insert(ehash, e_src, e_dst);
+  BLI_ptrhash_insert(ehash, e_src, e_dst);
 
   /* Copy attributes */
   BM_elem_attrs_copy(bm_src, bm_dst, e_src, e_dst);
@@ -146,8 +147,8 @@ static BMFace *bmo_face_copy(BMOperator *op,
                              BMesh *bm_dst,
                              BMesh *bm_src,
                              BMFace *f_src,
-                             GHash *vhash,
-                             GHash *ehash)
+                             PtrHash *vhash,
+                             PtrHash *ehash)
 {
   BMFace *f_dst;
   BMVert **vtar = BLI_array_alloca(vtar, f_src->len);
@@ -161,8 +162,8 @@ static BMFace *bmo_face_copy(BMOperator *op,
   l_iter_src = l_first_src;
   i = 0;
   do {
-    vtar[i] = BLI_ghash_lookup(vhash, l_iter_src->v);
-    edar[i] = BLI_ghash_lookup(ehash, l_iter_src->e);
+    vtar[i] = BLI_ptrhash_lookup(vhash, l_iter_src->v);
+    edar[i] = BLI_ptrhash_lookup(ehash, l_iter_src->e);
     i++;
   } while ((l_iter_src = l_iter_src->next) != l_first_src);
 
@@ -202,7 +203,7 @@ static void bmo_mesh_copy(BMOperator *op, BMesh *bm_dst, BMesh *bm_src)
   BMFace *f = NULL;
 
   BMIter viter, eiter, fiter;
-  GHash *vhash, *ehash;
+  PtrHash *vhash, *ehash;
 
   BMOpSlot *slot_boundary_map_out = BMO_slot_get(op->slots_out, "boundary_map.out");
   BMOpSlot *slot_isovert_map_out = BMO_slot_get(op->slots_out, "isovert_map.out");
@@ -212,8 +213,8 @@ static void bmo_mesh_copy(BMOperator *op, BMesh *bm_dst, BMesh *bm_src)
   BMOpSlot *slot_face_map_out = BMO_slot_get(op->slots_out, "face_map.out");
 
   /* initialize pointer hashes */
-  vhash = BLI_ghash_ptr_new("bmesh dupeops v");
-  ehash = BLI_ghash_ptr_new("bmesh dupeops e");
+  vhash = BLI_ptrhash_new("bmesh dupeops v");
+  ehash = BLI_ptrhash_new("bmesh dupeops e");
 
   /* duplicate flagged vertices */
   BM_ITER_MESH (v, &viter, bm_src, BM_VERTS_OF_MESH) {
@@ -308,8 +309,8 @@ static void bmo_mesh_copy(BMOperator *op, BMesh *bm_dst, BMesh *bm_src)
   }
 
   /* free pointer hashes */
-  BLI_ghash_free(vhash, NULL, NULL);
-  BLI_ghash_free(ehash, NULL, NULL);
+  BLI_ptrhash_free(vhash);
+  BLI_ptrhash_free(ehash);
 
   if (use_select_history) {
     BLI_assert(bm_src == bm_dst);
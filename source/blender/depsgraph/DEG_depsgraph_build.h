@@ -93,6 +93,14 @@ void DEG_graph_relations_update(struct Depsgraph *graph,
 /* Tag all relations in the database for update.*/
 void DEG_relations_tag_update(struct Main *bmain);
 
+/* Tag relations of the given ID for update. Unlike tagging the whole graph this allows to only
+ * rebuild nodes and relations of this ID and of IDs linked to it, falling back to a full rebuild
+ * when the change can not be handled incrementally.
+ *
+ * NOTE: Only objects are currently supported, removal of IDs requires a full rebuild. */
+void DEG_graph_id_tag_relations_update(struct Depsgraph *graph, struct ID *id);
+void DEG_id_tag_relations_update(struct Main *bmain, struct ID *id);
+
 /* Add Dependencies  ----------------------------- */
 
 /* Handle for components to define their dependencies from callbacks.
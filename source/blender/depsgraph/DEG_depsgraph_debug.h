@@ -65,10 +65,12 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
 
 /* ************************************************ */
 
-/* Compare two dependency graphs. */
+/* Compare IDs, operations and relations of two dependency graphs, printing the differences. */
 bool DEG_debug_compare(const struct Depsgraph *graph1, const struct Depsgraph *graph2);
 
-/* Check that dependencies in the graph are really up to date. */
+/* Check that dependencies in the graph are really up to date, by comparing them with a graph which
+ * is built from scratch. Used to validate incremental relations update, IDs which are only in the
+ * given graph (no longer referenced, kept until the next full rebuild) are ignored. */
 bool DEG_debug_graph_relations_validate(struct Depsgraph *graph,
                                         struct Main *bmain,
                                         struct Scene *scene,
@@ -27,15 +27,21 @@
 
 #include "DNA_anim_types.h"
 #include "DNA_armature_types.h"
+#include "DNA_constraint_types.h"
 #include "DNA_layer_types.h"
 #include "DNA_ID.h"
 #include "DNA_object_types.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_listbase.h"
 #include "BLI_stack.h"
+#include "BLI_string.h"
 
 #include "BKE_action.h"
+#include "BKE_armature.h"
 
 extern "C" {
 #include "BKE_animsys.h"
@@ -139,6 +145,133 @@ bool DepsgraphBuilder::check_pchan_has_bbone_segments(Object *object, const char
   return check_pchan_has_bbone_segments(object, pchan);
 }
 
+/* Add names of the bones written by drivers, they are evaluated after the driver. */
+static void pose_driven_bones_add(ID *id, set<string> *r_bone_names)
+{
+  AnimData *adt = BKE_animdata_from_id(id);
+  if (adt == NULL) {
+    return;
+  }
+  LISTBASE_FOREACH (FCurve *, fcu, &adt->drivers) {
+    if (fcu->rna_path == NULL) {
+      continue;
+    }
+    /* Matches both "pose.bones[" of the object and "bones[" of the armature. */
+    char *bone_name = BLI_str_quoted_substrN(fcu->rna_path, "bones[");
+    if (bone_name != NULL) {
+      r_bone_names->insert(bone_name);
+      MEM_freeN(bone_name);
+    }
+  }
+}
+
+/* Find the bones which can be evaluated in batches.
+ *
+ * A bone is cheap to evaluate when it has no constraints, is not part of an IK or Spline IK chain
+ * and is not written by drivers. Such bones only depend on the pose initialization and on their
+ * parent, so a cheap bone whose parent is not cheap and all the cheap bones under it are
+ * evaluated by one operation, level after level.
+ *
+ * Per bone operations are kept as no-ops, so relations to and from them still work. */
+static void find_pose_bone_batches(Object *object, PoseBoneBatches *r_bone_batches)
+{
+  BLI_assert(object->type == OB_ARMATURE);
+  r_bone_batches->batches.clear();
+  r_bone_batches->pchan_batch.clear();
+
+  vector<bPoseChannel *> pchans;
+  map<bPoseChannel *, int> pchan_indices;
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &object->pose->chanbase) {
+    pchan_indices[pchan] = pchans.size();
+    pchans.push_back(pchan);
+  }
+  const int pchans_len = pchans.size();
+  r_bone_batches->pchan_batch.resize(pchans_len, -1);
+
+  set<string> driven_bone_names;
+  pose_driven_bones_add(&object->id, &driven_bone_names);
+  pose_driven_bones_add((ID *)object->data, &driven_bone_names);
+
+  vector<bool> is_cheap(pchans_len, true);
+  for (int i = 0; i < pchans_len; i++) {
+    bPoseChannel *pchan = pchans[i];
+    if (pchan->bone == NULL || driven_bone_names.count(pchan->name) != 0) {
+      is_cheap[i] = false;
+    }
+    LISTBASE_FOREACH (bConstraint *, con, &pchan->constraints) {
+      is_cheap[i] = false;
+      /* Bones of the chain are solved together. */
+      bPoseChannel *rootchan = NULL;
+      if (con->type == CONSTRAINT_TYPE_KINEMATIC) {
+        rootchan = BKE_armature_ik_solver_find_root(pchan, (bKinematicConstraint *)con->data);
+      }
+      else if (con->type == CONSTRAINT_TYPE_SPLINEIK) {
+        rootchan = BKE_armature_splineik_solver_find_root(pchan,
+                                                          (bSplineIKConstraint *)con->data);
+      }
+      if (rootchan != NULL) {
+        for (bPoseChannel *chainchan = pchan; chainchan != NULL; chainchan = chainchan->parent) {
+          is_cheap[pchan_indices[chainchan]] = false;
+          if (chainchan == rootchan) {
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  vector<vector<int>> children(pchans_len);
+  for (int i = 0; i < pchans_len; i++) {
+    if (pchans[i]->parent != NULL) {
+      children[pchan_indices[pchans[i]->parent]].push_back(i);
+    }
+  }
+
+  for (int i = 0; i < pchans_len; i++) {
+    bPoseChannel *parchan = pchans[i]->parent;
+    if (!is_cheap[i] || (parchan != NULL && is_cheap[pchan_indices[parchan]])) {
+      continue;
+    }
+    /* Gather the cheap bones under the root breadth first, which orders them by level. */
+    PoseBoneBatch batch;
+    batch.rootchan = pchans[i];
+    batch.pchan_indices.push_back(i);
+    int level_start = 0;
+    while (level_start < (int)batch.pchan_indices.size()) {
+      const int level_end = batch.pchan_indices.size();
+      batch.level_offsets.push_back(level_start);
+      for (int j = level_start; j < level_end; j++) {
+        for (int child_index : children[batch.pchan_indices[j]]) {
+          if (is_cheap[child_index]) {
+            batch.pchan_indices.push_back(child_index);
+          }
+        }
+      }
+      level_start = level_end;
+    }
+    batch.level_offsets.push_back(batch.pchan_indices.size());
+    /* Nothing to gain from a batch of a single bone. */
+    if (batch.pchan_indices.size() < 2) {
+      continue;
+    }
+    for (int pchan_index : batch.pchan_indices) {
+      r_bone_batches->pchan_batch[pchan_index] = r_bone_batches->batches.size();
+    }
+    r_bone_batches->batches.push_back(batch);
+  }
+}
+
+const PoseBoneBatches &DepsgraphBuilder::ensure_pose_bone_batches(Object *object)
+{
+  map<Object *, PoseBoneBatches>::iterator it = cache_->pose_bone_batches_.find(object);
+  if (it != cache_->pose_bone_batches_.end()) {
+    return it->second;
+  }
+  PoseBoneBatches &bone_batches = cache_->pose_bone_batches_[object];
+  find_pose_bone_batches(object, &bone_batches);
+  return bone_batches;
+}
+
 /*******************************************************************************
  * Builder finalizer.
  */
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "intern/depsgraph_type.h"
+
 struct Base;
 struct Main;
 struct Object;
@@ -33,6 +35,22 @@ namespace DEG {
 struct Depsgraph;
 class DepsgraphBuilderCache;
 
+/* Bones of a rig evaluated by a single operation, instead of operations per bone. */
+struct PoseBoneBatch {
+  /* Bone holding the operation of the batch. */
+  bPoseChannel *rootchan;
+  /* Indices of the pose channels, level after level of the hierarchy, starting with the root. */
+  vector<int> pchan_indices;
+  /* Start of every level in pchan_indices, followed by the number of bones. */
+  vector<int> level_offsets;
+};
+
+struct PoseBoneBatches {
+  vector<PoseBoneBatch> batches;
+  /* Batch of every pose channel, -1 for bones evaluated by their own operations. */
+  vector<int> pchan_batch;
+};
+
 class DepsgraphBuilder {
  public:
   virtual ~DepsgraphBuilder();
@@ -43,6 +61,10 @@ class DepsgraphBuilder {
   virtual bool check_pchan_has_bbone_segments(Object *object, const bPoseChannel *pchan);
   virtual bool check_pchan_has_bbone_segments(Object *object, const char *bone_name);
 
+  /* Bones of the armature object evaluated in batches. Found once per build and kept in the
+   * builder cache, so the nodes and relations builders agree on them. */
+  virtual const PoseBoneBatches &ensure_pose_bone_batches(Object *object);
+
  protected:
   /* NOTE: The builder does NOT take ownership over any of those resources. */
   DepsgraphBuilder(Main *bmain, Depsgraph *graph, DepsgraphBuilderCache *cache);
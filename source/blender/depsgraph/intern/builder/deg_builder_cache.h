@@ -23,11 +23,13 @@
 
 #pragma once
 
+#include "intern/builder/deg_builder.h"
 #include "intern/depsgraph_type.h"
 
 #include "RNA_access.h"
 
 struct ID;
+struct Object;
 struct PointerRNA;
 struct PropertyRNA;
 
@@ -98,6 +100,37 @@ class DepsgraphBuilderCache {
   }
 
   AnimatedPropertyStorageMap animated_property_storage_map_;
+
+  /* Bones of armature objects evaluated in batches, see
+   * DepsgraphBuilder::ensure_pose_bone_batches. Objects which nodes are not rebuilt by an
+   * incremental update find their batches again when building relations, from the same pose. */
+  map<Object *, PoseBoneBatches> pose_bone_batches_;
+
+  /* Incremental relations update.
+   *
+   * Nodes of IDs from nodes_rebuild_ids_ are re-created by the nodes builder, all other nodes of
+   * the graph are kept. The nodes builder collects IDs which were linked to the re-created nodes
+   * or which were added to the graph into relations_rebuild_ids_, and IDs which got new
+   * operations into copy_on_write_relations_rebuild_ids_. The relations builder only builds
+   * relations of those IDs.
+   *
+   * All sets are empty for a regular full build. */
+  bool isIncrementalBuild() const
+  {
+    return !nodes_rebuild_ids_.empty();
+  }
+  bool needRebuildNodes(ID *id) const
+  {
+    return nodes_rebuild_ids_.find(id) != nodes_rebuild_ids_.end();
+  }
+  bool needRebuildRelations(ID *id) const
+  {
+    return relations_rebuild_ids_.find(id) != relations_rebuild_ids_.end();
+  }
+
+  set<ID *> nodes_rebuild_ids_;
+  set<ID *> relations_rebuild_ids_;
+  set<ID *> copy_on_write_relations_rebuild_ids_;
 };
 
 }  // namespace DEG
@@ -106,6 +106,7 @@ extern "C" {
 #include "DEG_depsgraph_build.h"
 
 #include "intern/builder/deg_builder.h"
+#include "intern/builder/deg_builder_cache.h"
 #include "intern/depsgraph.h"
 #include "intern/eval/deg_eval_copy_on_write.h"
 #include "intern/node/deg_node.h"
@@ -172,9 +173,11 @@ IDNode *DepsgraphNodeBuilder::add_id_node(ID *id)
     id_info->id_cow = NULL;
   }
   id_node = graph_->add_id_node(id, id_cow);
-  id_node->previously_visible_components_mask = previously_visible_components_mask;
-  id_node->previous_eval_flags = previous_eval_flags;
-  id_node->previous_customdata_masks = previous_customdata_masks;
+  if (id_info != NULL) {
+    id_node->previously_visible_components_mask = previously_visible_components_mask;
+    id_node->previous_eval_flags = previous_eval_flags;
+    id_node->previous_customdata_masks = previous_customdata_masks;
+  }
   /* Currently all ID nodes are supposed to have copy-on-write logic.
    *
    * NOTE: Zero number of components indicates that ID node was just created. */
@@ -186,6 +189,11 @@ IDNode *DepsgraphNodeBuilder::add_id_node(ID *id)
         "",
         -1);
     graph_->operations.push_back(op_cow);
+    if (cache_->isIncrementalBuild()) {
+      /* ID is added to the graph by an incremental update, all its relations are to be built. */
+      cache_->relations_rebuild_ids_.insert(id);
+      cache_->copy_on_write_relations_rebuild_ids_.insert(id);
+    }
   }
   return id_node;
 }
@@ -220,6 +228,14 @@ OperationNode *DepsgraphNodeBuilder::add_operation_node(ComponentNode *comp_node
   if (op_node == NULL) {
     op_node = comp_node->add_operation(op, opcode, name, name_tag);
     graph_->operations.push_back(op_node);
+    if (cache_->isIncrementalBuild()) {
+      cache_->copy_on_write_relations_rebuild_ids_.insert(comp_node->owner->id_orig);
+    }
+  }
+  else if (cache_->isIncrementalBuild()) {
+    /* Operation of an ID which is kept by the incremental update. Update the callback, since
+     * the arguments it is bound to might have changed (for example, index of the base). */
+    op_node->evaluate = op;
   }
   else {
     fprintf(stderr,
@@ -374,6 +390,124 @@ void DepsgraphNodeBuilder::end_build()
   }
 }
 
+void DepsgraphNodeBuilder::begin_build_incremental()
+{
+  BLI_assert(cache_->isIncrementalBuild());
+  /* Copy-on-write datablocks are kept in the ID nodes, so the hash is only used for IDs which are
+   * added to the graph. */
+  id_info_hash_ = BLI_ghash_ptr_new("Depsgraph id hash");
+  vector<OperationNode *> removed_operations;
+  for (IDNode *id_node : graph_->id_nodes) {
+    /* Current state becomes the previous one, so finalization only tags IDs which changed. */
+    id_node->previously_visible_components_mask = id_node->visible_components_mask;
+    id_node->previous_eval_flags = id_node->eval_flags;
+    id_node->previous_customdata_masks = id_node->customdata_masks;
+    if (!cache_->needRebuildNodes(id_node->id_orig)) {
+      built_map_.tagBuild(id_node->id_orig);
+      continue;
+    }
+    clear_id_node_for_rebuild(id_node, &removed_operations);
+  }
+  if (removed_operations.empty()) {
+    return;
+  }
+  const set<OperationNode *> removed_operations_set(removed_operations.begin(),
+                                                   removed_operations.end());
+  graph_->operations.erase(std::remove_if(graph_->operations.begin(),
+                                          graph_->operations.end(),
+                                          [&removed_operations_set](OperationNode *op_node) {
+                                            return removed_operations_set.count(op_node) != 0;
+                                          }),
+                           graph_->operations.end());
+  for (OperationNode *op_node : removed_operations) {
+    ComponentNode *comp_node = op_node->owner;
+    comp_node->remove_operation(op_node);
+    if (comp_node->num_operations() == 0) {
+      comp_node->owner->remove_component(comp_node);
+    }
+  }
+}
+
+void DepsgraphNodeBuilder::clear_id_node_for_rebuild(IDNode *id_node,
+                                                     vector<OperationNode *> *r_removed_operations)
+{
+  ID *id_orig = id_node->id_orig;
+  SavedIDState id_state;
+  id_state.id_node = id_node;
+  id_state.linked_state = id_node->linked_state;
+  id_state.is_directly_visible = id_node->is_directly_visible;
+  saved_id_states_.push_back(id_state);
+  cache_->relations_rebuild_ids_.insert(id_orig);
+  cache_->copy_on_write_relations_rebuild_ids_.insert(id_orig);
+  /* Flags and masks are accumulated again by the relations builder. */
+  id_node->eval_flags = 0;
+  id_node->customdata_masks = DEGCustomDataMeshMasks();
+  GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, id_node->components) {
+    BLI_assert(comp_node->operations_map == NULL);
+    for (OperationNode *op_node : comp_node->operations) {
+      /* Remove all relations of the operation. Relations of IDs on the other side are to be
+       * rebuilt, since some of them were linked to this ID. */
+      const vector<Relation *> relations_in = op_node->inlinks;
+      for (Relation *rel : relations_in) {
+        if (rel->from->type == NodeType::OPERATION) {
+          OperationNode *op_from = static_cast<OperationNode *>(rel->from);
+          cache_->relations_rebuild_ids_.insert(op_from->owner->owner->id_orig);
+        }
+        rel->unlink();
+        OBJECT_GUARDED_DELETE(rel, Relation);
+      }
+      const vector<Relation *> relations_out = op_node->outlinks;
+      for (Relation *rel : relations_out) {
+        if (rel->to->type == NodeType::OPERATION) {
+          OperationNode *op_to = static_cast<OperationNode *>(rel->to);
+          cache_->relations_rebuild_ids_.insert(op_to->owner->owner->id_orig);
+        }
+        rel->unlink();
+        OBJECT_GUARDED_DELETE(rel, Relation);
+      }
+      /* Copy-on-write operation is kept together with the copy-on-write datablock. ID property
+       * operations are created by the drivers of other IDs, which are not rebuilt. */
+      if (comp_node->type == NodeType::COPY_ON_WRITE ||
+          op_node->opcode == OperationCode::ID_PROPERTY) {
+        continue;
+      }
+      if (BLI_gset_haskey(graph_->entry_tags, op_node)) {
+        SavedEntryTag entry_tag;
+        entry_tag.id_orig = id_orig;
+        entry_tag.component_type = comp_node->type;
+        entry_tag.opcode = op_node->opcode;
+        entry_tag.name = op_node->name;
+        entry_tag.name_tag = op_node->name_tag;
+        saved_entry_tags_.push_back(entry_tag);
+        BLI_gset_remove(graph_->entry_tags, op_node, NULL);
+      }
+      r_removed_operations->push_back(op_node);
+    }
+  }
+  GHASH_FOREACH_END();
+}
+
+void DepsgraphNodeBuilder::end_build_incremental()
+{
+  for (const SavedIDState &id_state : saved_id_states_) {
+    IDNode *id_node = id_state.id_node;
+    ID *id_orig = id_node->id_orig;
+    if (!built_map_.checkIsBuilt(id_orig)) {
+      /* The ID is not reachable from the view layer (for example, it is only used as a driver
+       * target), so build it with the state it had in the graph. */
+      if (GS(id_orig->name) == ID_OB) {
+        build_object(-1, (Object *)id_orig, id_state.linked_state, id_state.is_directly_visible);
+      }
+      else {
+        build_id(id_orig);
+      }
+    }
+    id_node->linked_state = max(id_node->linked_state, id_state.linked_state);
+    id_node->is_directly_visible |= id_state.is_directly_visible;
+  }
+  end_build();
+}
+
 void DepsgraphNodeBuilder::build_id(ID *id)
 {
   if (id == NULL) {
@@ -535,8 +669,9 @@ void DepsgraphNodeBuilder::build_object(int base_index,
   if (has_object) {
     IDNode *id_node = find_id_node(&object->id);
     /* We need to build some extra stuff if object becomes linked
-     * directly. */
-    if (id_node->linked_state == DEG_ID_LINKED_INDIRECTLY) {
+     * directly. Incremental update also needs to update the base index
+     * of objects which are kept. */
+    if (id_node->linked_state == DEG_ID_LINKED_INDIRECTLY || cache_->isIncrementalBuild()) {
       build_object_flags(base_index, object, linked_state);
     }
     id_node->linked_state = max(id_node->linked_state, linked_state);
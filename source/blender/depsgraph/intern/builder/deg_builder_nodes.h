@@ -96,6 +96,14 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   virtual void begin_build();
   virtual void end_build();
 
+  /* Incremental update of an existing graph, see DepsgraphBuilderCache.
+   *
+   * Begin removes nodes of IDs which are to be rebuilt together with all their relations, and
+   * marks all other IDs of the graph as built. End makes sure all the IDs which are to be rebuilt
+   * got their nodes back, even when they are not reachable from the view layer. */
+  virtual void begin_build_incremental();
+  virtual void end_build_incremental();
+
   IDNode *add_id_node(ID *id);
   IDNode *find_id_node(ID *id);
   TimeSourceNode *add_time_source();
@@ -242,6 +250,17 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   };
   vector<SavedEntryTag> saved_entry_tags_;
 
+  /* State of ID nodes which are rebuilt by an incremental update. The state is accumulated from
+   * all the IDs which are referencing the ID, and not all of them are visited by the update. */
+  struct SavedIDState {
+    IDNode *id_node;
+    eDepsNode_LinkedState_Type linked_state;
+    bool is_directly_visible;
+  };
+  vector<SavedIDState> saved_id_states_;
+
+  void clear_id_node_for_rebuild(IDNode *id_node, vector<OperationNode *> *r_removed_operations);
+
   struct BuilderWalkUserData {
     DepsgraphNodeBuilder *builder;
     /* Denotes whether object the walk is invoked from is visible. */
@@ -207,28 +207,61 @@ void DepsgraphNodeBuilder::build_rig(Object *object, bool is_object_visible)
                                OperationCode::POSE_DONE,
                                function_bind(BKE_pose_eval_done, _1, object_cow));
   op_node->set_as_exit();
+  /* Cheap bones are evaluated in batches, by the pose operation of the root of the batch. */
+  const PoseBoneBatches &bone_batches = ensure_pose_bone_batches(object);
   /* Bones. */
   int pchan_index = 0;
   LISTBASE_FOREACH (bPoseChannel *, pchan, &object->pose->chanbase) {
+    const int batch_index = bone_batches.pchan_batch[pchan_index];
     /* Node for bone evaluation. */
     op_node = add_operation_node(
         &object->id, NodeType::BONE, pchan->name, OperationCode::BONE_LOCAL);
     op_node->set_as_entry();
 
-    add_operation_node(&object->id,
-                       NodeType::BONE,
-                       pchan->name,
-                       OperationCode::BONE_POSE_PARENT,
-                       function_bind(BKE_pose_eval_bone, _1, scene_cow, object_cow, pchan_index));
+    if (batch_index == -1) {
+      add_operation_node(
+          &object->id,
+          NodeType::BONE,
+          pchan->name,
+          OperationCode::BONE_POSE_PARENT,
+          function_bind(BKE_pose_eval_bone, _1, scene_cow, object_cow, pchan_index));
+    }
+    else if (bone_batches.batches[batch_index].rootchan == pchan) {
+      const PoseBoneBatch &batch = bone_batches.batches[batch_index];
+      add_operation_node(&object->id,
+                         NodeType::BONE,
+                         pchan->name,
+                         OperationCode::BONE_POSE_PARENT,
+                         [scene_cow, object_cow, batch](::Depsgraph *depsgraph) {
+                           BKE_pose_eval_bone_batch(depsgraph,
+                                                    scene_cow,
+                                                    object_cow,
+                                                    batch.pchan_indices.data(),
+                                                    batch.level_offsets.data(),
+                                                    batch.level_offsets.size() - 1);
+                         });
+    }
+    else {
+      /* Evaluated by the root of the batch. */
+      add_operation_node(
+          &object->id, NodeType::BONE, pchan->name, OperationCode::BONE_POSE_PARENT);
+    }
 
     /* NOTE: Dedicated noop for easier relationship construction. */
     add_operation_node(&object->id, NodeType::BONE, pchan->name, OperationCode::BONE_READY);
 
-    op_node = add_operation_node(&object->id,
-                                 NodeType::BONE,
-                                 pchan->name,
-                                 OperationCode::BONE_DONE,
-                                 function_bind(BKE_pose_bone_done, _1, object_cow, pchan_index));
+    if (batch_index == -1) {
+      op_node = add_operation_node(
+          &object->id,
+          NodeType::BONE,
+          pchan->name,
+          OperationCode::BONE_DONE,
+          function_bind(BKE_pose_bone_done, _1, object_cow, pchan_index));
+    }
+    else {
+      op_node = add_operation_node(
+          &object->id, NodeType::BONE, pchan->name, OperationCode::BONE_DONE);
+    }
 
     /* B-Bone shape computation - the real last step if present. */
     if (check_pchan_has_bbone(object, pchan)) {
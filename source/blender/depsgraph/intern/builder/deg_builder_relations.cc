@@ -101,6 +101,7 @@ extern "C" {
 #include "DEG_depsgraph_build.h"
 
 #include "intern/builder/deg_builder.h"
+#include "intern/builder/deg_builder_cache.h"
 #include "intern/builder/deg_builder_pchanmap.h"
 #include "intern/debug/deg_debug.h"
 #include "intern/depsgraph_tag.h"
@@ -360,6 +361,10 @@ Relation *DepsgraphRelationBuilder::add_time_relation(TimeSourceNode *timesrc,
                                                       int flags)
 {
   if (timesrc && node_to) {
+    if (cache_->isIncrementalBuild()) {
+      /* Relations between IDs which are kept by the incremental update are still in the graph. */
+      flags |= RELATION_CHECK_BEFORE_ADD;
+    }
     return graph_->add_new_relation(timesrc, node_to, description, flags);
   }
   else {
@@ -381,6 +386,10 @@ Relation *DepsgraphRelationBuilder::add_operation_relation(OperationNode *node_f
                                                            int flags)
 {
   if (node_from && node_to) {
+    if (cache_->isIncrementalBuild()) {
+      /* Relations between IDs which are kept by the incremental update are still in the graph. */
+      flags |= RELATION_CHECK_BEFORE_ADD;
+    }
     return graph_->add_new_relation(node_from, node_to, description, flags);
   }
   else {
@@ -488,6 +497,43 @@ void DepsgraphRelationBuilder::begin_build()
 {
 }
 
+void DepsgraphRelationBuilder::begin_build_incremental()
+{
+  BLI_assert(cache_->isIncrementalBuild());
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (!cache_->needRebuildRelations(id_node->id_orig)) {
+      built_map_.tagBuild(id_node->id_orig);
+    }
+  }
+}
+
+void DepsgraphRelationBuilder::end_build_incremental()
+{
+  /* Build relations of IDs which are not reachable from the view layer. */
+  for (ID *id : cache_->relations_rebuild_ids_) {
+    if (built_map_.checkIsBuilt(id)) {
+      continue;
+    }
+    switch (GS(id->name)) {
+      case ID_PA:
+        build_particle_settings((ParticleSettings *)id);
+        break;
+      case ID_GD:
+        build_gpencil((bGPdata *)id);
+        break;
+      default:
+        build_id(id);
+        break;
+    }
+  }
+  for (ID *id : cache_->copy_on_write_relations_rebuild_ids_) {
+    IDNode *id_node = graph_->find_id_node(id);
+    if (id_node != NULL) {
+      build_copy_on_write_relations(id_node);
+    }
+  }
+}
+
 void DepsgraphRelationBuilder::build_id(ID *id)
 {
   if (id == NULL) {
@@ -2577,6 +2623,8 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
    * explicit pointers. */
   Node *node_cow = find_node(copy_on_write_key);
   OperationNode *op_cow = node_cow->get_exit_operation();
+  /* Components of IDs which are kept by the incremental update might have relations already. */
+  const int cow_rel_flag = cache_->isIncrementalBuild() ? RELATION_CHECK_BEFORE_ADD : 0;
   /* Plug any other components to this one. */
   GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, id_node->components) {
     if (comp_node->type == NodeType::COPY_ON_WRITE) {
@@ -2617,16 +2665,27 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * copy of ID. */
     OperationNode *op_entry = comp_node->get_entry_operation();
     if (op_entry != NULL) {
-      Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency");
+      Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency", cow_rel_flag);
       rel->flag |= rel_flag;
     }
-    /* All dangling operations should also be executed after copy-on-write. */
-    GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
+    /* All dangling operations should also be executed after copy-on-write.
+     * NOTE: Components which were finalized by a previous build store operations in a vector. */
+    vector<OperationNode *> comp_operations;
+    if (comp_node->operations_map != NULL) {
+      GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
+        comp_operations.push_back(op_node);
+      }
+      GHASH_FOREACH_END();
+    }
+    else {
+      comp_operations = comp_node->operations;
+    }
+    for (OperationNode *op_node : comp_operations) {
       if (op_node == op_entry) {
         continue;
       }
       if (op_node->inlinks.size() == 0) {
-        Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
+        Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency", cow_rel_flag);
         rel->flag |= rel_flag;
       }
       else {
@@ -2642,12 +2701,12 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
           }
         }
         if (!has_same_comp_dependency) {
-          Relation *rel = graph_->add_new_relation(op_cow, op_node, "CoW Dependency");
+          Relation *rel = graph_->add_new_relation(
+              op_cow, op_node, "CoW Dependency", cow_rel_flag);
           rel->flag |= rel_flag;
         }
       }
     }
-    GHASH_FOREACH_END();
     /* NOTE: We currently ignore implicit relations to an external
      * data-blocks for copy-on-write operations. This means, for example,
      * copy-on-write component of Object will not wait for copy-on-write
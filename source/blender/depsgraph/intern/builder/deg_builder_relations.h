@@ -159,6 +159,14 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   void begin_build();
 
+  /* Incremental update of an existing graph, see DepsgraphBuilderCache.
+   *
+   * Relations are only built for IDs which were rebuilt or linked to them. End builds relations of
+   * such IDs which are not reachable from the view layer, and copy-on-write relations of IDs
+   * which got new operations. */
+  void begin_build_incremental();
+  void end_build_incremental();
+
   template<typename KeyFrom, typename KeyTo>
   Relation *add_relation(const KeyFrom &key_from,
                          const KeyTo &key_to,
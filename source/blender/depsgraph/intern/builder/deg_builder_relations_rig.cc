@@ -317,7 +317,10 @@ void DepsgraphRelationBuilder::build_rig(Object *object)
     ComponentKey local_transform_key(&object->id, NodeType::TRANSFORM);
     add_relation(local_transform_key, pose_key, "Local Transforms");
   }
+  /* Bones evaluated in batches, same as for the nodes. */
+  const PoseBoneBatches &bone_batches = ensure_pose_bone_batches(object);
   /* Links between operations for each bone. */
+  int pchan_index = 0;
   LISTBASE_FOREACH (bPoseChannel *, pchan, &object->pose->chanbase) {
     OperationKey bone_local_key(
         &object->id, NodeType::BONE, pchan->name, OperationCode::BONE_LOCAL);
@@ -331,6 +334,17 @@ void DepsgraphRelationBuilder::build_rig(Object *object)
     add_relation(pose_init_key, bone_local_key, "Pose Init - Bone Local", RELATION_FLAG_GODMODE);
     /* Local to pose parenting operation. */
     add_relation(bone_local_key, bone_pose_key, "Bone Local - Bone Pose");
+    /* Batch evaluating the bone. It is followed by the no-op pose operation of the bone through
+     * the parent relations. */
+    const int batch_index = bone_batches.pchan_batch[pchan_index];
+    if (batch_index != -1) {
+      const bPoseChannel *rootchan = bone_batches.batches[batch_index].rootchan;
+      if (rootchan != pchan) {
+        OperationKey root_pose_key(
+            &object->id, NodeType::BONE, rootchan->name, OperationCode::BONE_POSE_PARENT);
+        add_relation(bone_local_key, root_pose_key, "Bone Local - Bone Batch");
+      }
+    }
     /* Parent relation. */
     if (pchan->parent != NULL) {
       OperationCode parent_key_opcode;
@@ -415,6 +429,7 @@ void DepsgraphRelationBuilder::build_rig(Object *object)
     if (pchan->custom != NULL) {
       build_object(NULL, pchan->custom);
     }
+    pchan_index++;
   }
 }
 
@@ -82,6 +82,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
   BLI_spin_init(&lock);
   id_hash = BLI_ghash_ptr_new("Depsgraph id hash");
   entry_tags = BLI_gset_ptr_new("Depsgraph entry_tags");
+  scratch_arena = BLI_scratch_arena_new("Depsgraph scratch_arena");
   debug_flags = G.debug;
   memset(id_type_updated, 0, sizeof(id_type_updated));
   memset(id_type_exist, 0, sizeof(id_type_exist));
@@ -93,6 +94,7 @@ Depsgraph::~Depsgraph()
   clear_id_nodes();
   BLI_ghash_free(id_hash, NULL, NULL);
   BLI_gset_free(entry_tags, NULL);
+  BLI_scratch_arena_free(scratch_arena);
   if (time_source != NULL) {
     OBJECT_GUARDED_DELETE(time_source, TimeSourceNode);
   }
@@ -207,6 +209,21 @@ Relation *Depsgraph::check_nodes_connected(const Node *from,
                                            const Node *to,
                                            const char *description)
 {
+  /* Iterate over the shortest list of links, nodes like time source or view layer evaluation
+   * have links to almost every object in the scene. */
+  if (to->inlinks.size() < from->outlinks.size()) {
+    for (Relation *rel : to->inlinks) {
+      BLI_assert(rel->to == to);
+      if (rel->from != from) {
+        continue;
+      }
+      if (description != NULL && !STREQ(rel->name, description)) {
+        continue;
+      }
+      return rel;
+    }
+    return NULL;
+  }
   for (Relation *rel : from->outlinks) {
     BLI_assert(rel->from == from);
     if (rel->to != to) {
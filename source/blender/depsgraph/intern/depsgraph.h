@@ -35,6 +35,7 @@
 
 #include "BKE_main.h" /* for MAX_LIBARRAY */
 
+#include "BLI_scratch_arena.h"
 #include "BLI_threads.h" /* for SpinLock */
 
 #include "DEG_depsgraph.h"
@@ -147,6 +148,11 @@ struct Depsgraph {
   /* Indicates whether relations needs to be updated. */
   bool need_update;
 
+  /* IDs which relations were tagged for update with DEG_graph_id_tag_relations_update().
+   * When need_update is set and this set is not empty only nodes and relations of those IDs (and
+   * of the IDs they are linked to) are rebuilt. Empty set means full rebuild. */
+  set<ID *> relations_update_ids;
+
   /* Indicates which ID types were updated. */
   char id_type_updated[MAX_LIBARRAY];
 
@@ -200,6 +206,10 @@ struct Depsgraph {
 
   bool is_evaluating;
 
+  /* Temporary memory of evaluation functions, bound to the threads evaluating operations and
+   * reset after the evaluation. */
+  ScratchArena *scratch_arena;
+
   /* Is set to truth for dependency graph which are used for post-processing (compositor and
    * sequencer).
    * Such dependency graph needs all view layers (so render pipeline can access names), but it
@@ -34,9 +34,15 @@
 
 extern "C" {
 #include "DNA_cachefile_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_force_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
+#include "BKE_animsys.h"
+#include "BKE_collection.h"
+#include "BKE_collision.h"
+#include "BKE_effect.h"
 #include "BKE_main.h"
 #include "BKE_scene.h"
 } /* extern "C" */
@@ -222,6 +228,9 @@ static void graph_build_finalize_common(DEG::Depsgraph *deg_graph, Main *bmain)
 #endif
   /* Relations are up to date. */
   deg_graph->need_update = false;
+  deg_graph->relations_update_ids.clear();
+  /* Paths which could not be resolved before might be valid now. */
+  BKE_animsys_path_cache_tag_outdated();
 }
 
 /* Build depsgraph for the given scene layer, and dump results in given graph container. */
@@ -465,12 +474,156 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
   }
 }
 
+namespace DEG {
+
+static bool object_has_physics_relations(Object *object)
+{
+  if (object->pd != NULL && object->pd->forcefield != 0) {
+    return true;
+  }
+  if (object->rigidbody_object != NULL || object->rigidbody_constraint != NULL) {
+    return true;
+  }
+  LISTBASE_FOREACH (ModifierData *, md, &object->modifiers) {
+    if (ELEM(md->type,
+             eModifierType_Collision,
+             eModifierType_Fluid,
+             eModifierType_DynamicPaint,
+             eModifierType_Fluidsim)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Check whether object is used by the cached lists of colliders and effectors. */
+static bool physics_relations_use_object(Depsgraph *deg_graph, Object *object)
+{
+  for (int i = 0; i < DEG_PHYSICS_RELATIONS_NUM; i++) {
+    if (deg_graph->physics_relations[i] == NULL) {
+      continue;
+    }
+    GHASH_FOREACH_BEGIN (ListBase *, relations, deg_graph->physics_relations[i]) {
+      if (relations == NULL) {
+        continue;
+      }
+      if (i == DEG_PHYSICS_EFFECTOR) {
+        LISTBASE_FOREACH (EffectorRelation *, relation, relations) {
+          if (relation->ob == object) {
+            return true;
+          }
+        }
+      }
+      else {
+        LISTBASE_FOREACH (CollisionRelation *, relation, relations) {
+          if (relation->ob == object) {
+            return true;
+          }
+        }
+      }
+    }
+    GHASH_FOREACH_END();
+  }
+  return false;
+}
+
+/* Collect IDs which nodes are to be rebuilt by the incremental relations update.
+ * Returns false if the update can not be done incrementally. */
+static bool graph_incremental_update_collect_ids(Depsgraph *deg_graph, set<ID *> *r_rebuild_ids)
+{
+  vector<Object *> objects;
+  for (ID *id : deg_graph->relations_update_ids) {
+    /* Only objects are supported, changes of other IDs are handled by the full rebuild. */
+    if (GS(id->name) != ID_OB) {
+      return false;
+    }
+    Object *object = (Object *)id;
+    /* Colliders and effectors are cached per collection, which is not updated incrementally. */
+    if (object_has_physics_relations(object) || physics_relations_use_object(deg_graph, object)) {
+      return false;
+    }
+    r_rebuild_ids->insert(id);
+    objects.push_back(object);
+  }
+  /* Objects which instance collections with the tagged objects build nodes of those objects, so
+   * need to be rebuilt as well. */
+  for (IDNode *id_node : deg_graph->id_nodes) {
+    if (GS(id_node->id_orig->name) != ID_OB) {
+      continue;
+    }
+    Object *object = (Object *)id_node->id_orig;
+    if (object->instance_collection == NULL) {
+      continue;
+    }
+    for (Object *tagged_object : objects) {
+      if (BKE_collection_has_object_recursive(object->instance_collection, tagged_object)) {
+        r_rebuild_ids->insert(&object->id);
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+/* Rebuild nodes and relations of the IDs which were tagged with
+ * DEG_graph_id_tag_relations_update(), keeping the rest of the graph.
+ * Returns false if the update can not be done incrementally, graph is not modified then. */
+static bool graph_relations_update_incremental(Depsgraph *deg_graph,
+                                               Main *bmain,
+                                               Scene *scene,
+                                               ViewLayer *view_layer)
+{
+  if (deg_graph->relations_update_ids.empty() || deg_graph->is_render_pipeline_depsgraph) {
+    return false;
+  }
+  /* Transitive reduction removes relations which incremental update does not restore. */
+  if (G.debug_value == 799) {
+    return false;
+  }
+  double start_time = 0.0;
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    start_time = PIL_check_seconds_timer();
+  }
+  DepsgraphBuilderCache builder_cache;
+  if (!graph_incremental_update_collect_ids(deg_graph, &builder_cache.nodes_rebuild_ids_)) {
+    return false;
+  }
+  /* Re-create nodes of the tagged IDs. */
+  DepsgraphNodeBuilder node_builder(bmain, deg_graph, &builder_cache);
+  node_builder.begin_build_incremental();
+  node_builder.build_view_layer(scene, view_layer, DEG_ID_LINKED_DIRECTLY);
+  node_builder.end_build_incremental();
+  /* Re-create relations of the tagged IDs and of the IDs they were linked to. */
+  DepsgraphRelationBuilder relation_builder(bmain, deg_graph, &builder_cache);
+  relation_builder.begin_build_incremental();
+  relation_builder.build_view_layer(scene, view_layer, DEG_ID_LINKED_DIRECTLY);
+  relation_builder.end_build_incremental();
+  /* Cycles are detected again for the whole graph. */
+  for (OperationNode *op_node : deg_graph->operations) {
+    for (Relation *rel : op_node->inlinks) {
+      rel->flag &= ~RELATION_FLAG_CYCLIC;
+    }
+  }
+  graph_build_finalize_common(deg_graph, bmain);
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    printf("Depsgraph updated incrementally in %f seconds (%d IDs rebuilt, %d IDs relinked).\n",
+           PIL_check_seconds_timer() - start_time,
+           (int)builder_cache.nodes_rebuild_ids_.size(),
+           (int)builder_cache.relations_rebuild_ids_.size());
+  }
+  return true;
+}
+
+}  // namespace DEG
+
 /* Tag graph relations for update. */
 void DEG_graph_tag_relations_update(Depsgraph *graph)
 {
   DEG_DEBUG_PRINTF(graph, TAG, "%s: Tagging relations for update.\n", __func__);
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   deg_graph->need_update = true;
+  /* Full rebuild supersedes any incremental update. */
+  deg_graph->relations_update_ids.clear();
   /* NOTE: When relations are updated, it's quite possible that
    * we've got new bases in the scene. This means, we need to
    * re-create flat array of bases in view layer.
@@ -491,9 +644,38 @@ void DEG_graph_relations_update(Depsgraph *graph, Main *bmain, Scene *scene, Vie
     /* Graph is up to date, nothing to do. */
     return;
   }
+  if (DEG::graph_relations_update_incremental(deg_graph, bmain, scene, view_layer)) {
+    if (G.debug & G_DEBUG_DEPSGRAPH_VALIDATE) {
+      DEG_debug_graph_relations_validate(graph, bmain, scene, view_layer);
+    }
+    return;
+  }
   DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
 }
 
+/* Tag relations of the given ID for update. */
+void DEG_graph_id_tag_relations_update(Depsgraph *graph, ID *id)
+{
+  DEG_DEBUG_PRINTF(graph, TAG, "%s: Tagging relations of %s for update.\n", __func__, id->name);
+  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+  if (deg_graph->need_update && deg_graph->relations_update_ids.empty()) {
+    /* Full rebuild is already scheduled. */
+    return;
+  }
+  deg_graph->need_update = true;
+  deg_graph->relations_update_ids.insert(id);
+  /* NOTE: Same as for the full rebuild, flat array of bases in the view layer needs to be
+   * re-created. */
+  DEG::IDNode *scene_id_node = deg_graph->find_id_node(&deg_graph->scene->id);
+  if (scene_id_node != NULL) {
+    scene_id_node->tag_update(deg_graph, DEG::DEG_UPDATE_SOURCE_RELATIONS);
+  }
+  DEG::IDNode *id_node = deg_graph->find_id_node(id);
+  if (id_node != NULL) {
+    id_node->tag_update(deg_graph, DEG::DEG_UPDATE_SOURCE_RELATIONS);
+  }
+}
+
 /* Tag all relations for update. */
 void DEG_relations_tag_update(Main *bmain)
 {
@@ -502,3 +684,12 @@ void DEG_relations_tag_update(Main *bmain)
     DEG_graph_tag_relations_update(reinterpret_cast<Depsgraph *>(depsgraph));
   }
 }
+
+/* Tag relations of the given ID for update in all dependency graphs. */
+void DEG_id_tag_relations_update(Main *bmain, ID *id)
+{
+  DEG_GLOBAL_DEBUG_PRINTF(TAG, "%s: Tagging relations of %s for update.\n", __func__, id->name);
+  for (DEG::Depsgraph *depsgraph : DEG::get_all_registered_graphs(bmain)) {
+    DEG_graph_id_tag_relations_update(reinterpret_cast<Depsgraph *>(depsgraph), id);
+  }
+}
@@ -42,6 +42,7 @@ extern "C" {
 #include "intern/debug/deg_debug.h"
 #include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
 #include "intern/node/deg_node_time.h"
 
 void DEG_debug_flags_set(Depsgraph *depsgraph, int flags)
@@ -68,22 +69,103 @@ const char *DEG_debug_name_get(struct Depsgraph *depsgraph)
   return deg_graph->debug_name.c_str();
 }
 
+namespace DEG {
+
+static string debug_node_key(const Node *node)
+{
+  if (node->type != NodeType::OPERATION) {
+    return node->name;
+  }
+  const OperationNode *op_node = static_cast<const OperationNode *>(node);
+  const ComponentNode *comp_node = op_node->owner;
+  return comp_node->owner->name + "/" + nodeTypeAsString(comp_node->type) + "/" +
+         comp_node->name + "/" + op_node->identifier() + "#" + to_string(op_node->name_tag);
+}
+
+static bool debug_node_is_ignored(const Node *node, const set<string> &ignored_ids)
+{
+  if (node->type != NodeType::OPERATION) {
+    return false;
+  }
+  const OperationNode *op_node = static_cast<const OperationNode *>(node);
+  return ignored_ids.find(op_node->owner->owner->name) != ignored_ids.end();
+}
+
+/* Keys of the IDs, operations and relations of the graph, except for the ones of (or linked to)
+ * the ignored IDs. */
+static void debug_graph_keys(const Depsgraph *graph,
+                             const set<string> &ignored_ids,
+                             set<string> *r_id_keys,
+                             set<string> *r_operation_keys,
+                             set<string> *r_relation_keys)
+{
+  for (const IDNode *id_node : graph->id_nodes) {
+    if (ignored_ids.find(id_node->name) == ignored_ids.end()) {
+      r_id_keys->insert(id_node->name);
+    }
+  }
+  for (const OperationNode *op_node : graph->operations) {
+    if (debug_node_is_ignored(op_node, ignored_ids)) {
+      continue;
+    }
+    const string op_key = debug_node_key(op_node);
+    r_operation_keys->insert(op_key);
+    for (const Relation *rel : op_node->inlinks) {
+      if (debug_node_is_ignored(rel->from, ignored_ids)) {
+        continue;
+      }
+      r_relation_keys->insert(debug_node_key(rel->from) + " -> " + op_key + " : " + rel->name);
+    }
+  }
+}
+
+/* Print keys which are only present in the first set. */
+static int debug_print_keys_difference(const char *label,
+                                       const set<string> &keys1,
+                                       const set<string> &keys2)
+{
+  int num_differences = 0;
+  for (const string &key : keys1) {
+    if (keys2.find(key) == keys2.end()) {
+      fprintf(stderr, "%s: %s\n", label, key.c_str());
+      num_differences++;
+    }
+  }
+  return num_differences;
+}
+
+/* NOTE: Order of operations and flags of the nodes are not compared. */
+static bool debug_compare(const Depsgraph *graph1,
+                          const Depsgraph *graph2,
+                          const set<string> &ignored_ids)
+{
+  set<string> id_keys1, operation_keys1, relation_keys1;
+  set<string> id_keys2, operation_keys2, relation_keys2;
+  debug_graph_keys(graph1, ignored_ids, &id_keys1, &operation_keys1, &relation_keys1);
+  debug_graph_keys(graph2, ignored_ids, &id_keys2, &operation_keys2, &relation_keys2);
+  int num_differences = 0;
+  num_differences += debug_print_keys_difference("ID only in first graph", id_keys1, id_keys2);
+  num_differences += debug_print_keys_difference("ID only in second graph", id_keys2, id_keys1);
+  num_differences += debug_print_keys_difference(
+      "Operation only in first graph", operation_keys1, operation_keys2);
+  num_differences += debug_print_keys_difference(
+      "Operation only in second graph", operation_keys2, operation_keys1);
+  num_differences += debug_print_keys_difference(
+      "Relation only in first graph", relation_keys1, relation_keys2);
+  num_differences += debug_print_keys_difference(
+      "Relation only in second graph", relation_keys2, relation_keys1);
+  return num_differences == 0;
+}
+
+}  // namespace DEG
+
 bool DEG_debug_compare(const struct Depsgraph *graph1, const struct Depsgraph *graph2)
 {
   BLI_assert(graph1 != NULL);
   BLI_assert(graph2 != NULL);
   const DEG::Depsgraph *deg_graph1 = reinterpret_cast<const DEG::Depsgraph *>(graph1);
   const DEG::Depsgraph *deg_graph2 = reinterpret_cast<const DEG::Depsgraph *>(graph2);
-  if (deg_graph1->operations.size() != deg_graph2->operations.size()) {
-    return false;
-  }
-  /* TODO(sergey): Currently we only do real stupid check,
-   * which is fast but which isn't 100% reliable.
-   *
-   * Would be cool to make it more robust, but it's good enough
-   * for now. Also, proper graph check is actually NP-complex
-   * problem. */
-  return true;
+  return DEG::debug_compare(deg_graph1, deg_graph2, DEG::set<DEG::string>());
 }
 
 bool DEG_debug_graph_relations_validate(Depsgraph *graph,
@@ -94,8 +176,18 @@ bool DEG_debug_graph_relations_validate(Depsgraph *graph,
   Depsgraph *temp_depsgraph = DEG_graph_new(bmain, scene, view_layer, DEG_get_mode(graph));
   bool valid = true;
   DEG_graph_build_from_view_layer(temp_depsgraph, bmain, scene, view_layer);
-  if (!DEG_debug_compare(temp_depsgraph, graph)) {
-    fprintf(stderr, "ERROR! Depsgraph wasn't tagged for update when it should have!\n");
+  const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+  const DEG::Depsgraph *deg_temp_graph = reinterpret_cast<const DEG::Depsgraph *>(temp_depsgraph);
+  /* IDs which are no longer referenced stay in the graph until the next full rebuild after an
+   * incremental update, together with their operations and relations. */
+  DEG::set<DEG::string> ignored_ids;
+  for (const DEG::IDNode *id_node : deg_graph->id_nodes) {
+    if (deg_temp_graph->find_id_node(id_node->id_orig) == NULL) {
+      ignored_ids.insert(id_node->name);
+    }
+  }
+  if (!DEG::debug_compare(deg_temp_graph, deg_graph, ignored_ids)) {
+    fprintf(stderr, "ERROR! Depsgraph relations differ from the ones of a full rebuild!\n");
     BLI_assert(!"This should not happen!");
     valid = false;
   }
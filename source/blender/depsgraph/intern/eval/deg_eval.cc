@@ -31,6 +31,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_task.h"
 #include "BLI_ghash.h"
+#include "BLI_scratch_arena.h"
 
 #include "BKE_global.h"
 
@@ -77,6 +78,7 @@ static void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
   /* Sanity checks. */
   BLI_assert(!node->is_noop() && "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
+  ScratchArena *scratch_arena_prev = BLI_scratch_arena_bind(state->graph->scratch_arena);
   if (state->do_stats) {
     const double start_time = PIL_check_seconds_timer();
     node->evaluate((::Depsgraph *)state->graph);
@@ -85,6 +87,7 @@ static void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
   else {
     node->evaluate((::Depsgraph *)state->graph);
   }
+  BLI_scratch_arena_bind(scratch_arena_prev);
   /* Schedule children. */
   BLI_task_pool_delayed_push_begin(pool, thread_id);
   schedule_children(pool, state->graph, node, thread_id);
@@ -287,6 +290,8 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   schedule_graph(task_pool, graph);
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
+  /* Temporary memory of the evaluation isn't used anymore, keep it for the next evaluation. */
+  BLI_scratch_arena_reset(graph->scratch_arena);
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
@@ -820,6 +820,11 @@ void update_id_after_copy(const Depsgraph *depsgraph,
       update_scene_orig_pointers(scene_orig, scene_cow);
       break;
     }
+    case ID_AC: {
+      /* F-Curves of the action were copied again, paths resolved for them need to be checked. */
+      BKE_animsys_path_cache_tag_outdated();
+      break;
+    }
     default:
       break;
   }
@@ -203,8 +203,15 @@ OperationNode *ComponentNode::add_operation(const DepsEvalOperationCb &op,
     op_node = (OperationNode *)factory->create_node(this->owner->id_orig, "", name);
 
     /* register opnode in this component's operation set */
-    OperationIDKey *key = OBJECT_GUARDED_NEW(OperationIDKey, opcode, name, name_tag);
-    BLI_ghash_insert(operations_map, key, op_node);
+    if (operations_map != NULL) {
+      OperationIDKey *key = OBJECT_GUARDED_NEW(OperationIDKey, opcode, name, name_tag);
+      BLI_ghash_insert(operations_map, key, op_node);
+    }
+    else {
+      /* Component was finalized already, happens when operations are added by an incremental
+       * relations update. */
+      operations.push_back(op_node);
+    }
 
     /* set backlink */
     op_node->owner = this;
@@ -229,16 +236,45 @@ OperationNode *ComponentNode::add_operation(const DepsEvalOperationCb &op,
 
 void ComponentNode::set_entry_operation(OperationNode *op_node)
 {
-  BLI_assert(entry_operation == NULL);
+  BLI_assert(entry_operation == NULL || entry_operation == op_node);
   entry_operation = op_node;
 }
 
 void ComponentNode::set_exit_operation(OperationNode *op_node)
 {
-  BLI_assert(exit_operation == NULL);
+  BLI_assert(exit_operation == NULL || exit_operation == op_node);
   exit_operation = op_node;
 }
 
+void ComponentNode::remove_operation(OperationNode *op_node)
+{
+  BLI_assert(op_node->owner == this);
+  BLI_assert(op_node->inlinks.empty() && op_node->outlinks.empty());
+  if (operations_map != NULL) {
+    OperationIDKey key(op_node->opcode, op_node->name.c_str(), op_node->name_tag);
+    BLI_ghash_remove(operations_map, &key, comp_node_hash_key_free, NULL);
+  }
+  else {
+    operations.erase(std::remove(operations.begin(), operations.end(), op_node),
+                     operations.end());
+  }
+  if (entry_operation == op_node) {
+    entry_operation = NULL;
+  }
+  if (exit_operation == op_node) {
+    exit_operation = NULL;
+  }
+  OBJECT_GUARDED_DELETE(op_node, OperationNode);
+}
+
+int ComponentNode::num_operations() const
+{
+  if (operations_map != NULL) {
+    return BLI_ghash_len(operations_map);
+  }
+  return operations.size();
+}
+
 void ComponentNode::clear_operations()
 {
   if (operations_map != NULL) {
@@ -280,8 +316,8 @@ OperationNode *ComponentNode::get_entry_operation()
       op_node = tmp;
     }
     GHASH_FOREACH_END();
-    /* Cache for the subsequent usage. */
-    entry_operation = op_node;
+    /* NOTE: Result is not cached since more operations might be added to the component by an
+     * incremental relations update. */
     return op_node;
   }
   else if (operations.size() == 1) {
@@ -302,8 +338,8 @@ OperationNode *ComponentNode::get_exit_operation()
       op_node = tmp;
     }
     GHASH_FOREACH_END();
-    /* Cache for the subsequent usage. */
-    exit_operation = op_node;
+    /* NOTE: Result is not cached since more operations might be added to the component by an
+     * incremental relations update. */
     return op_node;
   }
   else if (operations.size() == 1) {
@@ -314,6 +350,10 @@ OperationNode *ComponentNode::get_exit_operation()
 
 void ComponentNode::finalize_build(Depsgraph * /*graph*/)
 {
+  if (operations_map == NULL) {
+    /* Component was finalized by a previous build, and kept by an incremental update. */
+    return;
+  }
   operations.reserve(BLI_ghash_len(operations_map));
   GHASH_FOREACH_BEGIN (OperationNode *, op_node, operations_map) {
     operations.push_back(op_node);
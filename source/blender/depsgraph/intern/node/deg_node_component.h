@@ -102,6 +102,12 @@ struct ComponentNode : public Node {
 
   void clear_operations();
 
+  /* Remove operation from the component and free it.
+   * The operation is expected to have all its relations removed already. */
+  void remove_operation(OperationNode *op_node);
+
+  int num_operations() const;
+
   virtual void tag_update(Depsgraph *graph, eUpdateSource source) override;
 
   virtual OperationNode *get_entry_operation() override;
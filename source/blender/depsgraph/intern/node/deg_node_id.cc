@@ -203,6 +203,13 @@ ComponentNode *IDNode::add_component(NodeType type, const char *name)
   return comp_node;
 }
 
+void IDNode::remove_component(ComponentNode *comp_node)
+{
+  BLI_assert(comp_node->owner == this);
+  ComponentIDKey key(comp_node->type, comp_node->name.c_str());
+  BLI_ghash_remove(components, &key, id_deps_node_hash_key_free, id_deps_node_hash_value_free);
+}
+
 void IDNode::tag_update(Depsgraph *graph, eUpdateSource source)
 {
   GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, components) {
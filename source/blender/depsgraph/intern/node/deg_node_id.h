@@ -65,6 +65,8 @@ struct IDNode : public Node {
 
   ComponentNode *find_component(NodeType type, const char *name = "") const;
   ComponentNode *add_component(NodeType type, const char *name = "");
+  /* Remove component from the ID and free it, together with all its operations. */
+  void remove_component(ComponentNode *comp_node);
 
   virtual void tag_update(Depsgraph *graph, eUpdateSource source) override;
 
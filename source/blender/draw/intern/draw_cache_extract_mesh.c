@@ -30,6 +30,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_math_vector.h"
 #include "BLI_math_bits.h"
+#include "BLI_scratch_arena.h"
 #include "BLI_string.h"
 #include "BLI_alloca.h"
 #include "BLI_edgehash.h"
@@ -113,6 +114,8 @@ typedef struct MeshRenderData {
   const MEdge *medge;
   const MLoop *mloop;
   const MPoly *mpoly;
+  /** Vertex positions stored separately from #MVert, may be NULL, see #mr_vert_co. */
+  const float (*vert_positions)[3];
   BMVert *eve_act;
   BMEdge *eed_act;
   BMFace *efa_act;
@@ -124,6 +127,11 @@ typedef struct MeshRenderData {
   int *lverts, *ledges;
 } MeshRenderData;
 
+BLI_INLINE const float *mr_vert_co(const MeshRenderData *mr, const int v)
+{
+  return (mr->vert_positions != NULL) ? mr->vert_positions[v] : mr->mvert[v].co;
+}
+
 static MeshRenderData *mesh_render_data_create(Mesh *me,
                                                const bool do_final,
                                                const bool do_uvedit,
@@ -132,7 +140,7 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
                                                const DRW_MeshCDMask *UNUSED(cd_used),
                                                const ToolSettings *ts)
 {
-  MeshRenderData *mr = MEM_callocN(sizeof(*mr), __func__);
+  MeshRenderData *mr = BLI_scratch_calloc(sizeof(*mr), __func__);
   mr->toolsettings = ts;
   mr->mat_len = mesh_render_mat_len_get(me);
 
@@ -199,13 +207,15 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
     mr->medge = CustomData_get_layer(&mr->me->edata, CD_MEDGE);
     mr->mloop = CustomData_get_layer(&mr->me->ldata, CD_MLOOP);
     mr->mpoly = CustomData_get_layer(&mr->me->pdata, CD_MPOLY);
+    mr->vert_positions = BKE_mesh_vert_positions(mr->me);
 
     mr->v_origindex = CustomData_get_layer(&mr->me->vdata, CD_ORIGINDEX);
     mr->e_origindex = CustomData_get_layer(&mr->me->edata, CD_ORIGINDEX);
     mr->p_origindex = CustomData_get_layer(&mr->me->pdata, CD_ORIGINDEX);
 
     if (data_flag & (MR_DATA_POLY_NOR | MR_DATA_LOOP_NOR | MR_DATA_TAN_LOOP_NOR)) {
-      mr->poly_normals = MEM_mallocN(sizeof(*mr->poly_normals) * mr->poly_len, __func__);
+      mr->poly_normals = BLI_scratch_alloc_array(
+          (size_t)mr->poly_len, sizeof(*mr->poly_normals), __func__);
       BKE_mesh_calc_normals_poly((MVert *)mr->mvert,
                                  NULL,
                                  mr->vert_len,
@@ -217,7 +227,8 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
                                  true);
     }
     if (((data_flag & MR_DATA_LOOP_NOR) && is_auto_smooth) || (data_flag & MR_DATA_TAN_LOOP_NOR)) {
-      mr->loop_normals = MEM_mallocN(sizeof(*mr->loop_normals) * mr->loop_len, __func__);
+      mr->loop_normals = BLI_scratch_alloc_array(
+          (size_t)mr->loop_len, sizeof(*mr->loop_normals), __func__);
       short(*clnors)[2] = CustomData_get_layer(&mr->me->ldata, CD_CUSTOMLOOPNORMAL);
       BKE_mesh_normals_loop_split(mr->me->mvert,
                                   mr->vert_len,
@@ -236,7 +247,8 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
                                   NULL);
     }
     if ((iter_type & MR_ITER_LOOPTRI) || (data_flag & MR_DATA_LOOPTRI)) {
-      mr->mlooptri = MEM_mallocN(sizeof(*mr->mlooptri) * mr->tri_len, "MR_DATATYPE_LOOPTRI");
+      mr->mlooptri = BLI_scratch_alloc_array(
+          (size_t)mr->tri_len, sizeof(*mr->mlooptri), "MR_DATATYPE_LOOPTRI");
       BKE_mesh_recalc_looptri(mr->me->mloop,
                               mr->me->mpoly,
                               mr->me->mvert,
@@ -293,7 +305,8 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
       /* Use bmface->no instead. */
     }
     if (((data_flag & MR_DATA_LOOP_NOR) && is_auto_smooth) || (data_flag & MR_DATA_TAN_LOOP_NOR)) {
-      mr->loop_normals = MEM_mallocN(sizeof(*mr->loop_normals) * mr->loop_len, __func__);
+      mr->loop_normals = BLI_scratch_alloc_array(
+          (size_t)mr->loop_len, sizeof(*mr->loop_normals), __func__);
       int clnors_offset = CustomData_get_offset(&mr->bm->ldata, CD_CUSTOMLOOPNORMAL);
       BM_loops_calc_normal_vcos(mr->bm,
                                 NULL,
@@ -347,14 +360,20 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
 
 static void mesh_render_data_free(MeshRenderData *mr)
 {
-  MEM_SAFE_FREE(mr->mlooptri);
-  MEM_SAFE_FREE(mr->poly_normals);
-  MEM_SAFE_FREE(mr->loop_normals);
-
   MEM_SAFE_FREE(mr->lverts);
   MEM_SAFE_FREE(mr->ledges);
 
-  MEM_freeN(mr);
+  /* Free scratch memory in reverse order of allocation. */
+  if (mr->mlooptri) {
+    BLI_scratch_free(mr->mlooptri);
+  }
+  if (mr->loop_normals) {
+    BLI_scratch_free(mr->loop_normals);
+  }
+  if (mr->poly_normals) {
+    BLI_scratch_free(mr->poly_normals);
+  }
+  BLI_scratch_free(mr);
 }
 
 BLI_INLINE BMFace *bm_original_face_get(const MeshRenderData *mr, int idx)
@@ -440,11 +459,11 @@ typedef struct MeshExtract_Tri_Data {
 
 static void *extract_tris_init(const MeshRenderData *mr, void *UNUSED(ibo))
 {
-  MeshExtract_Tri_Data *data = MEM_callocN(sizeof(*data), __func__);
+  MeshExtract_Tri_Data *data = BLI_scratch_calloc(sizeof(*data), __func__);
 
   size_t mat_tri_idx_size = sizeof(int) * mr->mat_len;
-  data->tri_mat_start = MEM_callocN(mat_tri_idx_size, __func__);
-  data->tri_mat_end = MEM_callocN(mat_tri_idx_size, __func__);
+  data->tri_mat_start = BLI_scratch_calloc(mat_tri_idx_size, __func__);
+  data->tri_mat_end = BLI_scratch_calloc(mat_tri_idx_size, __func__);
 
   int *mat_tri_len = data->tri_mat_start;
   /* Count how many triangle for each material. */
@@ -532,9 +551,9 @@ static void extract_tris_finish(const MeshRenderData *mr, void *ibo, void *_data
       GPU_batch_elembuf_set(mr->cache->surface_per_mat[i], sub_ibo, true);
     }
   }
-  MEM_freeN(data->tri_mat_start);
-  MEM_freeN(data->tri_mat_end);
-  MEM_freeN(data);
+  BLI_scratch_free(data->tri_mat_end);
+  BLI_scratch_free(data->tri_mat_start);
+  BLI_scratch_free(data);
 }
 
 static const MeshExtract extract_tris = {
@@ -560,7 +579,7 @@ static const MeshExtract extract_tris = {
 
 static void *extract_lines_init(const MeshRenderData *mr, void *UNUSED(buf))
 {
-  GPUIndexBufBuilder *elb = MEM_mallocN(sizeof(*elb), __func__);
+  GPUIndexBufBuilder *elb = BLI_scratch_alloc(sizeof(*elb), __func__);
   /* Put loose edges at the end. */
   GPU_indexbuf_init(
       elb, GPU_PRIM_LINES, mr->edge_len + mr->edge_loose_len, mr->loop_len + mr->loop_loose_len);
@@ -637,7 +656,7 @@ static void extract_lines_ledge_mesh(const MeshRenderData *mr,
 static void extract_lines_finish(const MeshRenderData *UNUSED(mr), void *ibo, void *elb)
 {
   GPU_indexbuf_build_in_place(elb, ibo);
-  MEM_freeN(elb);
+  BLI_scratch_free(elb);
 }
 
 static const MeshExtract extract_lines = {
@@ -713,7 +732,7 @@ static const MeshExtract extract_lines_loose = {
 
 static void *extract_points_init(const MeshRenderData *mr, void *UNUSED(buf))
 {
-  GPUIndexBufBuilder *elb = MEM_mallocN(sizeof(*elb), __func__);
+  GPUIndexBufBuilder *elb = BLI_scratch_alloc(sizeof(*elb), __func__);
   GPU_indexbuf_init(elb, GPU_PRIM_POINTS, mr->vert_len, mr->loop_len + mr->loop_loose_len);
   return elb;
 }
@@ -794,7 +813,7 @@ static void extract_points_lvert_mesh(const MeshRenderData *mr,
 static void extract_points_finish(const MeshRenderData *UNUSED(mr), void *ibo, void *elb)
 {
   GPU_indexbuf_build_in_place(elb, ibo);
-  MEM_freeN(elb);
+  BLI_scratch_free(elb);
 }
 
 static const MeshExtract extract_points = {
@@ -820,7 +839,7 @@ static const MeshExtract extract_points = {
 
 static void *extract_fdots_init(const MeshRenderData *mr, void *UNUSED(buf))
 {
-  GPUIndexBufBuilder *elb = MEM_mallocN(sizeof(*elb), __func__);
+  GPUIndexBufBuilder *elb = BLI_scratch_alloc(sizeof(*elb), __func__);
   GPU_indexbuf_init(elb, GPU_PRIM_POINTS, mr->poly_len, mr->poly_len);
   return elb;
 }
@@ -859,7 +878,7 @@ static void extract_fdots_loop_mesh(const MeshRenderData *mr,
 static void extract_fdots_finish(const MeshRenderData *UNUSED(mr), void *ibo, void *elb)
 {
   GPU_indexbuf_build_in_place(elb, ibo);
-  MEM_freeN(elb);
+  BLI_scratch_free(elb);
 }
 
 static const MeshExtract extract_fdots = {
@@ -1434,7 +1453,7 @@ static void *extract_pos_nor_init(const MeshRenderData *mr, void *buf)
 
   /* Pack normals per vert, reduce amount of computation. */
   size_t packed_nor_len = sizeof(GPUPackedNormal) * mr->vert_len;
-  MeshExtract_PosNor_Data *data = MEM_mallocN(sizeof(*data) + packed_nor_len, __func__);
+  MeshExtract_PosNor_Data *data = BLI_scratch_alloc(sizeof(*data) + packed_nor_len, __func__);
   data->vbo_data = (PosNorLoop *)vbo->data;
 
   /* Quicker than doing it for each loop. */
@@ -1476,7 +1495,7 @@ static void extract_pos_nor_loop_mesh(const MeshRenderData *mr,
   MeshExtract_PosNor_Data *data = _data;
   PosNorLoop *vert = data->vbo_data + l;
   const MVert *mvert = &mr->mvert[mloop->v];
-  copy_v3_v3(vert->pos, mvert->co);
+  copy_v3_v3(vert->pos, mr_vert_co(mr, mloop->v));
   vert->nor = data->packed_nor[mloop->v];
   /* Flag for paint mode overlay. */
   if (mvert->flag & ME_HIDE) {
@@ -1509,8 +1528,8 @@ static void extract_pos_nor_ledge_mesh(const MeshRenderData *mr,
   int l = mr->loop_len + e * 2;
   MeshExtract_PosNor_Data *data = _data;
   PosNorLoop *vert = data->vbo_data + l;
-  copy_v3_v3(vert[0].pos, mr->mvert[medge->v1].co);
-  copy_v3_v3(vert[1].pos, mr->mvert[medge->v2].co);
+  copy_v3_v3(vert[0].pos, mr_vert_co(mr, medge->v1));
+  copy_v3_v3(vert[1].pos, mr_vert_co(mr, medge->v2));
   vert[0].nor = data->packed_nor[medge->v1];
   vert[1].nor = data->packed_nor[medge->v2];
 }
@@ -1526,20 +1545,20 @@ static void extract_pos_nor_lvert_bmesh(const MeshRenderData *mr, int v, BMVert
 
 static void extract_pos_nor_lvert_mesh(const MeshRenderData *mr,
                                        int v,
-                                       const MVert *mvert,
+                                       const MVert *UNUSED(mvert),
                                        void *_data)
 {
   int l = mr->loop_len + mr->edge_loose_len * 2 + v;
   int v_idx = mr->lverts[v];
   MeshExtract_PosNor_Data *data = _data;
   PosNorLoop *vert = data->vbo_data + l;
-  copy_v3_v3(vert->pos, mvert->co);
+  copy_v3_v3(vert->pos, mr_vert_co(mr, v_idx));
   vert->nor = data->packed_nor[v_idx];
 }
 
 static void extract_pos_nor_finish(const MeshRenderData *UNUSED(mr), void *UNUSED(vbo), void *data)
 {
-  MEM_freeN(data);
+  BLI_scratch_free(data);
 }
 
 static const MeshExtract extract_pos_nor = {
@@ -2749,7 +2768,7 @@ BLI_INLINE float area_ratio_to_stretch(float ratio, float tot_ratio, float inv_t
 static void mesh_stretch_area_finish(const MeshRenderData *mr, void *buf, void *UNUSED(data))
 {
   float tot_area = 0.0f, tot_uv_area = 0.0f;
-  float *area_ratio = MEM_mallocN(sizeof(float) * mr->poly_len, __func__);
+  float *area_ratio = BLI_scratch_alloc_array((size_t)mr->poly_len, sizeof(float), __func__);
 
   if (mr->extract_type == MR_EXTRACT_BMESH) {
     CustomData *cd_ldata = &mr->bm->ldata;
@@ -2818,7 +2837,7 @@ static void mesh_stretch_area_finish(const MeshRenderData *mr, void *buf, void *
     BLI_assert(0);
   }
 
-  MEM_freeN(area_ratio);
+  BLI_scratch_free(area_ratio);
 }
 
 static const MeshExtract extract_stretch_area = {
@@ -3222,9 +3241,9 @@ static void statvis_calc_thickness(const MeshRenderData *mr, float *r_thickness)
     const MLoopTri *mlooptri = mr->mlooptri;
     for (int i = 0; i < mr->tri_len; i++, mlooptri++) {
       const int index = mlooptri->poly;
-      const float *cos[3] = {mr->mvert[mr->mloop[mlooptri->tri[0]].v].co,
-                             mr->mvert[mr->mloop[mlooptri->tri[1]].v].co,
-                             mr->mvert[mr->mloop[mlooptri->tri[2]].v].co};
+      const float *cos[3] = {mr_vert_co(mr, mr->mloop[mlooptri->tri[0]].v),
+                             mr_vert_co(mr, mr->mloop[mlooptri->tri[1]].v),
+                             mr_vert_co(mr, mr->mloop[mlooptri->tri[2]].v)};
       float ray_co[3];
       float ray_no[3];
 
@@ -3438,9 +3457,9 @@ static void statvis_calc_distort(const MeshRenderData *mr, float *r_distort)
           const MLoop *l_next = &mr->mloop[mpoly->loopstart + (i + 1) % mpoly->totloop];
           float no_corner[3];
           normal_tri_v3(no_corner,
-                        mr->mvert[l_prev->v].co,
-                        mr->mvert[l_curr->v].co,
-                        mr->mvert[l_next->v].co);
+                        mr_vert_co(mr, l_prev->v),
+                        mr_vert_co(mr, l_curr->v),
+                        mr_vert_co(mr, l_next->v));
           /* simple way to detect (what is most likely) concave */
           if (dot_v3v3(f_no, no_corner) < 0.0f) {
             negate_v3(no_corner);
@@ -3481,7 +3500,7 @@ static void statvis_calc_sharp(const MeshRenderData *mr, float *r_sharp)
   const float minmax_irange = 1.0f / (max - min);
 
   /* Can we avoid this extra allocation? */
-  float *vert_angles = MEM_mallocN(sizeof(float) * mr->vert_len, __func__);
+  float *vert_angles = BLI_scratch_alloc_array((size_t)mr->vert_len, sizeof(float), __func__);
   copy_vn_fl(vert_angles, mr->vert_len, -M_PI);
 
   if (mr->extract_type == MR_EXTRACT_BMESH) {
@@ -3567,7 +3586,7 @@ static void statvis_calc_sharp(const MeshRenderData *mr, float *r_sharp)
     }
   }
 
-  MEM_freeN(vert_angles);
+  BLI_scratch_free(vert_angles);
 }
 
 static void extract_mesh_analysis_finish(const MeshRenderData *mr, void *buf, void *UNUSED(data))
@@ -3661,7 +3680,7 @@ static void extract_fdots_pos_loop_mesh(const MeshRenderData *mr,
   }
   else {
     float w = 1.0f / (float)mpoly->totloop;
-    madd_v3_v3fl(center[p], mvert->co, w);
+    madd_v3_v3fl(center[p], mr_vert_co(mr, mloop->v), w);
   }
 }
 
@@ -4359,6 +4378,18 @@ static void extract_task_create(TaskPool *task_pool,
   }
 }
 
+/* Temporary data of the extraction, reused for every mesh.
+ * Drawing is serialized by the draw manager, so a single arena is enough. */
+static ScratchArena *extract_scratch_arena = NULL;
+
+void DRW_mesh_batch_cache_free_scratch(void)
+{
+  if (extract_scratch_arena) {
+    BLI_scratch_arena_free(extract_scratch_arena);
+    extract_scratch_arena = NULL;
+  }
+}
+
 void mesh_buffer_cache_create_requested(MeshBatchCache *cache,
                                         MeshBufferCache mbc,
                                         Mesh *me,
@@ -4421,6 +4452,11 @@ void mesh_buffer_cache_create_requested(MeshBatchCache *cache,
   double rdata_start = PIL_check_seconds_timer();
 #endif
 
+  if (extract_scratch_arena == NULL) {
+    extract_scratch_arena = BLI_scratch_arena_new("Mesh extract scratch_arena");
+  }
+  ScratchArena *scratch_arena_prev = BLI_scratch_arena_bind(extract_scratch_arena);
+
   MeshRenderData *mr = mesh_render_data_create(
       me, do_final, do_uvedit, iter_flag, data_flag, cd_layer_used, ts);
   mr->cache = cache; /* HACK */
@@ -4503,6 +4539,9 @@ void mesh_buffer_cache_create_requested(MeshBatchCache *cache,
 
   mesh_render_data_free(mr);
 
+  BLI_scratch_arena_bind(scratch_arena_prev);
+  BLI_scratch_arena_reset(extract_scratch_arena);
+
 #ifdef DEBUG_TIME
   double end = PIL_check_seconds_timer();
 
@@ -65,6 +65,7 @@ void DRW_gpencil_batch_cache_free(struct bGPdata *gpd);
 void DRW_batch_cache_free_old(struct Object *ob, int ctime);
 
 void DRW_mesh_batch_cache_free_old(struct Mesh *me, int ctime);
+void DRW_mesh_batch_cache_free_scratch(void);
 
 /* Curve */
 void DRW_curve_batch_cache_create_requested(struct Object *ob);
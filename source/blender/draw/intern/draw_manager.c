@@ -2821,6 +2821,7 @@ void DRW_engines_free(void)
 
   DRW_hair_free();
   DRW_shape_cache_free();
+  DRW_mesh_batch_cache_free_scratch();
   DRW_stats_free();
   DRW_globals_free();
 
@@ -1075,7 +1075,7 @@ static void mesh_remove_verts(Mesh *mesh, int len)
     return;
   }
   const int totvert = mesh->totvert - len;
-  CustomData_free_elem(&mesh->vdata, totvert, len);
+  CustomData_free_elem(&mesh->vdata, totvert, len, mesh->totvert);
   mesh->totvert = totvert;
 }
 
@@ -1085,7 +1085,7 @@ static void mesh_remove_edges(Mesh *mesh, int len)
     return;
   }
   const int totedge = mesh->totedge - len;
-  CustomData_free_elem(&mesh->edata, totedge, len);
+  CustomData_free_elem(&mesh->edata, totedge, len, mesh->totedge);
   mesh->totedge = totedge;
 }
 
@@ -1095,7 +1095,7 @@ static void mesh_remove_loops(Mesh *mesh, int len)
     return;
   }
   const int totloop = mesh->totloop - len;
-  CustomData_free_elem(&mesh->ldata, totloop, len);
+  CustomData_free_elem(&mesh->ldata, totloop, len, mesh->totloop);
   mesh->totloop = totloop;
 }
 
@@ -1105,7 +1105,7 @@ static void mesh_remove_polys(Mesh *mesh, int len)
     return;
   }
   const int totpoly = mesh->totpoly - len;
-  CustomData_free_elem(&mesh->pdata, totpoly, len);
+  CustomData_free_elem(&mesh->pdata, totpoly, len, mesh->totpoly);
   mesh->totpoly = totpoly;
 }
 
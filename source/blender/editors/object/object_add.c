@@ -489,7 +489,7 @@ Object *ED_object_add_type(bContext *C,
    * use DEG_id_tag_update here perhaps.
    */
   DEG_id_type_tag(bmain, ID_OB);
-  DEG_relations_tag_update(bmain);
+  DEG_id_tag_relations_update(bmain, &ob->id);
   if (ob->data != NULL) {
     DEG_id_tag_update_ex(bmain, (ID *)ob->data, ID_RECALC_EDITORS);
   }
@@ -446,13 +446,19 @@ static void create_ghost_curves(bAnimContext *ac, int start, int end)
     gcu->fpt = fpt = MEM_callocN(sizeof(FPoint) * (end - start + 1), "Ghost FPoint Samples");
     gcu->totvert = end - start + 1;
 
-    /* use the sampling callback at 1-frame intervals from start to end frames */
-    for (cfra = start; cfra <= end; cfra++, fpt++) {
-      float cfrae = BKE_nla_tweakedit_remap(adt, cfra, NLATIME_CONVERT_UNMAP);
-
-      fpt->vec[0] = cfrae;
-      fpt->vec[1] = (fcurve_samplingcb_evalcurve(fcu, NULL, cfrae) + offset) * unitFac;
+    /* sample the curve at 1-frame intervals from start to end frames */
+    float *evaltimes = MEM_malloc_arrayN(gcu->totvert, sizeof(float), "Ghost Sample Times");
+    float *values = MEM_malloc_arrayN(gcu->totvert, sizeof(float), "Ghost Sample Values");
+    for (cfra = start; cfra <= end; cfra++) {
+      evaltimes[cfra - start] = BKE_nla_tweakedit_remap(adt, cfra, NLATIME_CONVERT_UNMAP);
+    }
+    BKE_fcurve_evaluate_samples(fcu, evaltimes, values, gcu->totvert);
+    for (int i = 0; i < gcu->totvert; i++, fpt++) {
+      fpt->vec[0] = evaltimes[i];
+      fpt->vec[1] = (values[i] + offset) * unitFac;
     }
+    MEM_freeN(evaltimes);
+    MEM_freeN(values);
 
     /* set color of ghost curve
      * - make the color slightly darker
@@ -1079,6 +1079,8 @@ typedef struct AnimData {
 
   /** Runtime data, for depsgraph evaluation. */
   FCurve **driver_array;
+  /** Runtime data, resolved RNA paths of the animated properties, for depsgraph evaluation. */
+  struct AnimEvalPathCache *path_cache;
 
   /* settings for animation evaluation */
   /** User-defined settings. */
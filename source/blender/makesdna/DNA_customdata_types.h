@@ -54,6 +54,11 @@ typedef struct CustomDataLayer {
   char name[64];
   /** Layer data. */
   void *data;
+  /**
+   * Runtime only, shared ownership of the layer data with copies made with #CD_SHARE
+   * (evaluated data only, never set for original data). The data is freed by the last user.
+   */
+  struct CustomDataSharing *sharing;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
@@ -76,8 +81,7 @@ typedef struct CustomData {
    * MUST be >= CD_NUMTYPES, but we cant use a define here.
    * Correct size is ensured in CustomData_update_typemap assert().
    */
-  int typemap[42];
-  char _pad0[4];
+  int typemap[43];
   /** Number of layers, size of layers array. */
   int totlayer, maxlayer;
   /** In editmode, total size of all data layers. */
@@ -146,8 +150,10 @@ typedef enum CustomDataType {
   CD_MLOOPTANGENT = 39,
   CD_TESSLOOPNORMAL = 40,
   CD_CUSTOMLOOPNORMAL = 41,
+  /** Vertex positions stored as a separate float array, see #BKE_mesh_vert_positions. */
+  CD_POSITION = 42,
 
-  CD_NUMTYPES = 42,
+  CD_NUMTYPES = 43,
 } CustomDataType;
 
 /* Bits for CustomDataMask */
@@ -195,6 +201,7 @@ typedef enum CustomDataType {
 #define CD_MASK_MLOOPTANGENT (1LL << CD_MLOOPTANGENT)
 #define CD_MASK_TESSLOOPNORMAL (1LL << CD_TESSLOOPNORMAL)
 #define CD_MASK_CUSTOMLOOPNORMAL (1LL << CD_CUSTOMLOOPNORMAL)
+#define CD_MASK_POSITION (1LL << CD_POSITION)
 
 /** Data types that may be defined for all mesh elements types. */
 #define CD_MASK_GENERIC_DATA (CD_MASK_PROP_FLT | CD_MASK_PROP_INT | CD_MASK_PROP_STR)
@@ -94,9 +94,19 @@ int DNA_struct_find_nr_ex(const struct SDNA *sdna, const char *str, unsigned int
 int DNA_struct_find_nr(const struct SDNA *sdna, const char *str);
 void DNA_struct_switch_endian(const struct SDNA *oldsdna, int oldSDNAnr, char *data);
 const char *DNA_struct_get_compareflags(const struct SDNA *sdna, const struct SDNA *newsdna);
-void *DNA_struct_reconstruct(const struct SDNA *newsdna,
-                             const struct SDNA *oldsdna,
-                             const char *compflags,
+
+typedef struct DNA_ReconstructInfo DNA_ReconstructInfo;
+
+DNA_ReconstructInfo *DNA_reconstruct_info_create(const struct SDNA *oldsdna,
+                                                 const struct SDNA *newsdna,
+                                                 const char *compare_flags,
+                                                 const bool do_endian_swap);
+void DNA_reconstruct_info_free(DNA_ReconstructInfo *reconstruct_info);
+void DNA_struct_switch_endian_blocks(const DNA_ReconstructInfo *reconstruct_info,
+                                     int oldSDNAnr,
+                                     int blocks,
+                                     void *data);
+void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
                              int oldSDNAnr,
                              int blocks,
                              const void *data);
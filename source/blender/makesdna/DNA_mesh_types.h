@@ -105,6 +105,12 @@ typedef struct Mesh_Runtime {
   /** Non-manifold boundary data for Shrinkwrap Target Project. */
   struct ShrinkwrapBoundaryData *shrinkwrap_data;
 
+  /** Maps between elements, shared by evaluated copies, see 'mesh_runtime.c'. */
+  struct MeshTopologyCache *topology_cache;
+
+  /** Deform weights packed per vertex, for armature deform, see 'mesh_runtime.c'. */
+  struct MeshVertexWeights *vertex_weights;
+
   /** Set by modifier stack if only deformed from original. */
   char deformed_only;
   /**
@@ -603,8 +603,9 @@ typedef struct UserDef_FileSpaceData {
 typedef struct UserDef_Experimental {
   char use_tool_fallback;
   char use_usd_exporter;
+  char use_soa_positions;
 
-  char _pad0[6];
+  char _pad0[5];
 } UserDef_Experimental;
 
 #define USER_EXPERIMENTAL_TEST(userdef, member) \
@@ -41,6 +41,8 @@
 
 #include "BLI_ghash.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_genfile.h"
 #include "DNA_sdna_types.h"  // for SDNA ;-)
 
@@ -795,102 +797,98 @@ static eSDNA_Type sdna_type_nr(const char *dna_type)
 }
 
 /**
- * Converts a value of one primitive type to another.
- * Note there is no optimization for the case where otype and ctype are the same:
+ * Converts values of one primitive type to another.
+ * Note there is no optimization for the case where old_type and new_type are the same:
  * assumption is that caller will handle this case.
  *
- * \param ctype: Name of type to convert to
- * \param otype: Name of type to convert from
- * \param name_array_len: Result of #DNA_elem_array_size for this element.
- * \param curdata: Where to put converted data
- * \param olddata: Data of type otype to convert
+ * \param old_type: Type to convert from.
+ * \param new_type: Type to convert to.
+ * \param array_len: Number of elements to convert.
+ * \param old_data: Data of type old_type to convert.
+ * \param new_data: Where to put converted data.
  */
-static void cast_elem(
-    const char *ctype, const char *otype, int name_array_len, char *curdata, const char *olddata)
+static void cast_primitive_type(const eSDNA_Type old_type,
+                                const eSDNA_Type new_type,
+                                int array_len,
+                                const char *old_data,
+                                char *new_data)
 {
-  double val = 0.0;
-  int curlen = 1, oldlen = 1;
-
-  eSDNA_Type ctypenr, otypenr;
-
-  if ((otypenr = sdna_type_nr(otype)) == -1 || (ctypenr = sdna_type_nr(ctype)) == -1) {
-    return;
-  }
-
   /* define lengths */
-  oldlen = DNA_elem_type_size(otypenr);
-  curlen = DNA_elem_type_size(ctypenr);
+  const int oldlen = DNA_elem_type_size(old_type);
+  const int curlen = DNA_elem_type_size(new_type);
 
-  while (name_array_len > 0) {
-    switch (otypenr) {
+  double val = 0.0;
+
+  while (array_len > 0) {
+    switch (old_type) {
       case SDNA_TYPE_CHAR:
-        val = *olddata;
+        val = *old_data;
         break;
       case SDNA_TYPE_UCHAR:
-        val = *((unsigned char *)olddata);
+        val = *((unsigned char *)old_data);
         break;
       case SDNA_TYPE_SHORT:
-        val = *((short *)olddata);
+        val = *((short *)old_data);
         break;
       case SDNA_TYPE_USHORT:
-        val = *((unsigned short *)olddata);
+        val = *((unsigned short *)old_data);
         break;
       case SDNA_TYPE_INT:
-        val = *((int *)olddata);
+        val = *((int *)old_data);
         break;
       case SDNA_TYPE_FLOAT:
-        val = *((float *)olddata);
+        val = *((float *)old_data);
         break;
       case SDNA_TYPE_DOUBLE:
-        val = *((double *)olddata);
+        val = *((double *)old_data);
         break;
       case SDNA_TYPE_INT64:
-        val = *((int64_t *)olddata);
+        val = *((int64_t *)old_data);
         break;
       case SDNA_TYPE_UINT64:
-        val = *((uint64_t *)olddata);
+        val = *((uint64_t *)old_data);
         break;
     }
 
-    switch (ctypenr) {
+    switch (new_type) {
       case SDNA_TYPE_CHAR:
-        *curdata = val;
+        *new_data = val;
         break;
       case SDNA_TYPE_UCHAR:
-        *((unsigned char *)curdata) = val;
+        *((unsigned char *)new_data) = val;
         break;
       case SDNA_TYPE_SHORT:
-        *((short *)curdata) = val;
+        *((short *)new_data) = val;
         break;
       case SDNA_TYPE_USHORT:
-        *((unsigned short *)curdata) = val;
+        *((unsigned short *)new_data) = val;
         break;
       case SDNA_TYPE_INT:
-        *((int *)curdata) = val;
+        *((int *)new_data) = val;
         break;
       case SDNA_TYPE_FLOAT:
-        if (otypenr < 2) {
+        if (old_type < 2) {
           val /= 255;
         }
-        *((float *)curdata) = val;
+        *((float *)new_data) = val;
         break;
       case SDNA_TYPE_DOUBLE:
-        if (otypenr < 2) {
+        if (old_type < 2) {
           val /= 255;
         }
-        *((double *)curdata) = val;
+        *((double *)new_data) = val;
         break;
       case SDNA_TYPE_INT64:
-        *((int64_t *)curdata) = val;
+        *((int64_t *)new_data) = val;
         break;
       case SDNA_TYPE_UINT64:
-        *((uint64_t *)curdata) = val;
+        *((uint64_t *)new_data) = val;
         break;
     }
 
-    olddata += oldlen;
-    curdata += curlen;
-    name_array_len--;
+    old_data += oldlen;
+    new_data += curlen;
+    array_len--;
   }
 }
 
@@ -898,42 +896,31 @@ static void cast_elem(
  * Converts pointer values between different sizes. These are only used
  * as lookup keys to identify data blocks in the saved .blend file, not
  * as actual in-memory pointers.
- *
- * \param curlen: Pointer length to convert to
- * \param oldlen: Length of pointers in olddata
- * \param name_array_len: Result of #DNA_elem_array_size for this element.
- * \param curdata: Where to put converted data
- * \param olddata: Data to convert
  */
-static void cast_pointer(
-    int curlen, int oldlen, int name_array_len, char *curdata, const char *olddata)
+static void cast_pointer_32_to_64(int array_len, const char *old_data, char *new_data)
 {
-  int64_t lval;
+  while (array_len > 0) {
+    *((int64_t *)new_data) = *((int *)old_data);
 
-  while (name_array_len > 0) {
+    old_data += 4;
+    new_data += 8;
+    array_len--;
+  }
+}
 
-    if (curlen == oldlen) {
-      memcpy(curdata, olddata, curlen);
-    }
-    else if (curlen == 4 && oldlen == 8) {
-      lval = *((int64_t *)olddata);
+static void cast_pointer_64_to_32(int array_len, const char *old_data, char *new_data)
+{
+  while (array_len > 0) {
+    const int64_t lval = *((int64_t *)old_data);
 
-      /* WARNING: 32-bit Blender trying to load file saved by 64-bit Blender,
-       * pointers may lose uniqueness on truncation! (Hopefully this wont
-       * happen unless/until we ever get to multi-gigabyte .blend files...) */
-      *((int *)curdata) = lval >> 3;
-    }
-    else if (curlen == 8 && oldlen == 4) {
-      *((int64_t *)curdata) = *((int *)olddata);
-    }
-    else {
-      /* for debug */
-      printf("errpr: illegal pointersize!\n");
-    }
+    /* WARNING: 32-bit Blender trying to load file saved by 64-bit Blender,
+     * pointers may lose uniqueness on truncation! (Hopefully this wont
+     * happen unless/until we ever get to multi-gigabyte .blend files...) */
+    *((int *)new_data) = lval >> 3;
 
-    olddata += oldlen;
-    curdata += curlen;
-    name_array_len--;
+    old_data += 8;
+    new_data += 4;
+    array_len--;
   }
 }
 
@@ -1023,31 +1010,26 @@ static bool elem_exists_alias(const SDNA *sdna,
 }
 
 /**
- * Returns the address of the data for the specified field within olddata
- * according to the struct format pointed to by old, or NULL if no such
+ * Returns the offset of the data for the specified field
+ * according to the struct format pointed to by old, or -1 if no such
  * field can be found.
  *
- * Passing olddata=NULL doesn't work reliably for existence checks; it will
- * return NULL both when the field is found at offset 0 and when it is not
- * found at all. For field existence checks, use #elem_exists() instead.
- *
  * \param sdna: Old SDNA
  * \param type: Current field type name
  * \param name: Current field name
  * \param old: Pointer to struct information in sdna
- * \param olddata: Struct data
  * \param sppo: Optional place to return pointer to field info in sdna
- * \return Data address.
+ * \return Data offset.
  */
-static const char *find_elem(const SDNA *sdna,
-                             const char *type,
-                             const char *name,
-                             const short *old,
-                             const char *olddata,
-                             const short **sppo)
+static int find_elem_offset(const SDNA *sdna,
+                            const char *type,
+                            const char *name,
+                            const short *old,
+                            const short **sppo)
 {
   int a, elemcount, len;
   const char *otype, *oname;
+  int offset = 0;
 
   /* without arraypart, so names can differ: return old namenr and type */
 
@@ -1066,36 +1048,201 @@ static const char *find_elem(const SDNA *sdna,
         if (sppo) {
           *sppo = old;
         }
-        return olddata;
+        return offset;
       }
 
-      return NULL;
+      return -1;
     }
 
-    olddata += len;
+    offset += len;
   }
-  return NULL;
+  return -1;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Struct Reconstruction
+ *
+ * Converting struct data saved with an older SDNA is done using a plan that is compiled once
+ * for every struct of the old SDNA that's converted, so member names don't have to be looked up
+ * for every block that's read. Plans are executed over all blocks of an array at once,
+ * contiguous members that only need to be copied are merged into a single `memcpy`.
+ * \{ */
+
+typedef enum eReconstructStepType {
+  RECONSTRUCT_STEP_MEMCPY = 0,
+  RECONSTRUCT_STEP_CAST_PRIMITIVE,
+  RECONSTRUCT_STEP_CAST_POINTER_TO_32,
+  RECONSTRUCT_STEP_CAST_POINTER_TO_64,
+  /** Null-terminate a string that had to be truncated. */
+  RECONSTRUCT_STEP_TERMINATE_STRING,
+  RECONSTRUCT_STEP_SUBSTRUCT,
+} eReconstructStepType;
+
+typedef struct ReconstructStep {
+  eReconstructStepType type;
+  int old_offset;
+  int new_offset;
+  /** Size in bytes for #RECONSTRUCT_STEP_MEMCPY, otherwise the number of array elements. */
+  int len;
+  union {
+    struct {
+      eSDNA_Type old_type, new_type;
+    } cast_primitive;
+    struct {
+      /** Index of the struct in the old SDNA, it's plan is used to convert the elements. */
+      int old_struct_nr;
+    } substruct;
+  } data;
+} ReconstructStep;
+
+typedef enum eEndianSwapStepType {
+  ENDIAN_SWAP_STEP_INT16 = 0,
+  ENDIAN_SWAP_STEP_INT32,
+  ENDIAN_SWAP_STEP_INT64,
+  ENDIAN_SWAP_STEP_SUBSTRUCT,
+} eEndianSwapStepType;
+
+typedef struct EndianSwapStep {
+  eEndianSwapStepType type;
+  int offset;
+  /** Number of array elements. */
+  int len;
+  /** Index of the struct in the old SDNA, for #ENDIAN_SWAP_STEP_SUBSTRUCT. */
+  int struct_nr;
+} EndianSwapStep;
+
+/**
+ * Conversion plan for a single struct of the old SDNA.
+ */
+typedef struct ReconstructPlan {
+  /** Index of the struct in the new SDNA, -1 when it doesn't exist anymore. */
+  int new_struct_nr;
+  int old_size, new_size;
+
+  ReconstructStep *steps;
+  int steps_len;
+
+  /** Only set when created for files that need their endian switched. */
+  EndianSwapStep *endian_steps;
+  int endian_steps_len;
+} ReconstructPlan;
+
+struct DNA_ReconstructInfo {
+  const SDNA *oldsdna;
+  const SDNA *newsdna;
+  /** Result of #DNA_struct_get_compareflags (borrowed). */
+  const char *compare_flags;
+  bool do_endian_swap;
+
+  /**
+   * Aligned with the structs of the old SDNA, plans are compiled as they're first needed
+   * (most structs never need converting), see #reconstruct_plan_ensure.
+   */
+  ReconstructPlan **plans;
+};
+
+static void reconstruct_step_add_memcpy(
+    ReconstructStep *steps, int *steps_len, int old_offset, int new_offset, int size)
+{
+  /* Extend the previous step when it copies the data right in front of this. */
+  if (*steps_len != 0) {
+    ReconstructStep *step_prev = &steps[*steps_len - 1];
+    if ((step_prev->type == RECONSTRUCT_STEP_MEMCPY) &&
+        (step_prev->old_offset + step_prev->len == old_offset) &&
+        (step_prev->new_offset + step_prev->len == new_offset)) {
+      step_prev->len += size;
+      return;
+    }
+  }
+
+  ReconstructStep *step = &steps[(*steps_len)++];
+  step->type = RECONSTRUCT_STEP_MEMCPY;
+  step->old_offset = old_offset;
+  step->new_offset = new_offset;
+  step->len = size;
+}
+
+static ReconstructStep *reconstruct_step_add(ReconstructStep *steps,
+                                             int *steps_len,
+                                             eReconstructStepType type,
+                                             int old_offset,
+                                             int new_offset,
+                                             int len)
+{
+  ReconstructStep *step = &steps[(*steps_len)++];
+  step->type = type;
+  step->old_offset = old_offset;
+  step->new_offset = new_offset;
+  step->len = len;
+  return step;
+}
+
+static void reconstruct_pointer_compile(const SDNA *newsdna,
+                                        const SDNA *oldsdna,
+                                        int array_len,
+                                        int old_offset,
+                                        int new_offset,
+                                        ReconstructStep *steps,
+                                        int *steps_len)
+{
+  if (newsdna->pointer_size == oldsdna->pointer_size) {
+    reconstruct_step_add_memcpy(
+        steps, steps_len, old_offset, new_offset, array_len * newsdna->pointer_size);
+  }
+  else if (newsdna->pointer_size == 4 && oldsdna->pointer_size == 8) {
+    reconstruct_step_add(
+        steps, steps_len, RECONSTRUCT_STEP_CAST_POINTER_TO_32, old_offset, new_offset, array_len);
+  }
+  else if (newsdna->pointer_size == 8 && oldsdna->pointer_size == 4) {
+    reconstruct_step_add(
+        steps, steps_len, RECONSTRUCT_STEP_CAST_POINTER_TO_64, old_offset, new_offset, array_len);
+  }
+  else {
+    /* Pointer sizes are checked when reading the SDNA. */
+    BLI_assert(!"illegal pointer size");
+  }
+}
+
+static void reconstruct_cast_compile(const char *type,
+                                     const char *otype,
+                                     int array_len,
+                                     int old_offset,
+                                     int new_offset,
+                                     ReconstructStep *steps,
+                                     int *steps_len)
+{
+  const int old_type = sdna_type_nr(otype);
+  const int new_type = sdna_type_nr(type);
+
+  if (old_type == -1 || new_type == -1) {
+    return;
+  }
+
+  ReconstructStep *step = reconstruct_step_add(
+      steps, steps_len, RECONSTRUCT_STEP_CAST_PRIMITIVE, old_offset, new_offset, array_len);
+  step->data.cast_primitive.old_type = old_type;
+  step->data.cast_primitive.new_type = new_type;
 }
 
 /**
- * Converts the contents of a single field of a struct, of a non-struct type,
+ * Adds the steps to convert a single field of a struct, of a non-struct type,
  * from oldsdna to newsdna format.
  *
  * \param newsdna: SDNA of current Blender
  * \param oldsdna: SDNA of Blender that saved file
  * \param type: current field type name
  * \param new_name_nr: current field name number.
- * \param curdata: put field data converted to newsdna here
+ * \param new_offset: offset of the field in the current struct.
  * \param old: pointer to struct info in oldsdna
- * \param olddata: struct contents laid out according to oldsdna
  */
-static void reconstruct_elem(const SDNA *newsdna,
-                             const SDNA *oldsdna,
-                             const char *type,
-                             const int new_name_nr,
-                             char *curdata,
-                             const short *old,
-                             const char *olddata)
+static void reconstruct_elem_compile(const SDNA *newsdna,
+                                     const SDNA *oldsdna,
+                                     const char *type,
+                                     const int new_name_nr,
+                                     const int new_offset,
+                                     const short *old,
+                                     ReconstructStep *steps,
+                                     int *steps_len)
 {
   /* rules: test for NAME:
    *      - name equal:
@@ -1108,6 +1255,7 @@ static void reconstruct_elem(const SDNA *newsdna,
    */
   int a, elemcount, len, countpos, mul;
   const char *otype, *oname, *cp;
+  int old_offset = 0;
 
   /* is 'name' an array? */
   const char *name = newsdna->names[new_name_nr];
@@ -1131,19 +1279,18 @@ static void reconstruct_elem(const SDNA *newsdna,
     len = DNA_elem_size_nr(oldsdna, old[0], old[1]);
 
     if (strcmp(name, oname) == 0) { /* name equal */
+      const int new_name_array_len = newsdna->names_array_len[new_name_nr];
 
       if (ispointer(name)) { /* pointer of functionpointer afhandelen */
-        cast_pointer(newsdna->pointer_size,
-                     oldsdna->pointer_size,
-                     newsdna->names_array_len[new_name_nr],
-                     curdata,
-                     olddata);
+        reconstruct_pointer_compile(
+            newsdna, oldsdna, new_name_array_len, old_offset, new_offset, steps, steps_len);
       }
       else if (strcmp(type, otype) == 0) { /* type equal */
-        memcpy(curdata, olddata, len);
+        reconstruct_step_add_memcpy(steps, steps_len, old_offset, new_offset, len);
       }
       else {
-        cast_elem(type, otype, newsdna->names_array_len[new_name_nr], curdata, olddata);
+        reconstruct_cast_compile(
+            type, otype, new_name_array_len, old_offset, new_offset, steps, steps_len);
       }
 
       return;
@@ -1156,8 +1303,8 @@ static void reconstruct_elem(const SDNA *newsdna,
         const int min_name_array_len = MIN2(new_name_array_len, old_name_array_len);
 
         if (ispointer(name)) { /* handle pointer or functionpointer */
-          cast_pointer(
-              newsdna->pointer_size, oldsdna->pointer_size, min_name_array_len, curdata, olddata);
+          reconstruct_pointer_compile(
+              newsdna, oldsdna, min_name_array_len, old_offset, new_offset, steps, steps_len);
         }
         else if (strcmp(type, otype) == 0) { /* type equal */
           /* size of single old array element */
@@ -1165,139 +1312,356 @@ static void reconstruct_elem(const SDNA *newsdna,
           /* smaller of sizes of old and new arrays */
           mul *= min_name_array_len;
 
-          memcpy(curdata, olddata, mul);
+          reconstruct_step_add_memcpy(steps, steps_len, old_offset, new_offset, mul);
 
           if (old_name_array_len > new_name_array_len && strcmp(type, "char") == 0) {
             /* string had to be truncated, ensure it's still null-terminated */
-            curdata[mul - 1] = '\0';
+            reconstruct_step_add(
+                steps, steps_len, RECONSTRUCT_STEP_TERMINATE_STRING, 0, new_offset + mul - 1, 1);
           }
         }
         else {
-          cast_elem(type, otype, min_name_array_len, curdata, olddata);
+          reconstruct_cast_compile(
+              type, otype, min_name_array_len, old_offset, new_offset, steps, steps_len);
         }
         return;
       }
     }
-    olddata += len;
+    old_offset += len;
   }
 }
 
 /**
- * Converts the contents of an entire struct from oldsdna to newsdna format.
- *
- * \param newsdna: SDNA of current Blender
- * \param oldsdna: SDNA of Blender that saved file
- * \param compflags:
- *
- * Result from DNA_struct_get_compareflags to avoid needless conversions.
- * \param oldSDNAnr: Index of old struct definition in oldsdna
- * \param data: Struct contents laid out according to oldsdna
- * \param curSDNAnr: Index of current struct definition in newsdna
- * \param cur: Where to put converted struct contents
+ * Compiles the steps to convert the contents of an entire struct from oldsdna to newsdna format.
  */
-static void reconstruct_struct(const SDNA *newsdna,
-                               const SDNA *oldsdna,
-                               const char *compflags,
-
-                               int oldSDNAnr,
-                               const char *data,
-                               int curSDNAnr,
-                               char *cur)
+static void reconstruct_plan_compile(const DNA_ReconstructInfo *info,
+                                     ReconstructPlan *plan,
+                                     const int old_struct_nr)
 {
-  /* Recursive!
-   * Per element from cur_struct, read data from old_struct.
-   * If element is a struct, call recursive.
-   */
-  int a, elemcount, elen, eleno, mul, mulo, firststructtypenr;
-  const short *spo, *spc, *sppo;
-  const char *type;
-  const char *cpo;
-  char *cpc;
-  const char *name;
-
-  unsigned int oldsdna_index_last = UINT_MAX;
-  unsigned int cursdna_index_last = UINT_MAX;
-
-  if (oldSDNAnr == -1) {
-    return;
-  }
-  if (curSDNAnr == -1) {
+  const SDNA *oldsdna = info->oldsdna;
+  const SDNA *newsdna = info->newsdna;
+  const char *compare_flags = info->compare_flags;
+
+  const short *spo = oldsdna->structs[old_struct_nr];
+  plan->old_size = oldsdna->types_size[spo[0]];
+  plan->new_struct_nr = DNA_struct_find_nr(newsdna, oldsdna->types[spo[0]]);
+  if (plan->new_struct_nr == -1) {
     return;
   }
 
-  if (compflags[oldSDNAnr] == SDNA_CMP_EQUAL) {
-    /* if recursive: test for equal */
-    spo = oldsdna->structs[oldSDNAnr];
-    elen = oldsdna->types_size[spo[0]];
-    memcpy(cur, data, elen);
+  const short *spc = newsdna->structs[plan->new_struct_nr];
+  plan->new_size = newsdna->types_size[spc[0]];
 
+  if (compare_flags[old_struct_nr] == SDNA_CMP_EQUAL) {
+    plan->steps = MEM_mallocN(sizeof(*plan->steps), __func__);
+    reconstruct_step_add_memcpy(plan->steps, &plan->steps_len, 0, 0, plan->old_size);
     return;
   }
 
-  firststructtypenr = *(newsdna->structs[0]);
-
-  spo = oldsdna->structs[oldSDNAnr];
-  spc = newsdna->structs[curSDNAnr];
+  const int firststructtypenr = *(newsdna->structs[0]);
+  unsigned int oldsdna_index_last = UINT_MAX;
+  unsigned int cursdna_index_last = UINT_MAX;
 
-  elemcount = spc[1];
+  const int elemcount = spc[1];
+  /* At most two steps are needed for every field (copy & terminate a string). */
+  ReconstructStep *steps = MEM_mallocN(sizeof(*steps) * 2 * elemcount, __func__);
+  int steps_len = 0;
+  int new_offset = 0;
 
   spc += 2;
-  cpc = cur;
-  for (a = 0; a < elemcount; a++, spc += 2) { /* convert each field */
-    type = newsdna->types[spc[0]];
-    name = newsdna->names[spc[1]];
-
-    elen = DNA_elem_size_nr(newsdna, spc[0], spc[1]);
+  for (int a = 0; a < elemcount; a++, spc += 2) { /* convert each field */
+    const char *type = newsdna->types[spc[0]];
+    const char *name = newsdna->names[spc[1]];
+    const int elen = DNA_elem_size_nr(newsdna, spc[0], spc[1]);
 
     /* Skip pad bytes which must start with '_pad', see makesdna.c 'is_name_legal'.
      * for exact rules. Note that if we fail to skip a pad byte it's harmless,
      * this just avoids unnecessary reconstruction. */
     if (name[0] == '_' || (name[0] == '*' && name[1] == '_')) {
-      cpc += elen;
+      /* Pass. */
     }
     else if (spc[0] >= firststructtypenr && !ispointer(name)) {
       /* struct field type */
 
       /* where does the old struct data start (and is there an old one?) */
-      cpo = (char *)find_elem(oldsdna, type, name, spo, data, &sppo);
+      const short *sppo;
+      const int old_offset = find_elem_offset(oldsdna, type, name, spo, &sppo);
+
+      if (old_offset != -1) {
+        const int old_sub_nr = DNA_struct_find_nr_ex(oldsdna, type, &oldsdna_index_last);
+        const int new_sub_nr = DNA_struct_find_nr_ex(newsdna, type, &cursdna_index_last);
+
+        if (old_sub_nr != -1 && new_sub_nr != -1) {
+          /* array! new struct array may be larger than old */
+          const int array_len = MIN2(newsdna->names_array_len[spc[1]],
+                                     oldsdna->names_array_len[sppo[1]]);
+
+          if (compare_flags[old_sub_nr] == SDNA_CMP_EQUAL) {
+            const int old_sub_size = oldsdna->types_size[oldsdna->structs[old_sub_nr][0]];
+            reconstruct_step_add_memcpy(
+                steps, &steps_len, old_offset, new_offset, old_sub_size * array_len);
+          }
+          else {
+            ReconstructStep *step = reconstruct_step_add(
+                steps, &steps_len, RECONSTRUCT_STEP_SUBSTRUCT, old_offset, new_offset, array_len);
+            step->data.substruct.old_struct_nr = old_sub_nr;
+          }
+        }
+      }
+    }
+    else {
+      /* non-struct field type */
+      reconstruct_elem_compile(
+          newsdna, oldsdna, type, spc[1], new_offset, spo, steps, &steps_len);
+    }
+    new_offset += elen;
+  }
 
-      if (cpo) {
-        oldSDNAnr = DNA_struct_find_nr_ex(oldsdna, type, &oldsdna_index_last);
-        curSDNAnr = DNA_struct_find_nr_ex(newsdna, type, &cursdna_index_last);
+  plan->steps = steps;
+  plan->steps_len = steps_len;
+}
 
-        /* array! */
-        mul = newsdna->names_array_len[spc[1]];
-        mulo = oldsdna->names_array_len[sppo[1]];
+static void endian_swap_step_add(EndianSwapStep *steps,
+                                 int *steps_len,
+                                 eEndianSwapStepType type,
+                                 int type_size,
+                                 int offset,
+                                 int len)
+{
+  /* Extend the previous step when it swaps the data right in front of this. */
+  if (*steps_len != 0) {
+    EndianSwapStep *step_prev = &steps[*steps_len - 1];
+    if ((step_prev->type == type) && (step_prev->offset + step_prev->len * type_size == offset)) {
+      step_prev->len += len;
+      return;
+    }
+  }
 
-        eleno = DNA_elem_size_nr(oldsdna, sppo[0], sppo[1]);
+  EndianSwapStep *step = &steps[(*steps_len)++];
+  step->type = type;
+  step->offset = offset;
+  step->len = len;
+  step->struct_nr = -1;
+}
 
-        elen /= mul;
-        eleno /= mulo;
+/**
+ * Compiles the steps to do endian swapping on the fields of a struct value,
+ * see #DNA_struct_switch_endian.
+ */
+static void endian_swap_plan_compile(const DNA_ReconstructInfo *info,
+                                     ReconstructPlan *plan,
+                                     const int old_struct_nr)
+{
+  const SDNA *oldsdna = info->oldsdna;
 
-        while (mul--) {
-          reconstruct_struct(newsdna, oldsdna, compflags, oldSDNAnr, cpo, curSDNAnr, cpc);
-          cpo += eleno;
-          cpc += elen;
-
-          /* new struct array larger than old */
-          mulo--;
-          if (mulo <= 0) {
-            break;
-          }
+  const int firststructtypenr = *(oldsdna->structs[0]);
+  unsigned int oldsdna_index_last = UINT_MAX;
+
+  const short *spo, *spc;
+  spo = spc = oldsdna->structs[old_struct_nr];
+
+  const int elemcount = spo[1];
+  EndianSwapStep *steps = MEM_mallocN(sizeof(*steps) * elemcount, __func__);
+  int steps_len = 0;
+  int offset = 0;
+
+  spc += 2;
+  for (int a = 0; a < elemcount; a++, spc += 2) {
+    const char *type = oldsdna->types[spc[0]];
+    const char *name = oldsdna->names[spc[1]];
+    const int old_name_array_len = oldsdna->names_array_len[spc[1]];
+
+    /* DNA_elem_size_nr = including arraysize */
+    const int elen = DNA_elem_size_nr(oldsdna, spc[0], spc[1]);
+
+    /* test: is type a struct? */
+    if (spc[0] >= firststructtypenr && !ispointer(name)) {
+      /* struct field type */
+      /* where does the old data start (is there one?) */
+      const int sub_offset = find_elem_offset(oldsdna, type, name, spo, NULL);
+      if (sub_offset != -1) {
+        const int sub_nr = DNA_struct_find_nr_ex(oldsdna, type, &oldsdna_index_last);
+        if (sub_nr != -1) {
+          EndianSwapStep *step = &steps[steps_len++];
+          step->type = ENDIAN_SWAP_STEP_SUBSTRUCT;
+          step->offset = sub_offset;
+          step->len = old_name_array_len;
+          step->struct_nr = sub_nr;
         }
       }
-      else {
-        cpc += elen; /* skip field no longer present */
-      }
     }
     else {
       /* non-struct field type */
-      reconstruct_elem(newsdna, oldsdna, type, spc[1], cpc, spo, data);
-      cpc += elen;
+      if (ispointer(name)) {
+        if (oldsdna->pointer_size == 8) {
+          endian_swap_step_add(
+              steps, &steps_len, ENDIAN_SWAP_STEP_INT64, 8, offset, old_name_array_len);
+        }
+      }
+      else {
+        if (ELEM(spc[0], SDNA_TYPE_SHORT, SDNA_TYPE_USHORT)) {
+          /* exception: variable called blocktype: derived from ID_  */
+          if (!STREQ(name, "blocktype")) {
+            endian_swap_step_add(
+                steps, &steps_len, ENDIAN_SWAP_STEP_INT16, 2, offset, old_name_array_len);
+          }
+        }
+        else if (ELEM(spc[0], SDNA_TYPE_INT, SDNA_TYPE_FLOAT)) {
+          /* note, intentionally ignore long/ulong here these could be 4 or 8 bits,
+           * but turns out we only used for runtime vars and
+           * only once for a struct type that's no longer used. */
+          endian_swap_step_add(
+              steps, &steps_len, ENDIAN_SWAP_STEP_INT32, 4, offset, old_name_array_len);
+        }
+        else if (ELEM(spc[0], SDNA_TYPE_INT64, SDNA_TYPE_UINT64, SDNA_TYPE_DOUBLE)) {
+          endian_swap_step_add(
+              steps, &steps_len, ENDIAN_SWAP_STEP_INT64, 8, offset, old_name_array_len);
+        }
+      }
+    }
+    offset += elen;
+  }
+
+  plan->endian_steps = steps;
+  plan->endian_steps_len = steps_len;
+}
+
+static void reconstruct_plan_free(ReconstructPlan *plan)
+{
+  MEM_SAFE_FREE(plan->steps);
+  MEM_SAFE_FREE(plan->endian_steps);
+  MEM_freeN(plan);
+}
+
+/**
+ * Get the plan of a struct of the old SDNA, compiling it when it's first used.
+ * Can be called from multiple threads, when they compile the same plan only one is kept.
+ */
+static const ReconstructPlan *reconstruct_plan_ensure(const DNA_ReconstructInfo *info,
+                                                      const int old_struct_nr)
+{
+  ReconstructPlan *plan = info->plans[old_struct_nr];
+  if (LIKELY(plan != NULL)) {
+    return plan;
+  }
+
+  plan = MEM_callocN(sizeof(*plan), __func__);
+  reconstruct_plan_compile(info, plan, old_struct_nr);
+  if (info->do_endian_swap) {
+    endian_swap_plan_compile(info, plan, old_struct_nr);
+  }
+
+  ReconstructPlan *plan_other = atomic_cas_ptr(
+      (void **)&info->plans[old_struct_nr], NULL, plan);
+  if (plan_other != NULL) {
+    reconstruct_plan_free(plan);
+    return plan_other;
+  }
+  return plan;
+}
+
+/**
+ * Executes the plan of the old struct over an array of blocks.
+ */
+static void reconstruct_structs(const DNA_ReconstructInfo *info,
+                                const int old_struct_nr,
+                                const int blocks,
+                                const char *old_blocks,
+                                char *new_blocks)
+{
+  const ReconstructPlan *plan = reconstruct_plan_ensure(info, old_struct_nr);
+  const int old_size = plan->old_size;
+  const int new_size = plan->new_size;
+
+  for (int i = 0; i < plan->steps_len; i++) {
+    const ReconstructStep *step = &plan->steps[i];
+    const char *old_data = old_blocks + step->old_offset;
+    char *new_data = new_blocks + step->new_offset;
+
+    switch (step->type) {
+      case RECONSTRUCT_STEP_MEMCPY: {
+        if (step->len == old_size && step->len == new_size) {
+          /* All data of the struct is copied, copy all blocks at once. */
+          memcpy(new_data, old_data, (size_t)step->len * (size_t)blocks);
+          break;
+        }
+        for (int b = 0; b < blocks; b++, old_data += old_size, new_data += new_size) {
+          memcpy(new_data, old_data, step->len);
+        }
+        break;
+      }
+      case RECONSTRUCT_STEP_CAST_PRIMITIVE: {
+        for (int b = 0; b < blocks; b++, old_data += old_size, new_data += new_size) {
+          cast_primitive_type(step->data.cast_primitive.old_type,
+                              step->data.cast_primitive.new_type,
+                              step->len,
+                              old_data,
+                              new_data);
+        }
+        break;
+      }
+      case RECONSTRUCT_STEP_CAST_POINTER_TO_32: {
+        for (int b = 0; b < blocks; b++, old_data += old_size, new_data += new_size) {
+          cast_pointer_64_to_32(step->len, old_data, new_data);
+        }
+        break;
+      }
+      case RECONSTRUCT_STEP_CAST_POINTER_TO_64: {
+        for (int b = 0; b < blocks; b++, old_data += old_size, new_data += new_size) {
+          cast_pointer_32_to_64(step->len, old_data, new_data);
+        }
+        break;
+      }
+      case RECONSTRUCT_STEP_TERMINATE_STRING: {
+        for (int b = 0; b < blocks; b++, new_data += new_size) {
+          *new_data = '\0';
+        }
+        break;
+      }
+      case RECONSTRUCT_STEP_SUBSTRUCT: {
+        for (int b = 0; b < blocks; b++, old_data += old_size, new_data += new_size) {
+          reconstruct_structs(
+              info, step->data.substruct.old_struct_nr, step->len, old_data, new_data);
+        }
+        break;
+      }
     }
   }
 }
 
+static void switch_endian_structs(const DNA_ReconstructInfo *info,
+                                  const int old_struct_nr,
+                                  const int blocks,
+                                  char *data)
+{
+  const ReconstructPlan *plan = reconstruct_plan_ensure(info, old_struct_nr);
+  const int old_size = plan->old_size;
+
+  for (int i = 0; i < plan->endian_steps_len; i++) {
+    const EndianSwapStep *step = &plan->endian_steps[i];
+    char *cur = data + step->offset;
+
+    for (int b = 0; b < blocks; b++, cur += old_size) {
+      switch (step->type) {
+        case ENDIAN_SWAP_STEP_INT16:
+          BLI_endian_switch_int16_array((int16_t *)cur, step->len);
+          break;
+        case ENDIAN_SWAP_STEP_INT32:
+          BLI_endian_switch_int32_array((int32_t *)cur, step->len);
+          break;
+        case ENDIAN_SWAP_STEP_INT64:
+          BLI_endian_switch_int64_array((int64_t *)cur, step->len);
+          break;
+        case ENDIAN_SWAP_STEP_SUBSTRUCT:
+          switch_endian_structs(info, step->struct_nr, step->len, cur);
+          break;
+      }
+    }
+  }
+}
+
+/** \} */
+
 /**
  * Does endian swapping on the fields of a struct value.
  *
@@ -1340,8 +1704,9 @@ void DNA_struct_switch_endian(const SDNA *oldsdna, int oldSDNAnr, char *data)
     if (spc[0] >= firststructtypenr && !ispointer(name)) {
       /* struct field type */
       /* where does the old data start (is there one?) */
-      char *cpo = (char *)find_elem(oldsdna, type, name, spo, data, NULL);
-      if (cpo) {
+      const int offset = find_elem_offset(oldsdna, type, name, spo, NULL);
+      if (offset != -1) {
+        char *cpo = data + offset;
         oldSDNAnr = DNA_struct_find_nr_ex(oldsdna, type, &oldsdna_index_last);
 
         mul = old_name_array_len;
@@ -1392,52 +1757,82 @@ void DNA_struct_switch_endian(const SDNA *oldsdna, int oldSDNAnr, char *data)
 }
 
 /**
- * \param newsdna: SDNA of current Blender
+ * Prepare converting the structs of oldsdna to newsdna, plans are compiled as they're needed.
+ * The result can be used from multiple threads.
+ *
  * \param oldsdna: SDNA of Blender that saved file
- * \param compflags:
+ * \param newsdna: SDNA of current Blender
+ * \param compare_flags: Result from #DNA_struct_get_compareflags,
+ * must be kept until the result is freed.
+ * \param do_endian_swap: Also compile plans for #DNA_struct_switch_endian_blocks.
+ */
+DNA_ReconstructInfo *DNA_reconstruct_info_create(const SDNA *oldsdna,
+                                                 const SDNA *newsdna,
+                                                 const char *compare_flags,
+                                                 const bool do_endian_swap)
+{
+  DNA_ReconstructInfo *info = MEM_callocN(sizeof(*info), __func__);
+  info->oldsdna = oldsdna;
+  info->newsdna = newsdna;
+  info->compare_flags = compare_flags;
+  info->do_endian_swap = do_endian_swap;
+  info->plans = MEM_callocN(sizeof(*info->plans) * oldsdna->structs_len, __func__);
+
+  return info;
+}
+
+void DNA_reconstruct_info_free(DNA_ReconstructInfo *reconstruct_info)
+{
+  for (int old_struct_nr = 0; old_struct_nr < reconstruct_info->oldsdna->structs_len;
+       old_struct_nr++) {
+    if (reconstruct_info->plans[old_struct_nr] != NULL) {
+      reconstruct_plan_free(reconstruct_info->plans[old_struct_nr]);
+    }
+  }
+  MEM_freeN(reconstruct_info->plans);
+  MEM_freeN(reconstruct_info);
+}
+
+/**
+ * Does endian swapping on the fields of an array of struct values,
+ * equivalent to calling #DNA_struct_switch_endian on each of them.
  *
- * Result from DNA_struct_get_compareflags to avoid needless conversions
+ * \param oldSDNAnr: Index of struct info within oldsdna
+ * \param blocks: The number of array elements
+ * \param data: Array of struct data
+ */
+void DNA_struct_switch_endian_blocks(const DNA_ReconstructInfo *reconstruct_info,
+                                     int oldSDNAnr,
+                                     int blocks,
+                                     void *data)
+{
+  BLI_assert(reconstruct_info->do_endian_swap);
+  switch_endian_structs(reconstruct_info, oldSDNAnr, blocks, data);
+}
+
+/**
+ * \param reconstruct_info: Result of #DNA_reconstruct_info_create.
  * \param oldSDNAnr: Index of struct info within oldsdna
  * \param blocks: The number of array elements
  * \param data: Array of struct data
  * \return An allocated reconstructed struct
  */
-void *DNA_struct_reconstruct(const SDNA *newsdna,
-                             const SDNA *oldsdna,
-                             const char *compflags,
+void *DNA_struct_reconstruct(const DNA_ReconstructInfo *reconstruct_info,
                              int oldSDNAnr,
                              int blocks,
                              const void *data)
 {
-  int a, curSDNAnr, curlen = 0, oldlen;
-  const short *spo, *spc;
-  char *cur, *cpc;
-  const char *cpo;
-  const char *type;
-
   /* oldSDNAnr == structnr, we're looking for the corresponding 'cur' number */
-  spo = oldsdna->structs[oldSDNAnr];
-  type = oldsdna->types[spo[0]];
-  oldlen = oldsdna->types_size[spo[0]];
-  curSDNAnr = DNA_struct_find_nr(newsdna, type);
+  const ReconstructPlan *plan = reconstruct_plan_ensure(reconstruct_info, oldSDNAnr);
+  const int curlen = (plan->new_struct_nr != -1) ? plan->new_size : 0;
 
-  /* init data and alloc */
-  if (curSDNAnr != -1) {
-    spc = newsdna->structs[curSDNAnr];
-    curlen = newsdna->types_size[spc[0]];
-  }
   if (curlen == 0) {
     return NULL;
   }
 
-  cur = MEM_callocN(blocks * curlen, "reconstruct");
-  cpc = cur;
-  cpo = data;
-  for (a = 0; a < blocks; a++) {
-    reconstruct_struct(newsdna, oldsdna, compflags, oldSDNAnr, cpo, curSDNAnr, cpc);
-    cpc += curlen;
-    cpo += oldlen;
-  }
+  /* init data and alloc */
+  char *cur = MEM_callocN((size_t)blocks * curlen, "reconstruct");
+  reconstruct_structs(reconstruct_info, oldSDNAnr, blocks, data, cur);
 
   return cur;
 }
@@ -1450,9 +1845,10 @@ int DNA_elem_offset(SDNA *sdna, const char *stype, const char *vartype, const ch
 {
   const int SDNAnr = DNA_struct_find_nr(sdna, stype);
   const short *const spo = sdna->structs[SDNAnr];
-  const char *const cp = find_elem(sdna, vartype, name, spo, NULL, NULL);
+  const int offset = find_elem_offset(sdna, vartype, name, spo, NULL);
   BLI_assert(SDNAnr != -1);
-  return (int)((intptr_t)cp);
+  /* Not found is zero for compatibility. */
+  return MAX2(offset, 0);
 }
 
 bool DNA_struct_find(const SDNA *sdna, const char *stype)
@@ -582,6 +582,7 @@ static void rna_userdef_autosave_update(Main *bmain, Scene *scene, PointerRNA *p
 
 RNA_USERDEF_EXPERIMENTAL_BOOLEAN_GET(use_tool_fallback)
 RNA_USERDEF_EXPERIMENTAL_BOOLEAN_GET(use_usd_exporter)
+RNA_USERDEF_EXPERIMENTAL_BOOLEAN_GET(use_soa_positions)
 
 static bAddon *rna_userdef_addon_new(void)
 {
@@ -5870,6 +5871,15 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
   RNA_def_property_boolean_funcs(prop, "rna_userdef_experimental_use_usd_exporter_get", NULL);
   RNA_def_property_ui_text(prop, "USD Exporter", "Enable exporting to the USD format");
   RNA_def_property_update(prop, 0, "rna_userdef_update");
+
+  prop = RNA_def_property(srna, "use_soa_positions", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "use_soa_positions", 1);
+  RNA_def_property_boolean_funcs(prop, "rna_userdef_experimental_use_soa_positions_get", NULL);
+  RNA_def_property_ui_text(prop,
+                           "Separate Vertex Positions",
+                           "Store the vertex positions of evaluated meshes in a separate array, "
+                           "for faster drawing of deformed meshes");
+  RNA_def_property_update(prop, 0, "rna_userdef_update");
 }
 
 static void rna_def_userdef_addon_collection(BlenderRNA *brna, PropertyRNA *cprop)
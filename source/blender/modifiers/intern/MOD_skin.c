@@ -70,6 +70,7 @@
 #include "BKE_library.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_modifier.h"
 
 #include "MOD_modifiertypes.h"
@@ -1832,8 +1833,7 @@ static Mesh *base_skin(Mesh *origmesh, SkinModifierData *smd)
   BMesh *bm;
   EMat *emat;
   SkinNode *skin_nodes;
-  MeshElemMap *emap;
-  int *emapmem;
+  const MeshElemMap *emap;
   MVert *mvert;
   MEdge *medge;
   MDeformVert *dvert;
@@ -1848,7 +1848,7 @@ static Mesh *base_skin(Mesh *origmesh, SkinModifierData *smd)
   totvert = origmesh->totvert;
   totedge = origmesh->totedge;
 
-  BKE_mesh_vert_edge_map_create(&emap, &emapmem, medge, totvert, totedge);
+  emap = BKE_mesh_runtime_vert_edge_map_ensure(origmesh);
 
   emat = build_edge_mats(nodes, mvert, totvert, medge, emap, totedge, &has_valid_root);
   skin_nodes = build_frames(mvert, totvert, nodes, emap, emat);
@@ -1858,8 +1858,6 @@ static Mesh *base_skin(Mesh *origmesh, SkinModifierData *smd)
   bm = build_skin(skin_nodes, totvert, emap, medge, totedge, dvert, smd);
 
   MEM_freeN(skin_nodes);
-  MEM_freeN(emap);
-  MEM_freeN(emapmem);
 
   if (!has_valid_root) {
     modifier_setError(
@@ -32,7 +32,9 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_alloca.h"
+#include "BLI_bitmap.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_kdtree.h"
 #include "BLI_math.h"
 
 #include "DNA_mesh_types.h"
@@ -40,7 +42,6 @@
 #include "DNA_object_types.h"
 
 #include "BKE_deform.h"
-#include "BKE_bvhutils.h"
 #include "BKE_modifier.h"
 #include "BKE_mesh.h"
 
@@ -1592,19 +1593,94 @@ static void customdata_weld(
 /** \name Weld Modifier Main
  * \{ */
 
-struct WeldOverlapData {
-  const MVert *mvert;
-  float merge_dist_sq;
-};
-static bool bvhtree_weld_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+/* Number of points the kd-tree scans linearly instead of visiting them as nodes. */
+#define WELD_KDTREE_BUCKET_LEN 8
+
+/**
+ * Find the pairs of vertices within \a merge_dist of each other,
+ * using a batched kd-tree range search.
+ *
+ * \param max_interactions: Limits the number of nearest vertices considered per vertex
+ * (0 makes it infinite).
+ */
+static BVHTreeOverlap *weld_vert_overlap_find(const MVert *mvert,
+                                              const uint totvert,
+                                              const BLI_bitmap *v_mask,
+                                              const uint v_mask_act,
+                                              const float merge_dist,
+                                              const uint max_interactions,
+                                              uint *r_overlap_len)
 {
-  if (index_a < index_b) {
-    struct WeldOverlapData *data = userdata;
-    const MVert *mvert = data->mvert;
-    const float dist_sq = len_squared_v3v3(mvert[index_a].co, mvert[index_b].co);
-    return dist_sq <= data->merge_dist_sq;
+  const uint verts_len = v_mask ? v_mask_act : totvert;
+  float(*verts_co)[3] = MEM_mallocN(sizeof(*verts_co) * verts_len, __func__);
+  uint *verts_index = MEM_mallocN(sizeof(*verts_index) * verts_len, __func__);
+
+  KDTree_3d *tree = BLI_kdtree_3d_new(verts_len);
+  uint verts_num = 0;
+  for (uint i = 0; i < totvert; i++) {
+    if (v_mask == NULL || BLI_BITMAP_TEST(v_mask, i)) {
+      copy_v3_v3(verts_co[verts_num], mvert[i].co);
+      verts_index[verts_num] = i;
+      /* Use the position in the arrays, to map back to vertices without a lookup. */
+      BLI_kdtree_3d_insert(tree, (int)verts_num, mvert[i].co);
+      verts_num++;
+    }
   }
-  return false;
+  BLI_assert(verts_num == verts_len);
+  BLI_kdtree_3d_balance_ex(tree, WELD_KDTREE_BUCKET_LEN);
+
+  /* Each vertex finds itself, so include it in the limit. */
+  uint *nearest_offset;
+  KDTreeNearest_3d *nearest;
+  const uint nearest_len = (uint)BLI_kdtree_3d_range_search_batch(
+      tree,
+      (const float(*)[3])verts_co,
+      verts_len,
+      merge_dist,
+      max_interactions ? max_interactions + 1 : 0,
+      &nearest_offset,
+      &nearest);
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(verts_co);
+
+  /* Results are sorted by distance and index, so vertices in a group of overlapping vertices
+   * tend to find the same (lowest index) vertices, even when the number found is limited. */
+  BVHTreeOverlap *overlap = MEM_mallocN(sizeof(*overlap) * nearest_len, __func__);
+  uint overlap_len = 0;
+  for (uint i = 0; i < verts_len; i++) {
+    for (uint j = nearest_offset[i]; j < nearest_offset[i + 1]; j++) {
+      const uint k = (uint)nearest[j].index;
+      if (k == i) {
+        continue;
+      }
+      /* Pairs found from both vertices are only added once.
+       * Without a limit the search is symmetric, so the other vertex always found this one. */
+      bool is_found_by_other = false;
+      if (k < i) {
+        is_found_by_other = (max_interactions == 0);
+        for (uint l = nearest_offset[k]; !is_found_by_other && l < nearest_offset[k + 1]; l++) {
+          if ((uint)nearest[l].index == i) {
+            is_found_by_other = true;
+          }
+        }
+      }
+      if (!is_found_by_other) {
+        BVHTreeOverlap *overlap_iter = &overlap[overlap_len++];
+        overlap_iter->indexA = (int)verts_index[MIN2(i, k)];
+        overlap_iter->indexB = (int)verts_index[MAX2(i, k)];
+      }
+    }
+  }
+
+  MEM_freeN(verts_index);
+  MEM_freeN(nearest_offset);
+  if (nearest) {
+    MEM_freeN(nearest);
+  }
+
+  *r_overlap_len = overlap_len;
+  return overlap;
 }
 
 static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContext *ctx, Mesh *mesh)
@@ -1640,34 +1716,24 @@ static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContex
     }
   }
 
-  /* Get overlap map. */
-  /* TODO: For a better performanse use KD-Tree. */
-  struct BVHTreeFromMesh treedata;
-  BVHTree *bvhtree = bvhtree_from_mesh_verts_ex(
-      &treedata, mvert, totvert, false, v_mask, v_mask_act, wmd->merge_dist, 2, 6, 0, NULL);
-
-  if (v_mask) {
-    MEM_freeN(v_mask);
-  }
-
-  if (bvhtree == NULL) {
+  if ((v_mask ? v_mask_act : (int)totvert) == 0) {
+    MEM_SAFE_FREE(v_mask);
     return result;
   }
 
-  struct WeldOverlapData data;
-  data.mvert = mvert;
-  data.merge_dist_sq = SQUARE(wmd->merge_dist);
-
+  /* Get overlap map. */
   uint overlap_len;
-  BVHTreeOverlap *overlap = BLI_bvhtree_overlap_ex(bvhtree,
-                                                   bvhtree,
-                                                   &overlap_len,
-                                                   bvhtree_weld_overlap_cb,
-                                                   &data,
+  BVHTreeOverlap *overlap = weld_vert_overlap_find(mvert,
+                                                   totvert,
+                                                   v_mask,
+                                                   (uint)v_mask_act,
+                                                   wmd->merge_dist,
                                                    wmd->max_interactions,
-                                                   BVH_OVERLAP_RETURN_PAIRS);
+                                                   &overlap_len);
 
-  free_bvhtree_from_mesh(&treedata);
+  if (v_mask) {
+    MEM_freeN(v_mask);
+  }
 
   if (overlap_len) {
     WeldMesh weld_mesh;
@@ -2543,6 +2543,13 @@ static void save_set_compress(wmOperator *op)
       RNA_property_boolean_set(op->ptr, prop, (U.flag & USER_FILECOMPRESS) != 0);
     }
   }
+
+  prop = RNA_struct_find_property(op->ptr, "compress_fast");
+  if (!RNA_property_is_set(op->ptr, prop)) {
+    /* Keep flag for existing file, new files use the default (smaller) compression. */
+    RNA_property_boolean_set(
+        op->ptr, prop, G.save_over && (G.fileflags & G_FILE_COMPRESS_FAST) != 0);
+  }
 }
 
 static void save_set_filepath(bContext *C, wmOperator *op)
@@ -2600,6 +2607,8 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
 
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
+  SET_FLAG_FROM_TEST(
+      fileflags, RNA_boolean_get(op->ptr, "compress_fast"), G_FILE_COMPRESS_FAST);
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "relative_remap"), G_FILE_RELATIVE_REMAP);
   SET_FLAG_FROM_TEST(
       fileflags,
@@ -2664,6 +2673,12 @@ void WM_OT_save_as_mainfile(wmOperatorType *ot)
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_ALPHA);
   RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  RNA_def_boolean(ot->srna,
+                  "compress_fast",
+                  false,
+                  "Fast Compression",
+                  "Compress in parallel when writing a compressed .blend file, "
+                  "resulting in larger files that older Blender versions can't open");
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   true,
@@ -2736,6 +2751,12 @@ void WM_OT_save_mainfile(wmOperatorType *ot)
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_ALPHA);
   RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  RNA_def_boolean(ot->srna,
+                  "compress_fast",
+                  false,
+                  "Fast Compression",
+                  "Compress in parallel when writing a compressed .blend file, "
+                  "resulting in larger files that older Blender versions can't open");
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   false,
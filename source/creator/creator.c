@@ -276,18 +276,32 @@ int main(int argc,
    *       we need to perform switch from lock-free to fully
    *       guarded allocator before any allocation happened.
    */
+  /* Allocations are only profiled by the guarded allocator,
+   * so profiling is enabled here too, to include all allocations. */
   {
+    bool use_guarded = false, use_profile = false, use_profile_callstacks = false;
     int i;
     for (i = 0; i < argc; i++) {
       if (STR_ELEM(argv[i], "-d", "--debug", "--debug-memory", "--debug-all")) {
-        printf("Switching to fully guarded memory allocator.\n");
-        MEM_use_guarded_allocator();
-        break;
+        use_guarded = true;
+      }
+      else if (STREQ(argv[i], "--debug-memory-profile")) {
+        use_guarded = use_profile = true;
+      }
+      else if (STREQ(argv[i], "--debug-memory-profile-callstacks")) {
+        use_profile_callstacks = true;
       }
       else if (STREQ(argv[i], "--")) {
         break;
       }
     }
+    if (use_guarded) {
+      printf("Switching to fully guarded memory allocator.\n");
+      MEM_use_guarded_allocator();
+    }
+    if (use_profile) {
+      MEM_profile_enable(use_profile_callstacks);
+    }
   }
 
 #ifdef BUILD_DATE
@@ -42,9 +42,11 @@
 #  include "BLI_fileops.h"
 #  include "BLI_mempool.h"
 #  include "BLI_system.h"
+#  include "BLI_task.h"
 
 #  include "BLO_readfile.h" /* only for BLO_has_bfile_extension */
 
+#  include "BKE_blender.h"
 #  include "BKE_blender_version.h"
 #  include "BKE_context.h"
 
@@ -527,6 +529,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--task-scheduler");
 
   printf("\n");
   printf("Format Options:\n");
@@ -588,6 +591,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-cycles");
 #  endif
   BLI_argsPrintArgDoc(ba, "--debug-memory");
+  BLI_argsPrintArgDoc(ba, "--debug-memory-profile");
+  BLI_argsPrintArgDoc(ba, "--debug-memory-profile-callstacks");
   BLI_argsPrintArgDoc(ba, "--debug-jobs");
   BLI_argsPrintArgDoc(ba, "--debug-python");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph");
@@ -597,6 +602,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-time");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-pretty");
+  BLI_argsPrintArgDoc(ba, "--debug-depsgraph-validate");
   BLI_argsPrintArgDoc(ba, "--debug-gpu");
   BLI_argsPrintArgDoc(ba, "--debug-gpumem");
   BLI_argsPrintArgDoc(ba, "--debug-gpu-shaders");
@@ -966,6 +972,9 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_pretty[] =
     "\n\t"
     "Enable colors for dependency graph debug messages.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_validate[] =
+    "\n\t"
+    "Compare result of incremental dependency graph relations update with a full rebuild.";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
     "\n\t"
     "Enable GPU memory stats in status bar.";
@@ -1044,6 +1053,52 @@ static int arg_handle_debug_mode_memory_set(int UNUSED(argc),
   return 0;
 }
 
+static char debug_memory_profile_filepath[FILE_MAX] = "";
+
+static void callback_debug_memory_profile_write(void *UNUSED(user_data))
+{
+  if (MEM_profile_write(debug_memory_profile_filepath)) {
+    printf("Memory profile written to '%s'\n", debug_memory_profile_filepath);
+  }
+  else {
+    printf("Error: unable to write memory profile '%s'\n", debug_memory_profile_filepath);
+  }
+}
+
+static const char arg_handle_debug_mode_memory_profile_set_doc[] =
+    "<filepath>\n"
+    "\tEnable fully guarded memory allocation and write statistics of all allocations on exit,\n"
+    "\tgrouped by name. Written as JSON for files ending with '.json',\n"
+    "\totherwise as collapsed stacks (for use with flame graph tools).";
+static int arg_handle_debug_mode_memory_profile_set(int argc,
+                                                    const char **argv,
+                                                    void *UNUSED(data))
+{
+  const char *arg_id = "--debug-memory-profile";
+  if (argc > 1) {
+    if (debug_memory_profile_filepath[0] == '\0') {
+      BKE_blender_atexit_register(callback_debug_memory_profile_write, NULL);
+    }
+    BLI_strncpy(debug_memory_profile_filepath, argv[1], sizeof(debug_memory_profile_filepath));
+    return 1;
+  }
+  else {
+    printf("\nError: '%s' no args given.\n", arg_id);
+    return 0;
+  }
+}
+
+static const char arg_handle_debug_mode_memory_profile_callstacks_set_doc[] =
+    "\n\t"
+    "Also group the memory profile by the callstacks of allocations (Linux and macOS only).";
+static int arg_handle_debug_mode_memory_profile_callstacks_set(int UNUSED(argc),
+                                                               const char **UNUSED(argv),
+                                                               void *UNUSED(data))
+{
+  /* Handled on startup, before any allocations are made. */
+  return 0;
+}
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -1477,6 +1532,33 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_task_scheduler_set_doc[] =
+    "<scheduler>\n"
+    "\tUse given task scheduler backend for multi-threaded operations.\n"
+    "\tValid options are: 'QUEUE' (default) and 'WORK_STEALING'.";
+static int arg_handle_task_scheduler_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--task-scheduler";
+  if (argc > 1) {
+    if (STREQ(argv[1], "QUEUE")) {
+      BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_QUEUE);
+    }
+    else if (STREQ(argv[1], "WORK_STEALING")) {
+      BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_WORK_STEALING);
+    }
+    else {
+      printf("\nError: unknown task scheduler '%s %s', expected QUEUE or WORK_STEALING.\n",
+             arg_id,
+             argv[1]);
+    }
+    return 1;
+  }
+  else {
+    printf("\nError: you must specify a task scheduler after '%s'.\n", arg_id);
+    return 0;
+  }
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet logging verbosity level for debug messages which supports it.";
@@ -2098,6 +2180,18 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--debug-cycles", CB(arg_handle_debug_mode_cycles), NULL);
 #  endif
   BLI_argsAdd(ba, 1, NULL, "--debug-memory", CB(arg_handle_debug_mode_memory_set), NULL);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-memory-profile",
+              CB(arg_handle_debug_mode_memory_profile_set),
+              NULL);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-memory-profile-callstacks",
+              CB(arg_handle_debug_mode_memory_profile_callstacks_set),
+              NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-value", CB(arg_handle_debug_value_set), NULL);
   BLI_argsAdd(ba,
@@ -2154,6 +2248,12 @@ void main_args_setup(bContext *C, bArgs *ba)
               "--debug-depsgraph-pretty",
               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_pretty),
               (void *)G_DEBUG_DEPSGRAPH_PRETTY);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-depsgraph-validate",
+              CB_EX(arg_handle_debug_mode_generic_set, depsgraph_validate),
+              (void *)G_DEBUG_DEPSGRAPH_VALIDATE);
   BLI_argsAdd(ba,
               1,
               NULL,
@@ -2222,6 +2322,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--task-scheduler", CB(arg_handle_task_scheduler_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
@@ -0,0 +1,285 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_armature_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_action.h"
+#include "BKE_armature.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_lattice.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#define BONES_LEN 8
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Posed armature of bones across the grid, every third one a B-Bone, one of them scaling its
+ * weights by the envelope and one not deforming. */
+static Object *armature_test_create(Main *bmain)
+{
+  bArmature *arm = BKE_armature_add(bmain, "Armature");
+  for (int i = 0; i < BONES_LEN; i++) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    BLI_snprintf(bone->name, sizeof(bone->name), "Bone.%d", i);
+    bone->head[0] = 5.0f * (float)i;
+    bone->tail[0] = 5.0f * (float)i + 1.0f;
+    bone->tail[1] = 40.0f;
+    bone->tail[2] = 1.0f;
+    bone->roll = 0.3f * (float)i;
+    bone->rad_head = bone->rad_tail = 1.0f;
+    bone->dist = 2.0f;
+    bone->weight = 1.0f;
+    bone->xwidth = bone->zwidth = 0.1f;
+    bone->segments = (i % 3 == 0) ? 4 : 1;
+    bone->ease1 = bone->ease2 = 1.0f;
+    bone->scale_in_x = bone->scale_in_y = bone->scale_out_x = bone->scale_out_y = 1.0f;
+    bone->layer = 1;
+    if (i == 2) {
+      bone->flag |= BONE_MULT_VG_ENV;
+    }
+    if (i == 5) {
+      bone->flag |= BONE_NO_DEFORM;
+    }
+    BLI_addtail(&arm->bonebase, bone);
+  }
+  BKE_armature_where_is(arm);
+  LISTBASE_FOREACH (Bone *, bone, &arm->bonebase) {
+    copy_v3_v3(bone->arm_head, bone->head);
+    copy_v3_v3(bone->arm_tail, bone->tail);
+  }
+
+  Object *ob = BKE_object_add_only_object(bmain, OB_ARMATURE, "Armature");
+  ob->data = arm;
+  BKE_pose_rebuild(bmain, ob, arm, false);
+
+  int i = 0;
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+    const float axis[3] = {1.0f, 0.5f * (float)i, -0.3f};
+    axis_angle_to_quat(pchan->quat, axis, 0.2f * (float)(i + 1));
+    pchan->loc[2] = 0.1f * (float)i;
+    pchan->size[0] = 1.0f + 0.05f * (float)i;
+    pchan->curve_in_x = 0.5f;
+    pchan->roll2 = 0.2f;
+    i++;
+  }
+
+  Scene scene = {{NULL}};
+  BKE_pose_where_is(NULL, &scene, ob);
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+    if (pchan->bone->segments > 1) {
+      BKE_pchan_bbone_segments_cache_compute(pchan);
+    }
+    if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
+      mat4_to_dquat(&pchan->runtime.deform_dual_quat, pchan->bone->arm_mat, pchan->chan_mat);
+    }
+  }
+  return ob;
+}
+
+/* Grid weighted to the bones, with vertices without weights, vertices only in a group without
+ * bone, zero weights and an overall "Mask" group. */
+static Object *mesh_test_create(Main *bmain, const int grid_size)
+{
+  Mesh *mesh = mesh_test_grid_create(grid_size, grid_size);
+  mesh->dvert = (MDeformVert *)CustomData_add_layer(
+      &mesh->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, mesh->totvert);
+
+  Object *ob = BKE_object_add_only_object(bmain, OB_MESH, "Mesh");
+  ob->data = mesh;
+  char name[MAX_VGROUP_NAME];
+  for (int i = 0; i < BONES_LEN; i++) {
+    BLI_snprintf(name, sizeof(name), "Bone.%d", i);
+    BKE_object_defgroup_add_name(ob, name);
+  }
+  BKE_object_defgroup_add_name(ob, "Other");
+  BKE_object_defgroup_add_name(ob, "Mask");
+
+  for (int v = 0; v < mesh->totvert; v++) {
+    MDeformVert *dvert = &mesh->dvert[v];
+    if (v % 11 == 0) {
+      defvert_add_index_notest(dvert, BONES_LEN, 1.0f);
+      continue;
+    }
+    for (int j = 0; j < v % 5; j++) {
+      defvert_add_index_notest(
+          dvert, (v * 7 + j * 3) % BONES_LEN, (float)((v * 13 + j * 5) % 10) / 9.0f);
+    }
+    if (v % 3 != 0) {
+      defvert_add_index_notest(dvert, BONES_LEN + 1, (float)(v % 4) / 3.0f);
+    }
+  }
+  return ob;
+}
+
+/* Deform without and with the packed weights of the copy-on-write mesh, the results have to be
+ * exactly the same. */
+static void armature_deform_compare(Object *ob_arm,
+                                    Object *ob_mesh,
+                                    const Mesh *mesh_arg,
+                                    const int deformflag,
+                                    const char *defgrp_name,
+                                    const bool use_defmats,
+                                    const bool use_prevcos)
+{
+  Mesh *mesh = (Mesh *)ob_mesh->data;
+  const int verts_len = mesh->totvert;
+  float(*coords)[2][3] = (float(*)[2][3])MEM_malloc_arrayN(verts_len, sizeof(*coords), __func__);
+  float(*prevcos)[2][3] = (float(*)[2][3])MEM_malloc_arrayN(verts_len, sizeof(*prevcos), __func__);
+  float(*defmats)[2][3][3] = (float(*)[2][3][3])MEM_malloc_arrayN(
+      verts_len, sizeof(*defmats), __func__);
+
+  for (int pass = 0; pass < 2; pass++) {
+    float(*pass_coords)[3] = (float(*)[3])MEM_malloc_arrayN(verts_len, sizeof(float[3]), __func__);
+    float(*pass_prevcos)[3] = (float(*)[3])MEM_malloc_arrayN(
+        verts_len, sizeof(float[3]), __func__);
+    float(*pass_defmats)[3][3] = (float(*)[3][3])MEM_malloc_arrayN(
+        verts_len, sizeof(float[3][3]), __func__);
+    for (int i = 0; i < verts_len; i++) {
+      copy_v3_v3(pass_coords[i], mesh->mvert[i].co);
+      copy_v3_v3(pass_prevcos[i], mesh->mvert[i].co);
+      pass_prevcos[i][2] += 0.5f;
+      unit_m3(pass_defmats[i]);
+    }
+
+    BKE_mesh_runtime_vertex_weights_clear(mesh);
+    if (pass == 0) {
+      mesh->id.tag &= ~LIB_TAG_COPIED_ON_WRITE;
+    }
+    else {
+      mesh->id.tag |= LIB_TAG_COPIED_ON_WRITE;
+    }
+    armature_deform_verts(ob_arm,
+                          ob_mesh,
+                          mesh_arg,
+                          pass_coords,
+                          use_defmats ? pass_defmats : NULL,
+                          verts_len,
+                          deformflag,
+                          use_prevcos ? pass_prevcos : NULL,
+                          defgrp_name,
+                          NULL);
+    EXPECT_EQ(mesh->runtime.vertex_weights != NULL,
+              pass == 1 && ((deformflag & ARM_DEF_VGROUP) || defgrp_name != NULL));
+
+    for (int i = 0; i < verts_len; i++) {
+      copy_v3_v3(coords[i][pass], pass_coords[i]);
+      copy_v3_v3(prevcos[i][pass], pass_prevcos[i]);
+      copy_m3_m3(defmats[i][pass], pass_defmats[i]);
+    }
+    MEM_freeN(pass_coords);
+    MEM_freeN(pass_prevcos);
+    MEM_freeN(pass_defmats);
+  }
+  mesh->id.tag &= ~LIB_TAG_COPIED_ON_WRITE;
+  BKE_mesh_runtime_vertex_weights_clear(mesh);
+
+  for (int i = 0; i < verts_len; i++) {
+    for (int j = 0; j < 3; j++) {
+      EXPECT_EQ(coords[i][0][j], coords[i][1][j]);
+      EXPECT_EQ(prevcos[i][0][j], prevcos[i][1][j]);
+      for (int k = 0; k < 3; k++) {
+        EXPECT_EQ(defmats[i][0][j][k], defmats[i][1][j][k]);
+      }
+    }
+  }
+
+  MEM_freeN(coords);
+  MEM_freeN(prevcos);
+  MEM_freeN(defmats);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(armature_deform, PackedWeightsSameAsDeformVerts)
+{
+  BLI_threadapi_init();
+
+  Main *bmain = BKE_main_new();
+  Object *ob_arm = armature_test_create(bmain);
+  Object *ob_mesh = mesh_test_create(bmain, 40);
+  Mesh *mesh = (Mesh *)ob_mesh->data;
+
+  const int deformflags[] = {
+      ARM_DEF_VGROUP,
+      ARM_DEF_VGROUP | ARM_DEF_ENVELOPE,
+      ARM_DEF_VGROUP | ARM_DEF_QUATERNION,
+      ARM_DEF_VGROUP | ARM_DEF_ENVELOPE | ARM_DEF_QUATERNION,
+      ARM_DEF_ENVELOPE,
+  };
+  for (int i = 0; i < (int)ARRAY_SIZE(deformflags); i++) {
+    for (int use_defmats = 0; use_defmats < 2; use_defmats++) {
+      /* Weights read from the object data or from the mesh passed to the deform. */
+      armature_deform_compare(ob_arm, ob_mesh, NULL, deformflags[i], NULL, use_defmats, false);
+      armature_deform_compare(ob_arm, ob_mesh, mesh, deformflags[i], NULL, use_defmats, false);
+    }
+    /* Overall vertex group, used to blend with the previous coordinates too. */
+    armature_deform_compare(ob_arm, ob_mesh, NULL, deformflags[i], "Mask", true, false);
+    armature_deform_compare(ob_arm, ob_mesh, NULL, deformflags[i], "Mask", false, true);
+    armature_deform_compare(
+        ob_arm, ob_mesh, mesh, deformflags[i] | ARM_DEF_INVERT_VGROUP, "Mask", false, true);
+  }
+
+  BKE_id_free(NULL, mesh);
+  ob_mesh->data = NULL;
+  BKE_main_free(bmain);
+}
+
+TEST(armature_deform, PackedWeightsFollowDeformVerts)
+{
+  BLI_threadapi_init();
+
+  Main *bmain = BKE_main_new();
+  Object *ob_mesh = mesh_test_create(bmain, 10);
+  Mesh *mesh = (Mesh *)ob_mesh->data;
+  mesh->id.tag |= LIB_TAG_COPIED_ON_WRITE;
+
+  const MeshVertexWeights *vertex_weights = BKE_mesh_runtime_vertex_weights_ensure(mesh);
+  ASSERT_NE(vertex_weights, nullptr);
+  EXPECT_EQ(BKE_mesh_runtime_vertex_weights_ensure(mesh), vertex_weights);
+  for (int i = 0; i < mesh->totvert; i++) {
+    const MDeformVert *dvert = &mesh->dvert[i];
+    ASSERT_EQ(vertex_weights->offsets[i + 1] - vertex_weights->offsets[i], dvert->totweight);
+    for (int j = 0; j < dvert->totweight; j++) {
+      const MDeformWeight *dw = &vertex_weights->weights[vertex_weights->offsets[i] + j];
+      EXPECT_EQ(dw->def_nr, dvert->dw[j].def_nr);
+      EXPECT_EQ(dw->weight, dvert->dw[j].weight);
+    }
+  }
+
+  /* Not used for other deform vertices, or for meshes modified in place. */
+  MDeformVert *dvert = mesh->dvert;
+  mesh->dvert = (MDeformVert *)MEM_dupallocN(dvert);
+  EXPECT_EQ(BKE_mesh_runtime_vertex_weights_ensure(mesh), nullptr);
+  MEM_freeN(mesh->dvert);
+  mesh->dvert = dvert;
+
+  mesh->id.tag |= LIB_TAG_COPIED_ON_WRITE_EVAL_RESULT;
+  BKE_mesh_runtime_vertex_weights_clear(mesh);
+  EXPECT_EQ(BKE_mesh_runtime_vertex_weights_ensure(mesh), nullptr);
+  mesh->id.tag &= ~(LIB_TAG_COPIED_ON_WRITE | LIB_TAG_COPIED_ON_WRITE_EVAL_RESULT);
+
+  BKE_id_free(NULL, mesh);
+  ob_mesh->data = NULL;
+  BKE_main_free(bmain);
+}
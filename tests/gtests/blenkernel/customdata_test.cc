@@ -0,0 +1,128 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_library.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#define TOTELEM 1000
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void customdata_create(CustomData *data)
+{
+  CustomData_reset(data);
+  float *values = (float *)CustomData_add_layer(data, CD_BWEIGHT, CD_CALLOC, NULL, TOTELEM);
+  MDeformVert *dverts = (MDeformVert *)CustomData_add_layer(
+      data, CD_MDEFORMVERT, CD_CALLOC, NULL, TOTELEM);
+  for (int i = 0; i < TOTELEM; i++) {
+    values[i] = (float)i;
+    defvert_add_index_notest(&dverts[i], i % 4, 0.5f);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(customdata, ShareAndDuplicate)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  CustomData data, data_copy;
+  customdata_create(&data);
+  CustomData_copy(&data, &data_copy, CD_MASK_BWEIGHT | CD_MASK_MDEFORMVERT, CD_SHARE, TOTELEM);
+
+  float *values = (float *)CustomData_get_layer(&data, CD_BWEIGHT);
+  EXPECT_EQ(CustomData_get_layer(&data_copy, CD_BWEIGHT), values);
+  EXPECT_EQ(CustomData_get_layer(&data_copy, CD_MDEFORMVERT),
+            CustomData_get_layer(&data, CD_MDEFORMVERT));
+  EXPECT_TRUE(CustomData_is_shared_layer(&data, CD_BWEIGHT));
+  EXPECT_TRUE(CustomData_is_shared_layer(&data_copy, CD_BWEIGHT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&data_copy, CD_BWEIGHT));
+
+  /* Writing to the copy doesn't change the source. */
+  float *values_copy = (float *)CustomData_duplicate_referenced_layer(
+      &data_copy, CD_BWEIGHT, TOTELEM);
+  EXPECT_NE(values_copy, values);
+  values_copy[1] = -1.0f;
+  EXPECT_EQ(values[1], 1.0f);
+  EXPECT_FALSE(CustomData_is_shared_layer(&data, CD_BWEIGHT));
+  EXPECT_FALSE(CustomData_is_shared_layer(&data_copy, CD_BWEIGHT));
+  EXPECT_TRUE(CustomData_is_shared_layer(&data_copy, CD_MDEFORMVERT));
+
+  /* The copy keeps the shared data when the source is freed first. */
+  CustomData_free(&data, TOTELEM);
+  EXPECT_FALSE(CustomData_is_shared_layer(&data_copy, CD_MDEFORMVERT));
+  const MDeformVert *dverts = (const MDeformVert *)CustomData_get_layer(&data_copy,
+                                                                          CD_MDEFORMVERT);
+  EXPECT_EQ(dverts[5].totweight, 1);
+  EXPECT_EQ(dverts[5].dw[0].def_nr, 1);
+  CustomData_free(&data_copy, TOTELEM);
+
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareRealloc)
+{
+  const uint blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  CustomData data, data_copy;
+  customdata_create(&data);
+  CustomData_copy(&data, &data_copy, CD_MASK_BWEIGHT | CD_MASK_MDEFORMVERT, CD_SHARE, TOTELEM);
+
+  /* Elements freed in the copy stay valid in the source. */
+  CustomData_free_elem(&data_copy, TOTELEM / 2, TOTELEM / 2, TOTELEM);
+  CustomData_realloc(&data_copy, TOTELEM, TOTELEM / 2);
+  EXPECT_FALSE(CustomData_is_shared_layer(&data, CD_MDEFORMVERT));
+  EXPECT_FALSE(CustomData_is_shared_layer(&data, CD_BWEIGHT));
+
+  const MDeformVert *dverts = (const MDeformVert *)CustomData_get_layer(&data, CD_MDEFORMVERT);
+  const float *values_copy = (const float *)CustomData_get_layer(&data_copy, CD_BWEIGHT);
+  EXPECT_EQ(dverts[TOTELEM - 1].totweight, 1);
+  EXPECT_EQ(values_copy[TOTELEM / 2 - 1], (float)(TOTELEM / 2 - 1));
+
+  CustomData_free(&data_copy, TOTELEM / 2);
+  CustomData_free(&data, TOTELEM);
+
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(customdata, ShareMeshCopy)
+{
+  Mesh *mesh = mesh_test_grid_create(20, 10);
+  Mesh *mesh_copy = NULL;
+  BKE_id_copy_ex(
+      NULL, &mesh->id, (ID **)&mesh_copy, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE);
+
+  EXPECT_EQ(mesh_copy->mvert, mesh->mvert);
+  EXPECT_EQ(mesh_copy->mloop, mesh->mloop);
+  EXPECT_EQ(mesh_copy->mpoly, mesh->mpoly);
+
+  /* Deforming the copy only duplicates the vertices. */
+  const float z = mesh->mvert[0].co[2];
+  float(*vert_coords)[3] = BKE_mesh_vert_coords_alloc(mesh_copy, NULL);
+  vert_coords[0][2] = z + 1.0f;
+  BKE_mesh_vert_coords_apply(mesh_copy, vert_coords);
+  MEM_freeN(vert_coords);
+
+  EXPECT_NE(mesh_copy->mvert, mesh->mvert);
+  EXPECT_EQ(mesh_copy->mloop, mesh->mloop);
+  EXPECT_EQ(mesh_copy->mvert[0].co[2], z + 1.0f);
+  EXPECT_EQ(mesh->mvert[0].co[2], z);
+
+  /* The copy keeps the shared loops. */
+  const uint v = mesh->mloop[4].v;
+  BKE_id_free(NULL, mesh);
+  EXPECT_EQ(mesh_copy->mloop[4].v, v);
+  BKE_id_free(NULL, mesh_copy);
+}
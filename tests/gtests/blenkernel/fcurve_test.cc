@@ -0,0 +1,117 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BKE_fcurve.h"
+
+#include "DNA_anim_types.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Curve with keyframes at the given frames, alternating between the given interpolations. */
+static FCurve *fcurve_test_create(const float *frames,
+                                  const int frames_len,
+                                  const eBezTriple_Interpolation *ipos,
+                                  const int ipos_len)
+{
+  FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+  fcu->totvert = frames_len;
+  fcu->bezt = (BezTriple *)MEM_calloc_arrayN(frames_len, sizeof(BezTriple), __func__);
+  for (int i = 0; i < frames_len; i++) {
+    BezTriple *bezt = &fcu->bezt[i];
+    bezt->vec[1][0] = frames[i];
+    bezt->vec[1][1] = (float)((i * 7) % 5) - 2.0f;
+    bezt->ipo = ipos[i % ipos_len];
+    bezt->easing = BEZT_IPO_EASE_IN_OUT;
+    bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+  }
+  calchandles_fcurve(fcu);
+  return fcu;
+}
+
+/* Evaluate at every time in order, then in reverse order, checking against single evaluation. */
+static void fcurve_test_samples_compare(FCurve *fcu, const float *evaltimes, const int len)
+{
+  float *values = (float *)MEM_malloc_arrayN(len, sizeof(float), __func__);
+  BKE_fcurve_evaluate_samples(fcu, evaltimes, values, len);
+  for (int i = 0; i < len; i++) {
+    EXPECT_EQ(values[i], evaluate_fcurve_only_curve(fcu, evaltimes[i]));
+  }
+
+  float *evaltimes_reverse = (float *)MEM_malloc_arrayN(len, sizeof(float), __func__);
+  for (int i = 0; i < len; i++) {
+    evaltimes_reverse[i] = evaltimes[len - 1 - i];
+  }
+  BKE_fcurve_evaluate_samples(fcu, evaltimes_reverse, values, len);
+  for (int i = 0; i < len; i++) {
+    EXPECT_EQ(values[i], evaluate_fcurve_only_curve(fcu, evaltimes_reverse[i]));
+  }
+
+  MEM_freeN(evaltimes_reverse);
+  MEM_freeN(values);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(fcurve, EvaluateSamplesSameAsSingle)
+{
+  const float frames[] = {1.0f, 4.0f, 4.5f, 10.0f, 10.00005f, 17.0f, 30.0f, 31.0f};
+  const eBezTriple_Interpolation ipos[] = {
+      BEZT_IPO_BEZ, BEZT_IPO_LIN, BEZT_IPO_CONST, BEZT_IPO_ELASTIC, BEZT_IPO_BOUNCE};
+  FCurve *fcu = fcurve_test_create(frames, ARRAY_SIZE(frames), ipos, ARRAY_SIZE(ipos));
+
+  /* Frames and sub-frames across and outside of the keyframes, including times on and within the
+   * search threshold of keyframes. */
+  const int len = 400;
+  float evaltimes[len];
+  for (int i = 0; i < len; i++) {
+    evaltimes[i] = -2.0f + i * 0.1f;
+  }
+  evaltimes[10] = 4.0f;
+  evaltimes[20] = 4.00005f;
+  evaltimes[30] = 10.00002f;
+  evaltimes[40] = 9.99995f;
+  fcurve_test_samples_compare(fcu, evaltimes, len);
+
+  /* Linear extrapolation. */
+  fcu->extend = FCURVE_EXTRAPOLATE_LINEAR;
+  fcurve_test_samples_compare(fcu, evaltimes, len);
+
+  /* Jumping around. */
+  for (int i = 0; i < len; i++) {
+    evaltimes[i] = (float)((i * 37) % 350) * 0.1f;
+  }
+  fcurve_test_samples_compare(fcu, evaltimes, len);
+
+  free_fcurve(fcu);
+}
+
+TEST(fcurve, CalculateSegmentHint)
+{
+  const float frames[] = {0.0f, 10.0f, 20.0f, 30.0f, 40.0f};
+  const eBezTriple_Interpolation ipos[] = {BEZT_IPO_BEZ};
+  FCurve *fcu = fcurve_test_create(frames, ARRAY_SIZE(frames), ipos, ARRAY_SIZE(ipos));
+
+  int segment_hint = 0;
+  EXPECT_EQ(calculate_fcurve_ex(NULL, fcu, 15.0f, &segment_hint), evaluate_fcurve(fcu, 15.0f));
+  EXPECT_EQ(segment_hint, 2);
+  EXPECT_EQ(calculate_fcurve_ex(NULL, fcu, 25.0f, &segment_hint), evaluate_fcurve(fcu, 25.0f));
+  EXPECT_EQ(segment_hint, 3);
+  EXPECT_EQ(calculate_fcurve_ex(NULL, fcu, 5.0f, &segment_hint), evaluate_fcurve(fcu, 5.0f));
+  EXPECT_EQ(segment_hint, 1);
+
+  /* Hints out of range of the keyframes (after removing some) are ignored. */
+  segment_hint = 100;
+  EXPECT_EQ(calculate_fcurve_ex(NULL, fcu, 35.0f, &segment_hint), evaluate_fcurve(fcu, 35.0f));
+  EXPECT_EQ(segment_hint, 4);
+
+  free_fcurve(fcu);
+}
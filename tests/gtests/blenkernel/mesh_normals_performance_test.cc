@@ -0,0 +1,99 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_library.h"
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 10
+
+static void mesh_normals_test_do(const int grid_size)
+{
+  Mesh *mesh = mesh_test_grid_create(grid_size, grid_size);
+  double time_start;
+
+  printf("\n========== STARTING grid %dx%d (%d vertices) ==========\n",
+         grid_size,
+         grid_size,
+         mesh->totvert);
+
+  time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    BKE_mesh_calc_normals_poly(mesh->mvert,
+                               NULL,
+                               mesh->totvert,
+                               mesh->mloop,
+                               mesh->mpoly,
+                               mesh->totloop,
+                               mesh->totpoly,
+                               NULL,
+                               false);
+  }
+  printf("Accumulate: %f\n", (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED);
+
+  time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    MeshElemMap *vert_loop_map;
+    int *vert_loop_map_mem;
+    BKE_mesh_vert_loop_map_create_parallel(
+        &vert_loop_map, &vert_loop_map_mem, mesh->mloop, mesh->totvert, mesh->totloop);
+    MEM_freeN(vert_loop_map);
+    MEM_freeN(vert_loop_map_mem);
+  }
+  printf("Create map: %f\n", (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED);
+
+  const MeshElemMap *vert_loop_map = BKE_mesh_runtime_vert_loop_map_ensure(mesh);
+  time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    BKE_mesh_calc_normals_poly_ex(mesh->mvert,
+                                  NULL,
+                                  mesh->totvert,
+                                  mesh->mloop,
+                                  mesh->mpoly,
+                                  mesh->totloop,
+                                  mesh->totpoly,
+                                  NULL,
+                                  false,
+                                  vert_loop_map);
+  }
+  printf("Gather (cached map): %f\n",
+         (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED);
+
+  BKE_id_free(NULL, mesh);
+
+  printf("========== ENDED grid %dx%d ==========\n\n", grid_size, grid_size);
+}
+
+TEST(mesh_normals, Grid100)
+{
+  BLI_threadapi_init();
+  mesh_normals_test_do(100);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals, Grid1000)
+{
+  BLI_threadapi_init();
+  mesh_normals_test_do(1000);
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals, Grid2000)
+{
+  BLI_threadapi_init();
+  mesh_normals_test_do(2000);
+  BLI_threadapi_exit();
+}
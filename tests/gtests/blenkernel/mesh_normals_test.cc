@@ -0,0 +1,101 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_library.h"
+#include "BKE_mesh_mapping.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+TEST(mesh_normals, VertLoopMap)
+{
+  BLI_threadapi_init();
+
+  Mesh *mesh = mesh_test_grid_create(100, 60);
+  MeshElemMap *vert_loop_map;
+  int *vert_loop_map_mem;
+  BKE_mesh_vert_loop_map_create_parallel(
+      &vert_loop_map, &vert_loop_map_mem, mesh->mloop, mesh->totvert, mesh->totloop);
+
+  int loops_len = 0;
+  for (int v = 0; v < mesh->totvert; v++) {
+    const MeshElemMap *map_elem = &vert_loop_map[v];
+    for (int i = 0; i < map_elem->count; i++) {
+      EXPECT_EQ(mesh->mloop[map_elem->indices[i]].v, (uint)v);
+      if (i > 0) {
+        EXPECT_LT(map_elem->indices[i - 1], map_elem->indices[i]);
+      }
+    }
+    loops_len += map_elem->count;
+  }
+  EXPECT_EQ(loops_len, mesh->totloop);
+
+  MEM_freeN(vert_loop_map);
+  MEM_freeN(vert_loop_map_mem);
+  BKE_id_free(NULL, mesh);
+
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_normals, GatherSameAsAccumulate)
+{
+  BLI_threadapi_init();
+
+  Mesh *mesh = mesh_test_grid_create(100, 60);
+  const size_t verts_len = (size_t)mesh->totvert;
+  const size_t polys_len = (size_t)mesh->totpoly;
+
+  float(*vnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*vnors) * verts_len, __func__);
+  float(*pnors)[3] = (float(*)[3])MEM_mallocN(sizeof(*pnors) * polys_len, __func__);
+  float(*vnors_gather)[3] = (float(*)[3])MEM_mallocN(sizeof(*vnors) * verts_len, __func__);
+  float(*pnors_gather)[3] = (float(*)[3])MEM_mallocN(sizeof(*pnors) * polys_len, __func__);
+  MVert *mverts = (MVert *)MEM_dupallocN(mesh->mvert);
+
+  BKE_mesh_calc_normals_poly(mverts,
+                             vnors,
+                             mesh->totvert,
+                             mesh->mloop,
+                             mesh->mpoly,
+                             mesh->totloop,
+                             mesh->totpoly,
+                             pnors,
+                             false);
+
+  const MeshElemMap *vert_loop_map = BKE_mesh_calc_normals_vert_loop_map(mesh);
+  ASSERT_TRUE(vert_loop_map != NULL);
+  BKE_mesh_calc_normals_poly_ex(mesh->mvert,
+                                vnors_gather,
+                                mesh->totvert,
+                                mesh->mloop,
+                                mesh->mpoly,
+                                mesh->totloop,
+                                mesh->totpoly,
+                                pnors_gather,
+                                false,
+                                vert_loop_map);
+
+  /* Results have to be exactly the same. */
+  EXPECT_EQ(memcmp(vnors, vnors_gather, sizeof(*vnors) * verts_len), 0);
+  EXPECT_EQ(memcmp(pnors, pnors_gather, sizeof(*pnors) * polys_len), 0);
+  EXPECT_EQ(memcmp(mverts, mesh->mvert, sizeof(*mverts) * verts_len), 0);
+
+  /* The map is cached. */
+  EXPECT_EQ(BKE_mesh_calc_normals_vert_loop_map(mesh), vert_loop_map);
+
+  MEM_freeN(mverts);
+  MEM_freeN(vnors);
+  MEM_freeN(pnors);
+  MEM_freeN(vnors_gather);
+  MEM_freeN(pnors_gather);
+  BKE_id_free(NULL, mesh);
+
+  BLI_threadapi_exit();
+}
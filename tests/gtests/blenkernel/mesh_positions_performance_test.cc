@@ -0,0 +1,120 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BKE_library.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 10
+
+/* Number of deform modifiers in the simulated stack. */
+#define DEFORM_STACK_LEN 3
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Similar to what deform modifiers do with the positions. */
+static void deform_verts(float (*vert_coords)[3], const int verts_len, const int step)
+{
+  const float angle = 0.01f * (float)(step + 1);
+  const float c = cosf(angle), s = sinf(angle);
+  for (int i = 0; i < verts_len; i++) {
+    float *co = vert_coords[i];
+    const float x = co[0] * c - co[1] * s;
+    const float y = co[0] * s + co[1] * c;
+    co[0] = x;
+    co[1] = y;
+    co[2] += 0.1f * sinf(x);
+  }
+}
+
+/* Similar to the position extraction of the draw code, which reads positions per loop. */
+static float extract_positions(const Mesh *mesh, float (*r_loop_positions)[3])
+{
+  const float(*positions)[3] = BKE_mesh_vert_positions(mesh);
+  if (positions != NULL) {
+    for (int l = 0; l < mesh->totloop; l++) {
+      copy_v3_v3(r_loop_positions[l], positions[mesh->mloop[l].v]);
+    }
+  }
+  else {
+    for (int l = 0; l < mesh->totloop; l++) {
+      copy_v3_v3(r_loop_positions[l], mesh->mvert[mesh->mloop[l].v].co);
+    }
+  }
+  /* Use the result, so the extraction isn't optimized away. */
+  return r_loop_positions[mesh->totloop - 1][2];
+}
+
+static void mesh_deform_stack_test_do(const int grid_size, const bool use_positions)
+{
+  Mesh *mesh = mesh_test_grid_create(grid_size, grid_size);
+  float(*loop_positions)[3] = (float(*)[3])MEM_mallocN(
+      sizeof(*loop_positions) * (size_t)mesh->totloop, __func__);
+  float result = 0.0f;
+
+  double time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    float(*deformed_verts)[3] = BKE_mesh_vert_coords_alloc(mesh, NULL);
+    for (int step = 0; step < DEFORM_STACK_LEN; step++) {
+      deform_verts(deformed_verts, mesh->totvert, step);
+    }
+    BKE_mesh_vert_coords_apply(mesh, deformed_verts);
+    if (use_positions) {
+      BKE_mesh_vert_positions_add(mesh, deformed_verts);
+    }
+    MEM_freeN(deformed_verts);
+  }
+  const double time_stack = (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED;
+
+  time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    result += extract_positions(mesh, loop_positions);
+  }
+  const double time_extract = (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED;
+
+  printf("%s: stack %f, extract %f, total %f (%f)\n",
+         use_positions ? "Separate positions" : "Vertices",
+         time_stack,
+         time_extract,
+         time_stack + time_extract,
+         result);
+
+  MEM_freeN(loop_positions);
+  BKE_id_free(NULL, mesh);
+}
+
+static void mesh_positions_test_do(const int grid_size)
+{
+  printf("\n========== STARTING grid %dx%d ==========\n", grid_size, grid_size);
+  mesh_deform_stack_test_do(grid_size, false);
+  mesh_deform_stack_test_do(grid_size, true);
+  printf("========== ENDED grid %dx%d ==========\n\n", grid_size, grid_size);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(mesh_positions, Grid100)
+{
+  mesh_positions_test_do(100);
+}
+
+TEST(mesh_positions, Grid1000)
+{
+  mesh_positions_test_do(1000);
+}
+
+TEST(mesh_positions, Grid2000)
+{
+  mesh_positions_test_do(2000);
+}
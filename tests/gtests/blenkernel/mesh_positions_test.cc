@@ -0,0 +1,109 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+#include "BKE_customdata_cxx.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BKE_library.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Element type of #CD_POSITION layers for the typed array access. */
+struct Position {
+  float co[3];
+};
+
+static void mesh_positions_expect_synced(const Mesh *mesh)
+{
+  const float(*positions)[3] = BKE_mesh_vert_positions(mesh);
+  ASSERT_TRUE(positions != NULL);
+  for (int i = 0; i < mesh->totvert; i++) {
+    EXPECT_EQ(positions[i][0], mesh->mvert[i].co[0]);
+    EXPECT_EQ(positions[i][1], mesh->mvert[i].co[1]);
+    EXPECT_EQ(positions[i][2], mesh->mvert[i].co[2]);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(mesh_positions, AddAndApply)
+{
+  Mesh *mesh = mesh_test_grid_create(20, 10);
+  EXPECT_TRUE(BKE_mesh_vert_positions(mesh) == NULL);
+
+  /* From the vertices. */
+  BKE_mesh_vert_positions_add(mesh, NULL);
+  mesh_positions_expect_synced(mesh);
+
+  /* Kept in sync with the vertices. */
+  float(*vert_coords)[3] = BKE_mesh_vert_coords_alloc(mesh, NULL);
+  for (int i = 0; i < mesh->totvert; i++) {
+    vert_coords[i][2] += 1.0f;
+  }
+  BKE_mesh_vert_coords_apply(mesh, vert_coords);
+  mesh_positions_expect_synced(mesh);
+  MEM_freeN(vert_coords);
+
+  /* Modified positions are copied back to the vertices. */
+  float(*positions)[3] = BKE_mesh_vert_positions_for_write(mesh);
+  EXPECT_EQ(positions, BKE_mesh_vert_positions(mesh));
+  for (int i = 0; i < mesh->totvert; i++) {
+    mul_v3_fl(positions[i], 2.0f);
+  }
+  BKE_mesh_vert_positions_apply(mesh);
+  mesh_positions_expect_synced(mesh);
+
+  BKE_mesh_vert_positions_clear(mesh);
+  EXPECT_TRUE(BKE_mesh_vert_positions(mesh) == NULL);
+
+  BKE_id_free(NULL, mesh);
+}
+
+TEST(mesh_positions, NotCopied)
+{
+  Mesh *mesh = mesh_test_grid_create(20, 10);
+  BKE_mesh_vert_positions_add(mesh, NULL);
+
+  /* Copies could modify the vertices without updating the positions. */
+  Mesh *mesh_reference = BKE_mesh_copy_for_eval(mesh, true);
+  EXPECT_TRUE(BKE_mesh_vert_positions(mesh_reference) == NULL);
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(mesh, false);
+  EXPECT_TRUE(BKE_mesh_vert_positions(mesh_copy) == NULL);
+
+  BKE_id_free(NULL, mesh_copy);
+  BKE_id_free(NULL, mesh_reference);
+  BKE_id_free(NULL, mesh);
+}
+
+TEST(mesh_positions, LayerArray)
+{
+  Mesh *mesh = mesh_test_grid_create(20, 10);
+
+  BLI::ArrayRef<Position> positions = CustomData_get_layer_array<Position>(
+      &mesh->vdata, CD_POSITION, mesh->totvert);
+  EXPECT_EQ(positions.size(), 0);
+
+  BKE_mesh_vert_positions_add(mesh, NULL);
+  positions = CustomData_get_layer_array<Position>(&mesh->vdata, CD_POSITION, mesh->totvert);
+  EXPECT_EQ(positions.size(), mesh->totvert);
+  EXPECT_EQ(positions[0].co, BKE_mesh_vert_positions(mesh)[0]);
+
+  BLI::MutableArrayRef<Position> positions_write = CustomData_get_layer_array_for_write<Position>(
+      &mesh->vdata, CD_POSITION, mesh->totvert);
+  EXPECT_EQ(positions_write.size(), mesh->totvert);
+  positions_write[1].co[0] = 10.0f;
+  BKE_mesh_vert_positions_apply(mesh);
+  EXPECT_EQ(mesh->mvert[1].co[0], 10.0f);
+
+  BKE_id_free(NULL, mesh);
+}
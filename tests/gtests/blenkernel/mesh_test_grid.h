@@ -0,0 +1,91 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __MESH_TEST_GRID_H__
+#define __MESH_TEST_GRID_H__
+
+extern "C" {
+#include "BLI_math.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_mesh.h"
+}
+
+/**
+ * Create a wavy grid of \a x by \a y faces. Some cells are split into two triangles,
+ * and an octagon is added at the end, so all kinds of polygons are tested.
+ */
+static Mesh *mesh_test_grid_create(const int x, const int y)
+{
+  const int grid_verts_len = (x + 1) * (y + 1);
+  int tris_len = 0;
+  for (int i = 0; i < x; i++) {
+    for (int j = 0; j < y; j++) {
+      tris_len += ((i + j) % 5 == 0) ? 2 : 0;
+    }
+  }
+  const int quads_len = x * y - tris_len / 2;
+  const int verts_len = grid_verts_len + 8;
+  const int polys_len = quads_len + tris_len + 1;
+  const int loops_len = quads_len * 4 + tris_len * 3 + 8;
+
+  Mesh *mesh = BKE_mesh_new_nomain(verts_len, 0, 0, loops_len, polys_len);
+
+  for (int i = 0; i <= x; i++) {
+    for (int j = 0; j <= y; j++) {
+      MVert *mv = &mesh->mvert[i * (y + 1) + j];
+      mv->co[0] = (float)i;
+      mv->co[1] = (float)j;
+      mv->co[2] = sinf((float)i * 0.3f) * cosf((float)j * 0.2f);
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    MVert *mv = &mesh->mvert[grid_verts_len + i];
+    mv->co[0] = -10.0f + cosf((float)i * (float)M_PI_4);
+    mv->co[1] = -10.0f + sinf((float)i * (float)M_PI_4);
+    mv->co[2] = (float)(i % 2) * 0.1f;
+  }
+
+  MPoly *mp = mesh->mpoly;
+  MLoop *ml = mesh->mloop;
+  int loopstart = 0;
+  for (int i = 0; i < x; i++) {
+    for (int j = 0; j < y; j++) {
+      const uint v[4] = {(uint)(i * (y + 1) + j),
+                         (uint)((i + 1) * (y + 1) + j),
+                         (uint)((i + 1) * (y + 1) + j + 1),
+                         (uint)(i * (y + 1) + j + 1)};
+      if ((i + j) % 5 == 0) {
+        const uint tris[2][3] = {{v[0], v[1], v[2]}, {v[0], v[2], v[3]}};
+        for (int t = 0; t < 2; t++) {
+          mp->loopstart = loopstart;
+          mp->totloop = 3;
+          mp++;
+          for (int k = 0; k < 3; k++) {
+            (ml++)->v = tris[t][k];
+          }
+          loopstart += 3;
+        }
+      }
+      else {
+        mp->loopstart = loopstart;
+        mp->totloop = 4;
+        mp++;
+        for (int k = 0; k < 4; k++) {
+          (ml++)->v = v[k];
+        }
+        loopstart += 4;
+      }
+    }
+  }
+  mp->loopstart = loopstart;
+  mp->totloop = 8;
+  for (int i = 0; i < 8; i++) {
+    (ml++)->v = (uint)(grid_verts_len + i);
+  }
+
+  return mesh;
+}
+
+#endif /* __MESH_TEST_GRID_H__ */
@@ -0,0 +1,123 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "mesh_test_grid.h"
+
+extern "C" {
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static Mesh *mesh_test_grid_with_edges_create(const int x, const int y)
+{
+  Mesh *mesh = mesh_test_grid_create(x, y);
+  BKE_mesh_calc_edges(mesh, false, false);
+  return mesh;
+}
+
+static void mesh_elem_maps_compare(const MeshElemMap *map,
+                                   const MeshElemMap *map_expected,
+                                   const int totelem)
+{
+  for (int i = 0; i < totelem; i++) {
+    ASSERT_EQ(map[i].count, map_expected[i].count);
+    for (int j = 0; j < map[i].count; j++) {
+      EXPECT_EQ(map[i].indices[j], map_expected[i].indices[j]);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(mesh_topology_cache, SameAsSerialMaps)
+{
+  BLI_threadapi_init();
+
+  Mesh *mesh = mesh_test_grid_with_edges_create(100, 60);
+  MeshElemMap *map;
+  int *map_mem;
+
+  BKE_mesh_vert_loop_map_create(
+      &map, &map_mem, mesh->mpoly, mesh->mloop, mesh->totvert, mesh->totpoly, mesh->totloop);
+  mesh_elem_maps_compare(BKE_mesh_runtime_vert_loop_map_ensure(mesh), map, mesh->totvert);
+  MEM_freeN(map);
+  MEM_freeN(map_mem);
+
+  BKE_mesh_vert_poly_map_create(
+      &map, &map_mem, mesh->mpoly, mesh->mloop, mesh->totvert, mesh->totpoly, mesh->totloop);
+  mesh_elem_maps_compare(BKE_mesh_runtime_vert_poly_map_ensure(mesh), map, mesh->totvert);
+  MEM_freeN(map);
+  MEM_freeN(map_mem);
+
+  BKE_mesh_vert_edge_map_create(&map, &map_mem, mesh->medge, mesh->totvert, mesh->totedge);
+  mesh_elem_maps_compare(BKE_mesh_runtime_vert_edge_map_ensure(mesh), map, mesh->totvert);
+  MEM_freeN(map);
+  MEM_freeN(map_mem);
+
+  BKE_mesh_edge_poly_map_create(&map,
+                                &map_mem,
+                                mesh->medge,
+                                mesh->totedge,
+                                mesh->mpoly,
+                                mesh->totpoly,
+                                mesh->mloop,
+                                mesh->totloop);
+  mesh_elem_maps_compare(BKE_mesh_runtime_edge_poly_map_ensure(mesh), map, mesh->totedge);
+  MEM_freeN(map);
+  MEM_freeN(map_mem);
+
+  BKE_id_free(NULL, mesh);
+
+  BLI_threadapi_exit();
+}
+
+TEST(mesh_topology_cache, SharedByReferenceCopies)
+{
+  BLI_threadapi_init();
+
+  Mesh *mesh = mesh_test_grid_with_edges_create(20, 20);
+  const MeshElemMap *map = BKE_mesh_runtime_vert_edge_map_ensure(mesh);
+
+  /* Copies referencing the topology use the same maps. */
+  Mesh *mesh_reference = BKE_mesh_copy_for_eval(mesh, true);
+  EXPECT_EQ(BKE_mesh_runtime_vert_edge_map_ensure(mesh_reference), map);
+  const MeshElemMap *map_edge_poly = BKE_mesh_runtime_edge_poly_map_ensure(mesh_reference);
+  EXPECT_EQ(BKE_mesh_runtime_edge_poly_map_ensure(mesh), map_edge_poly);
+
+  /* Copies with their own topology don't. */
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(mesh, false);
+  EXPECT_NE(BKE_mesh_runtime_vert_edge_map_ensure(mesh_copy), map);
+  BKE_id_free(NULL, mesh_copy);
+
+  /* Changing the topology in place detaches the copy from the cache. */
+  CustomData_duplicate_referenced_layer(&mesh_reference->edata, CD_MEDGE, mesh_reference->totedge);
+  BKE_mesh_update_customdata_pointers(mesh_reference, false);
+  const uint v_removed = mesh_reference->medge[0].v2;
+  mesh_reference->medge[0].v2 = mesh_reference->medge[0].v1;
+  EXPECT_EQ(BKE_mesh_runtime_vert_edge_map_ensure(mesh_reference), map);
+  BKE_mesh_runtime_topology_cache_clear(mesh_reference);
+  const MeshElemMap *map_modified = BKE_mesh_runtime_vert_edge_map_ensure(mesh_reference);
+  EXPECT_NE(map_modified, map);
+  EXPECT_EQ(map_modified[v_removed].count, map[v_removed].count - 1);
+
+  /* The maps stay valid for the other users. */
+  BKE_id_free(NULL, mesh_reference);
+  EXPECT_EQ(BKE_mesh_runtime_vert_edge_map_ensure(mesh), map);
+  EXPECT_EQ(BKE_mesh_runtime_edge_poly_map_ensure(mesh), map_edge_poly);
+
+  BKE_id_free(NULL, mesh);
+
+  BLI_threadapi_exit();
+}
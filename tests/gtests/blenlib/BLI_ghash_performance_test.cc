@@ -9,6 +9,7 @@ extern "C" {
 #include "MEM_guardedalloc.h"
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_openhash.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
 #include "PIL_time_utildefines.h"
@@ -553,3 +554,185 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* Open addressing IntHash/PtrHash, compared to GHash for the same data. */
+
+static void int_inthash_tests(const char *id, const unsigned int nbr, const bool use_random)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  int *data = (int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+  unsigned int i;
+
+  {
+    RNG *rng = BLI_rng_new(0);
+    for (i = 0; i < nbr; i++) {
+      data[i] = use_random ? BLI_rng_get_int(rng) : (int)i;
+    }
+    BLI_rng_free(rng);
+  }
+
+  IntHash *inthash = BLI_inthash_new(__func__);
+
+  {
+    TIMEIT_START(int_insert);
+
+#ifdef GHASH_RESERVE
+    BLI_inthash_reserve(inthash, nbr);
+#endif
+
+    for (i = 0; i < nbr; i++) {
+      BLI_inthash_reinsert(inthash, data[i], data[i]);
+    }
+
+    TIMEIT_END(int_insert);
+  }
+
+  {
+    TIMEIT_START(int_lookup);
+
+    for (i = 0; i < nbr; i++) {
+      const int v = BLI_inthash_lookup_default(inthash, data[i], -1);
+      EXPECT_EQ(v, data[i]);
+    }
+
+    TIMEIT_END(int_lookup);
+  }
+
+  {
+    TIMEIT_START(int_iter);
+
+    IntHashIterator ihi;
+    INTHASH_ITER (ihi, inthash) {
+      EXPECT_EQ(BLI_inthashIterator_getKey(&ihi), BLI_inthashIterator_getValue(&ihi));
+    }
+
+    TIMEIT_END(int_iter);
+  }
+
+  {
+    TIMEIT_START(int_remove);
+
+    for (i = 0; i < nbr; i++) {
+      BLI_inthash_remove(inthash, data[i]);
+    }
+
+    TIMEIT_END(int_remove);
+  }
+  EXPECT_EQ(BLI_inthash_len(inthash), 0);
+
+  BLI_inthash_free(inthash);
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, IntIntHash12000)
+{
+  int_inthash_tests("IntHash - Open Addressing - 12000", 12000, false);
+}
+
+TEST(ghash, IntRandIntHash12000)
+{
+  int_inthash_tests("RandIntHash - Open Addressing - 12000", 12000, true);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ghash, IntIntHash100000000)
+{
+  int_inthash_tests("IntHash - Open Addressing - 100000000", 100000000, false);
+}
+
+TEST(ghash, IntRandIntHash50000000)
+{
+  int_inthash_tests("RandIntHash - Open Addressing - 50000000", 50000000, true);
+}
+#endif
+
+/* Ptr: addresses of elements of an array, similar to mapping mesh elements. */
+
+static void ptr_hash_tests(const char *id, const unsigned int nbr, const bool use_ptrhash)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  /* Elements the size of a #BMVert, so addresses are spread like in real use. */
+  const size_t elem_size = 64;
+  char *data = (char *)MEM_mallocN(elem_size * (size_t)nbr, __func__);
+  unsigned int i;
+
+  GHash *ghash = NULL;
+  PtrHash *ptrhash = NULL;
+  if (use_ptrhash) {
+    ptrhash = BLI_ptrhash_new(__func__);
+  }
+  else {
+    ghash = BLI_ghash_ptr_new(__func__);
+  }
+
+  {
+    TIMEIT_START(ptr_insert);
+
+    for (i = 0; i < nbr; i++) {
+      void *p = &data[elem_size * i];
+      if (use_ptrhash) {
+        BLI_ptrhash_insert(ptrhash, p, p);
+      }
+      else {
+        BLI_ghash_insert(ghash, p, p);
+      }
+    }
+
+    TIMEIT_END(ptr_insert);
+  }
+
+  {
+    TIMEIT_START(ptr_lookup);
+
+    for (i = 0; i < nbr; i++) {
+      void *p = &data[elem_size * i];
+      void *v = use_ptrhash ? BLI_ptrhash_lookup(ptrhash, p) : BLI_ghash_lookup(ghash, p);
+      EXPECT_EQ(v, p);
+    }
+
+    TIMEIT_END(ptr_lookup);
+  }
+
+  {
+    TIMEIT_START(ptr_iter);
+
+    if (use_ptrhash) {
+      PtrHashIterator phi;
+      PTRHASH_ITER (phi, ptrhash) {
+        EXPECT_EQ(BLI_ptrhashIterator_getKey(&phi), BLI_ptrhashIterator_getValue(&phi));
+      }
+    }
+    else {
+      GHashIterator ghi;
+      GHASH_ITER (ghi, ghash) {
+        EXPECT_EQ(BLI_ghashIterator_getKey(&ghi), BLI_ghashIterator_getValue(&ghi));
+      }
+    }
+
+    TIMEIT_END(ptr_iter);
+  }
+
+  if (use_ptrhash) {
+    BLI_ptrhash_free(ptrhash);
+  }
+  else {
+    BLI_ghash_free(ghash, NULL, NULL);
+  }
+  MEM_freeN(data);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, PtrGHash1000000)
+{
+  ptr_hash_tests("PtrGHash - GHash - 1000000", 1000000, false);
+}
+
+TEST(ghash, PtrPtrHash1000000)
+{
+  ptr_hash_tests("PtrHash - Open Addressing - 1000000", 1000000, true);
+}
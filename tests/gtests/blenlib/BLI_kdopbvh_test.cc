@@ -8,8 +8,10 @@ extern "C" {
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
+#include "BLI_threads.h"
 #include "BLI_math_vector.h"
 #include "MEM_guardedalloc.h"
+#include "PIL_time_utildefines.h"
 }
 
 #include "stubs/bf_intern_eigen_stubs.h"
@@ -135,3 +137,292 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* More threads than top level branches, with more leafs in the root than
+ * KDOPBVH_THREAD_SPLIT_THRESHOLD (16384 in release builds),
+ * so the threaded binned split is used. */
+TEST(kdopbvh, ThreadedSplitFindNearest_40000)
+{
+  BLI_system_num_threads_override_set(4);
+  find_nearest_points_test(40000, 1.0, 100000, 12);
+  BLI_system_num_threads_override_set(0);
+}
+
+/**
+ * Compare the packed layout and batched queries against the regular traversal.
+ */
+static void packed_queries_test(int points_len, char tree_type, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 6);
+  BVHTree *tree_packed = BLI_bvhtree_new(points_len, 0.0, tree_type, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*dirs)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * points_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * points_len, __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+    BLI_bvhtree_insert(tree_packed, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance(tree_packed);
+  EXPECT_TRUE(BLI_bvhtree_pack(tree_packed));
+
+  /* Aim rays at other points, starting slightly before their own point. */
+  for (int i = 0; i < points_len; i++) {
+    sub_v3_v3v3(dirs[i], points[(i * 7 + 1) % points_len], points[i]);
+    if (normalize_v3(dirs[i]) == 0.0f) {
+      dirs[i][0] = 1.0f;
+    }
+  }
+  for (int i = 0; i < points_len; i++) {
+    madd_v3_v3fl(points[i], dirs[i], -0.1f);
+  }
+
+  for (int i = 0; i < points_len; i++) {
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+  BLI_bvhtree_find_nearest_batch(tree_packed, points, points_len, nearest, NULL, NULL, 0);
+
+  for (int i = 0; i < points_len; i++) {
+    BVHTreeNearest nearest_single = {0};
+    nearest_single.index = -1;
+    nearest_single.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, points[i], &nearest_single, NULL, NULL);
+    EXPECT_EQ(nearest[i].dist_sq, nearest_single.dist_sq);
+  }
+
+  BLI_bvhtree_ray_cast_batch(
+      tree_packed, points, dirs, points_len, 0.0f, hits, NULL, NULL, BVH_RAYCAST_DEFAULT);
+
+  for (int i = 0; i < points_len; i++) {
+    BVHTreeRayHit hit_single = {0};
+    hit_single.index = -1;
+    hit_single.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, points[i], dirs[i], 0.0f, &hit_single, NULL, NULL);
+    EXPECT_EQ(hits[i].index != -1, hit_single.index != -1);
+    if (hit_single.index != -1) {
+      EXPECT_FLOAT_EQ(hits[i].dist, hit_single.dist);
+    }
+  }
+
+  /* Refit moves the packed bounds too. */
+  for (int i = 0; i < points_len; i++) {
+    float co[3];
+    add_v3_v3v3(co, points[i], dirs[i]);
+    BLI_bvhtree_update_node(tree, i, co, NULL, 1);
+    BLI_bvhtree_update_node(tree_packed, i, co, NULL, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+  BLI_bvhtree_update_tree(tree_packed);
+
+  for (int i = 0; i < points_len; i++) {
+    BVHTreeNearest nearest_single = {0}, nearest_packed = {0};
+    nearest_single.index = nearest_packed.index = -1;
+    nearest_single.dist_sq = nearest_packed.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, points[i], &nearest_single, NULL, NULL);
+    BLI_bvhtree_find_nearest(tree_packed, points[i], &nearest_packed, NULL, NULL);
+    EXPECT_EQ(nearest_packed.dist_sq, nearest_single.dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_packed);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(dirs);
+  MEM_freeN(nearest);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, PackedQueries_1)
+{
+  packed_queries_test(1, 4, 1234);
+}
+TEST(kdopbvh, PackedQueriesBinary_1000)
+{
+  packed_queries_test(1000, 2, 123);
+}
+TEST(kdopbvh, PackedQueriesQuad_1000)
+{
+  packed_queries_test(1000, 4, 12);
+}
+
+/**
+ * Move all points to random new positions, then refit and rebuild the degraded parts of the tree.
+ */
+static void refit_rebuild_test(int points_len, char tree_type, bool use_pack, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  if (use_pack) {
+    BLI_bvhtree_pack(tree);
+  }
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+  }
+  BLI_bvhtree_update_tree_ex(tree, 1.0f);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, RefitRebuild_1)
+{
+  refit_rebuild_test(1, 2, false, 1234);
+}
+TEST(kdopbvh, RefitRebuildBinary_1000)
+{
+  refit_rebuild_test(1000, 2, false, 123);
+}
+TEST(kdopbvh, RefitRebuildQuadPacked_1000)
+{
+  refit_rebuild_test(1000, 4, true, 12);
+}
+
+/* -------------------------------------------------------------------- */
+/* Benchmark */
+
+static void swirl_v3(float r_co[3], const float co[3], const float factor)
+{
+  const float angle = factor * (float)M_PI * 4.0f * len_v3(co);
+  const float c = cosf(angle), s = sinf(angle);
+  r_co[0] = co[0] * c - co[1] * s;
+  r_co[1] = co[0] * s + co[1] * c;
+  r_co[2] = co[2];
+}
+
+static void find_nearest_all(BVHTree *tree, const float (*points)[3], int *r_found, int points_len)
+{
+  for (int i = 0; i < points_len; i++) {
+    r_found[i] = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+  }
+}
+
+static void nearest_point_callback(void *userdata,
+                                   int index,
+                                   const float co[3],
+                                   BVHTreeNearest *nearest)
+{
+  const float(*points)[3] = (const float(*)[3])userdata;
+  const float dist_sq = len_squared_v3v3(co, points[index]);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+  }
+}
+
+/* Compare nearest points found in the tree with the brute force nearest point,
+ * for all points and a few positions between them. */
+static void find_nearest_check(BVHTree *tree,
+                               const float (*points)[3],
+                               const int *found,
+                               int points_len,
+                               struct RNG *rng)
+{
+  for (int i = 0; i < points_len; i++) {
+    ASSERT_NE(found[i], -1);
+    EXPECT_EQ_ARRAY(points[i], points[found[i]], 3);
+  }
+
+  for (int sample = 0; sample < 100; sample++) {
+    float co[3];
+    rng_v3_round(co, 3, rng, 100000, 1.0f);
+    float dist_sq_min = FLT_MAX;
+    for (int i = 0; i < points_len; i++) {
+      dist_sq_min = min_ff(dist_sq_min, len_squared_v3v3(co, points[i]));
+    }
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co, &nearest, nearest_point_callback, (void *)points);
+    ASSERT_NE(nearest.index, -1);
+    EXPECT_EQ(nearest.dist_sq, dist_sq_min);
+  }
+}
+
+/**
+ * Time balancing and refitting (with and without rebuilding degraded sub-trees)
+ * a tree of points which are swirled around the Z axis, along with queries after each refit.
+ */
+static void build_refit_benchmark(int points_len, char tree_type)
+{
+  struct RNG *rng = BLI_rng_new(points_len);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  float(*points_swirl)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  int *found = (int *)MEM_mallocN(sizeof(int) * points_len, __func__);
+  const float rebuild_thresholds[2] = {0.0f, 1.0f};
+
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 100000, 1.0f);
+  }
+
+  printf("\n========== %d points, tree type %d ==========\n", points_len, (int)tree_type);
+
+  for (int pass = 0; pass < 2; pass++) {
+    const float rebuild_threshold = rebuild_thresholds[pass];
+    BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, 6);
+
+    for (int i = 0; i < points_len; i++) {
+      BLI_bvhtree_insert(tree, i, points[i], 1);
+    }
+
+    TIMEIT_START(balance);
+    BLI_bvhtree_balance(tree);
+    TIMEIT_END(balance);
+
+    printf("rebuild threshold: %.2f\n", rebuild_threshold);
+    for (int step = 1; step <= 4; step++) {
+      for (int i = 0; i < points_len; i++) {
+        swirl_v3(points_swirl[i], points[i], (float)step / 4.0f);
+        BLI_bvhtree_update_node(tree, i, points_swirl[i], NULL, 1);
+      }
+
+      TIMEIT_START(refit);
+      BLI_bvhtree_update_tree_ex(tree, rebuild_threshold);
+      TIMEIT_END(refit);
+
+      TIMEIT_START(find_nearest);
+      find_nearest_all(tree, points_swirl, found, points_len);
+      TIMEIT_END(find_nearest);
+
+      find_nearest_check(tree, points_swirl, found, points_len, rng);
+    }
+
+    BLI_bvhtree_free(tree);
+  }
+
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(points_swirl);
+  MEM_freeN(found);
+}
+
+TEST(kdopbvh, BenchmarkBuildRefit)
+{
+  build_refit_benchmark(20000, 2);
+  build_refit_benchmark(20000, 4);
+}
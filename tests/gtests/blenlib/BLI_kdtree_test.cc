@@ -0,0 +1,176 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+#include "MEM_guardedalloc.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static KDTree_3d *kdtree_random_new(
+    float (*points)[3], int points_len, int random_seed, uint bucket_len)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance_ex(tree, bucket_len);
+  BLI_rng_free(rng);
+  return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+static void find_nearest_n_batch_test(int points_len, uint nearest_len, uint bucket_len)
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  KDTree_3d *tree = kdtree_random_new(points, points_len, 1234, bucket_len);
+
+  /* Search from the points themselves, as well as from offset points. */
+  const int co_len = points_len * 2;
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * co_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    copy_v3_v3(co[i], points[i]);
+    const float offset[3] = {0.01f, 0.02f, 0.03f};
+    add_v3_v3v3(co[points_len + i], points[i], offset);
+  }
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest) * nearest_len * co_len, __func__);
+  KDTreeNearest_3d *nearest_single = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest_single) * nearest_len, __func__);
+
+  const int found = BLI_kdtree_3d_find_nearest_n_batch(tree, co, co_len, nearest, nearest_len);
+  EXPECT_EQ(found, (int)MIN2(nearest_len, (uint)points_len));
+
+  for (int i = 0; i < co_len; i++) {
+    const int found_single = BLI_kdtree_3d_find_nearest_n(
+        tree, co[i], nearest_single, nearest_len);
+    EXPECT_EQ(found, found_single);
+    for (int j = 0; j < found_single; j++) {
+      const KDTreeNearest_3d *n = &nearest[i * nearest_len + j];
+      EXPECT_EQ(n->index, nearest_single[j].index);
+      EXPECT_FLOAT_EQ(n->dist, nearest_single[j].dist);
+      EXPECT_V3_NEAR(n->co, points[n->index], 0.0f);
+    }
+  }
+
+  MEM_freeN(nearest_single);
+  MEM_freeN(nearest);
+  MEM_freeN(co);
+  MEM_freeN(points);
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, FindNearestBatch_1)
+{
+  find_nearest_n_batch_test(1, 4, 0);
+  find_nearest_n_batch_test(1, 4, 8);
+}
+
+TEST(kdtree, FindNearestBatch_1000)
+{
+  find_nearest_n_batch_test(1000, 1, 0);
+  find_nearest_n_batch_test(1000, 8, 0);
+}
+
+TEST(kdtree, FindNearestBatchBucketed_1000)
+{
+  find_nearest_n_batch_test(1000, 1, 8);
+  find_nearest_n_batch_test(1000, 8, 1);
+  find_nearest_n_batch_test(1000, 8, 16);
+}
+
+static void range_search_batch_test(int points_len,
+                                    float range,
+                                    uint nearest_len_max,
+                                    uint bucket_len)
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  KDTree_3d *tree = kdtree_random_new(points, points_len, 123, bucket_len);
+
+  uint *nearest_offset;
+  KDTreeNearest_3d *nearest;
+  const int found = BLI_kdtree_3d_range_search_batch(
+      tree, points, points_len, range, nearest_len_max, &nearest_offset, &nearest);
+
+  EXPECT_EQ(nearest_offset[0], 0);
+  EXPECT_EQ(nearest_offset[points_len], (uint)found);
+
+  for (int i = 0; i < points_len; i++) {
+    KDTreeNearest_3d *nearest_single;
+    int found_single = BLI_kdtree_3d_range_search(tree, points[i], &nearest_single, range);
+    /* Always finds itself. */
+    EXPECT_GE(found_single, 1);
+    if (nearest_len_max) {
+      found_single = MIN2(found_single, (int)nearest_len_max);
+    }
+    EXPECT_EQ(nearest_offset[i + 1] - nearest_offset[i], (uint)found_single);
+    for (int j = 0; j < found_single; j++) {
+      const KDTreeNearest_3d *n = &nearest[nearest_offset[i] + j];
+      EXPECT_EQ(n->index, nearest_single[j].index);
+      EXPECT_FLOAT_EQ(n->dist, nearest_single[j].dist);
+      EXPECT_LE(n->dist, range);
+    }
+    if (nearest_single) {
+      MEM_freeN(nearest_single);
+    }
+  }
+
+  if (nearest) {
+    MEM_freeN(nearest);
+  }
+  MEM_freeN(nearest_offset);
+  MEM_freeN(points);
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, RangeSearchBatch_1)
+{
+  range_search_batch_test(1, 0.1f, 0, 0);
+  range_search_batch_test(1, 0.1f, 0, 8);
+}
+
+TEST(kdtree, RangeSearchBatch_1000)
+{
+  range_search_batch_test(1000, 0.0f, 0, 0);
+  range_search_batch_test(1000, 0.2f, 0, 0);
+  range_search_batch_test(1000, 0.2f, 4, 0);
+}
+
+TEST(kdtree, RangeSearchBatchBucketed_1000)
+{
+  range_search_batch_test(1000, 0.0f, 0, 8);
+  range_search_batch_test(1000, 0.2f, 0, 1);
+  range_search_batch_test(1000, 0.2f, 0, 16);
+  range_search_batch_test(1000, 0.2f, 4, 16);
+}
+
+TEST(kdtree, BatchEmpty)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance_ex(tree, 8);
+  const float co[1][3] = {{0.0f, 0.0f, 0.0f}};
+
+  KDTreeNearest_3d nearest[4];
+  EXPECT_EQ(BLI_kdtree_3d_find_nearest_n_batch(tree, co, 1, nearest, 4), 0);
+
+  uint *nearest_offset;
+  KDTreeNearest_3d *nearest_range;
+  EXPECT_EQ(
+      BLI_kdtree_3d_range_search_batch(tree, co, 1, 1.0f, 0, &nearest_offset, &nearest_range), 0);
+  EXPECT_EQ(nearest_offset[1], 0);
+  EXPECT_EQ(nearest_range, (KDTreeNearest_3d *)NULL);
+  MEM_freeN(nearest_offset);
+
+  BLI_kdtree_3d_free(tree);
+}
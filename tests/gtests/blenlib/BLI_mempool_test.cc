@@ -0,0 +1,160 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "atomic_ops.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+};
+
+#define NUM_ITEMS 100000
+
+typedef struct MempoolTestData {
+  BLI_mempool *mempool;
+  int **items;
+} MempoolTestData;
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void mempool_alloc_func(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MempoolTestData *data = (MempoolTestData *)userdata;
+  int *item = (int *)BLI_mempool_alloc(data->mempool);
+  *item = index;
+  data->items[index] = item;
+}
+
+static void mempool_free_func(void *__restrict userdata,
+                              const int index,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MempoolTestData *data = (MempoolTestData *)userdata;
+  /* Free in a different order than allocated, from other threads. */
+  const int index_free = NUM_ITEMS - 1 - index;
+  if (index_free % 3 != 0) {
+    BLI_mempool_free(data->mempool, data->items[index_free]);
+    data->items[index_free] = NULL;
+  }
+}
+
+static void mempool_realloc_func(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MempoolTestData *data = (MempoolTestData *)userdata;
+  if (data->items[index] == NULL) {
+    int *item = (int *)BLI_mempool_alloc(data->mempool);
+    int *item_temp = (int *)BLI_mempool_alloc(data->mempool);
+    *item = index;
+    *item_temp = -1;
+    BLI_mempool_free(data->mempool, item_temp);
+    data->items[index] = item;
+  }
+}
+
+static void mempool_iter_func(void *userdata, MempoolIterData *iter)
+{
+  int *item = (int *)iter;
+  int *count = (int *)userdata;
+
+  EXPECT_GE(*item, 0);
+  EXPECT_LT(*item, NUM_ITEMS);
+  atomic_add_and_fetch_int32(count, 1);
+}
+
+static void mempool_check_items(BLI_mempool *mempool, int **items, const int items_len)
+{
+  EXPECT_EQ(BLI_mempool_len(mempool), items_len);
+
+  /* All items keep their own value, so no element was handed out twice. */
+  int items_found = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    if (items[i] != NULL) {
+      EXPECT_EQ(*items[i], i);
+      items_found++;
+    }
+  }
+  EXPECT_EQ(items_found, items_len);
+
+  int **table = (int **)BLI_mempool_as_tableN(mempool, __func__);
+  for (int i = 0; i < items_len; i++) {
+    EXPECT_EQ(items[*table[i]], table[i]);
+  }
+  MEM_freeN(table);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(mempool, ConcurrentSingleThread)
+{
+  BLI_mempool *mempool = BLI_mempool_create(
+      sizeof(int), 0, 512, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_CONCURRENT);
+  int **items = (int **)MEM_callocN(sizeof(*items) * NUM_ITEMS, __func__);
+
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    items[i] = (int *)BLI_mempool_alloc(mempool);
+    *items[i] = i;
+  }
+  mempool_check_items(mempool, items, NUM_ITEMS);
+
+  for (int i = 0; i < NUM_ITEMS; i += 2) {
+    BLI_mempool_free(mempool, items[i]);
+    items[i] = NULL;
+  }
+  mempool_check_items(mempool, items, NUM_ITEMS / 2);
+
+  BLI_mempool_clear(mempool);
+  EXPECT_EQ(BLI_mempool_len(mempool), 0);
+  int *item = (int *)BLI_mempool_alloc(mempool);
+  EXPECT_EQ(BLI_mempool_len(mempool), 1);
+  BLI_mempool_free(mempool, item);
+  EXPECT_EQ(BLI_mempool_len(mempool), 0);
+
+  MEM_freeN(items);
+  BLI_mempool_destroy(mempool);
+}
+
+TEST(mempool, ConcurrentThreads)
+{
+  BLI_threadapi_init();
+
+  MempoolTestData data;
+  data.mempool = BLI_mempool_create(
+      sizeof(int), 1024, 512, BLI_MEMPOOL_ALLOW_ITER | BLI_MEMPOOL_CONCURRENT);
+  data.items = (int **)MEM_callocN(sizeof(*data.items) * NUM_ITEMS, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+
+  BLI_task_parallel_range(0, NUM_ITEMS, &data, mempool_alloc_func, &settings);
+  mempool_check_items(data.mempool, data.items, NUM_ITEMS);
+
+  BLI_task_parallel_range(0, NUM_ITEMS, &data, mempool_free_func, &settings);
+  mempool_check_items(data.mempool, data.items, (NUM_ITEMS + 2) / 3);
+
+  /* Reuse the freed elements. */
+  BLI_task_parallel_range(0, NUM_ITEMS, &data, mempool_realloc_func, &settings);
+  mempool_check_items(data.mempool, data.items, NUM_ITEMS);
+
+  int count = 0;
+  BLI_task_parallel_mempool(data.mempool, &count, mempool_iter_func, true);
+  EXPECT_EQ(count, NUM_ITEMS);
+
+  MEM_freeN(data.items);
+  BLI_mempool_destroy(data.mempool);
+
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,73 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_mmap.h"
+}
+
+/* Truncating the file while it's mapped is only possible on POSIX systems. */
+#ifndef _WIN32
+#  include <stdlib.h>
+#  include <unistd.h>
+
+#  define MMAP_TEST_LEN (1 << 16)
+
+static int mmap_test_file_create(void)
+{
+  char filepath[] = "/tmp/blender_mmap_test_XXXXXX";
+  const int file = mkstemp(filepath);
+  if (file != -1) {
+    unlink(filepath);
+    unsigned char buf[MMAP_TEST_LEN];
+    for (int i = 0; i < MMAP_TEST_LEN; i++) {
+      buf[i] = (unsigned char)(i & 0xff);
+    }
+    EXPECT_EQ(write(file, buf, sizeof(buf)), MMAP_TEST_LEN);
+  }
+  return file;
+}
+
+TEST(mmap, Read)
+{
+  const int file = mmap_test_file_create();
+  ASSERT_NE(file, -1);
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  ASSERT_NE(mmap_file, nullptr);
+  EXPECT_EQ(BLI_mmap_get_length(mmap_file), MMAP_TEST_LEN);
+
+  unsigned char buf[4];
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buf, 1000, sizeof(buf)));
+  EXPECT_EQ(buf[0], 1000 & 0xff);
+  EXPECT_EQ(buf[3], 1003 & 0xff);
+  EXPECT_TRUE(BLI_mmap_read(mmap_file, buf, MMAP_TEST_LEN - sizeof(buf), sizeof(buf)));
+
+  /* Reading past the end fails, also when the offset overflows. */
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buf, MMAP_TEST_LEN - 2, sizeof(buf)));
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buf, (size_t)-2, sizeof(buf)));
+  EXPECT_FALSE(BLI_mmap_any_io_error(mmap_file));
+
+  BLI_mmap_free(mmap_file);
+  close(file);
+}
+
+/* Reading from a file truncated while it's mapped fails instead of raising SIGBUS. */
+TEST(mmap, Truncated)
+{
+  const int file = mmap_test_file_create();
+  ASSERT_NE(file, -1);
+  BLI_mmap_file *mmap_file = BLI_mmap_open(file);
+  ASSERT_NE(mmap_file, nullptr);
+
+  ASSERT_EQ(ftruncate(file, 0), 0);
+
+  unsigned char buf[4];
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buf, MMAP_TEST_LEN - sizeof(buf), sizeof(buf)));
+  EXPECT_TRUE(BLI_mmap_any_io_error(mmap_file));
+  /* Stays failed, the memory doesn't hold the file contents anymore. */
+  EXPECT_FALSE(BLI_mmap_read(mmap_file, buf, 0, sizeof(buf)));
+
+  BLI_mmap_free(mmap_file);
+  close(file);
+}
+#endif
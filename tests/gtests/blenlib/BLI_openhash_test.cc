@@ -0,0 +1,175 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+#include <vector>
+#include <algorithm>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_openhash.h"
+}
+
+#define VALUE_1 POINTER_FROM_INT(1)
+#define VALUE_2 POINTER_FROM_INT(2)
+
+TEST(openhash, PtrInsertLookup)
+{
+  PtrHash *ph = BLI_ptrhash_new(__func__);
+  int a, b;
+
+  ASSERT_EQ(BLI_ptrhash_len(ph), 0);
+  BLI_ptrhash_insert(ph, &a, VALUE_1);
+  BLI_ptrhash_insert(ph, &b, VALUE_2);
+  ASSERT_EQ(BLI_ptrhash_len(ph), 2);
+
+  ASSERT_EQ(BLI_ptrhash_lookup(ph, &a), VALUE_1);
+  ASSERT_EQ(BLI_ptrhash_lookup(ph, &b), VALUE_2);
+  ASSERT_EQ(BLI_ptrhash_lookup(ph, nullptr), nullptr);
+  ASSERT_EQ(BLI_ptrhash_lookup_default(ph, nullptr, VALUE_2), VALUE_2);
+
+  BLI_ptrhash_free(ph);
+}
+
+TEST(openhash, PtrReinsert)
+{
+  PtrHash *ph = BLI_ptrhash_new(__func__);
+  int a;
+
+  ASSERT_TRUE(BLI_ptrhash_reinsert(ph, &a, VALUE_1));
+  ASSERT_FALSE(BLI_ptrhash_reinsert(ph, &a, VALUE_2));
+  ASSERT_EQ(BLI_ptrhash_len(ph), 1);
+  ASSERT_EQ(BLI_ptrhash_lookup(ph, &a), VALUE_2);
+
+  BLI_ptrhash_free(ph);
+}
+
+TEST(openhash, PtrEnsure)
+{
+  PtrHash *ph = BLI_ptrhash_new(__func__);
+  int a;
+  void **value_p;
+
+  ASSERT_FALSE(BLI_ptrhash_ensure_p(ph, &a, &value_p));
+  ASSERT_EQ(*value_p, nullptr);
+  *value_p = VALUE_1;
+  ASSERT_TRUE(BLI_ptrhash_ensure_p(ph, &a, &value_p));
+  ASSERT_EQ(*value_p, VALUE_1);
+  ASSERT_EQ(BLI_ptrhash_lookup_p(ph, &a), value_p);
+
+  BLI_ptrhash_free(ph);
+}
+
+TEST(openhash, IntZeroKeyAndValue)
+{
+  IntHash *ih = BLI_inthash_new(__func__);
+
+  ASSERT_FALSE(BLI_inthash_haskey(ih, 0));
+  BLI_inthash_insert(ih, 0, 0);
+  ASSERT_TRUE(BLI_inthash_haskey(ih, 0));
+  ASSERT_EQ(BLI_inthash_lookup_default(ih, 0, -1), 0);
+  ASSERT_EQ(BLI_inthash_lookup_default(ih, 1, -1), -1);
+
+  BLI_inthash_free(ih);
+}
+
+TEST(openhash, IntPop)
+{
+  IntHash *ih = BLI_inthash_new(__func__);
+  int value;
+
+  BLI_inthash_insert(ih, 4, 40);
+  BLI_inthash_insert(ih, 5, 50);
+  ASSERT_FALSE(BLI_inthash_pop(ih, 6, &value));
+  ASSERT_TRUE(BLI_inthash_pop(ih, 4, &value));
+  ASSERT_EQ(value, 40);
+  ASSERT_EQ(BLI_inthash_len(ih), 1);
+  ASSERT_FALSE(BLI_inthash_haskey(ih, 4));
+  ASSERT_EQ(BLI_inthash_lookup(ih, 5), 50);
+  ASSERT_FALSE(BLI_inthash_remove(ih, 4));
+
+  BLI_inthash_free(ih);
+}
+
+TEST(openhash, IntManyInsertRemove)
+{
+  IntHash *ih = BLI_inthash_new(__func__);
+  const int amount = 10000;
+
+  for (int i = 0; i < amount; i++) {
+    BLI_inthash_insert(ih, i * 7, i);
+  }
+  ASSERT_EQ(BLI_inthash_len(ih), amount);
+
+  /* Remove every odd key, keeping the others findable. */
+  for (int i = 1; i < amount; i += 2) {
+    ASSERT_TRUE(BLI_inthash_remove(ih, i * 7));
+  }
+  ASSERT_EQ(BLI_inthash_len(ih), amount / 2);
+
+  for (int i = 0; i < amount; i++) {
+    if (i % 2) {
+      ASSERT_FALSE(BLI_inthash_haskey(ih, i * 7));
+    }
+    else {
+      ASSERT_EQ(BLI_inthash_lookup_default(ih, i * 7, -1), i);
+    }
+  }
+
+  /* Re-add into the slots freed by removal. */
+  for (int i = 1; i < amount; i += 2) {
+    BLI_inthash_insert(ih, i * 7, i);
+  }
+  for (int i = 0; i < amount; i++) {
+    ASSERT_EQ(BLI_inthash_lookup_default(ih, i * 7, -1), i);
+  }
+
+  BLI_inthash_free(ih);
+}
+
+TEST(openhash, IntIterator)
+{
+  IntHash *ih = BLI_inthash_new(__func__);
+  std::vector<int> keys;
+  IntHashIterator ihi;
+
+  for (int i = 0; i < 100; i++) {
+    BLI_inthash_insert(ih, i * 3, i);
+  }
+  BLI_inthash_remove(ih, 30);
+
+  INTHASH_ITER (ihi, ih) {
+    const int key = BLI_inthashIterator_getKey(&ihi);
+    ASSERT_EQ(key, BLI_inthashIterator_getValue(&ihi) * 3);
+    BLI_inthashIterator_setValue(&ihi, -key);
+    keys.push_back(key);
+  }
+  ASSERT_EQ(keys.size(), 99);
+
+  std::sort(keys.begin(), keys.end());
+  ASSERT_TRUE(std::adjacent_find(keys.begin(), keys.end()) == keys.end());
+  ASSERT_TRUE(std::find(keys.begin(), keys.end(), 30) == keys.end());
+  ASSERT_EQ(BLI_inthash_lookup(ih, 33), -33);
+
+  BLI_inthash_free(ih);
+}
+
+TEST(openhash, IntClearAndReserve)
+{
+  IntHash *ih = BLI_inthash_new_ex(__func__, 4);
+
+  BLI_inthash_reserve(ih, 1000);
+  for (int i = 0; i < 1000; i++) {
+    BLI_inthash_insert(ih, i, i);
+  }
+  BLI_inthash_clear_ex(ih, 1000);
+  ASSERT_EQ(BLI_inthash_len(ih), 0);
+  ASSERT_FALSE(BLI_inthash_haskey(ih, 5));
+
+  BLI_inthash_insert(ih, 5, 6);
+  BLI_inthash_clear(ih);
+  ASSERT_EQ(BLI_inthash_len(ih), 0);
+  BLI_inthash_insert(ih, 5, 7);
+  ASSERT_EQ(BLI_inthash_lookup(ih, 5), 7);
+
+  BLI_inthash_free(ih);
+}
@@ -0,0 +1,136 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_scratch_arena.h"
+#include "BLI_utildefines.h"
+#include "MEM_guardedalloc.h"
+}
+
+#define THREADS_LEN 8
+
+TEST(scratch_arena, Unbound)
+{
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+  char *data = (char *)BLI_scratch_alloc(100, __func__);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + 1);
+  memset(data, 1, 100);
+  BLI_scratch_free(data);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(scratch_arena, BindRestore)
+{
+  ScratchArena *arena_a = BLI_scratch_arena_new(__func__);
+  ScratchArena *arena_b = BLI_scratch_arena_new(__func__);
+
+  EXPECT_EQ(BLI_scratch_arena_bind(arena_a), (ScratchArena *)NULL);
+  EXPECT_EQ(BLI_scratch_arena_bind(arena_b), arena_a);
+  EXPECT_EQ(BLI_scratch_arena_bind(arena_a), arena_b);
+  EXPECT_EQ(BLI_scratch_arena_bind(NULL), arena_a);
+
+  BLI_scratch_arena_free(arena_a);
+  BLI_scratch_arena_free(arena_b);
+}
+
+TEST(scratch_arena, AllocFreeReverse)
+{
+  ScratchArena *arena = BLI_scratch_arena_new(__func__);
+  BLI_scratch_arena_bind(arena);
+
+  void *a = BLI_scratch_alloc(10, __func__);
+  void *b = BLI_scratch_calloc(1000, __func__);
+  EXPECT_EQ((uintptr_t)a % 16, 0);
+  EXPECT_EQ((uintptr_t)b % 16, 0);
+  EXPECT_EQ(((char *)b)[999], 0);
+  BLI_scratch_free(b);
+  /* The memory of the last allocation is reused. */
+  void *c = BLI_scratch_alloc(100, __func__);
+  EXPECT_EQ(b, c);
+  BLI_scratch_free(c);
+  BLI_scratch_free(a);
+  EXPECT_EQ(BLI_scratch_alloc(1, __func__), a);
+
+  BLI_scratch_arena_bind(NULL);
+  BLI_scratch_arena_free(arena);
+}
+
+/* Evaluating repeatedly shouldn't allocate memory after the first evaluation. */
+TEST(scratch_arena, ResetReuse)
+{
+  ScratchArena *arena = BLI_scratch_arena_new(__func__);
+  size_t reserved, used_peak;
+  unsigned int blocks_in_use = 0;
+
+  for (int eval = 0; eval < 4; eval++) {
+    BLI_scratch_arena_bind(arena);
+    /* Larger than a single chunk. */
+    std::vector<void *> buffers;
+    for (int i = 0; i < 16; i++) {
+      buffers.push_back(BLI_scratch_alloc(512 * 1024, __func__));
+    }
+    for (void *buffer : buffers) {
+      BLI_scratch_free(buffer);
+    }
+    BLI_scratch_arena_bind(NULL);
+
+    BLI_scratch_arena_stats(arena, &reserved, &used_peak);
+    EXPECT_GE(reserved, (size_t)(16 * 512 * 1024));
+    EXPECT_GE(used_peak, (size_t)(16 * 512 * 1024));
+
+    BLI_scratch_arena_reset(arena);
+    if (eval == 1) {
+      blocks_in_use = MEM_get_memory_blocks_in_use();
+    }
+    else if (eval > 1) {
+      EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+    }
+  }
+
+  BLI_scratch_arena_stats(arena, &reserved, &used_peak);
+  EXPECT_EQ(used_peak, 0);
+
+  BLI_scratch_arena_free(arena);
+}
+
+TEST(scratch_arena, Threads)
+{
+  ScratchArena *arena = BLI_scratch_arena_new(__func__);
+
+  for (int eval = 0; eval < 2; eval++) {
+    std::vector<std::vector<int *>> buffers(THREADS_LEN);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS_LEN; t++) {
+      threads.push_back(std::thread([arena, &buffers, t]() {
+        for (int i = 0; i < 1000; i++) {
+          /* Bind for every task, as done by the dependency graph. */
+          BLI_scratch_arena_bind(arena);
+          int *buffer = (int *)BLI_scratch_alloc_array((size_t)i + 1, sizeof(int), __func__);
+          for (int j = 0; j <= i; j++) {
+            buffer[j] = t;
+          }
+          buffers[t].push_back(buffer);
+          BLI_scratch_arena_bind(NULL);
+        }
+      }));
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    for (int t = 0; t < THREADS_LEN; t++) {
+      for (int i = 0; i < 1000; i++) {
+        for (int j = 0; j <= i; j++) {
+          EXPECT_EQ(buffers[t][i][j], t);
+        }
+      }
+    }
+    BLI_scratch_arena_reset(arena);
+  }
+
+  BLI_scratch_arena_free(arena);
+}
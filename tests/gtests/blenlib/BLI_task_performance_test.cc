@@ -122,6 +122,85 @@ TEST(task, RangeIter1000k)
   task_parallel_range_test_do("Range parallel iteration - Threaded - 1000K items", 1000000, true);
 }
 
+static void task_parallel_range_test_backend_do(const char *id,
+                                                const int num_items,
+                                                const eTaskSchedulerBackend backend)
+{
+  BLI_task_scheduler_backend_default_set(backend);
+  BLI_threadapi_init();
+
+  task_parallel_range_test_do(id, num_items, true);
+
+  BLI_threadapi_exit();
+  BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_QUEUE);
+}
+
+TEST(task, RangeIter100kQueue)
+{
+  task_parallel_range_test_backend_do(
+      "Range parallel iteration - Queue scheduler - 100K items",
+      100000,
+      TASK_SCHEDULER_BACKEND_QUEUE);
+}
+
+TEST(task, RangeIter100kWorkStealing)
+{
+  task_parallel_range_test_backend_do(
+      "Range parallel iteration - Work stealing scheduler - 100K items",
+      100000,
+      TASK_SCHEDULER_BACKEND_WORK_STEALING);
+}
+
+/* *** Nested parallel iterations over range of indices. *** */
+
+static void task_parallel_range_nested_func(void *UNUSED(userdata),
+                                            int index,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+
+  BLI_task_parallel_range(index, index + 1000, NULL, task_parallel_range_func, &settings);
+}
+
+static void task_parallel_range_nested_test_do(const char *id,
+                                               const eTaskSchedulerBackend backend)
+{
+  BLI_task_scheduler_backend_default_set(backend);
+  BLI_threadapi_init();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    const double init_time = PIL_check_seconds_timer();
+    BLI_task_parallel_range(i, i + 64, NULL, task_parallel_range_nested_func, &settings);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+
+  printf("\t%s: done in %fs on average over %d runs\n",
+         id,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_threadapi_exit();
+  BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_QUEUE);
+}
+
+TEST(task, RangeIterNestedQueue)
+{
+  task_parallel_range_nested_test_do("Nested range parallel iteration - Queue scheduler",
+                                     TASK_SCHEDULER_BACKEND_QUEUE);
+}
+
+TEST(task, RangeIterNestedWorkStealing)
+{
+  task_parallel_range_nested_test_do("Nested range parallel iteration - Work stealing scheduler",
+                                     TASK_SCHEDULER_BACKEND_WORK_STEALING);
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_light_iter_func(void *UNUSED(userdata),
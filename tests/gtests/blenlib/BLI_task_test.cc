@@ -137,6 +137,61 @@ TEST(task, RangeIterPool)
   BLI_threadapi_exit();
 }
 
+/* *** Nested parallel iterations with the work stealing scheduler. *** */
+
+#define NUM_ITEMS_NESTED 64
+
+static void task_range_nested_inner_func(void *userdata,
+                                         int index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  int *data = (int *)userdata;
+  atomic_add_and_fetch_int32(&data[index], 1);
+}
+
+static void task_range_nested_outer_func(void *userdata,
+                                         int index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  int(*data)[NUM_ITEMS_NESTED] = (int(*)[NUM_ITEMS_NESTED])userdata;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(
+      0, NUM_ITEMS_NESTED, data[index], task_range_nested_inner_func, &settings);
+}
+
+TEST(task, RangeIterNestedWorkStealing)
+{
+  int data[NUM_ITEMS_NESTED][NUM_ITEMS_NESTED] = {{0}};
+
+  BLI_system_num_threads_override_set(4);
+  BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_WORK_STEALING);
+  BLI_threadapi_init();
+
+  EXPECT_EQ(BLI_task_scheduler_backend(BLI_task_scheduler_get()),
+            TASK_SCHEDULER_BACKEND_WORK_STEALING);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, NUM_ITEMS_NESTED, data, task_range_nested_outer_func, &settings);
+
+  /* Every item of every nested range must have been processed exactly once. */
+  for (int i = 0; i < NUM_ITEMS_NESTED; i++) {
+    for (int j = 0; j < NUM_ITEMS_NESTED; j++) {
+      EXPECT_EQ(data[i][j], 1);
+    }
+  }
+
+  BLI_threadapi_exit();
+  BLI_task_scheduler_backend_default_set(TASK_SCHEDULER_BACKEND_QUEUE);
+  BLI_system_num_threads_override_set(0);
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
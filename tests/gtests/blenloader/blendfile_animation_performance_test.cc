@@ -0,0 +1,439 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "blendfile_loading_base_test.h"
+
+extern "C" {
+#include "BKE_action.h"
+#include "BKE_animsys.h"
+#include "BKE_armature.h"
+#include "BKE_constraint.h"
+#include "BKE_fcurve.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_nla.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math_matrix.h"
+#include "BLI_math_vector.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "MEM_guardedalloc.h"
+#include "PIL_time.h"
+}
+
+/* Played back frames. */
+#define FRAMES_LEN 100
+
+/* Armatures in the scene, bones of each and drivers of each. */
+#define ARMATURES_LEN 8
+#define BONES_LEN 200
+#define DRIVERS_LEN 50
+
+/* Chains of bones under the root bone of the rig, and bones of each chain. */
+#define RIG_CHAINS_LEN 50
+#define RIG_CHAIN_LEN 20
+
+/* Keyframes of every F-Curve. */
+#define KEYS_LEN 10
+
+class BlendfileAnimationPerformanceTest : public BlendfileLoadingBaseTest {
+};
+
+static FCurve *fcurve_add(ListBase *curves, const char *rna_path, const int array_index)
+{
+  FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+  fcu->rna_path = BLI_strdup(rna_path);
+  fcu->array_index = array_index;
+  fcu->flag = FCURVE_VISIBLE | FCURVE_SELECTED;
+  BLI_addtail(curves, fcu);
+  return fcu;
+}
+
+static void fcurve_keys_add(FCurve *fcu, const int seed)
+{
+  fcu->totvert = KEYS_LEN;
+  fcu->bezt = (BezTriple *)MEM_calloc_arrayN(KEYS_LEN, sizeof(BezTriple), __func__);
+  for (int i = 0; i < KEYS_LEN; i++) {
+    BezTriple *bezt = &fcu->bezt[i];
+    bezt->vec[1][0] = (float)(i * FRAMES_LEN / (KEYS_LEN - 1));
+    bezt->vec[1][1] = (float)((i * 7 + seed) % 5) * 0.5f;
+    bezt->ipo = BEZT_IPO_BEZ;
+    bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+  }
+  calchandles_fcurve(fcu);
+}
+
+/* Armature object with a number of bones. */
+static Object *armature_add(Main *bmain, Scene *scene, ViewLayer *view_layer)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Armature");
+  bArmature *arm = (bArmature *)ob->data;
+  for (int i = 0; i < BONES_LEN; i++) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    BLI_snprintf(bone->name, sizeof(bone->name), "Bone.%d", i);
+    bone->tail[1] = 1.0f;
+    bone->length = 1.0f;
+    bone->layer = 1;
+    unit_m3(bone->bone_mat);
+    BLI_addtail(&arm->bonebase, bone);
+  }
+  BKE_armature_where_is(arm);
+  return ob;
+}
+
+/* Action keying location, rotation and scale of the bones, except the scale of the last ones. */
+static bAction *bones_action_add(Main *bmain, const int skip_scale_len, const int seed)
+{
+  bAction *act = BKE_action_add(bmain, "Action");
+  char rna_path[128];
+  for (int i = 0; i < BONES_LEN; i++) {
+    const struct {
+      const char *name;
+      int len;
+    } channels[] = {{"location", 3}, {"rotation_quaternion", 4}, {"scale", 3}};
+    for (int c = 0; c < (int)ARRAY_SIZE(channels); c++) {
+      BLI_snprintf(
+          rna_path, sizeof(rna_path), "pose.bones[\"Bone.%d\"].%s", i, channels[c].name);
+      for (int j = 0; j < channels[c].len; j++) {
+        if (c == 2 && i >= BONES_LEN - skip_scale_len) {
+          continue;
+        }
+        fcurve_keys_add(fcurve_add(&act->curves, rna_path, j), i + j + seed);
+      }
+    }
+  }
+  return act;
+}
+
+/* Armature object, animated by an action keying location, rotation and scale of all bones, and
+ * drivers on the scale of some bones which read the location of the first one. */
+static Object *animated_armature_add(Main *bmain, Scene *scene, ViewLayer *view_layer, int index)
+{
+  Object *ob = armature_add(bmain, scene, view_layer);
+
+  /* Drivers override the scale keys of the last bones. */
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  adt->action = bones_action_add(bmain, DRIVERS_LEN, index);
+
+  char rna_path[128];
+  for (int i = BONES_LEN - DRIVERS_LEN; i < BONES_LEN; i++) {
+    BLI_snprintf(rna_path, sizeof(rna_path), "pose.bones[\"Bone.%d\"].scale", i);
+    for (int j = 0; j < 3; j++) {
+      FCurve *fcu = fcurve_add(&adt->drivers, rna_path, j);
+      fcu->driver = (ChannelDriver *)MEM_callocN(sizeof(ChannelDriver), __func__);
+      fcu->driver->type = DRIVER_TYPE_AVERAGE;
+      DriverVar *dvar = driver_add_new_variable(fcu->driver);
+      dvar->targets[0].id = &ob->id;
+      dvar->targets[0].rna_path = BLI_strdup("pose.bones[\"Bone.0\"].location[0]");
+    }
+  }
+  return ob;
+}
+
+/* Armature object, animated by NLA tracks blending actions of all bones in every mode, with the
+ * active action on top. */
+static Object *nla_armature_add(Main *bmain, Scene *scene, ViewLayer *view_layer, int index)
+{
+  Object *ob = armature_add(bmain, scene, view_layer);
+
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  const short blendmodes[] = {
+      NLASTRIP_MODE_REPLACE, NLASTRIP_MODE_ADD, NLASTRIP_MODE_MULTIPLY, NLASTRIP_MODE_COMBINE};
+  for (int i = 0; i < (int)ARRAY_SIZE(blendmodes); i++) {
+    bAction *act = bones_action_add(bmain, 0, index + i);
+    NlaTrack *nlt = BKE_nlatrack_add(adt, NULL);
+    NlaStrip *strip = BKE_nlastrip_new(act);
+    strip->blendmode = blendmodes[i];
+    strip->influence = 0.75f;
+    strip->flag |= NLASTRIP_FLAG_USR_INFLUENCE;
+    BKE_nlatrack_add_strip(nlt, strip);
+    id_us_min(&act->id);
+  }
+
+  adt->action = bones_action_add(bmain, BONES_LEN, index + ARRAY_SIZE(blendmodes));
+  adt->act_blendmode = NLASTRIP_MODE_COMBINE;
+  adt->act_influence = 0.5f;
+  return ob;
+}
+
+static Bone *rig_bone_add(bArmature *arm, Bone *parent, const char *name)
+{
+  Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+  BLI_strncpy(bone->name, name, sizeof(bone->name));
+  bone->parent = parent;
+  bone->tail[1] = 1.0f;
+  bone->layer = 1;
+  BLI_addtail(parent ? &parent->childbase : &arm->bonebase, bone);
+  return bone;
+}
+
+/* Armature object with chains of bones under a root bone, a bone in the middle of every chain
+ * constrained and an IK chain, animated by an action keying the rotation of all bones and drivers
+ * on the scale of the tips of the chains. */
+static Object *rig_add(Main *bmain, Scene *scene, ViewLayer *view_layer)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Rig");
+  bArmature *arm = (bArmature *)ob->data;
+  char name[MAXBONENAME];
+  Bone *root = rig_bone_add(arm, NULL, "Root");
+  for (int i = 0; i < RIG_CHAINS_LEN; i++) {
+    Bone *bone = root;
+    for (int j = 0; j < RIG_CHAIN_LEN; j++) {
+      BLI_snprintf(name, sizeof(name), "Chain.%d.%d", i, j);
+      bone = rig_bone_add(arm, bone, name);
+      bone->roll = 0.1f * (float)i;
+    }
+  }
+  BKE_armature_where_is(arm);
+  BKE_pose_rebuild(bmain, ob, arm, true);
+
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  adt->action = BKE_action_add(bmain, "Action");
+  char rna_path[128];
+  int i = 0;
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+    BLI_snprintf(
+        rna_path, sizeof(rna_path), "pose.bones[\"%s\"].rotation_quaternion", pchan->name);
+    for (int j = 0; j < 4; j++) {
+      fcurve_keys_add(fcurve_add(&adt->action->curves, rna_path, j), i + j);
+    }
+    i++;
+  }
+
+  for (i = 0; i < RIG_CHAINS_LEN; i++) {
+    BLI_snprintf(name, sizeof(name), "Chain.%d.%d", i, RIG_CHAIN_LEN / 2);
+    BKE_constraint_add_for_pose(
+        ob, BKE_pose_channel_find_name(ob->pose, name), NULL, CONSTRAINT_TYPE_ROTLIMIT);
+
+    BLI_snprintf(rna_path,
+                 sizeof(rna_path),
+                 "pose.bones[\"Chain.%d.%d\"].scale",
+                 i,
+                 RIG_CHAIN_LEN - 1);
+    FCurve *fcu = fcurve_add(&adt->drivers, rna_path, 0);
+    fcu->driver = (ChannelDriver *)MEM_callocN(sizeof(ChannelDriver), __func__);
+    fcu->driver->type = DRIVER_TYPE_AVERAGE;
+    DriverVar *dvar = driver_add_new_variable(fcu->driver);
+    dvar->targets[0].id = &ob->id;
+    dvar->targets[0].rna_path = BLI_strdup("pose.bones[\"Root\"].rotation_quaternion[1]");
+  }
+
+  BLI_snprintf(name, sizeof(name), "Chain.0.%d", RIG_CHAIN_LEN - 1);
+  bConstraint *con = BKE_constraint_add_for_pose(
+      ob, BKE_pose_channel_find_name(ob->pose, name), NULL, CONSTRAINT_TYPE_KINEMATIC);
+  bKinematicConstraint *data = (bKinematicConstraint *)con->data;
+  data->tar = ob;
+  STRNCPY(data->subtarget, "Chain.1.5");
+  data->rootbone = 5;
+  return ob;
+}
+
+TEST_F(BlendfileAnimationPerformanceTest, Playback)
+{
+  Main *bmain = BKE_main_new();
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  ViewLayer *view_layer = (ViewLayer *)scene->view_layers.first;
+  Object *objects[ARMATURES_LEN];
+  for (int i = 0; i < ARMATURES_LEN; i++) {
+    objects[i] = animated_armature_add(bmain, scene, view_layer, i);
+  }
+
+  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+  DEG_evaluate_on_framechange(bmain, depsgraph, 0.0f);
+
+  printf("\n========== STARTING %d armatures, %d bones, %d drivers ==========\n",
+         ARMATURES_LEN,
+         BONES_LEN,
+         DRIVERS_LEN);
+
+  double time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    scene->r.cfra = frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, (float)frame);
+  }
+  printf("Depsgraph evaluation per frame: %f\n",
+         (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  /* Only the animation of the evaluated objects, through the depsgraph callback (using resolved
+   * paths cached in the evaluated animation data) and through the generic evaluation. */
+  time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    for (int i = 0; i < ARMATURES_LEN; i++) {
+      Object *ob_eval = DEG_get_evaluated_object(depsgraph, objects[i]);
+      BKE_animsys_eval_animdata(depsgraph, &ob_eval->id);
+    }
+  }
+  printf("Animation evaluation per frame: %f\n",
+         (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  const float ctime = DEG_get_ctime(depsgraph);
+  time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    for (int i = 0; i < ARMATURES_LEN; i++) {
+      Object *ob_eval = DEG_get_evaluated_object(depsgraph, objects[i]);
+      BKE_animsys_evaluate_animdata(
+          NULL, &ob_eval->id, ob_eval->adt, ctime, ADT_RECALC_ANIM, false);
+    }
+  }
+  printf("Animation evaluation per frame (paths not cached): %f\n",
+         (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  printf("========== ENDED ==========\n\n");
+
+  DEG_graph_free(depsgraph);
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileAnimationPerformanceTest, RigPlayback)
+{
+  Main *bmain = BKE_main_new();
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  ViewLayer *view_layer = (ViewLayer *)scene->view_layers.first;
+  Object *ob = rig_add(bmain, scene, view_layer);
+  const int bones_len = BLI_listbase_count(&ob->pose->chanbase);
+
+  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+  DEG_evaluate_on_framechange(bmain, depsgraph, 0.0f);
+
+  printf("\n========== STARTING rig with %d bones ==========\n", bones_len);
+
+  const double time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    scene->r.cfra = frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, (float)frame);
+  }
+  const double time_frame = (PIL_check_seconds_timer() - time_start) / FRAMES_LEN;
+  printf("Depsgraph evaluation per frame: %f\n", time_frame);
+  printf("Bones per millisecond: %f\n", bones_len / (time_frame * 1000.0));
+
+  printf("========== ENDED ==========\n\n");
+
+  DEG_graph_free(depsgraph);
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileAnimationPerformanceTest, Sampling)
+{
+  /* One curve with many keyframes, sampled on every sub-frame like when baking. */
+  const int keys_len = 1000;
+  const int samples_len = keys_len * 100;
+  ListBase curves = {NULL, NULL};
+  FCurve *fcu = fcurve_add(&curves, "location", 0);
+  fcu->totvert = keys_len;
+  fcu->bezt = (BezTriple *)MEM_calloc_arrayN(keys_len, sizeof(BezTriple), __func__);
+  for (int i = 0; i < keys_len; i++) {
+    fcu->bezt[i].vec[1][0] = (float)(i * 10);
+    fcu->bezt[i].vec[1][1] = (float)((i * 7) % 5) * 0.5f;
+    fcu->bezt[i].ipo = BEZT_IPO_BEZ;
+    fcu->bezt[i].h1 = fcu->bezt[i].h2 = HD_AUTO_ANIM;
+  }
+  calchandles_fcurve(fcu);
+
+  float *evaltimes = (float *)MEM_malloc_arrayN(samples_len, sizeof(float), __func__);
+  float *values = (float *)MEM_malloc_arrayN(samples_len, sizeof(float), __func__);
+  for (int i = 0; i < samples_len; i++) {
+    evaltimes[i] = (float)i * 0.1f;
+  }
+
+  printf("\n========== STARTING %d keyframes, %d samples ==========\n", keys_len, samples_len);
+
+  double time_start = PIL_check_seconds_timer();
+  for (int i = 0; i < samples_len; i++) {
+    values[i] = evaluate_fcurve(fcu, evaltimes[i]);
+  }
+  printf("Single evaluation: %f\n", PIL_check_seconds_timer() - time_start);
+
+  time_start = PIL_check_seconds_timer();
+  BKE_fcurve_evaluate_samples(fcu, evaltimes, values, samples_len);
+  printf("Batch evaluation: %f\n", PIL_check_seconds_timer() - time_start);
+
+  printf("========== ENDED ==========\n\n");
+
+  MEM_freeN(evaltimes);
+  MEM_freeN(values);
+  free_fcurves(&curves);
+}
+
+TEST_F(BlendfileAnimationPerformanceTest, NlaPlayback)
+{
+  Main *bmain = BKE_main_new();
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  ViewLayer *view_layer = (ViewLayer *)scene->view_layers.first;
+  Object *objects[ARMATURES_LEN];
+  for (int i = 0; i < ARMATURES_LEN; i++) {
+    objects[i] = nla_armature_add(bmain, scene, view_layer, i);
+  }
+
+  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+  DEG_evaluate_on_framechange(bmain, depsgraph, 0.0f);
+
+  printf("\n========== STARTING %d armatures, %d bones, NLA ==========\n",
+         ARMATURES_LEN,
+         BONES_LEN);
+
+  double time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    scene->r.cfra = frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, (float)frame);
+  }
+  printf("Depsgraph evaluation per frame: %f\n",
+         (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  const float ctime = DEG_get_ctime(depsgraph);
+  time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    for (int i = 0; i < ARMATURES_LEN; i++) {
+      Object *ob_eval = DEG_get_evaluated_object(depsgraph, objects[i]);
+      BKE_animsys_eval_animdata(depsgraph, &ob_eval->id);
+    }
+  }
+  printf("NLA evaluation per frame: %f\n", (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  time_start = PIL_check_seconds_timer();
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    for (int i = 0; i < ARMATURES_LEN; i++) {
+      Object *ob_eval = DEG_get_evaluated_object(depsgraph, objects[i]);
+      BKE_animsys_evaluate_animdata(
+          NULL, &ob_eval->id, ob_eval->adt, ctime, ADT_RECALC_ANIM, false);
+    }
+  }
+  printf("NLA evaluation per frame (channels not cached): %f\n",
+         (PIL_check_seconds_timer() - time_start) / FRAMES_LEN);
+
+  printf("========== ENDED ==========\n\n");
+
+  DEG_graph_free(depsgraph);
+  BKE_main_free(bmain);
+}
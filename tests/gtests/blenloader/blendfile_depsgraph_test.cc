@@ -0,0 +1,539 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "blendfile_loading_base_test.h"
+
+#include "blenkernel/mesh_test_grid.h"
+
+#include <vector>
+
+extern "C" {
+#include "BKE_action.h"
+#include "BKE_animsys.h"
+#include "BKE_armature.h"
+#include "BKE_constraint.h"
+#include "BKE_customdata.h"
+#include "BKE_fcurve.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_nla.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math_rotation.h"
+#include "BLI_math_vector.h"
+#include "BLI_string.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_debug.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* Scenes built in memory, so no test assets are needed. */
+class BlendfileDepsgraphTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = (ViewLayer *)scene->view_layers.first;
+  }
+
+  virtual void TearDown()
+  {
+    depsgraph_free();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  void depsgraph_evaluate()
+  {
+    if (depsgraph == nullptr) {
+      depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+      DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    }
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  /* Update relations of the object incrementally, compare them with a full rebuild. */
+  void relations_update_validate(Object *ob)
+  {
+    DEG_graph_id_tag_relations_update(depsgraph, &ob->id);
+    DEG_graph_relations_update(depsgraph, bmain, scene, view_layer);
+    EXPECT_TRUE(DEG_debug_graph_relations_validate(depsgraph, bmain, scene, view_layer));
+    EXPECT_TRUE(DEG_debug_consistency_check(depsgraph));
+    depsgraph_evaluate();
+  }
+
+  /* Evaluate the armature object at the given frame, and compare the pose with the one of all
+   * bones evaluated in order. */
+  void pose_evaluate_compare(Object *ob, const float frame)
+  {
+    scene->r.cfra = (int)frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, frame);
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+    std::vector<float> pose_mats;
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &ob_eval->pose->chanbase) {
+      pose_mats.insert(pose_mats.end(), &pchan->pose_mat[0][0], &pchan->pose_mat[0][0] + 16);
+    }
+    BKE_pose_where_is(depsgraph, DEG_get_evaluated_scene(depsgraph), ob_eval);
+    int i = 0;
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &ob_eval->pose->chanbase) {
+      EXPECT_EQ_ARRAY(&pchan->pose_mat[0][0], &pose_mats[i * 16], 16);
+      i++;
+    }
+  }
+
+  /* Evaluate the animation of the object at the given frame, using the paths cached in the
+   * evaluated animation data and resolving them again, and compare the results. Transforms are
+   * cleared before both evaluations so that skipped channels are detected too. */
+  void animation_evaluate_compare(Object *ob, const float frame)
+  {
+    scene->r.cfra = (int)frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, frame);
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+
+    object_transforms_clear(ob_eval);
+    BKE_animsys_eval_animdata(depsgraph, &ob_eval->id);
+    std::vector<float> transforms = object_transforms_get(ob_eval);
+
+    object_transforms_clear(ob_eval);
+    BKE_animsys_evaluate_animdata(NULL, &ob_eval->id, ob_eval->adt, frame, ADT_RECALC_ANIM, false);
+    EXPECT_EQ(transforms, object_transforms_get(ob_eval));
+  }
+
+ private:
+  static void object_transforms_clear(Object *ob)
+  {
+    zero_v3(ob->loc);
+    if (ob->pose != NULL) {
+      LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+        zero_v3(pchan->loc);
+        unit_qt(pchan->quat);
+        copy_v3_fl(pchan->size, 1.0f);
+      }
+    }
+  }
+
+  static std::vector<float> object_transforms_get(const Object *ob)
+  {
+    std::vector<float> transforms(ob->loc, ob->loc + 3);
+    if (ob->pose != NULL) {
+      LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+        transforms.insert(transforms.end(), pchan->loc, pchan->loc + 3);
+        transforms.insert(transforms.end(), pchan->quat, pchan->quat + 4);
+        transforms.insert(transforms.end(), pchan->size, pchan->size + 3);
+      }
+    }
+    return transforms;
+  }
+};
+
+/* Mesh object using a grid mesh. */
+static Object *mesh_object_add(Main *bmain, Scene *scene, ViewLayer *view_layer)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_MESH, "Mesh");
+  Mesh *mesh = mesh_test_grid_create(20, 10);
+  BKE_mesh_calc_edges(mesh, false, false);
+  BKE_mesh_nomain_to_mesh(mesh, (Mesh *)ob->data, ob, &CD_MASK_MESH, true);
+  return ob;
+}
+
+/* Armature object with unparented bones of the given names. */
+static Object *armature_object_add(Main *bmain,
+                                   Scene *scene,
+                                   ViewLayer *view_layer,
+                                   const char **bone_names,
+                                   const int bones_len)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Armature");
+  bArmature *arm = (bArmature *)ob->data;
+  for (int i = 0; i < bones_len; i++) {
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    BLI_strncpy(bone->name, bone_names[i], sizeof(bone->name));
+    bone->tail[1] = 1.0f;
+    bone->layer = 1;
+    BLI_addtail(&arm->bonebase, bone);
+  }
+  BKE_armature_where_is(arm);
+  BKE_pose_rebuild(bmain, ob, arm, true);
+  return ob;
+}
+
+/* F-Curve with a few keyframes, the seed varies their values. */
+static FCurve *fcurve_keys_add(ListBase *curves,
+                               const char *rna_path,
+                               const int array_index,
+                               const int seed)
+{
+  const int keys_len = 5;
+  FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+  fcu->rna_path = BLI_strdup(rna_path);
+  fcu->array_index = array_index;
+  fcu->totvert = keys_len;
+  fcu->bezt = (BezTriple *)MEM_calloc_arrayN(keys_len, sizeof(BezTriple), __func__);
+  for (int i = 0; i < keys_len; i++) {
+    BezTriple *bezt = &fcu->bezt[i];
+    bezt->vec[1][0] = (float)(i * 10);
+    bezt->vec[1][1] = (float)((i * 3 + seed) % 4) * 0.5f + 0.25f;
+    bezt->ipo = BEZT_IPO_BEZ;
+    bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+  }
+  calchandles_fcurve(fcu);
+  BLI_addtail(curves, fcu);
+  return fcu;
+}
+
+/* Action keying location and rotation of the given bones. */
+static bAction *bones_action_add(Main *bmain,
+                                 const char **bone_names,
+                                 const int bones_len,
+                                 const int seed)
+{
+  bAction *act = BKE_action_add(bmain, "Action");
+  char rna_path[128];
+  for (int i = 0; i < bones_len; i++) {
+    BLI_snprintf(rna_path, sizeof(rna_path), "pose.bones[\"%s\"].location", bone_names[i]);
+    for (int j = 0; j < 3; j++) {
+      fcurve_keys_add(&act->curves, rna_path, j, seed + i + j);
+    }
+    BLI_snprintf(
+        rna_path, sizeof(rna_path), "pose.bones[\"%s\"].rotation_quaternion", bone_names[i]);
+    for (int j = 0; j < 4; j++) {
+      fcurve_keys_add(&act->curves, rna_path, j, seed + i * 2 + j);
+    }
+  }
+  return act;
+}
+
+/* Armature object with chains of bones under a root bone, and an action keying the rotation of
+ * all bones. */
+static Object *rig_object_add(Main *bmain,
+                              Scene *scene,
+                              ViewLayer *view_layer,
+                              const int chains_len,
+                              const int chain_len)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Rig");
+  bArmature *arm = (bArmature *)ob->data;
+  Bone *root = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+  STRNCPY(root->name, "Root");
+  root->tail[1] = 1.0f;
+  root->layer = 1;
+  BLI_addtail(&arm->bonebase, root);
+  for (int i = 0; i < chains_len; i++) {
+    Bone *parent = root;
+    for (int j = 0; j < chain_len; j++) {
+      Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+      BLI_snprintf(bone->name, sizeof(bone->name), "Chain.%d.%d", i, j);
+      bone->parent = parent;
+      bone->tail[1] = 1.0f;
+      bone->roll = 0.1f * (float)(i + j);
+      bone->layer = 1;
+      BLI_addtail(&parent->childbase, bone);
+      parent = bone;
+    }
+  }
+  BKE_armature_where_is(arm);
+  BKE_pose_rebuild(bmain, ob, arm, true);
+
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  adt->action = BKE_action_add(bmain, "Action");
+  char rna_path[128];
+  int seed = 0;
+  LISTBASE_FOREACH (bPoseChannel *, pchan, &ob->pose->chanbase) {
+    BLI_snprintf(
+        rna_path, sizeof(rna_path), "pose.bones[\"%s\"].rotation_quaternion", pchan->name);
+    for (int j = 0; j < 4; j++) {
+      fcurve_keys_add(&adt->action->curves, rna_path, j, seed++);
+    }
+  }
+  return ob;
+}
+
+TEST_F(BlendfileDepsgraphTest, CopyOnWriteMeshIsolated)
+{
+  Object *ob = mesh_object_add(bmain, scene, view_layer);
+  Mesh *mesh = (Mesh *)ob->data;
+  depsgraph_evaluate();
+
+  Mesh *mesh_cow = (Mesh *)DEG_get_evaluated_id(depsgraph, &mesh->id);
+  ASSERT_NE(mesh_cow, mesh);
+  EXPECT_NE(mesh_cow->mvert, mesh->mvert);
+  EXPECT_NE(mesh_cow->mloop, mesh->mloop);
+  EXPECT_FALSE(CustomData_is_shared_layer(&mesh->vdata, CD_MVERT));
+
+  /* Editing the original in place (as sculpt mode does) doesn't change the evaluated mesh. */
+  const float z = mesh->mvert[0].co[2];
+  mesh->mvert[0].co[2] = z + 1.0f;
+  mesh->mloop[0].v = mesh->mloop[1].v;
+  EXPECT_EQ(mesh_cow->mvert[0].co[2], z);
+  EXPECT_NE(mesh_cow->mloop[0].v, mesh_cow->mloop[1].v);
+
+  /* Normals calculated for the evaluated mesh are not written to the original. */
+  short no[3];
+  copy_v3_v3_short(no, mesh->mvert[0].no);
+  mesh_cow->mvert[0].co[2] = z + 10.0f;
+  BKE_mesh_calc_normals(mesh_cow);
+  EXPECT_NE(mesh_cow->mvert[0].no[2], no[2]);
+  EXPECT_EQ_ARRAY(mesh->mvert[0].no, no, 3);
+}
+
+TEST_F(BlendfileDepsgraphTest, IncrementalRelationsModifier)
+{
+  Object *ob = mesh_object_add(bmain, scene, view_layer);
+  Object *ob_offset = BKE_object_add(bmain, scene, view_layer, OB_EMPTY, "Offset");
+  const int totvert = ((Mesh *)ob->data)->totvert;
+  depsgraph_evaluate();
+
+  ArrayModifierData *amd = (ArrayModifierData *)modifier_new(eModifierType_Array);
+  amd->offset_type = MOD_ARR_OFF_OBJ;
+  amd->offset_ob = ob_offset;
+  BLI_addtail(&ob->modifiers, amd);
+  relations_update_validate(ob);
+  Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_EQ(ob_eval->runtime.mesh_eval->totvert, totvert * amd->count);
+
+  ModifierData *md = modifier_new(eModifierType_Mirror);
+  BLI_addtail(&ob->modifiers, md);
+  relations_update_validate(ob);
+
+  BLI_remlink(&ob->modifiers, amd);
+  modifier_free(&amd->modifier);
+  relations_update_validate(ob);
+  ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_GT(ob_eval->runtime.mesh_eval->totvert, totvert);
+
+  BLI_remlink(&ob->modifiers, md);
+  modifier_free(md);
+  relations_update_validate(ob);
+  ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_EQ(ob_eval->runtime.mesh_eval->totvert, totvert);
+}
+
+TEST_F(BlendfileDepsgraphTest, IncrementalRelationsConstraint)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_EMPTY, "Object");
+  Object *ob_target = BKE_object_add(bmain, scene, view_layer, OB_EMPTY, "Target");
+  const float target_loc[3] = {1.0f, 2.0f, 3.0f};
+  copy_v3_v3(ob_target->loc, target_loc);
+  depsgraph_evaluate();
+
+  bConstraint *con = BKE_constraint_add_for_object(ob, NULL, CONSTRAINT_TYPE_LOCLIKE);
+  ((bLocateLikeConstraint *)con->data)->tar = ob_target;
+  relations_update_validate(ob);
+  Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_EQ_ARRAY(ob_eval->obmat[3], target_loc, 3);
+
+  BKE_constraint_remove(&ob->constraints, con);
+  relations_update_validate(ob);
+  ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_EQ(len_v3(ob_eval->obmat[3]), 0.0f);
+}
+
+TEST_F(BlendfileDepsgraphTest, IncrementalRelationsUnreferencedID)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_EMPTY, "Object");
+  /* Target is not in the scene, it's only in the graph while the constraint uses it. */
+  Object *ob_target = BKE_object_add_only_object(bmain, OB_EMPTY, "Target");
+  depsgraph_evaluate();
+  EXPECT_EQ(DEG_get_evaluated_id(depsgraph, &ob_target->id), &ob_target->id);
+
+  bConstraint *con = BKE_constraint_add_for_object(ob, NULL, CONSTRAINT_TYPE_LOCLIKE);
+  ((bLocateLikeConstraint *)con->data)->tar = ob_target;
+  relations_update_validate(ob);
+  EXPECT_NE(DEG_get_evaluated_id(depsgraph, &ob_target->id), &ob_target->id);
+
+  /* The target stays in the graph until the next full rebuild, which validation accepts. */
+  BKE_constraint_remove(&ob->constraints, con);
+  relations_update_validate(ob);
+  EXPECT_NE(DEG_get_evaluated_id(depsgraph, &ob_target->id), &ob_target->id);
+
+  DEG_graph_tag_relations_update(depsgraph);
+  DEG_graph_relations_update(depsgraph, bmain, scene, view_layer);
+  EXPECT_EQ(DEG_get_evaluated_id(depsgraph, &ob_target->id), &ob_target->id);
+}
+
+TEST_F(BlendfileDepsgraphTest, AnimationPathCache)
+{
+  const char *bone_names[] = {"Bone", "Other"};
+  Object *ob = armature_object_add(bmain, scene, view_layer, bone_names, 2);
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  bAction *act = BKE_action_add(bmain, "Action");
+  adt->action = act;
+  fcurve_keys_add(&act->curves, "location", 0, 0);
+  FCurve *fcu = fcurve_keys_add(&act->curves, "pose.bones[\"Bone\"].location", 1, 1);
+  /* Not resolved until a bone gets this name. */
+  fcurve_keys_add(&act->curves, "pose.bones[\"Renamed\"].rotation_quaternion", 2, 2);
+  depsgraph_evaluate();
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+
+  /* Editing the action copies it again, the cached paths are checked against the new copy. */
+  MEM_freeN(fcu->rna_path);
+  fcu->rna_path = BLI_strdup("pose.bones[\"Other\"].location");
+  DEG_graph_id_tag_update(bmain, depsgraph, &act->id, ID_RECALC_COPY_ON_WRITE);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+  Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_EQ(len_v3(BKE_pose_channel_find_name(ob_eval->pose, "Bone")->loc), 0.0f);
+  EXPECT_NE(len_v3(BKE_pose_channel_find_name(ob_eval->pose, "Other")->loc), 0.0f);
+
+  /* Renaming a bone makes the path valid. */
+  bArmature *arm = (bArmature *)ob->data;
+  Bone *bone = BKE_armature_find_bone_name(arm, "Other");
+  BLI_strncpy(bone->name, "Renamed", sizeof(bone->name));
+  BKE_pose_rebuild(bmain, ob, arm, true);
+  DEG_graph_id_tag_update(bmain, depsgraph, &arm->id, ID_RECALC_COPY_ON_WRITE);
+  relations_update_validate(ob);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+  ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  bPoseChannel *pchan_eval = BKE_pose_channel_find_name(ob_eval->pose, "Renamed");
+  ASSERT_NE(pchan_eval, nullptr);
+  EXPECT_NE(pchan_eval->quat[2], 0.0f);
+}
+
+TEST_F(BlendfileDepsgraphTest, AnimationNlaCache)
+{
+  const char *bone_names[] = {"Bone", "Other"};
+  Object *ob = armature_object_add(bmain, scene, view_layer, bone_names, 2);
+  AnimData *adt = BKE_animdata_add_id(&ob->id);
+  const short blendmodes[] = {
+      NLASTRIP_MODE_REPLACE, NLASTRIP_MODE_ADD, NLASTRIP_MODE_MULTIPLY, NLASTRIP_MODE_COMBINE};
+  bAction *act_strip = NULL;
+  for (int i = 0; i < (int)ARRAY_SIZE(blendmodes); i++) {
+    act_strip = bones_action_add(bmain, bone_names, 2, i);
+    NlaTrack *nlt = BKE_nlatrack_add(adt, NULL);
+    NlaStrip *strip = BKE_nlastrip_new(act_strip);
+    strip->blendmode = blendmodes[i];
+    strip->influence = 0.75f;
+    strip->flag |= NLASTRIP_FLAG_USR_INFLUENCE;
+    BKE_nlatrack_add_strip(nlt, strip);
+    id_us_min(&act_strip->id);
+  }
+  adt->action = bones_action_add(bmain, bone_names, 1, ARRAY_SIZE(blendmodes));
+  adt->act_blendmode = NLASTRIP_MODE_COMBINE;
+  adt->act_influence = 0.5f;
+  depsgraph_evaluate();
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+
+  /* Actions copied again between evaluations, with different F-Curves. */
+  FCurve *fcu = (FCurve *)act_strip->curves.first;
+  MEM_freeN(fcu->rna_path);
+  fcu->rna_path = BLI_strdup("pose.bones[\"Other\"].location");
+  DEG_graph_id_tag_update(bmain, depsgraph, &act_strip->id, ID_RECALC_COPY_ON_WRITE);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+
+  fcu = (FCurve *)adt->action->curves.last;
+  BLI_remlink(&adt->action->curves, fcu);
+  free_fcurve(fcu);
+  DEG_graph_id_tag_update(bmain, depsgraph, &adt->action->id, ID_RECALC_COPY_ON_WRITE);
+  DEG_graph_id_tag_update(bmain, depsgraph, &act_strip->id, ID_RECALC_COPY_ON_WRITE);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    animation_evaluate_compare(ob, (float)frame);
+  }
+}
+
+TEST_F(BlendfileDepsgraphTest, RigBoneBatches)
+{
+  Object *ob = rig_object_add(bmain, scene, view_layer, 4, 8);
+  Object *ob_curve = BKE_object_add(bmain, scene, view_layer, OB_CURVE, "Curve");
+
+  /* Constrained bone in the middle of a chain, with a batch above and one below it. */
+  bConstraint *con = BKE_constraint_add_for_pose(
+      ob, BKE_pose_channel_find_name(ob->pose, "Chain.0.3"), NULL, CONSTRAINT_TYPE_ROTLIMIT);
+  bRotLimitConstraint *limit = (bRotLimitConstraint *)con->data;
+  limit->flag = LIMIT_XROT | LIMIT_ZROT;
+  limit->xmin = limit->zmin = -0.1f;
+  limit->xmax = limit->zmax = 0.1f;
+
+  /* IK chain targeting a batched bone. */
+  con = BKE_constraint_add_for_pose(
+      ob, BKE_pose_channel_find_name(ob->pose, "Chain.1.6"), NULL, CONSTRAINT_TYPE_KINEMATIC);
+  bKinematicConstraint *ik = (bKinematicConstraint *)con->data;
+  ik->tar = ob;
+  STRNCPY(ik->subtarget, "Chain.2.1");
+  ik->rootbone = 3;
+
+  con = BKE_constraint_add_for_pose(
+      ob, BKE_pose_channel_find_name(ob->pose, "Chain.2.5"), NULL, CONSTRAINT_TYPE_SPLINEIK);
+  bSplineIKConstraint *spline_ik = (bSplineIKConstraint *)con->data;
+  spline_ik->tar = ob_curve;
+  spline_ik->chainlen = 3;
+
+  /* Driven bone, reading a batched one. */
+  FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+  fcu->rna_path = BLI_strdup("pose.bones[\"Chain.3.4\"].scale");
+  fcu->driver = (ChannelDriver *)MEM_callocN(sizeof(ChannelDriver), __func__);
+  fcu->driver->type = DRIVER_TYPE_AVERAGE;
+  DriverVar *dvar = driver_add_new_variable(fcu->driver);
+  dvar->targets[0].id = &ob->id;
+  dvar->targets[0].rna_path = BLI_strdup("pose.bones[\"Chain.3.1\"].rotation_quaternion[1]");
+  BLI_addtail(&ob->adt->drivers, fcu);
+
+  depsgraph_evaluate();
+  EXPECT_TRUE(DEG_debug_consistency_check(depsgraph));
+  for (int frame = -5; frame <= 45; frame += 5) {
+    pose_evaluate_compare(ob, (float)frame);
+  }
+  Object *ob_eval = DEG_get_evaluated_object(depsgraph, ob);
+  EXPECT_NE(BKE_pose_channel_find_name(ob_eval->pose, "Chain.3.4")->size[0], 1.0f);
+
+  /* Nodes and relations of the changed batches are rebuilt incrementally, same as when building
+   * the whole graph. */
+  BKE_constraint_add_for_pose(
+      ob, BKE_pose_channel_find_name(ob->pose, "Chain.3.2"), NULL, CONSTRAINT_TYPE_ROTLIMIT);
+  relations_update_validate(ob);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    pose_evaluate_compare(ob, (float)frame);
+  }
+
+  bPoseChannel *pchan = BKE_pose_channel_find_name(ob->pose, "Chain.0.3");
+  BKE_constraint_remove(&pchan->constraints, (bConstraint *)pchan->constraints.first);
+  relations_update_validate(ob);
+  for (int frame = -5; frame <= 45; frame += 5) {
+    pose_evaluate_compare(ob, (float)frame);
+  }
+}
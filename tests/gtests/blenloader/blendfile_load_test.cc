@@ -17,6 +17,30 @@
  */
 #include "blendfile_loading_base_test.h"
 
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+
+#include "BLI_fileops.h"
+#include "BLI_linklist.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "MEM_guardedalloc.h"
+}
+
 class BlendfileLoadingTest : public BlendfileLoadingBaseTest {
 };
 
@@ -29,3 +53,186 @@ TEST_F(BlendfileLoadingTest, CanaryTest)
   depsgraph_create(DAG_EVAL_RENDER);
   EXPECT_NE(nullptr, this->depsgraph);
 }
+
+/* Write a file with meshes large enough to span several compressed chunks, then read it back.
+ * Reading the meshes data may be done in parallel. */
+static void blendfile_roundtrip_test(BlendFileData **r_bfile, const int write_flags)
+{
+  const int meshes_len = 4;
+  const int verts_len = 50000;
+
+  Main *bmain = BKE_main_new();
+  for (int m = 0; m < meshes_len; m++) {
+    Mesh *me = BKE_mesh_add(bmain, "Mesh");
+    me->totvert = verts_len + m;
+    MVert *mvert = (MVert *)CustomData_add_layer(
+        &me->vdata, CD_MVERT, CD_CALLOC, NULL, me->totvert);
+    for (int i = 0; i < me->totvert; i++) {
+      mvert[i].co[0] = (float)i;
+      mvert[i].co[1] = (float)(i % 7);
+      mvert[i].co[2] = (float)(i * 31 % 101);
+    }
+    BKE_mesh_update_customdata_pointers(me, false);
+  }
+
+  BKE_tempdir_init(NULL);
+  char filepath[FILE_MAX];
+  BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "roundtrip.blend");
+
+  ASSERT_TRUE(BLO_write_file(bmain, filepath, write_flags, NULL, NULL));
+  BKE_main_free(bmain);
+
+  if (write_flags & G_FILE_COMPRESS) {
+    /* Gzip unless the chunked container is asked for,
+     * which must not be mistaken for an uncompressed file. */
+    char header[8];
+    FILE *fp = BLI_fopen(filepath, "rb");
+    ASSERT_NE(fp, nullptr);
+    EXPECT_EQ(fread(header, 1, sizeof(header), fp), sizeof(header));
+    fclose(fp);
+    if (write_flags & G_FILE_COMPRESS_FAST) {
+      EXPECT_EQ(memcmp(header, "BLENDERZ", sizeof(header)), 0);
+    }
+    else {
+      EXPECT_EQ(memcmp(header, "\x1f\x8b", 2), 0);
+    }
+  }
+
+  *r_bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+  BLI_delete(filepath, false, false);
+  ASSERT_NE(*r_bfile, nullptr);
+
+  ASSERT_EQ(BLI_listbase_count(&(*r_bfile)->main->meshes), meshes_len);
+  int m = 0;
+  LISTBASE_FOREACH (Mesh *, me, &(*r_bfile)->main->meshes) {
+    ASSERT_EQ(me->totvert, verts_len + m);
+    ASSERT_NE(me->mvert, nullptr);
+    for (int i = 0; i < me->totvert; i++) {
+      EXPECT_EQ(me->mvert[i].co[0], (float)i);
+      EXPECT_EQ(me->mvert[i].co[1], (float)(i % 7));
+      EXPECT_EQ(me->mvert[i].co[2], (float)(i * 31 % 101));
+    }
+    m++;
+  }
+}
+
+TEST_F(BlendfileLoadingTest, RoundTrip)
+{
+  blendfile_roundtrip_test(&this->bfile, 0);
+}
+
+TEST_F(BlendfileLoadingTest, CompressedRoundTrip)
+{
+  blendfile_roundtrip_test(&this->bfile, G_FILE_COMPRESS);
+}
+
+TEST_F(BlendfileLoadingTest, CompressedFastRoundTrip)
+{
+  blendfile_roundtrip_test(&this->bfile, G_FILE_COMPRESS | G_FILE_COMPRESS_FAST);
+}
+
+/* Link one mesh (and its material) from a library only indexed on demand. */
+TEST_F(BlendfileLoadingTest, LinkLazyIndex)
+{
+  const char *names[] = {"A", "B", "C"};
+
+  Main *bmain_lib = BKE_main_new();
+  for (int m = 0; m < ARRAY_SIZE(names); m++) {
+    Mesh *me = BKE_mesh_add(bmain_lib, names[m]);
+    me->totvert = 1000 * (m + 1);
+    MVert *mvert = (MVert *)CustomData_add_layer(
+        &me->vdata, CD_MVERT, CD_CALLOC, NULL, me->totvert);
+    for (int i = 0; i < me->totvert; i++) {
+      mvert[i].co[0] = (float)(i + m);
+    }
+    BKE_mesh_update_customdata_pointers(me, false);
+
+    Material *ma = BKE_material_add(bmain_lib, names[m]);
+    ma->r = (float)m;
+    me->mat = (Material **)MEM_callocN(sizeof(*me->mat), __func__);
+    me->mat[0] = ma;
+    me->totcol = 1;
+  }
+
+  BKE_tempdir_init(NULL);
+  char filepath[FILE_MAX];
+  BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "library.blend");
+  ASSERT_TRUE(BLO_write_file(bmain_lib, filepath, 0, NULL, NULL));
+  BKE_main_free(bmain_lib);
+
+  BlendHandle *bh = BLO_blendhandle_from_file_lazy_index(filepath, NULL);
+  ASSERT_NE(bh, nullptr);
+
+  int names_len;
+  LinkNode *names_list = BLO_blendhandle_get_datablock_names(bh, ID_ME, &names_len);
+  EXPECT_EQ(names_len, ARRAY_SIZE(names));
+  BLI_linklist_free(names_list, free);
+
+  Main *bmain = BKE_main_new();
+  Main *mainl = BLO_library_link_begin(bmain, &bh, filepath);
+  ID *id = BLO_library_link_named_part(mainl, &bh, ID_ME, "B");
+  EXPECT_NE(id, nullptr);
+  BLO_library_link_end(mainl, &bh, 0, bmain, NULL, NULL, NULL);
+  BLO_blendhandle_close(bh);
+  BLI_delete(filepath, false, false);
+
+  ASSERT_EQ(BLI_listbase_count(&bmain->meshes), 1);
+  Mesh *me = (Mesh *)bmain->meshes.first;
+  EXPECT_STREQ(me->id.name + 2, "B");
+  ASSERT_EQ(me->totvert, 2000);
+  for (int i = 0; i < me->totvert; i++) {
+    EXPECT_EQ(me->mvert[i].co[0], (float)(i + 1));
+  }
+
+  /* Only the material used by the mesh is read. */
+  ASSERT_EQ(BLI_listbase_count(&bmain->materials), 1);
+  ASSERT_EQ(me->totcol, 1);
+  EXPECT_EQ(me->mat[0], bmain->materials.first);
+  EXPECT_EQ(me->mat[0]->r, 1.0f);
+
+  BKE_main_free(bmain);
+}
+
+/* Undo steps only store data that changed, data only used by older steps may be compressed.
+ * Read the first step back after the second step inserted and changed data before it. */
+TEST_F(BlendfileLoadingTest, MemfileUndo)
+{
+  const int verts_len = 50000;
+
+  Main *bmain = BKE_main_new();
+  Mesh *me = BKE_mesh_add(bmain, "Mesh");
+  me->totvert = verts_len;
+  MVert *mvert = (MVert *)CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, verts_len);
+  for (int i = 0; i < verts_len; i++) {
+    mvert[i].co[0] = (float)i;
+  }
+  BKE_mesh_update_customdata_pointers(me, false);
+
+  MemFile memfile_a = {{NULL}}, memfile_b = {{NULL}};
+  ASSERT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_a, 0));
+
+  /* Sorted before the other mesh, offsetting all of its data. */
+  BKE_mesh_add(bmain, "Added");
+  for (int i = 0; i < 100; i++) {
+    me->mvert[i].co[1] = 1.0f;
+  }
+  ASSERT_TRUE(BLO_write_file_mem(bmain, &memfile_a, &memfile_b, 0));
+  EXPECT_LT(memfile_b.size, memfile_a.size / 2);
+
+  BLO_memfile_chunk_store_wait();
+  BlendFileData *bfd = BLO_read_from_memfile(bmain, "", &memfile_a, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(bfd, nullptr);
+  ASSERT_EQ(BLI_listbase_count(&bfd->main->meshes), 1);
+  me = (Mesh *)bfd->main->meshes.first;
+  ASSERT_EQ(me->totvert, verts_len);
+  for (int i = 0; i < verts_len; i++) {
+    EXPECT_EQ(me->mvert[i].co[0], (float)i);
+    EXPECT_EQ(me->mvert[i].co[1], 0.0f);
+  }
+  BKE_main_free(bfd->main);
+  MEM_freeN(bfd);
+
+  BLO_memfile_free(&memfile_a);
+  BLO_memfile_free(&memfile_b);
+  BKE_main_free(bmain);
+}
@@ -0,0 +1,148 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "blendfile_loading_base_test.h"
+
+extern "C" {
+#include "BKE_customdata.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "MEM_guardedalloc.h"
+#include "PIL_time.h"
+}
+
+/* Number of undo steps pushed. */
+#define STEPS_LEN 100
+
+/* Meshes in the file, and vertices of each. */
+#define MESHES_LEN 8
+#define VERTS_LEN 100000
+
+class BlendfileUndoPerformanceTest : public BlendfileLoadingBaseTest {
+};
+
+static Mesh *mesh_add(Main *bmain, const char *name, const int verts_len)
+{
+  Mesh *me = BKE_mesh_add(bmain, name);
+  me->totvert = verts_len;
+  MVert *mvert = (MVert *)CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, verts_len);
+  for (int i = 0; i < verts_len; i++) {
+    mvert[i].co[0] = (float)(i % 1000);
+    mvert[i].co[1] = (float)(i / 1000);
+    mvert[i].co[2] = (float)(i % 7);
+  }
+  BKE_mesh_update_customdata_pointers(me, false);
+  return me;
+}
+
+/* A scripted edit session, every step does one of:
+ * - Moving some vertices of a mesh.
+ * - Adding a small mesh (sorted before the others, offsetting all their data in the file).
+ * - Moving all vertices of a mesh.
+ * - Selecting a vertex.
+ */
+static void edit_step(Main *bmain, const int step)
+{
+  /* Edit the original meshes, sorted after the added ones. */
+  const int mesh_index = BLI_listbase_count(&bmain->meshes) - 1 - (step / 4) % MESHES_LEN;
+  Mesh *me = (Mesh *)BLI_findlink(&bmain->meshes, mesh_index);
+  switch (step % 4) {
+    case 0:
+      for (int i = 0; i < me->totvert; i += 100) {
+        me->mvert[i].co[2] += 1.0f;
+      }
+      break;
+    case 1: {
+      char name[MAX_NAME];
+      BLI_snprintf(name, sizeof(name), "Added_%d", step);
+      mesh_add(bmain, name, 100);
+      break;
+    }
+    case 2:
+      for (int i = 0; i < me->totvert; i++) {
+        me->mvert[i].co[0] += 0.5f;
+      }
+      break;
+    case 3:
+      me->mvert[step].flag ^= SELECT;
+      break;
+  }
+}
+
+TEST_F(BlendfileUndoPerformanceTest, EditSession)
+{
+  Main *bmain = BKE_main_new();
+  for (int m = 0; m < MESHES_LEN; m++) {
+    char name[MAX_NAME];
+    BLI_snprintf(name, sizeof(name), "Mesh_%d", m);
+    mesh_add(bmain, name, VERTS_LEN);
+  }
+
+  MemFile *memfiles = (MemFile *)MEM_callocN(sizeof(*memfiles) * STEPS_LEN, __func__);
+  double push_time_total = 0.0, push_time_max = 0.0;
+  size_t size_stored = 0, size_full = 0;
+
+  for (int step = 0; step < STEPS_LEN; step++) {
+    if (step != 0) {
+      edit_step(bmain, step);
+    }
+
+    const double time_start = PIL_check_seconds_timer();
+    BLO_write_file_mem(bmain, step ? &memfiles[step - 1] : NULL, &memfiles[step], 0);
+    const double push_time = PIL_check_seconds_timer() - time_start;
+
+    push_time_total += push_time;
+    push_time_max = MAX2(push_time_max, push_time);
+    size_stored += memfiles[step].size;
+    LISTBASE_FOREACH (MemFileChunk *, chunk, &memfiles[step].chunks) {
+      size_full += chunk->size;
+    }
+  }
+
+  BLO_memfile_chunk_store_wait();
+  size_t chunks_len, size_resident, size_compressed;
+  BLO_memfile_chunk_store_stats(&chunks_len, &size_resident, &size_compressed);
+
+  printf("Undo push: %.3f ms average, %.3f ms max\n",
+         push_time_total * 1000.0 / STEPS_LEN,
+         push_time_max * 1000.0);
+  printf("Full copies: %.2f MB, stored: %.2f MB\n",
+         (double)size_full / (1 << 20),
+         (double)size_stored / (1 << 20));
+  printf("Chunk store: %d chunks, %.2f MB resident, %.2f MB compressed\n",
+         (int)chunks_len,
+         (double)size_resident / (1 << 20),
+         (double)size_compressed / (1 << 20));
+
+  for (int step = 0; step < STEPS_LEN; step++) {
+    BLO_memfile_free(&memfiles[step]);
+  }
+  MEM_freeN(memfiles);
+  BKE_main_free(bmain);
+}
@@ -0,0 +1,73 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "PIL_time.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+/* Allocations done by every thread. */
+#define ALLOCS_LEN 1000000
+
+/* Blocks each thread keeps allocated, freeing the oldest one for every allocation. */
+#define BLOCKS_LIVE_LEN 64
+
+static void alloc_free_thread(const int seed)
+{
+  void *blocks[BLOCKS_LIVE_LEN] = {NULL};
+  unsigned int rand = (unsigned int)seed;
+  for (int i = 0; i < ALLOCS_LEN; i++) {
+    rand = rand * 1103515245 + 12345;
+    void **block = &blocks[i % BLOCKS_LIVE_LEN];
+    if (*block) {
+      MEM_freeN(*block);
+    }
+    /* Small blocks, as typically allocated for lists & temporary data. */
+    *block = MEM_mallocN(8 + (rand >> 16) % 248, __func__);
+  }
+  for (int i = 0; i < BLOCKS_LIVE_LEN; i++) {
+    MEM_SAFE_FREE(blocks[i]);
+  }
+}
+
+static void alloc_free_test(const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  for (int threads_len = 1; threads_len <= 64; threads_len *= 2) {
+    const double time_start = PIL_check_seconds_timer();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_len; t++) {
+      threads.push_back(std::thread(alloc_free_thread, t));
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    const double time = PIL_check_seconds_timer() - time_start;
+    printf("%2d threads: %8.3f ms, %6.1f M allocations per second\n",
+           threads_len,
+           time * 1000.0,
+           (double)threads_len * ALLOCS_LEN / time / 1e6);
+  }
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(guardedalloc, LockfreeAllocFree)
+{
+  alloc_free_test("Lock-free allocator");
+}
+
+TEST(guardedalloc, LockfreeAllocFreeSmallBlockCache)
+{
+  MEM_use_small_block_cache();
+  alloc_free_test("Lock-free allocator, small block cache");
+}
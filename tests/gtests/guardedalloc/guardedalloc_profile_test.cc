@@ -0,0 +1,75 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+namespace {
+
+std::string temp_filepath(const std::string &filename)
+{
+  const char *dir = getenv("TMPDIR");
+#ifdef _WIN32
+  if (dir == NULL) {
+    dir = getenv("TEMP");
+  }
+#endif
+  return std::string(dir ? dir : "/tmp") + "/" + filename;
+}
+
+std::string read_file(const std::string &filepath)
+{
+  std::ifstream file(filepath);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+}  // namespace
+
+TEST(guardedalloc, GuardedProfile)
+{
+  MEM_use_guarded_allocator();
+  MEM_profile_enable(true);
+
+  std::vector<void *> blocks;
+  for (int i = 0; i < 10; i++) {
+    blocks.push_back(MEM_mallocN(100, "profile_test_a"));
+  }
+  for (int i = 0; i < 5; i++) {
+    MEM_freeN(blocks.back());
+    blocks.pop_back();
+  }
+  void *block_b = MEM_callocN(1000, "profile_test_b");
+  MEM_freeN(block_b);
+
+  const std::string filepath_json = temp_filepath("guardedalloc_profile_test.json");
+  EXPECT_TRUE(MEM_profile_write(filepath_json.c_str()));
+  const std::string json = read_file(filepath_json);
+  EXPECT_NE(json.find("{\"name\": \"profile_test_a\", \"count\": 10, \"bytes\": 1000, "
+                      "\"live_count\": 5, \"live_bytes\": 500, \"peak_bytes\": 1000, "
+                      "\"lifetime\": ["),
+            std::string::npos);
+  EXPECT_NE(json.find("{\"name\": \"profile_test_b\", \"count\": 1, \"bytes\": 1000, "
+                      "\"live_count\": 0, \"live_bytes\": 0, \"peak_bytes\": 1000, "
+                      "\"lifetime\": ["),
+            std::string::npos);
+  remove(filepath_json.c_str());
+
+  const std::string filepath_collapsed = temp_filepath("guardedalloc_profile_test.txt");
+  EXPECT_TRUE(MEM_profile_write(filepath_collapsed.c_str()));
+  const std::string collapsed = read_file(filepath_collapsed);
+  EXPECT_NE(collapsed.find("profile_test_a 1000\n"), std::string::npos);
+  EXPECT_NE(collapsed.find("profile_test_b 1000\n"), std::string::npos);
+  remove(filepath_collapsed.c_str());
+
+  for (void *block : blocks) {
+    MEM_freeN(block);
+  }
+}
@@ -0,0 +1,90 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+#define THREADS_LEN 8
+#define BLOCKS_LEN 1000
+
+/* Blocks allocated by one thread and freed by another. */
+TEST(guardedalloc, LockfreeStatsThreads)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  std::vector<std::vector<void *>> blocks(THREADS_LEN);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS_LEN; t++) {
+    threads.push_back(std::thread([&blocks, t]() {
+      for (int i = 0; i < BLOCKS_LEN; i++) {
+        blocks[t].push_back(MEM_mallocN((size_t)(i % 300) * 4 + 4, __func__));
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  size_t mem_allocated = 0;
+  for (int t = 0; t < THREADS_LEN; t++) {
+    for (int i = 0; i < BLOCKS_LEN; i++) {
+      mem_allocated += (size_t)(i % 300) * 4 + 4;
+    }
+  }
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use + mem_allocated);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + THREADS_LEN * BLOCKS_LEN);
+  EXPECT_GE(MEM_get_peak_memory(), mem_in_use + mem_allocated);
+
+  for (int t = 0; t < THREADS_LEN; t++) {
+    threads.push_back(std::thread([&blocks, t]() {
+      for (void *block : blocks[(t + 1) % THREADS_LEN]) {
+        MEM_freeN(block);
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(guardedalloc, LockfreeSmallBlockCache)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+
+  MEM_use_small_block_cache();
+
+  void *block = MEM_mallocN(100, __func__);
+  EXPECT_EQ(MEM_allocN_len(block), 100);
+  memset(block, 1, 100);
+  MEM_freeN(block);
+
+  /* Reused for the same size class. */
+  char *block_reused = (char *)MEM_callocN(104, __func__);
+  EXPECT_EQ((void *)block_reused, block);
+  EXPECT_EQ(MEM_allocN_len(block_reused), 104);
+  for (int i = 0; i < 104; i++) {
+    EXPECT_EQ(block_reused[i], 0);
+  }
+
+  block_reused = (char *)MEM_reallocN(block_reused, 1000);
+  EXPECT_EQ(MEM_allocN_len(block_reused), 1000);
+  for (int i = 0; i < 104; i++) {
+    EXPECT_EQ(block_reused[i], 0);
+  }
+  MEM_freeN(block_reused);
+
+  /* Cached blocks are counted as freed. */
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+}
@@ -0,0 +1,185 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "dna_sdna_builder.h"
+
+extern "C" {
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+}
+
+/* Number of blocks to convert, similar to the vertices of a dense mesh. */
+#define BLOCKS_LEN 1000000
+
+/* Number of separately stored blocks of a large struct. */
+#define BLOCKS_LARGE_LEN 20000
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void reconstruct_test(const char *id,
+                             const SDNABuilder &old_builder,
+                             const SDNABuilder &new_builder,
+                             const char *type,
+                             const int blocks)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  SDNA *oldsdna = old_builder.build();
+  SDNA *newsdna = new_builder.build();
+  const int old_struct_nr = DNA_struct_find_nr(oldsdna, type);
+  const int old_size = oldsdna->types_size[oldsdna->structs[old_struct_nr][0]];
+
+  char *old_data = (char *)MEM_mallocN((size_t)old_size * blocks, __func__);
+  RNG *rng = BLI_rng_new(0);
+  BLI_rng_get_char_n(rng, old_data, (size_t)old_size * blocks);
+  BLI_rng_free(rng);
+
+  const char *compare_flags = DNA_struct_get_compareflags(oldsdna, newsdna);
+  DNA_ReconstructInfo *reconstruct_info;
+
+  TIMEIT_START(reconstruct_info_create);
+  reconstruct_info = DNA_reconstruct_info_create(oldsdna, newsdna, compare_flags, false);
+  TIMEIT_END(reconstruct_info_create);
+
+  {
+    /* All blocks of an array at once. */
+    void *new_data;
+    TIMEIT_START(reconstruct_array);
+    new_data = DNA_struct_reconstruct(reconstruct_info, old_struct_nr, blocks, old_data);
+    TIMEIT_END(reconstruct_array);
+    MEM_freeN(new_data);
+  }
+
+  {
+    /* Every block separately. */
+    TIMEIT_START(reconstruct_single);
+    for (int i = 0; i < blocks; i++) {
+      void *new_data = DNA_struct_reconstruct(
+          reconstruct_info, old_struct_nr, 1, old_data + (size_t)old_size * i);
+      MEM_freeN(new_data);
+    }
+    TIMEIT_END(reconstruct_single);
+  }
+
+  DNA_reconstruct_info_free(reconstruct_info);
+  MEM_freeN((void *)compare_flags);
+  MEM_freeN(old_data);
+  DNA_sdna_free(newsdna);
+  DNA_sdna_free(oldsdna);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+/* Versions of a vertex struct, the current one is #vert_builder_current. */
+
+static void vert_builder_current(SDNABuilder &builder)
+{
+  builder.add_struct(
+      "Vert", {{"float", "co[3]"}, {"short", "no[3]"}, {"char", "flag"}, {"char", "bweight"}});
+}
+
+/** An older version, before a member was added. */
+static void vert_builder_added_member(SDNABuilder &builder)
+{
+  builder.add_struct("Vert", {{"float", "co[3]"}, {"short", "no[3]"}, {"char", "flag"}});
+}
+
+/** An older version, with members in a different order. */
+static void vert_builder_reordered(SDNABuilder &builder)
+{
+  builder.add_struct(
+      "Vert", {{"char", "flag"}, {"char", "bweight"}, {"short", "no[3]"}, {"float", "co[3]"}});
+}
+
+/** An older version, with a different type of a member. */
+static void vert_builder_type_changed(SDNABuilder &builder)
+{
+  builder.add_struct(
+      "Vert", {{"float", "co[3]"}, {"short", "no[3]"}, {"char", "flag"}, {"uchar", "bweight"}});
+}
+
+/* Versions of a large struct with nested structs & pointers. */
+
+static void large_builder(SDNABuilder &builder, const int version)
+{
+  builder.add_struct("Vec", {{"float", "x"}, {"float", "y"}, {"float", "z"}});
+
+  SDNABuilder::Members nested = {{"void", "*next"}, {"void", "*prev"}, {"int", "flag"}};
+  if (version > 0) {
+    nested.push_back({"int", "mode"});
+  }
+  builder.add_struct("Nested", nested);
+
+  SDNABuilder::Members members = {{"void", "*next"}, {"void", "*prev"}, {"char", "name[64]"}};
+  for (int i = 0; i < 64; i++) {
+    members.push_back({"float", "value_" + std::to_string(i)});
+    if (version > 1 && i == 32) {
+      members.push_back({"int", "added"});
+    }
+  }
+  members.push_back({"Vec", "vec[8]"});
+  members.push_back({"Nested", "nested[4]"});
+  members.push_back({"void", "*data[16]"});
+  builder.add_struct("Large", members);
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(dna_genfile, ReconstructVertAddedMember)
+{
+  SDNABuilder old_builder(8), new_builder(8);
+  vert_builder_added_member(old_builder);
+  vert_builder_current(new_builder);
+  reconstruct_test("Vert - added member", old_builder, new_builder, "Vert", BLOCKS_LEN);
+}
+
+TEST(dna_genfile, ReconstructVertReordered)
+{
+  SDNABuilder old_builder(8), new_builder(8);
+  vert_builder_reordered(old_builder);
+  vert_builder_current(new_builder);
+  reconstruct_test("Vert - reordered", old_builder, new_builder, "Vert", BLOCKS_LEN);
+}
+
+TEST(dna_genfile, ReconstructVertTypeChanged)
+{
+  SDNABuilder old_builder(8), new_builder(8);
+  vert_builder_type_changed(old_builder);
+  vert_builder_current(new_builder);
+  reconstruct_test("Vert - type changed", old_builder, new_builder, "Vert", BLOCKS_LEN);
+}
+
+TEST(dna_genfile, ReconstructVertPointerSize)
+{
+  SDNABuilder old_builder(4), new_builder(8);
+  vert_builder_current(old_builder);
+  vert_builder_current(new_builder);
+  reconstruct_test("Vert - 32 bit pointers", old_builder, new_builder, "Vert", BLOCKS_LEN);
+}
+
+TEST(dna_genfile, ReconstructLarge)
+{
+  for (int version = 0; version < 2; version++) {
+    SDNABuilder old_builder(8), new_builder(8);
+    large_builder(old_builder, version);
+    large_builder(new_builder, 2);
+    reconstruct_test(("Large - version " + std::to_string(version)).c_str(),
+                     old_builder,
+                     new_builder,
+                     "Large",
+                     BLOCKS_LARGE_LEN);
+  }
+}
+
+TEST(dna_genfile, ReconstructLargePointerSize)
+{
+  SDNABuilder old_builder(4), new_builder(8);
+  large_builder(old_builder, 2);
+  large_builder(new_builder, 2);
+  reconstruct_test(
+      "Large - 32 bit pointers", old_builder, new_builder, "Large", BLOCKS_LARGE_LEN);
+}
@@ -0,0 +1,258 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "dna_sdna_builder.h"
+
+extern "C" {
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+}
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+template<typename T>
+static void elem_set(SDNA *sdna, char *data, const char *type, const char *name, T value)
+{
+  memcpy(data + DNA_elem_offset(sdna, "Foo", type, name), &value, sizeof(value));
+}
+
+template<typename T>
+static T elem_get(SDNA *sdna, const char *data, const char *type, const char *name)
+{
+  T value;
+  memcpy(&value, data + DNA_elem_offset(sdna, "Foo", type, name), sizeof(value));
+  return value;
+}
+
+static int struct_size(const SDNA *sdna, const char *type)
+{
+  return sdna->types_size[sdna->structs[DNA_struct_find_nr(sdna, type)][0]];
+}
+
+static void *reconstruct(const SDNA *oldsdna, const SDNA *newsdna, int blocks, const void *data)
+{
+  const char *compare_flags = DNA_struct_get_compareflags(oldsdna, newsdna);
+  DNA_ReconstructInfo *reconstruct_info = DNA_reconstruct_info_create(
+      oldsdna, newsdna, compare_flags, false);
+  void *result = DNA_struct_reconstruct(
+      reconstruct_info, DNA_struct_find_nr(oldsdna, "Foo"), blocks, data);
+  DNA_reconstruct_info_free(reconstruct_info);
+  MEM_freeN((void *)compare_flags);
+  return result;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(dna_genfile, ReconstructChangedMembers)
+{
+  SDNABuilder old_builder(sizeof(void *));
+  old_builder.add_struct("Vec", {{"float", "x"}, {"float", "y"}, {"float", "z"}});
+  old_builder.add_struct("Bar", {{"int", "x"}, {"int", "y"}});
+  old_builder.add_struct("Foo",
+                         {{"int", "a"},
+                          {"char", "name[8]"},
+                          {"short", "s"},
+                          {"short", "flag"},
+                          {"float", "f[3]"},
+                          {"Bar", "bar[2]"},
+                          {"Vec", "co"},
+                          {"float", "removed"},
+                          {"void", "*p"},
+                          {"void", "*ptrs[2]"},
+                          {"char", "c"}});
+  SDNA *oldsdna = old_builder.build();
+
+  SDNABuilder new_builder(sizeof(void *));
+  new_builder.add_struct("Vec", {{"float", "x"}, {"float", "y"}, {"float", "z"}});
+  new_builder.add_struct("Bar", {{"int", "y"}, {"int", "x"}, {"int", "z"}});
+  new_builder.add_struct("Foo",
+                         {{"void", "*p"},
+                          {"float", "a"},
+                          {"char", "name[4]"},
+                          {"short", "s"},
+                          {"char", "_pad0[2]"},
+                          {"float", "f[4]"},
+                          {"Bar", "bar[3]"},
+                          {"Vec", "co"},
+                          {"int", "added"},
+                          {"float", "c"},
+                          {"char", "_pad1[4]"},
+                          {"void", "*ptrs[2]"}});
+  SDNA *newsdna = new_builder.build();
+  ASSERT_NE(oldsdna, (SDNA *)NULL);
+  ASSERT_NE(newsdna, (SDNA *)NULL);
+
+  const int blocks = 3;
+  const int old_size = struct_size(oldsdna, "Foo");
+  const int new_size = struct_size(newsdna, "Foo");
+  const int bar_offset = DNA_elem_offset(oldsdna, "Foo", "Bar", "bar[]");
+  const int co_offset = DNA_elem_offset(oldsdna, "Foo", "Vec", "co");
+
+  char *old_data = (char *)MEM_callocN(old_size * blocks, __func__);
+  for (int b = 0; b < blocks; b++) {
+    char *data = old_data + b * old_size;
+    elem_set<int>(oldsdna, data, "int", "a", 10 + b);
+    memcpy(data + DNA_elem_offset(oldsdna, "Foo", "char", "name[]"), "abcdefg", 8);
+    elem_set<short>(oldsdna, data, "short", "s", -5 - b);
+    elem_set<short>(oldsdna, data, "short", "flag", 1);
+    const float f[3] = {1.0f, 2.0f, (float)b};
+    memcpy(data + DNA_elem_offset(oldsdna, "Foo", "float", "f[]"), f, sizeof(f));
+    const int bar[2][2] = {{100 + b, 200 + b}, {300 + b, 400 + b}};
+    memcpy(data + bar_offset, bar, sizeof(bar));
+    const float co[3] = {0.5f, -0.5f, (float)b};
+    memcpy(data + co_offset, co, sizeof(co));
+    elem_set<float>(oldsdna, data, "float", "removed", 7.0f);
+    elem_set<void *>(oldsdna, data, "void", "*p", (void *)(intptr_t)(0x1000 + b));
+    void *ptrs[2] = {(void *)0x2000, (void *)(intptr_t)(0x3000 + b)};
+    memcpy(data + DNA_elem_offset(oldsdna, "Foo", "void", "*ptrs[]"), ptrs, sizeof(ptrs));
+    elem_set<char>(oldsdna, data, "char", "c", 51);
+  }
+
+  char *new_data = (char *)reconstruct(oldsdna, newsdna, blocks, old_data);
+  ASSERT_NE(new_data, (char *)NULL);
+  EXPECT_EQ(MEM_allocN_len(new_data), (size_t)(new_size * blocks));
+
+  for (int b = 0; b < blocks; b++) {
+    const char *data = new_data + b * new_size;
+    EXPECT_EQ(elem_get<void *>(newsdna, data, "void", "*p"), (void *)(intptr_t)(0x1000 + b));
+    EXPECT_EQ(elem_get<float>(newsdna, data, "float", "a"), (float)(10 + b));
+    /* Truncated strings are null terminated. */
+    EXPECT_STREQ(data + DNA_elem_offset(newsdna, "Foo", "char", "name[]"), "abc");
+    EXPECT_EQ(elem_get<short>(newsdna, data, "short", "s"), -5 - b);
+
+    float f[4];
+    memcpy(f, data + DNA_elem_offset(newsdna, "Foo", "float", "f[]"), sizeof(f));
+    EXPECT_EQ(f[0], 1.0f);
+    EXPECT_EQ(f[1], 2.0f);
+    EXPECT_EQ(f[2], (float)b);
+    EXPECT_EQ(f[3], 0.0f);
+
+    /* Members of the nested struct are reordered, new array items are zero initialized. */
+    int bar[3][3];
+    memcpy(bar, data + DNA_elem_offset(newsdna, "Foo", "Bar", "bar[]"), sizeof(bar));
+    EXPECT_EQ(bar[0][0], 200 + b);
+    EXPECT_EQ(bar[0][1], 100 + b);
+    EXPECT_EQ(bar[0][2], 0);
+    EXPECT_EQ(bar[1][0], 400 + b);
+    EXPECT_EQ(bar[1][1], 300 + b);
+    EXPECT_EQ(bar[1][2], 0);
+    EXPECT_EQ(bar[2][0], 0);
+    EXPECT_EQ(bar[2][1], 0);
+    EXPECT_EQ(bar[2][2], 0);
+
+    float co[3];
+    memcpy(co, data + DNA_elem_offset(newsdna, "Foo", "Vec", "co"), sizeof(co));
+    EXPECT_EQ(co[0], 0.5f);
+    EXPECT_EQ(co[1], -0.5f);
+    EXPECT_EQ(co[2], (float)b);
+
+    EXPECT_EQ(elem_get<int>(newsdna, data, "int", "added"), 0);
+    /* Converting from char to float divides by 255. */
+    EXPECT_FLOAT_EQ(elem_get<float>(newsdna, data, "float", "c"), 0.2f);
+
+    void *ptrs[2];
+    memcpy(ptrs, data + DNA_elem_offset(newsdna, "Foo", "void", "*ptrs[]"), sizeof(ptrs));
+    EXPECT_EQ(ptrs[0], (void *)0x2000);
+    EXPECT_EQ(ptrs[1], (void *)(intptr_t)(0x3000 + b));
+  }
+
+  MEM_freeN(new_data);
+  MEM_freeN(old_data);
+  DNA_sdna_free(newsdna);
+  DNA_sdna_free(oldsdna);
+}
+
+TEST(dna_genfile, ReconstructPointerSize)
+{
+  const SDNABuilder::Members members = {{"void", "*p"}, {"int", "i"}, {"void", "*ptrs[2]"}};
+
+  SDNABuilder builder_32(4);
+  builder_32.add_struct("Foo", members);
+  SDNA *sdna_32 = builder_32.build();
+  SDNABuilder builder_64(8);
+  builder_64.add_struct("Foo", members);
+  SDNA *sdna_64 = builder_64.build();
+
+  const int blocks = 2;
+  int data_32[blocks][4] = {{0x10, 1, 0x20, 0x30}, {0x40, 2, 0x50, 0x60}};
+
+  /* 32 to 64 bit. */
+  int64_t *result_64 = (int64_t *)reconstruct(sdna_32, sdna_64, blocks, data_32);
+  ASSERT_NE(result_64, (int64_t *)NULL);
+  for (int b = 0; b < blocks; b++) {
+    char *data = (char *)result_64 + b * struct_size(sdna_64, "Foo");
+    EXPECT_EQ(elem_get<int64_t>(sdna_64, data, "void", "*p"), data_32[b][0]);
+    EXPECT_EQ(elem_get<int>(sdna_64, data, "int", "i"), data_32[b][1]);
+    int64_t ptrs[2];
+    memcpy(ptrs, data + DNA_elem_offset(sdna_64, "Foo", "void", "*ptrs[]"), sizeof(ptrs));
+    EXPECT_EQ(ptrs[0], data_32[b][2]);
+    EXPECT_EQ(ptrs[1], data_32[b][3]);
+  }
+
+  /* 64 to 32 bit, pointers are shifted to keep them unique. */
+  int *result_32 = (int *)reconstruct(sdna_64, sdna_32, blocks, result_64);
+  ASSERT_NE(result_32, (int *)NULL);
+  for (int b = 0; b < blocks; b++) {
+    EXPECT_EQ(result_32[b * 4 + 0], data_32[b][0] >> 3);
+    EXPECT_EQ(result_32[b * 4 + 1], data_32[b][1]);
+    EXPECT_EQ(result_32[b * 4 + 2], data_32[b][2] >> 3);
+    EXPECT_EQ(result_32[b * 4 + 3], data_32[b][3] >> 3);
+  }
+
+  MEM_freeN(result_32);
+  MEM_freeN(result_64);
+  DNA_sdna_free(sdna_64);
+  DNA_sdna_free(sdna_32);
+}
+
+TEST(dna_genfile, SwitchEndianBlocks)
+{
+  SDNABuilder builder(8);
+  builder.add_struct("Bar", {{"short", "s[3]"}, {"char", "c"}, {"double", "d"}});
+  builder.add_struct("Foo",
+                     {{"short", "blocktype"},
+                      {"short", "flag"},
+                      {"int", "i[2]"},
+                      {"float", "f"},
+                      {"void", "*p"},
+                      {"Bar", "bar[2]"},
+                      {"uint64_t", "u"}});
+  SDNA *sdna = builder.build();
+  ASSERT_NE(sdna, (SDNA *)NULL);
+
+  const int struct_nr = DNA_struct_find_nr(sdna, "Foo");
+  const int size = struct_size(sdna, "Foo");
+  const int blocks = 5;
+
+  char *data = (char *)MEM_mallocN(size * blocks, __func__);
+  RNG *rng = BLI_rng_new(1);
+  BLI_rng_get_char_n(rng, data, size * blocks);
+  BLI_rng_free(rng);
+
+  char *data_orig = (char *)MEM_dupallocN(data);
+  char *data_expected = (char *)MEM_dupallocN(data);
+  for (int b = 0; b < blocks; b++) {
+    DNA_struct_switch_endian(sdna, struct_nr, data_expected + b * size);
+  }
+
+  const char *compare_flags = DNA_struct_get_compareflags(sdna, sdna);
+  DNA_ReconstructInfo *reconstruct_info = DNA_reconstruct_info_create(
+      sdna, sdna, compare_flags, true);
+  DNA_struct_switch_endian_blocks(reconstruct_info, struct_nr, blocks, data);
+  EXPECT_EQ(memcmp(data, data_expected, size * blocks), 0);
+
+  /* The "blocktype" member is never switched. */
+  for (int b = 0; b < blocks; b++) {
+    EXPECT_EQ(memcmp(data + b * size, data_orig + b * size, sizeof(short)), 0);
+  }
+
+  DNA_reconstruct_info_free(reconstruct_info);
+  MEM_freeN((void *)compare_flags);
+  MEM_freeN(data_expected);
+  MEM_freeN(data_orig);
+  MEM_freeN(data);
+  DNA_sdna_free(sdna);
+}
@@ -0,0 +1,159 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __DNA_SDNA_BUILDER_H__
+#define __DNA_SDNA_BUILDER_H__
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "DNA_genfile.h"
+#include "DNA_sdna_types.h"
+#include "MEM_guardedalloc.h"
+}
+
+/**
+ * Builds encoded SDNA data (as written by makesdna) from struct definitions,
+ * so tests can simulate files saved by other versions of Blender.
+ *
+ * Structs have to be added after the structs they contain.
+ */
+class SDNABuilder {
+ public:
+  typedef std::vector<std::pair<std::string, std::string>> Members;
+
+  explicit SDNABuilder(int pointer_size) : pointer_size_(pointer_size)
+  {
+    /* Same order as #eSDNA_Type. */
+    const std::pair<const char *, short> primitives[] = {
+        {"char", 1},
+        {"uchar", 1},
+        {"short", 2},
+        {"ushort", 2},
+        {"int", 4},
+        {"long", 4},
+        {"ulong", 4},
+        {"float", 4},
+        {"double", 8},
+        {"void", 0},
+        {"int64_t", 8},
+        {"uint64_t", 8},
+    };
+    for (const auto &primitive : primitives) {
+      types_.push_back(primitive.first);
+      types_size_.push_back(primitive.second);
+    }
+    /* Required to detect the pointer size. */
+    add_struct("ListBase", {{"void", "*first"}, {"void", "*last"}});
+  }
+
+  void add_struct(const std::string &type, const Members &members)
+  {
+    const short type_nr = type_find_or_add(type);
+    std::vector<short> struct_info = {type_nr, (short)members.size()};
+    int size = 0;
+    for (const auto &member : members) {
+      const short member_type_nr = type_find_or_add(member.first);
+      struct_info.push_back(member_type_nr);
+      struct_info.push_back(name_find_or_add(member.second));
+      size += elem_size(member_type_nr, member.second);
+    }
+    types_size_[type_nr] = size;
+    structs_.push_back(struct_info);
+  }
+
+  SDNA *build() const
+  {
+    std::string data = "SDNANAME";
+    append_int(data, names_.size());
+    for (const std::string &name : names_) {
+      data.append(name.c_str(), name.size() + 1);
+    }
+    pad_4(data);
+
+    data += "TYPE";
+    append_int(data, types_.size());
+    for (const std::string &type : types_) {
+      data.append(type.c_str(), type.size() + 1);
+    }
+    pad_4(data);
+
+    data += "TLEN";
+    for (short size : types_size_) {
+      append_short(data, size);
+    }
+    pad_4(data);
+
+    data += "STRC";
+    append_int(data, structs_.size());
+    for (const std::vector<short> &struct_info : structs_) {
+      for (short value : struct_info) {
+        append_short(data, value);
+      }
+    }
+
+    void *data_alloc = MEM_mallocN(data.size(), __func__);
+    memcpy(data_alloc, data.data(), data.size());
+    const char *error_message = NULL;
+    return DNA_sdna_from_data(data_alloc, data.size(), false, true, &error_message);
+  }
+
+ private:
+  int pointer_size_;
+  std::vector<std::string> names_;
+  std::vector<std::string> types_;
+  std::vector<short> types_size_;
+  std::vector<std::vector<short>> structs_;
+
+  short type_find_or_add(const std::string &type)
+  {
+    for (size_t i = 0; i < types_.size(); i++) {
+      if (types_[i] == type) {
+        return (short)i;
+      }
+    }
+    types_.push_back(type);
+    types_size_.push_back(0);
+    return (short)(types_.size() - 1);
+  }
+
+  short name_find_or_add(const std::string &name)
+  {
+    for (size_t i = 0; i < names_.size(); i++) {
+      if (names_[i] == name) {
+        return (short)i;
+      }
+    }
+    names_.push_back(name);
+    return (short)(names_.size() - 1);
+  }
+
+  int elem_size(short type_nr, const std::string &name) const
+  {
+    int array_len = 1;
+    for (size_t i = name.find('['); i != std::string::npos; i = name.find('[', i + 1)) {
+      array_len *= atoi(name.c_str() + i + 1);
+    }
+    const bool is_pointer = (name[0] == '*' || name[0] == '(');
+    return (is_pointer ? pointer_size_ : types_size_[type_nr]) * array_len;
+  }
+
+  static void append_int(std::string &data, int value)
+  {
+    data.append((const char *)&value, sizeof(value));
+  }
+
+  static void append_short(std::string &data, short value)
+  {
+    data.append((const char *)&value, sizeof(value));
+  }
+
+  static void pad_4(std::string &data)
+  {
+    data.append((4 - (data.size() & 3)) & 3, '\0');
+  }
+};
+
+#endif /* __DNA_SDNA_BUILDER_H__ */